@@ -26,7 +26,20 @@ module ACC #(
     parameter C_S_AXI_ADDR_WIDTH = 32,
     //Master Interface Widths
     parameter C_M_AXI_DATA_WIDTH = 32,
-    parameter C_M_AXI_ADDR_WIDTH = 32
+    parameter C_M_AXI_ADDR_WIDTH = 32,
+    parameter C_M_AXI_MAX_BURST  = 256,   // longest AXI4 INCR burst on the master port
+    //Result write-combining
+    parameter WC_DEPTH      = 32,         // FIFO entries; also the longest result burst (<= C_M_AXI_MAX_BURST)
+    parameter WC_FLUSH_IDLE = 8,          // cycles without a new result before a partial burst is written
+    //Weight bank
+    parameter WBANK_AW      = 12,         // log2 of the number of 9-byte filter slots
+    //Processing elements
+    parameter PE_PARALLEL   = 0,          // 0: serial PE.v (9 cycles per op), 1: PE_PAR (all 9 bytes in one cycle)
+    parameter PE_LANES      = 9,          // PE_PAR multipliers per PE; ceil(9 / PE_LANES) cycles per op
+    //GEMV engine
+    parameter GEMV_XBUF_AW  = 12,         // log2 of the on-chip input chunk in words
+    parameter GEMV_MAX_ROWS = 128,        // accumulators per input vector, i.e. longest output vector
+    parameter GEMV_BATCH_AW = 2           // log2 of the input vectors one run multiplies (>= 1)
 )(
     // Global signals
     input  wire                           ACLK,
@@ -66,6 +79,9 @@ module ACC #(
     // AXI_MST interface
     // Write Address Channel
     output wire [C_M_AXI_ADDR_WIDTH-1:0]  M_AXI_AWADDR,
+    output wire [7:0]                     M_AXI_AWLEN,
+    output wire [2:0]                     M_AXI_AWSIZE,
+    output wire [1:0]                     M_AXI_AWBURST,
     output wire [2:0]                     M_AXI_AWPROT,
     output wire                           M_AXI_AWVALID,
     input  wire                           M_AXI_AWREADY,
@@ -73,6 +89,7 @@ module ACC #(
     // Write Data Channel
     output wire [C_M_AXI_DATA_WIDTH-1:0]  M_AXI_WDATA,
     output wire [(C_M_AXI_DATA_WIDTH/8)-1:0] M_AXI_WSTRB,
+    output wire                           M_AXI_WLAST,
     output wire                           M_AXI_WVALID,
     input  wire                           M_AXI_WREADY,
     
@@ -83,6 +100,9 @@ module ACC #(
     
     // Read Address Channel
     output wire [C_M_AXI_ADDR_WIDTH-1:0]  M_AXI_ARADDR,
+    output wire [7:0]                     M_AXI_ARLEN,
+    output wire [2:0]                     M_AXI_ARSIZE,
+    output wire [1:0]                     M_AXI_ARBURST,
     output wire [2:0]                     M_AXI_ARPROT,
     output wire                           M_AXI_ARVALID,
     input  wire                           M_AXI_ARREADY,
@@ -90,6 +110,7 @@ module ACC #(
     // Read Data Channel
     input  wire [C_M_AXI_DATA_WIDTH-1:0]  M_AXI_RDATA,
     input  wire [1:0]                     M_AXI_RRESP,
+    input  wire                           M_AXI_RLAST,
     input  wire                           M_AXI_RVALID,
     output wire                           M_AXI_RREADY
 );
@@ -107,13 +128,57 @@ module ACC #(
     wire [C_S_AXI_DATA_WIDTH-1:0]   reg_read_data;     // Read data
 
     //singals from axi master interface
-    reg                            ip_start_transaction;
+    wire                            ip_start_transaction;
     wire                            ip_transaction_type;  // 0: read, 1: write
-    reg [C_M_AXI_ADDR_WIDTH-1:0]   ip_address;
-    reg [C_M_AXI_DATA_WIDTH-1:0]   ip_write_data;
+    wire [C_M_AXI_ADDR_WIDTH-1:0]   ip_address;
+    wire [7:0]                      ip_burst_len;
+    wire [C_M_AXI_DATA_WIDTH-1:0]   ip_write_data;
+    wire                            ip_write_next;
     wire [C_M_AXI_DATA_WIDTH-1:0]   ip_read_data;
     wire                            ip_read_data_valid;
     wire                            ip_transaction_done;
+    wire                            ip_write_done;
+    wire                            ip_read_done;
+
+    // Register map: addr[6] = 0 selects the operand buffers (0x00-0x2C),
+    // addr[6] = 1 the descriptor ring registers (0x40-0x54), PASSES (0x58),
+    // the weight bank registers (0x5C-0x64) and the GEMV engine (0x68-0x7C).
+    // addr[7] = 1 selects the performance counters (0x80-0xA0).
+    wire buf_write_enable = reg_write_enable && !reg_write_addr[7] && !reg_write_addr[6];
+    wire dma_reg_write    = reg_write_enable && !reg_write_addr[7] && reg_write_addr[6];
+    wire perf_reg_write   = reg_write_enable && reg_write_addr[7];
+    wire [31:0] perf_read_data;
+
+    // Result write-back
+    reg                            result_req;        // PE selected by out_flag waits for the write FIFO
+    wire                           result_push;       // its result enters the FIFO this cycle
+    reg [C_M_AXI_ADDR_WIDTH-1:0]   result_address;    // free-running pointer for register-fed ops
+    reg [2:0]                      out_sel;           // PE selected by out_flag
+    wire [C_M_AXI_ADDR_WIDTH-1:0]  push_addr;         // where the pushed result goes
+    wire [C_M_AXI_DATA_WIDTH-1:0]  push_data;
+
+    // Write-combining FIFO. Results are queued with their address; runs of
+    // consecutive addresses (never crossing a 4 KB boundary) are written back
+    // as one INCR burst. Run bookkeeping lives in a second FIFO of
+    // {start address, beats - 1}; the newest run stays open for extension.
+    localparam WC_PTR_W = (WC_DEPTH > 128) ? 8 : (WC_DEPTH > 64) ? 7 : (WC_DEPTH > 32) ? 6 :
+                          (WC_DEPTH > 16) ? 5 : (WC_DEPTH > 8) ? 4 : 3;
+    reg [C_M_AXI_DATA_WIDTH-1:0]   wc_data [0:WC_DEPTH-1];
+    reg [WC_PTR_W-1:0]             wc_wr_ptr, wc_rd_ptr;
+    reg [WC_PTR_W:0]               wc_count;
+    reg [C_M_AXI_ADDR_WIDTH-1:0]   run_addr [0:WC_DEPTH-1];
+    reg [7:0]                      run_len [0:WC_DEPTH-1];
+    reg [WC_PTR_W-1:0]             run_wr_ptr, run_rd_ptr;
+    reg [WC_PTR_W:0]               run_count;
+    reg                            run_open;          // newest run may still grow
+    reg [C_M_AXI_ADDR_WIDTH-1:0]   run_next_addr;     // address that would extend it
+    reg [7:0]                      wc_idle;           // cycles since the last push
+    reg                            wc_busy;           // burst issued, response not yet received
+
+    // Operands reach the PEs one byte per cycle for nine cycles (serial PE),
+    // or all nine bytes in a single cycle (PE_PAR).
+    localparam FEED_LAST = PE_PARALLEL ? 4'd1 : 4'd9;                  // last buffer_counter value of an op
+    localparam PE_COOL   = PE_PARALLEL ? (9 + PE_LANES - 1) / PE_LANES - 1 : 9;  // idle cycles a PE needs after its feed
 
     reg [7:0] w_buffer1 [11:0];
     reg [7:0] a_buffer1 [11:0];
@@ -123,7 +188,7 @@ module ACC #(
     reg [3:0] buffer_counter;
     reg pp_counter;     //0 for buffer1; 0 for buffer2
     
-    wire [7:0] a,b;
+    wire [71:0] a,b;
     wire [255:0] c;
     wire [7:0] in_valid;
     reg [7:0] store;
@@ -132,6 +197,195 @@ module ACC #(
     wire [7:0] out_valid;
     reg [7:0] out_resp;
 
+    // Descriptor ring engine (firmware side: Microblaze/acc_dma.h).
+    // A descriptor is eight words in DDR:
+    //   0 input address   1 weight address   2 result address
+    //   3 {inner count[31:16], outer count[15:0]}
+    //   4 input outer stride   5 input inner stride
+    //   6 weight outer stride  7 weight inner stride
+    // For every (outer, inner) pair PASSES (register 0x58, latched per
+    // descriptor) 3x3 MACs run on one PE, on the 9 input and 9 weight bytes
+    // at pass * 9 (any byte alignment), and the PE's accumulated sum is
+    // written to the next word at the result address.
+    // In bank mode (RING_CTRL bit 2) the weight address and strides count
+    // weight bank slots instead of bytes, and pass p uses the slot
+    // p * inner count further on, i.e. a tile is stored [pass][inner].
+    localparam DMA_IDLE    = 4'd0;
+    localparam DMA_DESC    = 4'd1;   // fetch the eight descriptor words
+    localparam DMA_START   = 4'd2;   // load loop state
+    localparam DMA_OP      = 4'd3;   // decide which operands must be fetched
+    localparam DMA_FETCH_W = 4'd4;   // three words around the weight bytes
+    localparam DMA_FETCH_A = 4'd5;   // three words around the input bytes
+    localparam DMA_WAIT_PE = 4'd6;   // target PE must have written its last result
+    localparam DMA_FEED    = 4'd7;   // operands into the PE (nine cycles, one with PE_PAR)
+    localparam DMA_NEXT    = 4'd8;   // advance the loop counters
+    localparam DMA_DRAIN   = 4'd9;   // wait for the descriptor's last results
+    localparam DMA_BANK    = 4'd10;  // weight bytes from the bank slot
+
+    reg [3:0]  dma_state;
+    reg        dma_enable;
+    reg [31:0] dma_ring_base;
+    reg [15:0] dma_ring_size;
+    reg [15:0] dma_slot;             // ring entry of the next descriptor
+    reg [31:0] dma_tail;             // doorbell: descriptors submitted (free running)
+    reg [31:0] dma_head;             // completion: descriptors finished (free running)
+    reg [31:0] desc [0:7];
+    reg [2:0]  desc_word;
+
+    reg        dma_rd_req;           // read waiting for the AXI master
+    reg        dma_rd_pending;       // read issued, waiting for ip_read_done
+    reg [31:0] dma_rd_addr;
+    reg [7:0]  dma_rd_len;           // beats - 1
+    reg [1:0]  fetch_word;
+    reg [31:0] fetch_buf0, fetch_buf1;
+
+    reg [15:0] outer_idx, inner_idx;
+    reg [31:0] in_row, in_cur, w_row, w_cur, out_cur;
+    reg [15:0] acc_passes;           // PASSES register, shared with register-fed ops
+    reg [15:0] dma_passes;           // latched for the running descriptor
+    reg [15:0] pass_idx;
+    reg [31:0] in_pass_off;          // pass_idx * 9
+    reg [31:0] w_pass_off;           // pass_idx * 9, or pass_idx * inner count slots in bank mode
+    reg        dma_wbank;            // RING_CTRL bit 2: weight addresses are bank slots
+    reg [3:0]  pe_cool [0:7];        // cycles until a PE may take its next op
+    reg [31:0] in_cached, w_cached;
+    reg        in_cache_valid, w_cache_valid;
+    reg [7:0]  dma_a_bytes [0:8];
+    reg [7:0]  dma_w_bytes [0:8];
+    reg [3:0]  dma_feed_count;
+    reg [2:0]  dma_pe;
+    reg [7:0]  pe_dma;               // PE holds (or is computing) a descriptor result
+    reg [31:0] pe_addr [0:7];        // where that result goes
+    reg [31:0] dma_pending;          // descriptor results not yet written
+
+    // GEMV engine (0x68-0x7C), see the section below.
+    localparam GEMV_XBUF_WORDS = 1 << GEMV_XBUF_AW;
+    localparam GEMV_MAX_BATCH = 1 << GEMV_BATCH_AW;
+    localparam GEMV_SLICE_AW = GEMV_XBUF_AW - GEMV_BATCH_AW;   // xbuf share of one input vector
+    localparam GEMV_SLICE_WORDS = 1 << GEMV_SLICE_AW;
+    localparam G_IDLE  = 3'd0;
+    localparam G_CHUNK = 3'd1;  // size the next input chunk
+    localparam G_X     = 3'd2;  // load the input chunk into xbuf
+    localparam G_W     = 3'd3;  // stream the chunk's slice of every weight row
+    localparam G_ROWS  = 3'd4;  // wait for the MAC pipeline to commit the last row
+    localparam G_WB    = 3'd5;  // push the accumulators into the write FIFO
+    localparam G_DONE  = 3'd6;  // wait until they are in DDR
+
+    reg [2:0]  gemv_state;
+    reg [31:0] gemv_w, gemv_x, gemv_y;   // weight matrix, input vector, result vector
+    reg [15:0] gemv_rows;
+    reg [7:0]  gemv_batch;               // input vectors, 0 meaning 1
+    reg [31:0] gemv_cols;                // bytes per row, a multiple of 4
+    reg        gemv_rd_req, gemv_rd_pending;
+    reg [31:0] gemv_rd_addr;
+    reg [7:0]  gemv_rd_len;
+    reg [31:0] gemv_addr;                // next byte the current stream reads
+    reg [12:0] gemv_left;                // words of the current stream not yet requested
+    reg [31:0] gemv_x_off;               // byte offset of the current input chunk
+    reg [12:0] gemv_chunk;               // words in the current input chunk
+    reg [7:0]  gemv_xb;                  // input vector whose chunk is being loaded
+    reg [31:0] gemv_x_base;              // ... and where that chunk starts
+    reg [31:0] gemv_row_addr;            // weight row of the current stream
+    reg [15:0] gemv_row;                 // row being streamed
+    reg [15:0] gemv_row_c;               // row the MAC pipeline commits next
+    reg [12:0] gemv_x_word, gemv_w_word;
+    reg [15:0] gemv_wb_idx;              // accumulator and lane being written back
+    reg [7:0]  gemv_wb_lane;
+    reg [31:0] gemv_wb_addr;
+    wire [32*GEMV_MAX_BATCH-1:0] gemv_acc_q;   // accumulator gemv_wb_idx of every lane
+    wire       gemv_push;
+
+    wire dma_feeding = (dma_state == DMA_FEED);
+    // The first pass of a result needs a PE whose previous result has left;
+    // later passes go back to the same PE once its pipeline has drained.
+    wire dma_issue   = (dma_state == DMA_WAIT_PE) && (pe_cool[dma_pe] == 0) && (buffer_counter == 0) &&
+                       ((pass_idx != 0) || (!pe_dma[dma_pe] && !out_valid[dma_pe]));
+    wire dma_issue_first = dma_issue && (pass_idx == 0);
+    wire [31:0] op_in = in_cur + in_pass_off;
+    wire [31:0] op_w  = w_cur + w_pass_off;
+    wire pass_reset = dma_reg_write && (reg_write_addr[5:2] == 'd6);
+    wire dma_retire  = |(out_resp & pe_dma);
+    wire wc_issue;                   // write-back burst starts this cycle
+    wire wc_idle_all = (wc_count == 0) && !wc_busy;
+    wire dma_rd_fire = dma_rd_req && !wc_issue && !gemv_rd_pending;   // result writes have priority
+    wire gemv_rd_fire = gemv_rd_req && !wc_issue && !dma_rd_req && !dma_rd_pending;
+    wire [95:0] fetch_window = {ip_read_data, fetch_buf1, fetch_buf0};
+    wire [31:0] fetch_addr = {(dma_state == DMA_FETCH_W) ? op_w[31:2] : op_in[31:2], 2'b00}
+                             + {fetch_word, 2'b00};
+    wire wc_push;                    // a PE result or a GEMV accumulator enters the FIFO
+
+    // Weight bank (0x5C-0x64). 2^WBANK_AW filter slots of 9 bytes, loaded by
+    // the firmware once per model through WBANK_ADDR/WBANK_DATA (three data
+    // writes per slot: bytes 0-3, 4-7, 8). A control word with bit 26 set
+    // takes its weights from the next slot of the WBANK_SEQ sequence
+    // {count[31:16], start[15:0]} instead of the filter registers, so only
+    // the input words are written per op. The descriptor engine reads slots
+    // directly in bank mode. Slots are written only while the array is idle.
+    localparam WBANK_DEPTH = 1 << WBANK_AW;
+    reg [71:0]          wbank [0:WBANK_DEPTH-1];
+    reg [71:0]          wbank_qa;            // port A: load / descriptor engine
+    reg [71:0]          wbank_qb;            // port B: register-fed sequence
+    reg [WBANK_AW-1:0]  wbank_ptr;           // slot the next WBANK_DATA triple goes to
+    reg [1:0]           wbank_word;
+    reg [31:0]          wbank_lo, wbank_mid;
+    reg [15:0]          wbank_start, wbank_count, wbank_idx;
+
+    wire wbank_we    = dma_reg_write && (reg_write_addr[5:2] == 'd8) && (wbank_word == 2'd2);
+    wire wbank_fill1 = buf_write_enable && (reg_write_addr[5:2] == 'd5) && reg_write_data[26];
+    wire wbank_fill2 = buf_write_enable && (reg_write_addr[5:2] == 'd11) && reg_write_data[26];
+    wire [WBANK_AW-1:0] wbank_addr_a = wbank_we ? wbank_ptr : op_w[WBANK_AW-1:0];
+    wire [WBANK_AW-1:0] wbank_addr_b = wbank_start[WBANK_AW-1:0] + wbank_idx[WBANK_AW-1:0];
+
+    always @(posedge ACLK) begin
+        if (wbank_we) wbank[wbank_ptr] <= {reg_write_data[7:0], wbank_mid, wbank_lo};
+        wbank_qa <= wbank[wbank_addr_a];
+    end
+
+    // The sequence slot only moves on a control write, so wbank_qb is valid
+    // by the next one (register writes are several cycles apart).
+    always @(posedge ACLK) begin
+        wbank_qb <= wbank[wbank_addr_b];
+    end
+
+    always @(posedge ACLK or negedge ARESETN) begin
+        if (!ARESETN) begin
+            wbank_ptr <= 0;
+            wbank_word <= 2'd0;
+            wbank_lo <= 32'b0;
+            wbank_mid <= 32'b0;
+            wbank_start <= 16'b0;
+            wbank_count <= 16'b0;
+            wbank_idx <= 16'b0;
+        end else begin
+            if (dma_reg_write) begin
+                case (reg_write_addr[5:2])
+                    'd7: begin                                        // WBANK_ADDR
+                        wbank_ptr <= reg_write_data[WBANK_AW-1:0];
+                        wbank_word <= 2'd0;
+                    end
+                    'd8: begin                                        // WBANK_DATA
+                        if (wbank_word == 2'd0) wbank_lo <= reg_write_data;
+                        if (wbank_word == 2'd1) wbank_mid <= reg_write_data;
+                        if (wbank_word == 2'd2) begin
+                            wbank_word <= 2'd0;
+                            wbank_ptr <= wbank_ptr + 1;
+                        end else begin
+                            wbank_word <= wbank_word + 1;
+                        end
+                    end
+                    'd9: begin                                        // WBANK_SEQ
+                        wbank_start <= reg_write_data[15:0];
+                        wbank_count <= reg_write_data[31:16];
+                        wbank_idx <= 16'b0;
+                    end
+                endcase
+            end
+            if (wbank_fill1 || wbank_fill2) begin
+                wbank_idx <= (wbank_idx + 1 >= wbank_count) ? 16'b0 : wbank_idx + 1;
+            end
+        end
+    end
+
 //////////////////////////////////////////////////////////from AXI slave signals
     integer i;
     always @(posedge ACLK or negedge ARESETN) begin
@@ -140,7 +394,7 @@ module ACC #(
                 w_buffer1[i] = 0;  
             end
         end else begin
-            if (reg_write_enable) begin
+            if (buf_write_enable) begin
                 case(reg_write_addr[5:2])
                     4'b0000: begin 
                             {w_buffer1[3], w_buffer1[2], w_buffer1[1], w_buffer1[0]} <= reg_write_data;
@@ -152,6 +406,10 @@ module ACC #(
                             {w_buffer1[11], w_buffer1[10], w_buffer1[9], w_buffer1[8]} <= reg_write_data;
                         end
                 endcase
+                if (wbank_fill1) begin
+                    {w_buffer1[8], w_buffer1[7], w_buffer1[6], w_buffer1[5], w_buffer1[4],
+                     w_buffer1[3], w_buffer1[2], w_buffer1[1], w_buffer1[0]} <= wbank_qb;
+                end
             end
         end
     end
@@ -162,7 +420,7 @@ module ACC #(
                 a_buffer1[i] = 0;  
             end
         end else begin
-            if (reg_write_enable) begin
+            if (buf_write_enable) begin
                 case(reg_write_addr[5:2])
                     'd3: begin 
                             {a_buffer1[3], a_buffer1[2], a_buffer1[1], a_buffer1[0]} <= reg_write_data;
@@ -174,10 +432,11 @@ module ACC #(
                             {a_buffer1[11], a_buffer1[10], a_buffer1[9], a_buffer1[8]} <= reg_write_data;
                         end
                 endcase
-                
-                if (buffer_counter != 0 && !pp_counter) begin
-                    a_buffer1[11][0] <= 0;
-                end 
+            end
+            // The op has started: drop its enable even if no register write
+            // arrives while it runs (banked ops leave long gaps between writes).
+            if (buffer_counter != 0 && !pp_counter) begin
+                a_buffer1[11][0] <= 0;
             end
         end
     end
@@ -188,7 +447,7 @@ module ACC #(
                 w_buffer2[i] = 0;  
             end
         end else begin
-            if (reg_write_enable) begin
+            if (buf_write_enable) begin
                 case(reg_write_addr[5:2])
                     'd6: begin 
                             {w_buffer2[3], w_buffer2[2], w_buffer2[1], w_buffer2[0]} <= reg_write_data;
@@ -200,6 +459,10 @@ module ACC #(
                             {w_buffer2[11], w_buffer2[10], w_buffer2[9], w_buffer2[8]} <= reg_write_data;
                         end
                 endcase
+                if (wbank_fill2) begin
+                    {w_buffer2[8], w_buffer2[7], w_buffer2[6], w_buffer2[5], w_buffer2[4],
+                     w_buffer2[3], w_buffer2[2], w_buffer2[1], w_buffer2[0]} <= wbank_qb;
+                end
             end
         end
     end
@@ -210,7 +473,7 @@ module ACC #(
                 a_buffer2[i] = 0;  
             end
         end else begin
-            if (reg_write_enable) begin
+            if (buf_write_enable) begin
                 case(reg_write_addr[5:2])
                     'd9: begin 
                             {a_buffer2[3], a_buffer2[2], a_buffer2[1], a_buffer2[0]} <= reg_write_data;
@@ -222,10 +485,9 @@ module ACC #(
                             {a_buffer2[11], a_buffer2[10], a_buffer2[9], a_buffer2[8]} <= reg_write_data;
                         end
                 endcase
-                
-                if (buffer_counter != 0 && pp_counter) begin
-                    a_buffer2[11][0] <= 0;
-                end 
+            end
+            if (buffer_counter != 0 && pp_counter) begin
+                a_buffer2[11][0] <= 0;
             end
         end
     end
@@ -234,7 +496,7 @@ module ACC #(
         if(!ARESETN) begin
             pp_counter <= 'd0;
         end else begin
-            if (buffer_counter == 'd9) begin
+            if (buffer_counter == FEED_LAST) begin
                 pp_counter <= !pp_counter;
             end
         end
@@ -248,7 +510,7 @@ module ACC #(
         end else begin
             case (buffer_counter)
                 'd0: if ((a_buffer1[11][0] == 'd1 && !pp_counter) || (a_buffer2[11][0] == 'd1 && pp_counter)) buffer_counter <= 'd1;
-                'd1: buffer_counter <= 'd2;
+                'd1: buffer_counter <= PE_PARALLEL ? 'd0 : 'd2;
                 'd2: buffer_counter <= 'd3;
                 'd3: buffer_counter <= 'd4;
                 'd4: buffer_counter <= 'd5;
@@ -262,9 +524,27 @@ module ACC #(
         end
     end
     
-    assign a = pp_counter ? a_buffer2[buffer_counter-1] : a_buffer1[buffer_counter-1];
-    assign b = pp_counter ? w_buffer2[buffer_counter-1] : w_buffer1[buffer_counter-1];
-    assign in_valid = (buffer_counter != 0) ? (pp_counter ? a_buffer2[10] : a_buffer1[10]) : 0;
+    // Operands come from the register buffers, or from the descriptor engine while it feeds a PE.
+    wire [7:0] a_byte = dma_feeding ? dma_a_bytes[dma_feed_count] :
+                        (pp_counter ? a_buffer2[buffer_counter-1] : a_buffer1[buffer_counter-1]);
+    wire [7:0] b_byte = dma_feeding ? dma_w_bytes[dma_feed_count] :
+                        (pp_counter ? w_buffer2[buffer_counter-1] : w_buffer1[buffer_counter-1]);
+    wire [71:0] a_word = dma_feeding ? {dma_a_bytes[8], dma_a_bytes[7], dma_a_bytes[6], dma_a_bytes[5], dma_a_bytes[4],
+                                        dma_a_bytes[3], dma_a_bytes[2], dma_a_bytes[1], dma_a_bytes[0]} :
+                         pp_counter  ? {a_buffer2[8], a_buffer2[7], a_buffer2[6], a_buffer2[5], a_buffer2[4],
+                                        a_buffer2[3], a_buffer2[2], a_buffer2[1], a_buffer2[0]} :
+                                       {a_buffer1[8], a_buffer1[7], a_buffer1[6], a_buffer1[5], a_buffer1[4],
+                                        a_buffer1[3], a_buffer1[2], a_buffer1[1], a_buffer1[0]};
+    wire [71:0] b_word = dma_feeding ? {dma_w_bytes[8], dma_w_bytes[7], dma_w_bytes[6], dma_w_bytes[5], dma_w_bytes[4],
+                                        dma_w_bytes[3], dma_w_bytes[2], dma_w_bytes[1], dma_w_bytes[0]} :
+                         pp_counter  ? {w_buffer2[8], w_buffer2[7], w_buffer2[6], w_buffer2[5], w_buffer2[4],
+                                        w_buffer2[3], w_buffer2[2], w_buffer2[1], w_buffer2[0]} :
+                                       {w_buffer1[8], w_buffer1[7], w_buffer1[6], w_buffer1[5], w_buffer1[4],
+                                        w_buffer1[3], w_buffer1[2], w_buffer1[1], w_buffer1[0]};
+    assign a = PE_PARALLEL ? a_word : {64'b0, a_byte};
+    assign b = PE_PARALLEL ? b_word : {64'b0, b_byte};
+    assign in_valid = dma_feeding ? (8'b1 << dma_pe) :
+                      ((buffer_counter != 0) ? (pp_counter ? a_buffer2[10] : a_buffer1[10]) : 0);
     
     always @(posedge ACLK or negedge ARESETN) begin
         if(!ARESETN) begin
@@ -297,24 +577,27 @@ module ACC #(
     end
                 
 ///////////////////////////////////////////////////////////////// to AXI master signals       
+    // Register-fed results use the free-running pointer; descriptor results
+    // carry their own address captured when the op was issued.
     always @(posedge ACLK or negedge ARESETN) begin
         if(!ARESETN) begin
-            ip_address <= 'h87E0_0000;
+            result_address <= 'h87E0_0000;
         end else begin
-            if (ip_start_transaction) begin
-                ip_address <= ip_address + 4;
+            if (result_push && !pe_dma[out_sel]) begin
+                // Free-running result pointer, wraps inside the 2 MB window at 0x87E0_0000
+                result_address <= {result_address[31:21], result_address[20:0] + 21'd4};
             end
         end
     end
     
     always @(posedge ACLK or negedge ARESETN) begin
         if(!ARESETN) begin
-            ip_start_transaction <= 0;
+            result_req <= 0;
         end else begin
             if ((out_flag == 0) && (out_valid != 0)) begin
-                ip_start_transaction <= 1;
-            end else begin
-                ip_start_transaction <= 0;
+                result_req <= 1;
+            end else if (result_push) begin
+                result_req <= 0;
             end
         end
     end
@@ -359,53 +642,744 @@ module ACC #(
         end
     end
     
-    assign ip_transaction_type = 1;
+    // The AXI master is shared: a write-back burst takes the port when one
+    // is issued, descriptor/operand reads and GEMV reads use it otherwise
+    // (one read outstanding at a time).
+    assign ip_start_transaction = wc_issue || dma_rd_fire || gemv_rd_fire;
+    assign ip_transaction_type = wc_issue;
+    assign ip_address = wc_issue ? run_addr[run_rd_ptr] : (dma_rd_fire ? dma_rd_addr : gemv_rd_addr);
+    assign ip_burst_len = wc_issue ? run_len[run_rd_ptr] : (dma_rd_fire ? dma_rd_len : gemv_rd_len);
+    assign ip_write_data = wc_data[wc_rd_ptr];
     
+    // out_flag is one-hot and already holds the PE being written back when
+    // result_req is raised, so data and response are selected by it. The PE
+    // is released as soon as its result is in the FIFO. GEMV accumulators
+    // only enter while no PE result is waiting.
+    assign result_push = result_req && (wc_count != WC_DEPTH);
+    assign wc_push = result_push || gemv_push;
+    assign push_addr = !result_push     ? gemv_wb_addr :
+                       pe_dma[out_sel] ? pe_addr[out_sel] : result_address;
+    assign push_data = result_push ? c[out_sel*32 +: 32] : gemv_acc_q[gemv_wb_lane*32 +: 32];
+
     always @(*) begin
-        // Default assignments
-        ip_write_data = 32'b0;  // Ensure ip_write_data is 32 bits wide
-        out_resp = 8'b0;
-        
-        if (out_valid[0]) begin
-            ip_write_data = c[31:0];    // Access the first 32 bits of c (c1)
-            out_resp[0] = ip_transaction_done;
-        end
-        else if (out_valid[1]) begin
-            ip_write_data = c[63:32];   // Access the next 32 bits of c (c2)
-            out_resp[1] = ip_transaction_done;
-        end
-        else if (out_valid[2]) begin
-            ip_write_data = c[95:64];   // Access the next 32 bits of c (c3)
-            out_resp[2] = ip_transaction_done;
+        case (out_flag)
+            8'b00000010: out_sel = 3'd1;
+            8'b00000100: out_sel = 3'd2;
+            8'b00001000: out_sel = 3'd3;
+            8'b00010000: out_sel = 3'd4;
+            8'b00100000: out_sel = 3'd5;
+            8'b01000000: out_sel = 3'd6;
+            8'b10000000: out_sel = 3'd7;
+            default:     out_sel = 3'd0;
+        endcase
+        out_resp = result_push ? out_flag : 8'b0;
+    end
+
+    // The open run is written once it fills the FIFO, or once no result has
+    // arrived for WC_FLUSH_IDLE cycles while no descriptor is mid-flight
+    // (register-fed results are read back as soon as the result pointer has
+    // passed them and STATUS shows the FIFO drained; descriptor results only
+    // once the descriptor completes).
+    wire run_head_open = run_open && (run_count == 1);
+    wire run_flush = !run_head_open || (run_len[run_rd_ptr] == WC_DEPTH - 1) ||
+                     ((wc_idle >= WC_FLUSH_IDLE) &&
+                      (dma_state == DMA_IDLE || dma_state == DMA_DRAIN));
+    assign wc_issue = !wc_busy && (run_count != 0) && run_flush;
+    wire run_extend = wc_push && run_open && (push_addr == run_next_addr) &&
+                      (push_addr[11:0] != 12'h000) && !(wc_issue && run_head_open) &&
+                      (run_len[(run_wr_ptr == 0) ? WC_DEPTH - 1 : run_wr_ptr - 1] != WC_DEPTH - 1);
+    wire run_new = wc_push && !run_extend;
+
+    integer w;
+    always @(posedge ACLK or negedge ARESETN) begin
+        if (!ARESETN) begin
+            wc_wr_ptr <= 0;
+            wc_rd_ptr <= 0;
+            wc_count <= 0;
+            run_wr_ptr <= 0;
+            run_rd_ptr <= 0;
+            run_count <= 0;
+            run_open <= 1'b0;
+            run_next_addr <= 0;
+            wc_idle <= 8'd0;
+            wc_busy <= 1'b0;
+            for (w = 0; w < WC_DEPTH; w = w + 1) begin
+                wc_data[w] <= 0;
+                run_addr[w] <= 0;
+                run_len[w] <= 8'd0;
+            end
+        end else begin
+            // Result data
+            if (wc_push) begin
+                wc_data[wc_wr_ptr] <= push_data;
+                wc_wr_ptr <= (wc_wr_ptr == WC_DEPTH - 1) ? 0 : wc_wr_ptr + 1;
+                run_next_addr <= push_addr + 4;
+            end
+            if (ip_write_next) begin
+                wc_rd_ptr <= (wc_rd_ptr == WC_DEPTH - 1) ? 0 : wc_rd_ptr + 1;
+            end
+            if (wc_push && !ip_write_next)
+                wc_count <= wc_count + 1;
+            else if (!wc_push && ip_write_next)
+                wc_count <= wc_count - 1;
+
+            // Runs
+            if (run_extend) begin
+                run_len[(run_wr_ptr == 0) ? WC_DEPTH - 1 : run_wr_ptr - 1] <=
+                    run_len[(run_wr_ptr == 0) ? WC_DEPTH - 1 : run_wr_ptr - 1] + 1;
+            end
+            if (run_new) begin
+                run_addr[run_wr_ptr] <= push_addr;
+                run_len[run_wr_ptr] <= 8'd0;
+                run_wr_ptr <= (run_wr_ptr == WC_DEPTH - 1) ? 0 : run_wr_ptr + 1;
+            end
+            if (wc_issue) begin
+                run_rd_ptr <= (run_rd_ptr == WC_DEPTH - 1) ? 0 : run_rd_ptr + 1;
+            end
+            if (run_new && !wc_issue)
+                run_count <= run_count + 1;
+            else if (!run_new && wc_issue)
+                run_count <= run_count - 1;
+            if (run_new)
+                run_open <= 1'b1;
+            else if (wc_issue && run_head_open)
+                run_open <= 1'b0;
+
+            wc_idle <= wc_push ? 8'd0 : ((wc_idle == 8'hFF) ? wc_idle : wc_idle + 1);
+
+            if (wc_issue)
+                wc_busy <= 1'b1;
+            else if (ip_write_done)
+                wc_busy <= 1'b0;
         end
-        else if (out_valid[3]) begin
-            ip_write_data = c[127:96];  // Access the next 32 bits of c (c4)
-            out_resp[3] = ip_transaction_done;
+    end
+
+///////////////////////////////////////////////////////////////// descriptor ring engine
+    // Register reads: the ring registers, the register-fed result pointer
+    // (0x5C, an offset in the 2 MB window) and the performance counters.
+    assign reg_read_data = reg_read_addr[7]           ? perf_read_data :
+                           !reg_read_addr[6]          ? 32'b0 :
+                           (reg_read_addr[5:2] == 'd0) ? dma_ring_base :
+                           (reg_read_addr[5:2] == 'd1) ? {16'b0, dma_ring_size} :
+                           (reg_read_addr[5:2] == 'd2) ? dma_tail :
+                           (reg_read_addr[5:2] == 'd3) ? dma_head :
+                           (reg_read_addr[5:2] == 'd4) ? {29'b0, !wc_idle_all, dma_pending != 0, dma_state != DMA_IDLE} :
+                           (reg_read_addr[5:2] == 'd5) ? {29'b0, dma_wbank, 1'b0, dma_enable} :
+                           (reg_read_addr[5:2] == 'd6) ? {16'b0, acc_passes} :
+                           (reg_read_addr[5:2] == 'd7) ? {11'b0, result_address[20:0]} :
+                           (reg_read_addr[5:2] == 'd15) ? {31'b0, gemv_state != G_IDLE} :
+                           32'b0;
+
+    integer k;
+    always @(posedge ACLK or negedge ARESETN) begin
+        if (!ARESETN) begin
+            dma_state <= DMA_IDLE;
+            dma_enable <= 1'b0;
+            dma_ring_base <= 32'b0;
+            dma_ring_size <= 16'b0;
+            dma_slot <= 16'b0;
+            dma_tail <= 32'b0;
+            dma_head <= 32'b0;
+            desc_word <= 3'd0;
+            dma_rd_req <= 1'b0;
+            dma_rd_pending <= 1'b0;
+            dma_rd_addr <= 32'b0;
+            dma_rd_len <= 8'd0;
+            fetch_word <= 2'd0;
+            fetch_buf0 <= 32'b0;
+            fetch_buf1 <= 32'b0;
+            outer_idx <= 16'b0;
+            inner_idx <= 16'b0;
+            in_row <= 32'b0;
+            in_cur <= 32'b0;
+            w_row <= 32'b0;
+            w_cur <= 32'b0;
+            out_cur <= 32'b0;
+            in_cached <= 32'b0;
+            w_cached <= 32'b0;
+            in_cache_valid <= 1'b0;
+            w_cache_valid <= 1'b0;
+            dma_feed_count <= 4'd0;
+            dma_pe <= 3'd0;
+            acc_passes <= 16'd1;
+            dma_passes <= 16'd1;
+            pass_idx <= 16'b0;
+            in_pass_off <= 32'b0;
+            w_pass_off <= 32'b0;
+            dma_wbank <= 1'b0;
+            pe_dma <= 8'b0;
+            dma_pending <= 32'b0;
+            for (k = 0; k < 8; k = k + 1) begin
+                desc[k] <= 32'b0;
+                pe_addr[k] <= 32'b0;
+                pe_cool[k] <= 4'd0;
+            end
+            for (k = 0; k < 9; k = k + 1) begin
+                dma_a_bytes[k] <= 8'b0;
+                dma_w_bytes[k] <= 8'b0;
+            end
+        end else begin
+            // Ring registers
+            if (dma_reg_write) begin
+                case (reg_write_addr[5:2])
+                    'd0: dma_ring_base <= reg_write_data;
+                    'd1: dma_ring_size <= reg_write_data[15:0];
+                    'd2: dma_tail <= reg_write_data;                  // doorbell
+                    'd5: begin
+                        dma_enable <= reg_write_data[0];
+                        dma_wbank <= reg_write_data[2];               // only while idle
+                        if (reg_write_data[1]) begin                  // ring reset, only while idle
+                            dma_head <= 32'b0;
+                            dma_tail <= 32'b0;
+                            dma_slot <= 16'b0;
+                        end
+                    end
+                    'd6: acc_passes <= reg_write_data[15:0];        // only while the array is idle
+                endcase
+            end
+
+            for (k = 0; k < 8; k = k + 1) begin
+                if (pe_cool[k] != 0) pe_cool[k] <= pe_cool[k] - 1;
+            end
+
+            // AXI master read handshake
+            if (dma_rd_fire) begin
+                dma_rd_req <= 1'b0;
+                dma_rd_pending <= 1'b1;
+            end
+            if (dma_rd_pending && ip_read_done) begin
+                dma_rd_pending <= 1'b0;
+            end
+
+            // Descriptor results leaving the PEs
+            for (k = 0; k < 8; k = k + 1) begin
+                if (out_resp[k]) pe_dma[k] <= 1'b0;
+            end
+
+            case (dma_state)
+                DMA_IDLE: begin
+                    if (dma_enable && dma_head != dma_tail && dma_ring_size != 0) begin
+                        desc_word <= 3'd0;
+                        dma_state <= DMA_DESC;
+                    end
+                end
+
+                DMA_DESC: begin
+                    // One 8-beat burst; entries are 32-byte aligned so it never crosses 4 KB.
+                    if (!dma_rd_req && !dma_rd_pending) begin
+                        dma_rd_req <= 1'b1;
+                        dma_rd_addr <= dma_ring_base + {dma_slot, 5'b0};
+                        dma_rd_len <= 8'd7;
+                    end
+                    if (dma_rd_pending && ip_read_data_valid) begin
+                        desc[desc_word] <= ip_read_data;
+                        desc_word <= desc_word + 1;
+                    end
+                    if (dma_rd_pending && ip_read_done) begin
+                        dma_state <= DMA_START;
+                    end
+                end
+
+                DMA_START: begin
+                    in_row <= desc[0];
+                    in_cur <= desc[0];
+                    w_row <= desc[1];
+                    w_cur <= desc[1];
+                    out_cur <= desc[2];
+                    outer_idx <= 16'b0;
+                    inner_idx <= 16'b0;
+                    dma_passes <= (acc_passes == 0) ? 16'd1 : acc_passes;
+                    pass_idx <= 16'b0;
+                    in_pass_off <= 32'b0;
+                    w_pass_off <= 32'b0;
+                    // Operand memory may have been rewritten since the last descriptor.
+                    in_cache_valid <= 1'b0;
+                    w_cache_valid <= 1'b0;
+                    if (desc[3][15:0] == 0 || desc[3][31:16] == 0)
+                        dma_state <= DMA_DRAIN;
+                    else
+                        dma_state <= DMA_OP;
+                end
+
+                DMA_OP: begin
+                    fetch_word <= 2'd0;
+                    // Operands that did not move (e.g. one input patch against
+                    // every filter) are not fetched again. Bank slots are read
+                    // on port A, whose address follows op_w.
+                    if (dma_wbank)
+                        dma_state <= DMA_BANK;
+                    else if (!w_cache_valid || w_cached != op_w)
+                        dma_state <= DMA_FETCH_W;
+                    else if (!in_cache_valid || in_cached != op_in)
+                        dma_state <= DMA_FETCH_A;
+                    else
+                        dma_state <= DMA_WAIT_PE;
+                end
+
+                DMA_BANK: begin
+                    for (k = 0; k < 9; k = k + 1) begin
+                        dma_w_bytes[k] <= wbank_qa[k * 8 +: 8];
+                    end
+                    if (!in_cache_valid || in_cached != op_in)
+                        dma_state <= DMA_FETCH_A;
+                    else
+                        dma_state <= DMA_WAIT_PE;
+                end
+
+                DMA_FETCH_W, DMA_FETCH_A: begin
+                    // The three words are one burst, split in two if it would cross 4 KB.
+                    if (!dma_rd_req && !dma_rd_pending) begin
+                        dma_rd_req <= 1'b1;
+                        dma_rd_addr <= fetch_addr;
+                        dma_rd_len <= (fetch_addr[11:2] + (2'd2 - fetch_word) > 11'h3FF) ?
+                                      10'h3FF - fetch_addr[11:2] : 2'd2 - fetch_word;
+                    end
+                    if (dma_rd_pending && ip_read_data_valid) begin
+                        fetch_word <= fetch_word + 1;
+                        if (fetch_word == 2'd0) fetch_buf0 <= ip_read_data;
+                        if (fetch_word == 2'd1) fetch_buf1 <= ip_read_data;
+                        if (fetch_word == 2'd2) begin
+                            // Nine bytes starting at the byte offset inside the first word
+                            for (k = 0; k < 9; k = k + 1) begin
+                                if (dma_state == DMA_FETCH_W)
+                                    dma_w_bytes[k] <= fetch_window[(op_w[1:0] + k) * 8 +: 8];
+                                else
+                                    dma_a_bytes[k] <= fetch_window[(op_in[1:0] + k) * 8 +: 8];
+                            end
+                            fetch_word <= 2'd0;
+                            if (dma_state == DMA_FETCH_W) begin
+                                w_cached <= op_w;
+                                w_cache_valid <= 1'b1;
+                                if (!in_cache_valid || in_cached != op_in)
+                                    dma_state <= DMA_FETCH_A;
+                                else
+                                    dma_state <= DMA_WAIT_PE;
+                            end else begin
+                                in_cached <= op_in;
+                                in_cache_valid <= 1'b1;
+                                dma_state <= DMA_WAIT_PE;
+                            end
+                        end
+                    end
+                end
+
+                DMA_WAIT_PE: begin
+                    // The PE's previous result must be written back and no
+                    // register-fed op may be using the array.
+                    if (dma_issue) begin
+                        if (pass_idx == 0) begin
+                            pe_dma[dma_pe] <= 1'b1;
+                            pe_addr[dma_pe] <= out_cur;
+                            out_cur <= out_cur + 4;
+                        end
+                        dma_feed_count <= 4'd0;
+                        dma_state <= DMA_FEED;
+                    end
+                end
+
+                DMA_FEED: begin
+                    dma_feed_count <= dma_feed_count + 1;
+                    if (dma_feed_count == FEED_LAST - 1) begin
+                        // PE.v needs eight idle cycles before its next op,
+                        // PE_PAR one cycle per chunk of PE_LANES bytes.
+                        pe_cool[dma_pe] <= PE_COOL;
+                        if (pass_idx + 1 == dma_passes) dma_pe <= dma_pe + 1;
+                        dma_state <= DMA_NEXT;
+                    end
+                end
+
+                DMA_NEXT: begin
+                    if (pass_idx + 1 != dma_passes) begin
+                        pass_idx <= pass_idx + 1;
+                        in_pass_off <= in_pass_off + 9;
+                        w_pass_off <= w_pass_off + (dma_wbank ? {16'b0, desc[3][31:16]} : 32'd9);
+                        dma_state <= DMA_OP;
+                    end else if (inner_idx + 1 != desc[3][31:16]) begin
+                        pass_idx <= 16'b0;
+                        in_pass_off <= 32'b0;
+                        w_pass_off <= 32'b0;
+                        inner_idx <= inner_idx + 1;
+                        in_cur <= in_cur + desc[5];
+                        w_cur <= w_cur + desc[7];
+                        dma_state <= DMA_OP;
+                    end else if (outer_idx + 1 != desc[3][15:0]) begin
+                        pass_idx <= 16'b0;
+                        in_pass_off <= 32'b0;
+                        w_pass_off <= 32'b0;
+                        inner_idx <= 16'b0;
+                        outer_idx <= outer_idx + 1;
+                        in_row <= in_row + desc[4];
+                        in_cur <= in_row + desc[4];
+                        w_row <= w_row + desc[6];
+                        w_cur <= w_row + desc[6];
+                        dma_state <= DMA_OP;
+                    end else begin
+                        dma_state <= DMA_DRAIN;
+                    end
+                end
+
+                DMA_DRAIN: begin
+                    // Done once every result has been written to DDR.
+                    if (dma_pending == 0 && wc_idle_all && !result_req) begin
+                        dma_head <= dma_head + 1;
+                        dma_slot <= (dma_slot + 1 == dma_ring_size) ? 16'b0 : dma_slot + 1;
+                        dma_state <= DMA_IDLE;
+                    end
+                end
+
+                default: dma_state <= DMA_IDLE;
+            endcase
+
+            // Outstanding descriptor results: +1 per started result, -1 per write-back
+            if (dma_issue_first && !dma_retire)
+                dma_pending <= dma_pending + 1;
+            else if (!dma_issue_first && dma_retire)
+                dma_pending <= dma_pending - 1;
         end
-        else if (out_valid[4]) begin
-            ip_write_data = c[159:128]; // Access the next 32 bits of c (c5)
-            out_resp[4] = ip_transaction_done;
+    end
+
+///////////////////////////////////////////////////////////////// GEMV engine
+    // y[r] = sum_k W[r * cols + k] * x[k] on signed bytes, for r < rows, as
+    // int32 (firmware side: acc_gemv_* in Microblaze/acc_dma.h). Registers:
+    //   0x68 W address   0x6C x address   0x70 y address
+    //   0x74 bits 15:0 rows (<= GEMV_MAX_ROWS), bits 23:16 batch (0 or 1: one x)
+    //   0x78 cols in bytes (multiple of 4)
+    //   0x7C write 1: start; read bit 0: busy
+    // W, x and y are word aligned. x is loaded GEMV_XBUF_WORDS words at a
+    // time into on-chip memory; for each chunk the matching slice of every
+    // weight row is burst-read and multiplied four bytes per beat into
+    // GEMV_MAX_ROWS on-chip accumulators, so every weight byte crosses the
+    // bus once. The accumulators leave through the write-combining FIFO.
+    // A batch of up to GEMV_MAX_BATCH input vectors, stored back to back
+    // (vector b at x + b * cols), splits xbuf into one slice per vector and
+    // runs one MAC lane per vector on every weight beat, so the weights are
+    // still read once for the whole batch; y holds rows results per vector,
+    // vector b at y + 4 * b * rows.
+    // The PE array and the descriptor engine must be idle while it runs.
+    wire gemv_beat = gemv_rd_pending && ip_read_data_valid;
+    wire gemv_stream_done = (gemv_left == 0) && !gemv_rd_req && !gemv_rd_pending;
+    wire [7:0]  gemv_nb = (gemv_batch == 8'd0) ? 8'd1 : gemv_batch;
+    wire        gemv_single = (gemv_nb == 8'd1);
+    wire [31:0] gemv_rem = (gemv_cols - gemv_x_off) >> 2;          // input words from the chunk start
+    wire [12:0] gemv_xbuf_limit = gemv_single ? GEMV_XBUF_WORDS : GEMV_SLICE_WORDS;
+    wire [12:0] gemv_chunk_words = (gemv_rem > gemv_xbuf_limit) ? gemv_xbuf_limit : gemv_rem[12:0];
+    wire [12:0] gemv_page = 13'd1024 - {3'b0, gemv_addr[11:2]};    // words left in the 4 KB page
+    wire [12:0] gemv_beats0 = (gemv_left > C_M_AXI_MAX_BURST) ? C_M_AXI_MAX_BURST : gemv_left;
+    wire [12:0] gemv_beats = (gemv_beats0 > gemv_page) ? gemv_page : gemv_beats0;
+    wire gemv_start = dma_reg_write && (reg_write_addr[5:2] == 'd15) && reg_write_data[0];
+    // xbuf word the current input beat goes to
+    wire [GEMV_XBUF_AW-1:0] gemv_x_idx = gemv_single ? gemv_x_word[GEMV_XBUF_AW-1:0] :
+                                         {gemv_xb[GEMV_BATCH_AW-1:0], gemv_x_word[GEMV_SLICE_AW-1:0]};
+
+    assign gemv_push = (gemv_state == G_WB) && !result_req && (wc_count != WC_DEPTH);
+
+    always @(posedge ACLK or negedge ARESETN) begin
+        if (!ARESETN) begin
+            gemv_state <= G_IDLE;
+            gemv_w <= 32'b0;
+            gemv_x <= 32'b0;
+            gemv_y <= 32'b0;
+            gemv_rows <= 16'b0;
+            gemv_batch <= 8'd0;
+            gemv_cols <= 32'b0;
+            gemv_rd_req <= 1'b0;
+            gemv_rd_pending <= 1'b0;
+            gemv_rd_addr <= 32'b0;
+            gemv_rd_len <= 8'd0;
+            gemv_addr <= 32'b0;
+            gemv_left <= 13'd0;
+            gemv_x_off <= 32'b0;
+            gemv_chunk <= 13'd0;
+            gemv_xb <= 8'd0;
+            gemv_x_base <= 32'b0;
+            gemv_row_addr <= 32'b0;
+            gemv_row <= 16'b0;
+            gemv_x_word <= 13'd0;
+            gemv_w_word <= 13'd0;
+            gemv_wb_idx <= 16'b0;
+            gemv_wb_lane <= 8'd0;
+            gemv_wb_addr <= 32'b0;
+        end else begin
+            // Parameter registers, written only while the engine is idle
+            if (dma_reg_write) begin
+                case (reg_write_addr[5:2])
+                    'd10: gemv_w <= reg_write_data;
+                    'd11: gemv_x <= reg_write_data;
+                    'd12: gemv_y <= reg_write_data;
+                    'd13: begin
+                        gemv_rows <= reg_write_data[15:0];
+                        gemv_batch <= reg_write_data[23:16];
+                    end
+                    'd14: gemv_cols <= reg_write_data;
+                endcase
+            end
+
+            // AXI master read handshake
+            if (gemv_rd_fire) begin
+                gemv_rd_req <= 1'b0;
+                gemv_rd_pending <= 1'b1;
+            end
+            if (gemv_rd_pending && ip_read_done) begin
+                gemv_rd_pending <= 1'b0;
+            end
+
+            // One burst at a time, never past 4 KB, for the stream at gemv_addr
+            if ((gemv_state == G_X || gemv_state == G_W) &&
+                !gemv_rd_req && !gemv_rd_pending && gemv_left != 0) begin
+                gemv_rd_req <= 1'b1;
+                gemv_rd_addr <= gemv_addr;
+                gemv_rd_len <= gemv_beats - 1;
+                gemv_addr <= gemv_addr + {gemv_beats, 2'b00};
+                gemv_left <= gemv_left - gemv_beats;
+            end
+            if (gemv_beat && gemv_state == G_X) gemv_x_word <= gemv_x_word + 1;
+            if (gemv_beat && gemv_state == G_W) gemv_w_word <= gemv_w_word + 1;
+
+            case (gemv_state)
+                G_IDLE: begin
+                    if (gemv_start && gemv_rows != 0 && gemv_rows <= GEMV_MAX_ROWS &&
+                        gemv_nb <= GEMV_MAX_BATCH && gemv_cols != 0 && gemv_cols[1:0] == 2'b00) begin
+                        gemv_x_off <= 32'b0;
+                        gemv_state <= G_CHUNK;
+                    end
+                end
+
+                G_CHUNK: begin
+                    gemv_chunk <= gemv_chunk_words;
+                    gemv_left <= gemv_chunk_words;
+                    gemv_addr <= gemv_x + gemv_x_off;
+                    gemv_x_base <= gemv_x + gemv_x_off;
+                    gemv_xb <= 8'd0;
+                    gemv_x_word <= 13'd0;
+                    gemv_state <= G_X;
+                end
+
+                G_X: begin
+                    // the same chunk of every input vector, one after the other
+                    if (gemv_stream_done) begin
+                        if (gemv_xb + 1 != gemv_nb) begin
+                            gemv_xb <= gemv_xb + 1;
+                            gemv_x_base <= gemv_x_base + gemv_cols;
+                            gemv_addr <= gemv_x_base + gemv_cols;
+                            gemv_left <= gemv_chunk;
+                            gemv_x_word <= 13'd0;
+                        end else begin
+                            gemv_row <= 16'b0;
+                            gemv_row_addr <= gemv_w + gemv_x_off;
+                            gemv_addr <= gemv_w + gemv_x_off;
+                            gemv_left <= gemv_chunk;
+                            gemv_w_word <= 13'd0;
+                            gemv_state <= G_W;
+                        end
+                    end
+                end
+
+                G_W: begin
+                    if (gemv_stream_done) begin
+                        if (gemv_row + 1 != gemv_rows) begin
+                            gemv_row <= gemv_row + 1;
+                            gemv_row_addr <= gemv_row_addr + gemv_cols;
+                            gemv_addr <= gemv_row_addr + gemv_cols;
+                            gemv_left <= gemv_chunk;
+                            gemv_w_word <= 13'd0;
+                        end else begin
+                            gemv_state <= G_ROWS;
+                        end
+                    end
+                end
+
+                G_ROWS: begin
+                    // xbuf is reloaded only after the last row has used it
+                    if (gemv_row_c == gemv_rows) begin
+                        gemv_x_off <= gemv_x_off + {gemv_chunk, 2'b00};
+                        if (gemv_x_off + {gemv_chunk, 2'b00} < gemv_cols) begin
+                            gemv_state <= G_CHUNK;
+                        end else begin
+                            gemv_wb_idx <= 16'b0;
+                            gemv_wb_lane <= 8'd0;
+                            gemv_wb_addr <= gemv_y;
+                            gemv_state <= G_WB;
+                        end
+                    end
+                end
+
+                G_WB: begin
+                    // lane by lane, so y is one contiguous run of results
+                    if (gemv_push) begin
+                        gemv_wb_addr <= gemv_wb_addr + 4;
+                        if (gemv_wb_idx + 1 != gemv_rows) begin
+                            gemv_wb_idx <= gemv_wb_idx + 1;
+                        end else begin
+                            gemv_wb_idx <= 16'b0;
+                            gemv_wb_lane <= gemv_wb_lane + 1;
+                            if (gemv_wb_lane + 1 == gemv_nb) gemv_state <= G_DONE;
+                        end
+                    end
+                end
+
+                G_DONE: begin
+                    if (wc_idle_all) gemv_state <= G_IDLE;
+                end
+
+                default: gemv_state <= G_IDLE;
+            endcase
         end
-        else if (out_valid[5]) begin
-            ip_write_data = c[191:160]; // Access the next 32 bits of c (c6)
-            out_resp[5] = ip_transaction_done;
+    end
+
+    // MAC pipeline: A) weight word and the lanes' input words, B) four byte
+    // products per lane, C) row sums, committed to the row's accumulators on
+    // the last beat of the row's slice.
+    reg [31:0]        gemv_wa;
+    reg               gemv_va, gemv_lasta;
+    reg               gemv_vb, gemv_lastb;
+    reg [GEMV_BATCH_AW-1:0] gemv_bank_sel;   // xbuf slice of lane 0's input word with one vector
+    wire [32*GEMV_MAX_BATCH-1:0] gemv_xq;   // every slice's word gemv_w_word, a cycle later
+    wire gemv_commit = gemv_vb && gemv_lastb && (gemv_state != G_CHUNK);
+
+    always @(posedge ACLK) begin
+        gemv_bank_sel <= gemv_w_word[GEMV_XBUF_AW-1:GEMV_SLICE_AW];
+    end
+
+    always @(posedge ACLK or negedge ARESETN) begin
+        if (!ARESETN) begin
+            gemv_wa <= 32'b0;
+            gemv_va <= 1'b0;
+            gemv_lasta <= 1'b0;
+            gemv_vb <= 1'b0;
+            gemv_lastb <= 1'b0;
+            gemv_row_c <= 16'b0;
+        end else begin
+            gemv_wa <= ip_read_data;
+            gemv_va <= gemv_beat && (gemv_state == G_W);
+            gemv_lasta <= (gemv_w_word == gemv_chunk - 1);
+            gemv_vb <= gemv_va;
+            gemv_lastb <= gemv_lasta;
+
+            if (gemv_state == G_CHUNK) begin
+                gemv_row_c <= 16'b0;
+            end else if (gemv_vb && gemv_lastb) begin
+                gemv_row_c <= gemv_row_c + 1;
+            end
         end
-        else if (out_valid[6]) begin
-            ip_write_data = c[223:192]; // Access the next 32 bits of c (c7)
-            out_resp[6] = ip_transaction_done;
+    end
+
+    // One lane per input vector: its xbuf slice, products, row sum and
+    // accumulators. With a single vector the slices together are its chunk
+    // and only lane 0's results are written back.
+    genvar gl;
+    generate
+        for (gl = 0; gl < GEMV_MAX_BATCH; gl = gl + 1) begin : gemv_lane
+            reg [31:0]        xslice [0:GEMV_SLICE_WORDS-1];
+            reg [31:0]        xq;
+            reg signed [15:0] p [0:3];
+            reg signed [31:0] row_sum;
+            reg [31:0]        acc [0:GEMV_MAX_ROWS-1];
+            wire [31:0] x = (gl == 0 && gemv_single) ? gemv_xq[gemv_bank_sel*32 +: 32] : xq;
+            wire signed [31:0] sum = row_sum + p[0] + p[1] + p[2] + p[3];
+            integer g;
+
+            always @(posedge ACLK) begin
+                if (gemv_beat && gemv_state == G_X && gemv_x_idx[GEMV_XBUF_AW-1:GEMV_SLICE_AW] == gl)
+                    xslice[gemv_x_idx[GEMV_SLICE_AW-1:0]] <= ip_read_data;
+                xq <= xslice[gemv_w_word[GEMV_SLICE_AW-1:0]];
+                if (gemv_commit)
+                    acc[gemv_row_c] <= (gemv_x_off == 0) ? sum : acc[gemv_row_c] + sum;
+            end
+
+            always @(posedge ACLK or negedge ARESETN) begin
+                if (!ARESETN) begin
+                    row_sum <= 32'sd0;
+                    for (g = 0; g < 4; g = g + 1)
+                        p[g] <= 16'sd0;
+                end else begin
+                    for (g = 0; g < 4; g = g + 1)
+                        p[g] <= $signed(gemv_wa[8*g +: 8]) * $signed(x[8*g +: 8]);
+                    if (gemv_state == G_CHUNK || (gemv_vb && gemv_lastb)) begin
+                        row_sum <= 32'sd0;
+                    end else if (gemv_vb) begin
+                        row_sum <= sum;
+                    end
+                end
+            end
+
+            assign gemv_xq[gl*32 +: 32] = xq;
+            assign gemv_acc_q[gl*32 +: 32] = acc[gemv_wb_idx];
         end
-        else if (out_valid[7]) begin
-            ip_write_data = c[255:224]; // Access the next 32 bits of c (c8)
-            out_resp[7] = ip_transaction_done;
+    endgenerate
+
+///////////////////////////////////////////////////////////////// performance counters
+    // Free-running 32-bit counters (firmware side: acc_perf.c). Registers:
+    //   0x80 write bit 0: clear all, bit 1: count; read bit 1: counting
+    //   0x84 cycles            0x88 busy cycles       0x8C idle cycles
+    //   0x90 PE ops fed        0x94 GEMV weight beats
+    //   0x98 AXI master stall cycles (a valid or ready not answered)
+    //   0x9C bytes read        0xA0 bytes written on the AXI master
+    // Busy means any engine, the PE feed or the write-back path has work.
+    localparam PERF_BEAT_BYTES = C_M_AXI_DATA_WIDTH / 8;
+
+    reg        perf_run;
+    reg [31:0] perf_cycles, perf_busy, perf_idle, perf_ops, perf_gemv_beats;
+    reg [31:0] perf_stall, perf_rd_bytes, perf_wr_bytes;
+
+    wire perf_op_fed = (buffer_counter == FEED_LAST) ||
+                       (dma_feeding && dma_feed_count == FEED_LAST - 1);
+    wire perf_active = (dma_state != DMA_IDLE) || (gemv_state != G_IDLE) || (buffer_counter != 0) ||
+                       result_req || (out_valid != 0) || !wc_idle_all;
+    wire perf_stalled = (M_AXI_ARVALID && !M_AXI_ARREADY) || (M_AXI_RREADY && !M_AXI_RVALID) ||
+                        (M_AXI_AWVALID && !M_AXI_AWREADY) || (M_AXI_WVALID && !M_AXI_WREADY);
+
+    assign perf_read_data = (reg_read_addr[5:2] == 'd0) ? {30'b0, perf_run, 1'b0} :
+                            (reg_read_addr[5:2] == 'd1) ? perf_cycles :
+                            (reg_read_addr[5:2] == 'd2) ? perf_busy :
+                            (reg_read_addr[5:2] == 'd3) ? perf_idle :
+                            (reg_read_addr[5:2] == 'd4) ? perf_ops :
+                            (reg_read_addr[5:2] == 'd5) ? perf_gemv_beats :
+                            (reg_read_addr[5:2] == 'd6) ? perf_stall :
+                            (reg_read_addr[5:2] == 'd7) ? perf_rd_bytes :
+                            (reg_read_addr[5:2] == 'd8) ? perf_wr_bytes :
+                            32'b0;
+
+    always @(posedge ACLK or negedge ARESETN) begin
+        if (!ARESETN) begin
+            perf_run <= 1'b0;
+            perf_cycles <= 32'b0;
+            perf_busy <= 32'b0;
+            perf_idle <= 32'b0;
+            perf_ops <= 32'b0;
+            perf_gemv_beats <= 32'b0;
+            perf_stall <= 32'b0;
+            perf_rd_bytes <= 32'b0;
+            perf_wr_bytes <= 32'b0;
+        end else if (perf_reg_write && reg_write_addr[5:2] == 'd0) begin
+            perf_run <= reg_write_data[1];
+            if (reg_write_data[0]) begin
+                perf_cycles <= 32'b0;
+                perf_busy <= 32'b0;
+                perf_idle <= 32'b0;
+                perf_ops <= 32'b0;
+                perf_gemv_beats <= 32'b0;
+                perf_stall <= 32'b0;
+                perf_rd_bytes <= 32'b0;
+                perf_wr_bytes <= 32'b0;
+            end
+        end else if (perf_run) begin
+            perf_cycles <= perf_cycles + 1;
+            if (perf_active) perf_busy <= perf_busy + 1;
+            else             perf_idle <= perf_idle + 1;
+            if (perf_op_fed) perf_ops <= perf_ops + 1;
+            if (gemv_beat && gemv_state == G_W) perf_gemv_beats <= perf_gemv_beats + 1;
+            if (perf_stalled) perf_stall <= perf_stall + 1;
+            if (M_AXI_RVALID && M_AXI_RREADY) perf_rd_bytes <= perf_rd_bytes + PERF_BEAT_BYTES;
+            if (M_AXI_WVALID && M_AXI_WREADY) perf_wr_bytes <= perf_wr_bytes + PERF_BEAT_BYTES;
         end
     end
 
-         
 ////////////////////////////////////////////////////
     // Instantiate the AXI_MST module
     AXI_MST  #(
         .C_M_AXI_ADDR_WIDTH(32),
-        .C_M_AXI_DATA_WIDTH(32)
+        .C_M_AXI_DATA_WIDTH(32),
+        .C_M_AXI_MAX_BURST(C_M_AXI_MAX_BURST)
     ) axi_master_inst (
         // Global signals
         .ACLK(ACLK),
@@ -413,6 +1387,9 @@ module ACC #(
         
         // Write Address Channel
         .M_AXI_AWADDR(M_AXI_AWADDR),
+        .M_AXI_AWLEN(M_AXI_AWLEN),
+        .M_AXI_AWSIZE(M_AXI_AWSIZE),
+        .M_AXI_AWBURST(M_AXI_AWBURST),
         .M_AXI_AWPROT(M_AXI_AWPROT),
         .M_AXI_AWVALID(M_AXI_AWVALID),
         .M_AXI_AWREADY(M_AXI_AWREADY),
@@ -420,6 +1397,7 @@ module ACC #(
         // Write Data Channel
         .M_AXI_WDATA(M_AXI_WDATA),
         .M_AXI_WSTRB(M_AXI_WSTRB),
+        .M_AXI_WLAST(M_AXI_WLAST),
         .M_AXI_WVALID(M_AXI_WVALID),
         .M_AXI_WREADY(M_AXI_WREADY),
         
@@ -430,6 +1408,9 @@ module ACC #(
         
         // Read Address Channel
         .M_AXI_ARADDR(M_AXI_ARADDR),
+        .M_AXI_ARLEN(M_AXI_ARLEN),
+        .M_AXI_ARSIZE(M_AXI_ARSIZE),
+        .M_AXI_ARBURST(M_AXI_ARBURST),
         .M_AXI_ARPROT(M_AXI_ARPROT),
         .M_AXI_ARVALID(M_AXI_ARVALID),
         .M_AXI_ARREADY(M_AXI_ARREADY),
@@ -437,6 +1418,7 @@ module ACC #(
         // Read Data Channel
         .M_AXI_RDATA(M_AXI_RDATA),
         .M_AXI_RRESP(M_AXI_RRESP),
+        .M_AXI_RLAST(M_AXI_RLAST),
         .M_AXI_RVALID(M_AXI_RVALID),
         .M_AXI_RREADY(M_AXI_RREADY),
         
@@ -444,10 +1426,14 @@ module ACC #(
         .ip_start_transaction(ip_start_transaction),
         .ip_transaction_type(ip_transaction_type),
         .ip_address(ip_address),
+        .ip_burst_len(ip_burst_len),
         .ip_write_data(ip_write_data),
+        .ip_write_next(ip_write_next),
         .ip_read_data(ip_read_data),
         .ip_read_data_valid(ip_read_data_valid),
-        .ip_transaction_done(ip_transaction_done)
+        .ip_transaction_done(ip_transaction_done),
+        .ip_write_done(ip_write_done),
+        .ip_read_done(ip_read_done)
     );
     
     
@@ -502,13 +1488,18 @@ module ACC #(
     );
 
 
-    PE_ARRAY pe_array_inst (
+    PE_ARRAY #(
+        .PE_PARALLEL(PE_PARALLEL),
+        .PE_LANES(PE_LANES)
+    ) pe_array_inst (
         .clk(ACLK),
         .rst(rst),
         .A(a),
         .B(b),
         .IN_VALID(in_valid),
-        .STORE(store),
+        .STORE(dma_state != DMA_IDLE ? 8'b0 : store),   // descriptor ops rely on PASSES alone
+        .PASSES(acc_passes),
+        .PASS_RESET(pass_reset),
         .C(c),
         .OUT_VALID(out_valid),
         .OUT_RESP(out_resp)
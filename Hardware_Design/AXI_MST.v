@@ -1,6 +1,9 @@
+// AXI4 master with INCR bursts of 1..C_M_AXI_MAX_BURST beats.
+// The requester must not let a burst cross a 4 KB boundary.
 module AXI_MST #(
     parameter C_M_AXI_ADDR_WIDTH = 32,
-    parameter C_M_AXI_DATA_WIDTH = 32
+    parameter C_M_AXI_DATA_WIDTH = 32,
+    parameter C_M_AXI_MAX_BURST  = 256     // longest burst accepted on ip_burst_len (<= 256)
 )(
     // Global signals
     input  wire                            ACLK,
@@ -8,6 +11,9 @@ module AXI_MST #(
     
     // Write Address Channel
     output wire [C_M_AXI_ADDR_WIDTH-1:0]   M_AXI_AWADDR,
+    output wire [7:0]                      M_AXI_AWLEN,
+    output wire [2:0]                      M_AXI_AWSIZE,
+    output wire [1:0]                      M_AXI_AWBURST,
     output wire [2:0]                      M_AXI_AWPROT,
     output wire                            M_AXI_AWVALID,
     input  wire                            M_AXI_AWREADY,
@@ -15,6 +21,7 @@ module AXI_MST #(
     // Write Data Channel
     output wire [C_M_AXI_DATA_WIDTH-1:0]   M_AXI_WDATA,
     output wire [(C_M_AXI_DATA_WIDTH/8)-1:0] M_AXI_WSTRB,
+    output wire                            M_AXI_WLAST,
     output wire                            M_AXI_WVALID,
     input  wire                            M_AXI_WREADY,
     
@@ -25,6 +32,9 @@ module AXI_MST #(
     
     // Read Address Channel
     output wire [C_M_AXI_ADDR_WIDTH-1:0]   M_AXI_ARADDR,
+    output wire [7:0]                      M_AXI_ARLEN,
+    output wire [2:0]                      M_AXI_ARSIZE,
+    output wire [1:0]                      M_AXI_ARBURST,
     output wire [2:0]                      M_AXI_ARPROT,
     output wire                            M_AXI_ARVALID,
     input  wire                            M_AXI_ARREADY,
@@ -32,6 +42,7 @@ module AXI_MST #(
     // Read Data Channel
     input  wire [C_M_AXI_DATA_WIDTH-1:0]   M_AXI_RDATA,
     input  wire [1:0]                      M_AXI_RRESP,
+    input  wire                            M_AXI_RLAST,
     input  wire                            M_AXI_RVALID,
     output wire                            M_AXI_RREADY,
     
@@ -39,12 +50,20 @@ module AXI_MST #(
     input  wire                            ip_start_transaction,
     input  wire                            ip_transaction_type,    // 0: read, 1: write
     input  wire [C_M_AXI_ADDR_WIDTH-1:0]   ip_address,
-    input  wire [C_M_AXI_DATA_WIDTH-1:0]   ip_write_data,
+    input  wire [7:0]                      ip_burst_len,           // beats - 1, as AxLEN
+    input  wire [C_M_AXI_DATA_WIDTH-1:0]   ip_write_data,          // current write beat, advanced by ip_write_next
+    output wire                            ip_write_next,          // pulses when a write beat is accepted
     output wire [C_M_AXI_DATA_WIDTH-1:0]   ip_read_data,
-    output wire                            ip_read_data_valid,
-    output wire                            ip_transaction_done
+    output wire                            ip_read_data_valid,     // pulses once per read beat
+    output wire                            ip_transaction_done,
+    output wire                            ip_write_done,          // pulses when a write response is accepted
+    output wire                            ip_read_done            // pulses with the last read beat
 );
 
+    localparam [2:0] AXI_SIZE = (C_M_AXI_DATA_WIDTH == 64) ? 3'd3 : 3'd2;   // bytes per beat
+    localparam [7:0] MAX_LEN  = C_M_AXI_MAX_BURST - 1;
+    wire [7:0] burst_len = (ip_burst_len > MAX_LEN) ? MAX_LEN : ip_burst_len;
+
     // FSM states for both read and write channels
     localparam IDLE = 2'b00;
     localparam ADDR = 2'b01;
@@ -60,6 +79,8 @@ module AXI_MST #(
     
     // Control flags
     reg transaction_complete_reg;
+    reg write_done_reg;
+    reg read_done_reg;
     reg read_data_valid_reg;
     
     // Transaction type register
@@ -67,16 +88,18 @@ module AXI_MST #(
     
     // AXI signals assignments
     reg [C_M_AXI_ADDR_WIDTH-1:0]   axi_awaddr;
+    reg [7:0]                      axi_awlen;
     reg [2:0]                      axi_awprot;
     reg                            axi_awvalid;
     
-    reg [C_M_AXI_DATA_WIDTH-1:0]   axi_wdata;
     reg [(C_M_AXI_DATA_WIDTH/8)-1:0] axi_wstrb;
     reg                            axi_wvalid;
+    reg [7:0]                      w_beat;          // beats accepted in the current burst
     
     reg                            axi_bready;
     
     reg [C_M_AXI_ADDR_WIDTH-1:0]   axi_araddr;
+    reg [7:0]                      axi_arlen;
     reg [2:0]                      axi_arprot;
     reg                            axi_arvalid;
     
@@ -84,16 +107,25 @@ module AXI_MST #(
     
     // Connect internal registers to output ports
     assign M_AXI_AWADDR  = axi_awaddr;
+    assign M_AXI_AWLEN   = axi_awlen;
+    assign M_AXI_AWSIZE  = AXI_SIZE;
+    assign M_AXI_AWBURST = 2'b01;               // INCR
     assign M_AXI_AWPROT  = axi_awprot;
     assign M_AXI_AWVALID = axi_awvalid;
     
-    assign M_AXI_WDATA   = axi_wdata;
+    // Write data is taken straight from the requester, which presents the
+    // next beat once ip_write_next has consumed the current one.
+    assign M_AXI_WDATA   = ip_write_data;
     assign M_AXI_WSTRB   = axi_wstrb;
+    assign M_AXI_WLAST   = axi_wvalid && (w_beat == axi_awlen);
     assign M_AXI_WVALID  = axi_wvalid;
     
     assign M_AXI_BREADY  = axi_bready;
     
     assign M_AXI_ARADDR  = axi_araddr;
+    assign M_AXI_ARLEN   = axi_arlen;
+    assign M_AXI_ARSIZE  = AXI_SIZE;
+    assign M_AXI_ARBURST = 2'b01;               // INCR
     assign M_AXI_ARPROT  = axi_arprot;
     assign M_AXI_ARVALID = axi_arvalid;
     
@@ -102,15 +134,22 @@ module AXI_MST #(
     // Connect to user IP interface
     assign ip_read_data = read_data_reg;
     assign ip_read_data_valid = read_data_valid_reg;
+    assign ip_write_next = axi_wvalid && M_AXI_WREADY;
     assign ip_transaction_done = transaction_complete_reg;
+    assign ip_write_done = write_done_reg;
+    assign ip_read_done = read_done_reg;
     
     // Unified transaction management
     always @(posedge ACLK or negedge ARESETN) begin
         if (!ARESETN) begin
             transaction_complete_reg <= 1'b0;
             transaction_type_reg <= 1'b0;
+            write_done_reg <= 1'b0;
+            read_done_reg <= 1'b0;
         end else begin
             transaction_complete_reg <= 1'b0;
+            write_done_reg <= 1'b0;
+            read_done_reg <= 1'b0;
             // Start a new transaction
             if (ip_start_transaction) begin
                 transaction_complete_reg <= 1'b0;
@@ -120,11 +159,13 @@ module AXI_MST #(
             // Complete a write transaction
             if (write_state == RESP && M_AXI_BVALID && axi_bready) begin
                 transaction_complete_reg <= 1'b1;
+                write_done_reg <= 1'b1;
             end
             
-            // Complete a read transaction
-            if (read_state == DATA && M_AXI_RVALID && axi_rready) begin
+            // Complete a read transaction on its last beat
+            if (read_state == DATA && M_AXI_RVALID && axi_rready && M_AXI_RLAST) begin
                 transaction_complete_reg <= 1'b1;
+                read_done_reg <= 1'b1;
             end
         end
     end
@@ -137,36 +178,42 @@ module AXI_MST #(
             axi_wvalid <= 1'b0;
             axi_bready <= 1'b0;
             axi_awaddr <= 0;
+            axi_awlen <= 8'd0;
+            w_beat <= 8'd0;
         end else begin
             case (write_state)
                 IDLE: begin
                     if (ip_start_transaction && ip_transaction_type) begin
                         // Setup for write transaction
                         axi_awaddr <= ip_address;
+                        axi_awlen <= burst_len;
                         axi_awprot <= 3'b000;   // Unprivileged, secure, data access
                         axi_awvalid <= 1'b1;    // Address is valid
                         
-                        // Prepare write data
-                        axi_wdata <= ip_write_data;
+                        // Data beats follow ip_write_data
                         axi_wstrb <= {(C_M_AXI_DATA_WIDTH/8){1'b1}}; // All bytes in the word are valid
                         axi_wvalid <= 1'b1;     // Data is valid
+                        w_beat <= 8'd0;
                         
                         write_state <= ADDR;
                     end
                 end
                 
                 ADDR: begin
-                    // Wait for both address and data to be accepted
+                    // Wait for the address and every data beat to be accepted
                     if (M_AXI_AWREADY && axi_awvalid) begin
                         axi_awvalid <= 1'b0;  // Address has been accepted
                     end
                     
                     if (M_AXI_WREADY && axi_wvalid) begin
-                        axi_wvalid <= 1'b0;   // Data has been accepted
+                        if (M_AXI_WLAST)
+                            axi_wvalid <= 1'b0;   // Last beat has been accepted
+                        else
+                            w_beat <= w_beat + 1;
                     end
                     
                     // When both address and data have been accepted, move to response phase
-                    if ((!axi_awvalid || M_AXI_AWREADY) && (!axi_wvalid || M_AXI_WREADY)) begin
+                    if ((!axi_awvalid || M_AXI_AWREADY) && (!axi_wvalid || (M_AXI_WREADY && M_AXI_WLAST))) begin
                         axi_bready <= 1'b1;   // Ready to accept response
                         write_state <= RESP;
                     end else begin
@@ -194,16 +241,18 @@ module AXI_MST #(
             axi_rready <= 1'b0;
             read_data_valid_reg <= 1'b0;
             read_data_reg <= {C_M_AXI_DATA_WIDTH{1'b0}};
+            axi_arlen <= 8'd0;
         end else begin
+            read_data_valid_reg <= 1'b0;
             case (read_state)
                 IDLE: begin
                     if (ip_start_transaction && !ip_transaction_type) begin
                         // Setup for read transaction
                         axi_araddr <= ip_address;
+                        axi_arlen <= burst_len;
                         axi_arprot <= 3'b000;   // Unprivileged, secure, data access
                         axi_arvalid <= 1'b1;    // Address is valid
                         read_state <= ADDR;
-                        read_data_valid_reg <= 1'b0;
                     end
                 end
                 
@@ -219,8 +268,10 @@ module AXI_MST #(
                     if (M_AXI_RVALID && axi_rready) begin
                         read_data_reg <= M_AXI_RDATA;
                         read_data_valid_reg <= 1'b1;
-                        axi_rready <= 1'b0;
-                        read_state <= IDLE;
+                        if (M_AXI_RLAST) begin
+                            axi_rready <= 1'b0;
+                            read_state <= IDLE;
+                        end
                     end
                 end
                 
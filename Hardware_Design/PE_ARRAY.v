@@ -20,13 +20,18 @@
 //////////////////////////////////////////////////////////////////////////////////
 
 
-module PE_ARRAY(
+module PE_ARRAY #(
+    parameter PE_PARALLEL = 0,      // 0: serial PE.v, one byte per cycle; 1: PE_PAR
+    parameter PE_LANES    = 9       // PE_PAR multipliers per PE
+)(
     clk,
     rst,
     A,
     B,
     IN_VALID,
     STORE,
+    PASSES,
+    PASS_RESET,
     OUT_RESP,
     C,
     OUT_VALID
@@ -34,10 +39,12 @@ module PE_ARRAY(
     
     input clk;
     input rst;
-    input [7:0] A;
-    input [7:0] B;
+    input [71:0] A;             // serial PEs use A[7:0] / B[7:0], PE_PAR all nine bytes
+    input [71:0] B;
     input [7:0] IN_VALID;
     input [7:0] STORE;
+    input [15:0] PASSES;        // ops accumulated per result (0 and 1: every op emits)
+    input PASS_RESET;           // restart pass counting, pulsed when PASSES is written
     input [7:0] OUT_RESP;
     output reg [255:0] C;
     output reg [7:0] OUT_VALID;
@@ -69,36 +76,36 @@ module PE_ARRAY(
     
         case (IN_VALID)
             8'b0000_0001: begin
-                a1 = A;
-                b1 = B;
+                a1 = A[7:0];
+                b1 = B[7:0];
             end
             8'b0000_0010: begin
-                a2 = A;
-                b2 = B;
+                a2 = A[7:0];
+                b2 = B[7:0];
             end
             8'b0000_0100: begin
-                a3 = A;
-                b3 = B;
+                a3 = A[7:0];
+                b3 = B[7:0];
             end
             8'b0000_1000: begin
-                a4 = A;
-                b4 = B;
+                a4 = A[7:0];
+                b4 = B[7:0];
             end
             8'b0001_0000: begin
-                a5 = A;
-                b5 = B;
+                a5 = A[7:0];
+                b5 = B[7:0];
             end
             8'b0010_0000: begin
-                a6 = A;
-                b6 = B;
+                a6 = A[7:0];
+                b6 = B[7:0];
             end
             8'b0100_0000: begin
-                a7 = A;
-                b7 = B;
+                a7 = A[7:0];
+                b7 = B[7:0];
             end
             8'b1000_0000: begin
-                a8 = A;
-                b8 = B;
+                a8 = A[7:0];
+                b8 = B[7:0];
             end
             default: begin
                 // Default case (optional)
@@ -122,6 +129,51 @@ module PE_ARRAY(
         endcase
     end
     
+    // Cross-channel accumulation: each PE counts the ops it has been fed and
+    // holds its partial sum (as with STORE) until the PASSES-th one, so a
+    // multi-channel dot product leaves the array as a single result. An op
+    // ends on the falling edge of its IN_VALID bit, before the PE samples
+    // store, so pass_last always describes the op being finished.
+    // PE_PAR takes a whole op in the single cycle IN_VALID is high and samples
+    // store with it, so there every IN_VALID cycle is counted and op_last
+    // describes the op being fed.
+    reg [15:0] pass_count [0:7];
+    reg [7:0]  pass_last;       // the op that just ended completes its result
+    reg [7:0]  in_valid_d;
+    wire [7:0] op_last;         // the op fed this cycle completes its result
+    wire [7:0] op_end = PE_PARALLEL ? IN_VALID : (in_valid_d & ~IN_VALID);
+    wire [7:0] pe_store = STORE | ~(PE_PARALLEL ? op_last : pass_last);
+
+    genvar g;
+    generate
+        for (g = 0; g < 8; g = g + 1) begin : g_op_last
+            assign op_last[g] = (pass_count[g] + 1 >= PASSES);
+        end
+    endgenerate
+
+    integer p;
+    always @(posedge clk) begin
+        if (rst || PASS_RESET) begin
+            pass_last <= 8'hFF;
+            in_valid_d <= 8'b0;
+            for (p = 0; p < 8; p = p + 1)
+                pass_count[p] <= 16'b0;
+        end else begin
+            in_valid_d <= IN_VALID;
+            for (p = 0; p < 8; p = p + 1) begin
+                if (op_end[p]) begin
+                    if (pass_count[p] + 1 >= PASSES) begin
+                        pass_count[p] <= 16'b0;
+                        pass_last[p] <= 1'b1;
+                    end else begin
+                        pass_count[p] <= pass_count[p] + 1;
+                        pass_last[p] <= 1'b0;
+                    end
+                end
+            end
+        end
+    end
+
     always @(posedge clk) begin
         if (rst) begin
             C <= 256'b0;  // Set C to zero on reset
@@ -192,92 +244,186 @@ module PE_ARRAY(
     end
 
     
-    PE pe1 (
-    .clk(clk),
-    .rst(rst),
-    .A(a1),
-    .B(b1),
-    .in_valid(IN_VALID[0]),
-    .store(STORE[0]),
-    .C(c1),
-    .out_valid(out_valid1)
-    );
-    
-    PE pe2 (
-    .clk(clk),
-    .rst(rst),
-    .A(a2),
-    .B(b2),
-    .in_valid(IN_VALID[1]),
-    .store(STORE[1]),
-    .C(c2),
-    .out_valid(out_valid2)
-    );
+    // Each PE_PAR sees the full operand word; only the one whose IN_VALID
+    // bit is set takes it.
+    generate
+        if (PE_PARALLEL) begin : g_par
+            PE_PAR #(.LANES(PE_LANES)) pe1 (
+            .clk(clk),
+            .rst(rst),
+            .A(A),
+            .B(B),
+            .in_valid(IN_VALID[0]),
+            .store(pe_store[0]),
+            .C(c1),
+            .out_valid(out_valid1)
+            );
 
-    PE pe3 (
-    .clk(clk),
-    .rst(rst),
-    .A(a3),
-    .B(b3),
-    .in_valid(IN_VALID[2]),
-    .store(STORE[2]),
-    .C(c3),
-    .out_valid(out_valid3)
-    );
+            PE_PAR #(.LANES(PE_LANES)) pe2 (
+            .clk(clk),
+            .rst(rst),
+            .A(A),
+            .B(B),
+            .in_valid(IN_VALID[1]),
+            .store(pe_store[1]),
+            .C(c2),
+            .out_valid(out_valid2)
+            );
 
-    PE pe4 (
-    .clk(clk),
-    .rst(rst),
-    .A(a4),
-    .B(b4),
-    .in_valid(IN_VALID[3]),
-    .store(STORE[3]),
-    .C(c4),
-    .out_valid(out_valid4)
-    );
+            PE_PAR #(.LANES(PE_LANES)) pe3 (
+            .clk(clk),
+            .rst(rst),
+            .A(A),
+            .B(B),
+            .in_valid(IN_VALID[2]),
+            .store(pe_store[2]),
+            .C(c3),
+            .out_valid(out_valid3)
+            );
 
-    PE pe5 (
-    .clk(clk),
-    .rst(rst),
-    .A(a5),
-    .B(b5),
-    .in_valid(IN_VALID[4]),
-    .store(STORE[4]),
-    .C(c5),
-    .out_valid(out_valid5)
-    );
+            PE_PAR #(.LANES(PE_LANES)) pe4 (
+            .clk(clk),
+            .rst(rst),
+            .A(A),
+            .B(B),
+            .in_valid(IN_VALID[3]),
+            .store(pe_store[3]),
+            .C(c4),
+            .out_valid(out_valid4)
+            );
 
-    PE pe6 (
-    .clk(clk),
-    .rst(rst),
-    .A(a6),
-    .B(b6),
-    .in_valid(IN_VALID[5]),
-    .store(STORE[5]),
-    .C(c6),
-    .out_valid(out_valid6)
-    );
+            PE_PAR #(.LANES(PE_LANES)) pe5 (
+            .clk(clk),
+            .rst(rst),
+            .A(A),
+            .B(B),
+            .in_valid(IN_VALID[4]),
+            .store(pe_store[4]),
+            .C(c5),
+            .out_valid(out_valid5)
+            );
 
-    PE pe7 (
-    .clk(clk),
-    .rst(rst),
-    .A(a7),
-    .B(b7),
-    .in_valid(IN_VALID[6]),
-    .store(STORE[6]),
-    .C(c7),
-    .out_valid(out_valid7)
-    );
+            PE_PAR #(.LANES(PE_LANES)) pe6 (
+            .clk(clk),
+            .rst(rst),
+            .A(A),
+            .B(B),
+            .in_valid(IN_VALID[5]),
+            .store(pe_store[5]),
+            .C(c6),
+            .out_valid(out_valid6)
+            );
 
-    PE pe8 (
-    .clk(clk),
-    .rst(rst),
-    .A(a8),
-    .B(b8),
-    .in_valid(IN_VALID[7]),
-    .store(STORE[7]),
-    .C(c8),
-    .out_valid(out_valid8)
-    );
+            PE_PAR #(.LANES(PE_LANES)) pe7 (
+            .clk(clk),
+            .rst(rst),
+            .A(A),
+            .B(B),
+            .in_valid(IN_VALID[6]),
+            .store(pe_store[6]),
+            .C(c7),
+            .out_valid(out_valid7)
+            );
+
+            PE_PAR #(.LANES(PE_LANES)) pe8 (
+            .clk(clk),
+            .rst(rst),
+            .A(A),
+            .B(B),
+            .in_valid(IN_VALID[7]),
+            .store(pe_store[7]),
+            .C(c8),
+            .out_valid(out_valid8)
+            );
+        end else begin : g_serial
+            PE pe1 (
+            .clk(clk),
+            .rst(rst),
+            .A(a1),
+            .B(b1),
+            .in_valid(IN_VALID[0]),
+            .store(pe_store[0]),
+            .C(c1),
+            .out_valid(out_valid1)
+            );
+
+            PE pe2 (
+            .clk(clk),
+            .rst(rst),
+            .A(a2),
+            .B(b2),
+            .in_valid(IN_VALID[1]),
+            .store(pe_store[1]),
+            .C(c2),
+            .out_valid(out_valid2)
+            );
+
+            PE pe3 (
+            .clk(clk),
+            .rst(rst),
+            .A(a3),
+            .B(b3),
+            .in_valid(IN_VALID[2]),
+            .store(pe_store[2]),
+            .C(c3),
+            .out_valid(out_valid3)
+            );
+
+            PE pe4 (
+            .clk(clk),
+            .rst(rst),
+            .A(a4),
+            .B(b4),
+            .in_valid(IN_VALID[3]),
+            .store(pe_store[3]),
+            .C(c4),
+            .out_valid(out_valid4)
+            );
+
+            PE pe5 (
+            .clk(clk),
+            .rst(rst),
+            .A(a5),
+            .B(b5),
+            .in_valid(IN_VALID[4]),
+            .store(pe_store[4]),
+            .C(c5),
+            .out_valid(out_valid5)
+            );
+
+            PE pe6 (
+            .clk(clk),
+            .rst(rst),
+            .A(a6),
+            .B(b6),
+            .in_valid(IN_VALID[5]),
+            .store(pe_store[5]),
+            .C(c6),
+            .out_valid(out_valid6)
+            );
+
+            PE pe7 (
+            .clk(clk),
+            .rst(rst),
+            .A(a7),
+            .B(b7),
+            .in_valid(IN_VALID[6]),
+            .store(pe_store[6]),
+            .C(c7),
+            .out_valid(out_valid7)
+            );
+
+            PE pe8 (
+            .clk(clk),
+            .rst(rst),
+            .A(a8),
+            .B(b8),
+            .in_valid(IN_VALID[7]),
+            .store(pe_store[7]),
+            .C(c8),
+            .out_valid(out_valid8)
+            );
+        end
+    endgenerate
     
 endmodule
@@ -0,0 +1,146 @@
+`timescale 1ns / 1ps
+//////////////////////////////////////////////////////////////////////////////////
+// Module Name: PE_PAR
+// Description: Parallel-lane replacement for PE. All nine operand bytes
+//              arrive in the single cycle in_valid is high; LANES int8
+//              multipliers and an adder tree reduce them, LANES bytes per
+//              cycle, so with LANES = 9 a new 3x3 dot product can start every
+//              cycle. store is sampled together with in_valid: when set the
+//              sum is kept for the next op, otherwise it is presented on C
+//              with a one-cycle out_valid pulse and cleared.
+//
+//              Latency from in_valid to out_valid is STEPS + 2 cycles. The
+//              next op for this PE may start STEPS cycles after the previous
+//              one (every cycle for LANES = 9).
+//////////////////////////////////////////////////////////////////////////////////
+
+
+module PE_PAR #(
+    parameter LANES = 9             // multipliers, 1..9
+)(
+    clk,
+    rst,
+    A,
+    B,
+    in_valid,
+    store,
+    C,
+    out_valid
+    );
+
+    localparam STEPS = (9 + LANES - 1) / LANES;     // cycles per dot product
+    localparam WIDTH = 8 * LANES * STEPS;           // operand bytes, zero padded
+
+    input wire clk;
+    input wire rst;
+
+    input wire [71:0] A;            // byte k = element k of the 3x3 window
+    input wire [71:0] B;
+    input wire in_valid;
+    input wire store;
+
+    output reg [31:0] C;
+    output reg out_valid;
+
+    // Operand chunks still to be multiplied for the current op
+    reg [WIDTH-1:0] a_rem, b_rem;
+    reg [3:0] steps_left;
+    reg store_op;
+
+    wire [WIDTH-1:0] a_ext = {{(WIDTH - 72){1'b0}}, A};
+    wire [WIDTH-1:0] b_ext = {{(WIDTH - 72){1'b0}}, B};
+    wire [8*LANES-1:0] a_chunk = in_valid ? a_ext[8*LANES-1:0] : a_rem[8*LANES-1:0];
+    wire [8*LANES-1:0] b_chunk = in_valid ? b_ext[8*LANES-1:0] : b_rem[8*LANES-1:0];
+    wire chunk_valid = in_valid || (steps_left != 0);
+    wire chunk_last = in_valid ? (STEPS == 1) : (steps_left == 1);
+    wire chunk_store = in_valid ? store : store_op;
+
+    always @(posedge clk) begin
+        if (rst) begin
+            a_rem <= 0;
+            b_rem <= 0;
+            steps_left <= 4'd0;
+            store_op <= 1'b0;
+        end else if (in_valid) begin
+            a_rem <= a_ext >> (8 * LANES);
+            b_rem <= b_ext >> (8 * LANES);
+            steps_left <= STEPS - 1;
+            store_op <= store;
+        end else if (steps_left != 0) begin
+            a_rem <= a_rem >> (8 * LANES);
+            b_rem <= b_rem >> (8 * LANES);
+            steps_left <= steps_left - 1;
+        end
+    end
+
+    // Stage 1: lane products
+    reg signed [15:0] prod [0:LANES-1];
+    reg valid1, last1, store1;
+
+    integer l;
+    always @(posedge clk) begin
+        if (rst) begin
+            valid1 <= 1'b0;
+            last1 <= 1'b0;
+            store1 <= 1'b0;
+            for (l = 0; l < LANES; l = l + 1)
+                prod[l] <= 16'sd0;
+        end else begin
+            valid1 <= chunk_valid;
+            last1 <= chunk_last;
+            store1 <= chunk_store;
+            for (l = 0; l < LANES; l = l + 1)
+                prod[l] <= $signed(a_chunk[8*l +: 8]) * $signed(b_chunk[8*l +: 8]);
+        end
+    end
+
+    // Stage 2: adder tree over the lanes
+    reg signed [31:0] tree;
+    integer t;
+    always @(*) begin
+        tree = 32'sd0;
+        for (t = 0; t < LANES; t = t + 1)
+            tree = tree + prod[t];
+    end
+
+    reg signed [31:0] sum2;
+    reg valid2, last2, store2;
+
+    always @(posedge clk) begin
+        if (rst) begin
+            sum2 <= 32'sd0;
+            valid2 <= 1'b0;
+            last2 <= 1'b0;
+            store2 <= 1'b0;
+        end else begin
+            sum2 <= tree;
+            valid2 <= valid1;
+            last2 <= last1;
+            store2 <= store1;
+        end
+    end
+
+    // Stage 3: accumulate chunks, and ops while store is set
+    reg signed [31:0] acc;
+    wire signed [31:0] total = acc + sum2;
+
+    always @(posedge clk) begin
+        if (rst) begin
+            acc <= 32'sd0;
+            C <= 32'b0;
+            out_valid <= 1'b0;
+        end else begin
+            out_valid <= 1'b0;
+            if (valid2) begin
+                if (last2 && !store2) begin
+                    C <= total;
+                    out_valid <= 1'b1;
+                    acc <= 32'sd0;
+                end else begin
+                    acc <= total;
+                end
+            end
+        end
+    end
+
+endmodule
@@ -0,0 +1,96 @@
+`timescale 1ns / 1ps
+// AXI4-Lite master bus-functional model standing in for the MicroBlaze data
+// port on ACC's slave interface. write()/read() take register offsets
+// (ACC_REG_* in Microblaze/acc_hal.h) and return once the response has been
+// accepted; 'gap' idle cycles follow every access, roughly the time the
+// firmware needs between two stores. Address and data are presented together,
+// as AXI_SLV only accepts a write when both are valid. BREADY and RREADY are
+// held high.
+module axi_lite_master_bfm #(
+    parameter ADDR_BASE = 32'hC000_0000     // ACC_BASE_ADDR
+)(
+    input  wire        ACLK,
+    input  wire        ARESETN,
+
+    output reg  [31:0] M_AXI_AWADDR,
+    output wire [2:0]  M_AXI_AWPROT,
+    output reg         M_AXI_AWVALID,
+    input  wire        M_AXI_AWREADY,
+
+    output reg  [31:0] M_AXI_WDATA,
+    output wire [3:0]  M_AXI_WSTRB,
+    output reg         M_AXI_WVALID,
+    input  wire        M_AXI_WREADY,
+
+    input  wire [1:0]  M_AXI_BRESP,
+    input  wire        M_AXI_BVALID,
+    output wire        M_AXI_BREADY,
+
+    output reg  [31:0] M_AXI_ARADDR,
+    output wire [2:0]  M_AXI_ARPROT,
+    output reg         M_AXI_ARVALID,
+    input  wire        M_AXI_ARREADY,
+
+    input  wire [31:0] M_AXI_RDATA,
+    input  wire [1:0]  M_AXI_RRESP,
+    input  wire        M_AXI_RVALID,
+    output wire        M_AXI_RREADY
+);
+
+    integer gap = 8;            // idle cycles after each access
+    integer writes = 0;
+    integer reads = 0;
+    integer errors = 0;         // SLVERR/DECERR responses
+
+    assign M_AXI_AWPROT = 3'b000;
+    assign M_AXI_ARPROT = 3'b000;
+    assign M_AXI_WSTRB  = 4'hF;
+    assign M_AXI_BREADY = 1'b1;
+    assign M_AXI_RREADY = 1'b1;
+
+    initial begin
+        M_AXI_AWADDR  = 32'b0;
+        M_AXI_AWVALID = 1'b0;
+        M_AXI_WDATA   = 32'b0;
+        M_AXI_WVALID  = 1'b0;
+        M_AXI_ARADDR  = 32'b0;
+        M_AXI_ARVALID = 1'b0;
+    end
+
+    // Handshakes are sampled right after the clock edge, i.e. the values the
+    // slave saw at that edge.
+    task write(input [31:0] offset, input [31:0] data);
+        begin
+            M_AXI_AWADDR  <= ADDR_BASE + offset;
+            M_AXI_WDATA   <= data;
+            M_AXI_AWVALID <= 1'b1;
+            M_AXI_WVALID  <= 1'b1;
+            @(posedge ACLK);
+            while (!(M_AXI_AWREADY && M_AXI_WREADY)) @(posedge ACLK);
+            M_AXI_AWVALID <= 1'b0;
+            M_AXI_WVALID  <= 1'b0;
+            @(posedge ACLK);
+            while (!M_AXI_BVALID) @(posedge ACLK);
+            if (M_AXI_BRESP != 2'b00) errors = errors + 1;
+            writes = writes + 1;
+            repeat (gap) @(posedge ACLK);
+        end
+    endtask
+
+    task read(input [31:0] offset, output [31:0] data);
+        begin
+            M_AXI_ARADDR  <= ADDR_BASE + offset;
+            M_AXI_ARVALID <= 1'b1;
+            @(posedge ACLK);
+            while (!M_AXI_ARREADY) @(posedge ACLK);
+            M_AXI_ARVALID <= 1'b0;
+            @(posedge ACLK);
+            while (!M_AXI_RVALID) @(posedge ACLK);
+            data = M_AXI_RDATA;
+            if (M_AXI_RRESP != 2'b00) errors = errors + 1;
+            reads = reads + 1;
+            repeat (gap) @(posedge ACLK);
+        end
+    endtask
+
+endmodule
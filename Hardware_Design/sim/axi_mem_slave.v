@@ -0,0 +1,253 @@
+`timescale 1ns / 1ps
+// AXI4 memory model for ACC's master port (DDR behind the MIG on the board).
+//
+// Serves one INCR read burst and one write burst at a time, which is all
+// AXI_MST issues. The first read beat comes RD_LATENCY cycles after the
+// address is accepted; with READY_PCT < 100 RVALID and WREADY are dropped at
+// random to model a shared interconnect.
+//
+// Storage covers [BASE, BASE + 2^SPAN_AW) in 4 KB pages that are allocated on
+// first use from a pool of MEM_PAGES, so traces can touch model DRAM, the DMA
+// window and the result window without a 64 MB array. The testbench preloads
+// words with poke(); reads of words never written return X and are counted.
+// Every accepted write beat is reported on the mon_* outputs.
+module axi_mem_slave #(
+    parameter BASE       = 32'h8400_0000,
+    parameter SPAN_AW    = 26,
+    parameter MEM_PAGES  = 4096,
+    parameter RD_LATENCY = 16,
+    parameter READY_PCT  = 100,
+    parameter SEED       = 1
+)(
+    input  wire        ACLK,
+    input  wire        ARESETN,
+    input  wire        count_en,        // statistics only advance while set
+
+    input  wire [31:0] S_AXI_AWADDR,
+    input  wire [7:0]  S_AXI_AWLEN,
+    input  wire [2:0]  S_AXI_AWSIZE,
+    input  wire [1:0]  S_AXI_AWBURST,
+    input  wire        S_AXI_AWVALID,
+    output wire        S_AXI_AWREADY,
+
+    input  wire [31:0] S_AXI_WDATA,
+    input  wire [3:0]  S_AXI_WSTRB,
+    input  wire        S_AXI_WLAST,
+    input  wire        S_AXI_WVALID,
+    output wire        S_AXI_WREADY,
+
+    output reg  [1:0]  S_AXI_BRESP,
+    output reg         S_AXI_BVALID,
+    input  wire        S_AXI_BREADY,
+
+    input  wire [31:0] S_AXI_ARADDR,
+    input  wire [7:0]  S_AXI_ARLEN,
+    input  wire [2:0]  S_AXI_ARSIZE,
+    input  wire [1:0]  S_AXI_ARBURST,
+    input  wire        S_AXI_ARVALID,
+    output wire        S_AXI_ARREADY,
+
+    output wire [31:0] S_AXI_RDATA,
+    output wire [1:0]  S_AXI_RRESP,
+    output wire        S_AXI_RLAST,
+    output wire        S_AXI_RVALID,
+    input  wire        S_AXI_RREADY,
+
+    output wire        mon_write,       // a write beat is accepted this cycle
+    output wire [31:0] mon_addr,
+    output wire [31:0] mon_data
+);
+
+    localparam PAGE_WORDS = 1024;
+    localparam DIR_SIZE   = 1 << (SPAN_AW - 12);
+
+    reg [31:0] mem [0:MEM_PAGES*PAGE_WORDS-1];
+    integer    page_dir [0:DIR_SIZE-1];     // page index + 1, 0 if not allocated
+    integer    pages_used = 0;
+
+    // Statistics
+    integer rd_bursts = 0, rd_beats = 0, wr_bursts = 0, wr_beats = 0;
+    integer rd_wait = 0;        // cycles a read burst was waiting for its data
+    integer unmapped_reads = 0, errors = 0;
+    integer seed = SEED;
+
+    integer d;
+    initial begin
+        for (d = 0; d < DIR_SIZE; d = d + 1) page_dir[d] = 0;
+    end
+
+    function in_range(input [31:0] addr);
+        in_range = (addr >= BASE) && ((addr - BASE) >> SPAN_AW) == 0;
+    endfunction
+
+    // Word index in mem[] of a mapped address, -1 if its page is not allocated.
+    function integer word_index(input [31:0] addr);
+        integer page;
+        begin
+            word_index = -1;
+            if (in_range(addr)) begin
+                page = page_dir[(addr - BASE) >> 12];
+                if (page != 0) word_index = (page - 1) * PAGE_WORDS + addr[11:2];
+            end
+        end
+    endfunction
+
+    task map_page(input [31:0] addr);
+        begin
+            if (page_dir[(addr - BASE) >> 12] == 0) begin
+                if (pages_used == MEM_PAGES) begin
+                    $display("axi_mem_slave: out of pages at %h, raise MEM_PAGES", addr);
+                    $finish;
+                end
+                pages_used = pages_used + 1;
+                page_dir[(addr - BASE) >> 12] = pages_used;
+            end
+        end
+    endtask
+
+    task poke(input [31:0] addr, input [31:0] data);
+        begin
+            if (!in_range(addr)) begin
+                $display("axi_mem_slave: preload outside the memory at %h", addr);
+                errors = errors + 1;
+            end else begin
+                map_page(addr);
+                mem[word_index(addr)] = data;
+            end
+        end
+    endtask
+
+    function [31:0] peek(input [31:0] addr);
+        integer idx;
+        begin
+            idx = word_index(addr);
+            peek = (idx < 0) ? 32'bx : mem[idx];
+        end
+    endfunction
+
+    function throttle(input integer dummy);
+        throttle = (READY_PCT >= 100) || (($random(seed) % 100 + 100) % 100 < READY_PCT);
+    endfunction
+
+    ///////////////////////////////////////////////////////////////// reads
+    reg        rd_active;
+    reg [31:0] rd_addr;
+    reg [7:0]  rd_left;             // beats after the current one
+    reg [15:0] rd_delay;
+    reg        rd_valid;
+    reg [31:0] rd_data;
+    reg [1:0]  rd_resp;
+
+    assign S_AXI_ARREADY = ARESETN && !rd_active;
+    assign S_AXI_RVALID  = rd_valid;
+    assign S_AXI_RDATA   = rd_data;
+    assign S_AXI_RRESP   = rd_resp;
+    assign S_AXI_RLAST   = rd_valid && (rd_left == 0);
+
+    always @(posedge ACLK) begin
+        if (!ARESETN) begin
+            rd_active <= 1'b0;
+            rd_valid <= 1'b0;
+            rd_addr <= 32'b0;
+            rd_left <= 8'd0;
+            rd_delay <= 16'd0;
+            rd_data <= 32'b0;
+            rd_resp <= 2'b00;
+        end else begin
+            if (S_AXI_ARVALID && S_AXI_ARREADY) begin
+                rd_active <= 1'b1;
+                rd_addr <= S_AXI_ARADDR;
+                rd_left <= S_AXI_ARLEN;
+                rd_delay <= RD_LATENCY;
+                if (count_en) rd_bursts = rd_bursts + 1;
+                if (S_AXI_ARBURST != 2'b01 || S_AXI_ARSIZE != 3'd2) begin
+                    $display("axi_mem_slave: unsupported read burst type %0d size %0d at %h",
+                             S_AXI_ARBURST, S_AXI_ARSIZE, S_AXI_ARADDR);
+                    errors = errors + 1;
+                end
+            end
+            if (rd_active && count_en && !(rd_valid && S_AXI_RREADY)) rd_wait = rd_wait + 1;
+
+            if (rd_valid && S_AXI_RREADY) begin
+                rd_valid <= 1'b0;
+                if (count_en) rd_beats = rd_beats + 1;
+                if (rd_left == 0) begin
+                    rd_active <= 1'b0;
+                end else begin
+                    rd_left <= rd_left - 1;
+                    rd_addr <= rd_addr + 4;
+                end
+            end
+
+            // Offer the next beat once the first-beat latency has passed.
+            if (rd_active && rd_delay != 0) begin
+                rd_delay <= rd_delay - 1;
+            end else if (rd_active && (!rd_valid || S_AXI_RREADY) && !(rd_valid && rd_left == 0) &&
+                         throttle(0)) begin
+                rd_valid <= 1'b1;
+                rd_data <= peek(rd_valid ? rd_addr + 4 : rd_addr);
+                rd_resp <= in_range(rd_valid ? rd_addr + 4 : rd_addr) ? 2'b00 : 2'b10;
+                if (word_index(rd_valid ? rd_addr + 4 : rd_addr) < 0) unmapped_reads = unmapped_reads + 1;
+            end
+        end
+    end
+
+    ///////////////////////////////////////////////////////////////// writes
+    reg        wr_active;           // address accepted, data beats pending
+    reg [31:0] wr_addr;
+    reg        wr_ready;
+    reg        wr_error;
+
+    assign S_AXI_AWREADY = ARESETN && !wr_active && !S_AXI_BVALID;
+    assign S_AXI_WREADY  = wr_ready;
+    assign mon_write     = S_AXI_WVALID && wr_ready;
+    assign mon_addr      = wr_addr;
+    assign mon_data      = S_AXI_WDATA;
+
+    integer b;
+    reg [31:0] merged;
+
+    always @(posedge ACLK) begin
+        if (!ARESETN) begin
+            wr_active <= 1'b0;
+            wr_addr <= 32'b0;
+            wr_ready <= 1'b0;
+            wr_error <= 1'b0;
+            S_AXI_BVALID <= 1'b0;
+            S_AXI_BRESP <= 2'b00;
+        end else begin
+            if (S_AXI_AWVALID && S_AXI_AWREADY) begin
+                wr_active <= 1'b1;
+                wr_addr <= S_AXI_AWADDR;
+                wr_error <= !in_range(S_AXI_AWADDR);
+                if (count_en) wr_bursts = wr_bursts + 1;
+                if (S_AXI_AWBURST != 2'b01 || S_AXI_AWSIZE != 3'd2) begin
+                    $display("axi_mem_slave: unsupported write burst type %0d size %0d at %h",
+                             S_AXI_AWBURST, S_AXI_AWSIZE, S_AXI_AWADDR);
+                    errors = errors + 1;
+                end
+            end
+
+            if (S_AXI_WVALID && wr_ready) begin
+                if (in_range(wr_addr)) begin
+                    map_page(wr_addr);
+                    merged = mem[word_index(wr_addr)];
+                    for (b = 0; b < 4; b = b + 1)
+                        if (S_AXI_WSTRB[b]) merged[8*b +: 8] = S_AXI_WDATA[8*b +: 8];
+                    mem[word_index(wr_addr)] = merged;
+                end
+                if (count_en) wr_beats = wr_beats + 1;
+                wr_addr <= wr_addr + 4;
+                if (S_AXI_WLAST) begin
+                    wr_active <= 1'b0;
+                    S_AXI_BVALID <= 1'b1;
+                    S_AXI_BRESP <= wr_error ? 2'b10 : 2'b00;
+                end
+            end
+            wr_ready <= wr_active && !(S_AXI_WVALID && wr_ready && S_AXI_WLAST) && throttle(0);
+
+            if (S_AXI_BVALID && S_AXI_BREADY) S_AXI_BVALID <= 1'b0;
+        end
+    end
+
+endmodule
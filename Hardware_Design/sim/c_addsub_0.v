@@ -0,0 +1,27 @@
+`timescale 1ns / 1ps
+// Simulation stand-in for the Vivado Adder/Subtracter IP instantiated by
+// PE.v (simulation only). 32-bit A + B with two pipeline stages, no clock
+// enable, cleared by SCLR.
+module c_addsub_0 (
+    input  wire [31:0] A,
+    input  wire [31:0] B,
+    input  wire        CLK,
+    input  wire        SCLR,
+    output wire [31:0] S
+);
+
+    reg [31:0] s1, s2;
+
+    always @(posedge CLK) begin
+        if (SCLR) begin
+            s1 <= 32'b0;
+            s2 <= 32'b0;
+        end else begin
+            s1 <= A + B;
+            s2 <= s1;
+        end
+    end
+
+    assign S = s2;
+
+endmodule
@@ -0,0 +1,29 @@
+#!/bin/sh
+# Records the accelerator command streams of one inference with the host
+# build of the firmware (Microblaze/acc_model.c, ACC_HOST_TRACE), for both
+# feeds:
+#   ./gen_traces.sh model_params.bin [audio.bin] [outdir]
+# writes <outdir>/{ring,mmio}_{conv1,conv2,fc1,fc2}.trace (default outdir:
+# traces). conv1 covers the first three rows and conv2 the first row. Traces
+# stop after ACC_HOST_TRACE_RECORDS records (default here 1000000), which cuts
+# fc1 on the MMIO feed off before its first results. The dense fc1 trace on the ring feed holds the
+# whole weight matrix (GEMV engine) and needs MEM_PAGES=8192.
+# The voice activity gate is off so that any spectrogram is classified.
+set -e
+export ACC_HOST_TRACE_RECORDS=${ACC_HOST_TRACE_RECORDS:-1000000}
+model=$(realpath "$1")
+audio=${2:+$(realpath "$2")}
+out=$(realpath -m "${3:-traces}")
+cd "$(dirname "$0")"
+mkdir -p "$out"
+gcc -O2 -DACC_HOST_BUILD -o "$out/acc_host" ../../Microblaze/ACC.c ../../Microblaze/acc_dma.c \
+    ../../Microblaze/acc_perf.c ../../Microblaze/acc_quant.c ../../Microblaze/acc_sw.c \
+    ../../Microblaze/acc_store.c ../../Microblaze/acc_log.c ../../Microblaze/acc_vad.c ../../Microblaze/acc_arena.c \
+    ../../Microblaze/acc_host.c ../../Microblaze/acc_model.c -lm
+for feed in ring mmio; do
+    for layer in conv1 conv2 fc1 fc2; do
+        env ACC_HOST_MODEL="$model" ${audio:+ACC_HOST_AUDIO="$audio"} ACC_HOST_RUNS=1 ACC_HOST_VAD=off ACC_HOST_BACKEND=accel \
+            ACC_HOST_FEED=$feed ACC_HOST_TRACE=$out/${feed}_$layer.trace ACC_HOST_TRACE_LAYER=$layer \
+            "$out/acc_host" | grep "trace records"
+    done
+done
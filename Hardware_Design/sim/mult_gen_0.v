@@ -0,0 +1,32 @@
+`timescale 1ns / 1ps
+// Simulation stand-in for the Vivado Multiplier IP instantiated by PE.v
+// (simulation only; the synthesized design uses the generated core).
+// Signed 8 x 8 -> 16 with three pipeline stages, all advanced by CE and
+// cleared by SCLR. PE.v's counter sequencing only accumulates correctly with
+// this latency together with the two-stage c_addsub_0.
+module mult_gen_0 (
+    input  wire        CLK,
+    input  wire [7:0]  A,
+    input  wire [7:0]  B,
+    input  wire        CE,
+    input  wire        SCLR,
+    output wire [15:0] P
+);
+
+    reg [15:0] p1, p2, p3;
+
+    always @(posedge CLK) begin
+        if (SCLR) begin
+            p1 <= 16'b0;
+            p2 <= 16'b0;
+            p3 <= 16'b0;
+        end else if (CE) begin
+            p1 <= $signed(A) * $signed(B);
+            p2 <= p1;
+            p3 <= p2;
+        end
+    end
+
+    assign P = p3;
+
+endmodule
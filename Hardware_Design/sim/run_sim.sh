@@ -0,0 +1,31 @@
+#!/bin/sh
+# Builds the ACC testbench with Icarus Verilog and replays traces on it:
+#   ./run_sim.sh [-P<param>=<value> ...] trace... [+plusarg ...]
+# -P overrides a tb_acc parameter (PE_PARALLEL, PE_LANES, MEM_PAGES,
+# RD_LATENCY, READY_PCT), +plusargs are passed to every run (see tb_acc.v).
+# Prints each run's report and exits non-zero if any trace fails.
+set -e
+cd "$(dirname "$0")"
+params=""
+traces=""
+plusargs=""
+for arg in "$@"; do
+    case $arg in
+        -P*) params="$params -Ptb_acc.${arg#-P}" ;;
+        +*)  plusargs="$plusargs $arg" ;;
+        /*)  traces="$traces $arg" ;;
+        *)   traces="$traces $OLDPWD/$arg" ;;
+    esac
+done
+[ -n "$traces" ] || { echo "usage: $0 [-Pparam=value ...] trace... [+plusarg ...]"; exit 2; }
+
+iverilog -g2005 -Wall -s tb_acc $params -o tb_acc.vvp \
+    tb_acc.v axi_lite_master_bfm.v axi_mem_slave.v mult_gen_0.v c_addsub_0.v \
+    ../ACC.v ../AXI_MST.v ../AXI_SLV.v ../PE_ARRAY.v ../PE.v ../PE_PAR.v
+
+status=0
+for trace in $traces; do
+    vvp -n tb_acc.vvp +trace="$trace" $plusargs | tee tb_acc.log | grep "^tb_acc:"
+    grep -q "^tb_acc: PASS" tb_acc.log || status=1
+done
+exit $status
@@ -0,0 +1,338 @@
+`timescale 1ns / 1ps
+// Trace-driven testbench for ACC.
+//
+// Replays a trace written by the host firmware model (Microblaze/acc_model.c,
+// ACC_HOST_TRACE) on the RTL: register writes and polls go through the
+// AXI-Lite master BFM, DDR contents are preloaded into the AXI memory model
+// just before the accelerator needs them, and every result word ACC writes is
+// checked, in order, against the model's result at that address.
+//
+// At the end the performance counters (0x80-0xA0) are read back and the run
+// is summarized: MACs per cycle (9 per 3x3 op, 4 per GEMV weight beat), AXI
+// channel utilization, result latency per kind of trigger (register-fed op,
+// descriptor doorbell, GEMV start) and the time the firmware would spend
+// polling. The op and GEMV beat counters must match the model. The run ends
+// with "tb_acc: PASS" or "tb_acc: FAIL".
+//
+// Plusargs:
+//   +trace=<file>      trace to replay (default trace.txt)
+//   +gap=<cycles>      idle cycles after each register access (default 8)
+//   +timeout=<cycles>  longest poll or wait for a result (default 200000)
+//   +min_mpc=<n>       fail below n / 1000 MACs per cycle (default 0)
+//   +vcd               dump waveforms to tb_acc.vcd
+module tb_acc;
+
+    parameter PE_PARALLEL = 0;
+    parameter PE_LANES    = 9;
+    parameter MEM_PAGES   = 4096;
+    parameter RD_LATENCY  = 16;
+    parameter READY_PCT   = 100;
+    parameter CLK_PERIOD  = 10;         // 100 MHz
+    localparam SB_DEPTH   = 65536;      // results in flight
+
+    reg ACLK = 1'b0;
+    reg ARESETN = 1'b0;
+    always #(CLK_PERIOD / 2) ACLK = ~ACLK;
+
+    // ACC slave port
+    wire [31:0] s_awaddr, s_wdata, s_araddr, s_rdata;
+    wire [2:0]  s_awprot, s_arprot;
+    wire [3:0]  s_wstrb;
+    wire [1:0]  s_bresp, s_rresp;
+    wire        s_awvalid, s_awready, s_wvalid, s_wready, s_bvalid, s_bready;
+    wire        s_arvalid, s_arready, s_rvalid, s_rready;
+
+    // ACC master port
+    wire [31:0] m_awaddr, m_wdata, m_araddr, m_rdata;
+    wire [7:0]  m_awlen, m_arlen;
+    wire [2:0]  m_awsize, m_awprot, m_arsize, m_arprot;
+    wire [1:0]  m_awburst, m_arburst, m_bresp, m_rresp;
+    wire [3:0]  m_wstrb;
+    wire        m_awvalid, m_awready, m_wlast, m_wvalid, m_wready, m_bvalid, m_bready;
+    wire        m_arvalid, m_arready, m_rlast, m_rvalid, m_rready;
+
+    wire        mon_write;
+    wire [31:0] mon_addr, mon_data;
+    reg         measuring = 1'b0;       // between the trace's PERF_CTRL run write and the end
+
+    ACC #(
+        .PE_PARALLEL(PE_PARALLEL),
+        .PE_LANES(PE_LANES)
+    ) dut (
+        .ACLK(ACLK), .ARESETN(ARESETN),
+        .S_AXI_AWADDR(s_awaddr), .S_AXI_AWPROT(s_awprot), .S_AXI_AWVALID(s_awvalid), .S_AXI_AWREADY(s_awready),
+        .S_AXI_WDATA(s_wdata), .S_AXI_WSTRB(s_wstrb), .S_AXI_WVALID(s_wvalid), .S_AXI_WREADY(s_wready),
+        .S_AXI_BRESP(s_bresp), .S_AXI_BVALID(s_bvalid), .S_AXI_BREADY(s_bready),
+        .S_AXI_ARADDR(s_araddr), .S_AXI_ARPROT(s_arprot), .S_AXI_ARVALID(s_arvalid), .S_AXI_ARREADY(s_arready),
+        .S_AXI_RDATA(s_rdata), .S_AXI_RRESP(s_rresp), .S_AXI_RVALID(s_rvalid), .S_AXI_RREADY(s_rready),
+        .M_AXI_AWADDR(m_awaddr), .M_AXI_AWLEN(m_awlen), .M_AXI_AWSIZE(m_awsize), .M_AXI_AWBURST(m_awburst),
+        .M_AXI_AWPROT(m_awprot), .M_AXI_AWVALID(m_awvalid), .M_AXI_AWREADY(m_awready),
+        .M_AXI_WDATA(m_wdata), .M_AXI_WSTRB(m_wstrb), .M_AXI_WLAST(m_wlast), .M_AXI_WVALID(m_wvalid),
+        .M_AXI_WREADY(m_wready),
+        .M_AXI_BRESP(m_bresp), .M_AXI_BVALID(m_bvalid), .M_AXI_BREADY(m_bready),
+        .M_AXI_ARADDR(m_araddr), .M_AXI_ARLEN(m_arlen), .M_AXI_ARSIZE(m_arsize), .M_AXI_ARBURST(m_arburst),
+        .M_AXI_ARPROT(m_arprot), .M_AXI_ARVALID(m_arvalid), .M_AXI_ARREADY(m_arready),
+        .M_AXI_RDATA(m_rdata), .M_AXI_RRESP(m_rresp), .M_AXI_RLAST(m_rlast), .M_AXI_RVALID(m_rvalid),
+        .M_AXI_RREADY(m_rready)
+    );
+
+    axi_lite_master_bfm cpu (
+        .ACLK(ACLK), .ARESETN(ARESETN),
+        .M_AXI_AWADDR(s_awaddr), .M_AXI_AWPROT(s_awprot), .M_AXI_AWVALID(s_awvalid), .M_AXI_AWREADY(s_awready),
+        .M_AXI_WDATA(s_wdata), .M_AXI_WSTRB(s_wstrb), .M_AXI_WVALID(s_wvalid), .M_AXI_WREADY(s_wready),
+        .M_AXI_BRESP(s_bresp), .M_AXI_BVALID(s_bvalid), .M_AXI_BREADY(s_bready),
+        .M_AXI_ARADDR(s_araddr), .M_AXI_ARPROT(s_arprot), .M_AXI_ARVALID(s_arvalid), .M_AXI_ARREADY(s_arready),
+        .M_AXI_RDATA(s_rdata), .M_AXI_RRESP(s_rresp), .M_AXI_RVALID(s_rvalid), .M_AXI_RREADY(s_rready)
+    );
+
+    axi_mem_slave #(
+        .MEM_PAGES(MEM_PAGES),
+        .RD_LATENCY(RD_LATENCY),
+        .READY_PCT(READY_PCT)
+    ) ddr (
+        .ACLK(ACLK), .ARESETN(ARESETN), .count_en(measuring),
+        .S_AXI_AWADDR(m_awaddr), .S_AXI_AWLEN(m_awlen), .S_AXI_AWSIZE(m_awsize), .S_AXI_AWBURST(m_awburst),
+        .S_AXI_AWVALID(m_awvalid), .S_AXI_AWREADY(m_awready),
+        .S_AXI_WDATA(m_wdata), .S_AXI_WSTRB(m_wstrb), .S_AXI_WLAST(m_wlast), .S_AXI_WVALID(m_wvalid),
+        .S_AXI_WREADY(m_wready),
+        .S_AXI_BRESP(m_bresp), .S_AXI_BVALID(m_bvalid), .S_AXI_BREADY(m_bready),
+        .S_AXI_ARADDR(m_araddr), .S_AXI_ARLEN(m_arlen), .S_AXI_ARSIZE(m_arsize), .S_AXI_ARBURST(m_arburst),
+        .S_AXI_ARVALID(m_arvalid), .S_AXI_ARREADY(m_arready),
+        .S_AXI_RDATA(m_rdata), .S_AXI_RRESP(m_rresp), .S_AXI_RLAST(m_rlast), .S_AXI_RVALID(m_rvalid),
+        .S_AXI_RREADY(m_rready),
+        .mon_write(mon_write), .mon_addr(mon_addr), .mon_data(mon_data)
+    );
+
+    ///////////////////////////////////////////////////////////////// result scoreboard
+    // Results leave ACC in the order the model produced them (PEs finish in
+    // issue order, the write-combining FIFO keeps it), so each write beat is
+    // compared with the oldest outstanding expectation.
+    localparam TRIG_OP = 0, TRIG_DESC = 1, TRIG_GEMV = 2, TRIG_OTHER = 3;
+
+    reg [31:0] sb_addr [0:SB_DEPTH-1];
+    reg [31:0] sb_data [0:SB_DEPTH-1];
+    integer    sb_time [0:SB_DEPTH-1];      // cycle the triggering write completed
+    reg [1:0]  sb_trig [0:SB_DEPTH-1];
+    integer    sb_wr = 0, sb_rd = 0;
+    integer    sb_last = 0;                 // cycle of the last checked result
+
+    integer cycle = 0;
+    integer checked = 0, mismatches = 0, unexpected = 0;
+    integer lat_count [0:3];
+    integer lat_min [0:3];
+    integer lat_max [0:3];
+    real    lat_sum [0:3];
+
+    integer ck_slot, ck_lat, ck_trig;
+    initial begin
+        for (ck_trig = 0; ck_trig < 4; ck_trig = ck_trig + 1) begin
+            lat_count[ck_trig] = 0;
+            lat_min[ck_trig] = 0;
+            lat_max[ck_trig] = 0;
+            lat_sum[ck_trig] = 0.0;
+        end
+    end
+
+    always @(posedge ACLK) begin
+        cycle = cycle + 1;
+        if (mon_write) begin
+            if (sb_rd == sb_wr) begin
+                unexpected = unexpected + 1;
+                if (unexpected <= 10) $display("tb_acc: unexpected write of %h to %h", mon_data, mon_addr);
+            end else begin
+                ck_slot = sb_rd % SB_DEPTH;
+                if (mon_addr !== sb_addr[ck_slot] || mon_data !== sb_data[ck_slot]) begin
+                    mismatches = mismatches + 1;
+                    if (mismatches <= 10)
+                        $display("tb_acc: result %0d: wrote %h to %h, expected %h at %h",
+                                 checked, mon_data, mon_addr, sb_data[ck_slot], sb_addr[ck_slot]);
+                end
+                ck_lat = cycle - sb_time[ck_slot];
+                ck_trig = sb_trig[ck_slot];
+                if (lat_count[ck_trig] == 0 || ck_lat < lat_min[ck_trig]) lat_min[ck_trig] = ck_lat;
+                if (ck_lat > lat_max[ck_trig]) lat_max[ck_trig] = ck_lat;
+                lat_sum[ck_trig] = lat_sum[ck_trig] + ck_lat;
+                lat_count[ck_trig] = lat_count[ck_trig] + 1;
+                checked = checked + 1;
+                sb_rd = sb_rd + 1;
+                sb_last = cycle;
+            end
+        end
+    end
+
+    ///////////////////////////////////////////////////////////////// trace replay
+    reg [8*256-1:0] trace_name;
+    integer fd, fields, gap, timeout, min_mpc, slot, t;
+    integer n_writes = 0, n_polls = 0, n_words = 0, n_layers = 0;
+    integer poll_cycles = 0, t0 = 0, t_end = 0;
+    integer exp_ops = -1, exp_beats = -1;
+    reg [7:0]  kind;
+    reg [31:0] a, b, v;
+    reg [1:0]  trig;
+    reg        done, failed;
+    integer    issue_time;
+
+    // Performance counters, read back at the end
+    reg [31:0] perf [0:7];
+    localparam PERF_CYCLES = 0, PERF_BUSY = 1, PERF_IDLE = 2, PERF_OPS = 3,
+               PERF_GEMV_BEATS = 4, PERF_STALL = 5, PERF_RD_BYTES = 6, PERF_WR_BYTES = 7;
+
+    task show_layer(input [31:0] id);
+        begin
+            case (id)
+                0: $display("tb_acc: conv1 at cycle %0d", cycle);
+                1: $display("tb_acc: conv2 at cycle %0d", cycle);
+                2: $display("tb_acc: fc1 at cycle %0d", cycle);
+                3: $display("tb_acc: fc2 at cycle %0d", cycle);
+                default: $display("tb_acc: layer %0d at cycle %0d", id, cycle);
+            endcase
+        end
+    endtask
+
+    task show_latency(input integer k, input [8*24-1:0] what);
+        begin
+            if (lat_count[k] != 0)
+                $display("tb_acc: %0s latency min %0d avg %0.1f max %0d cycles over %0d results",
+                         what, lat_min[k], lat_sum[k] / lat_count[k], lat_max[k], lat_count[k]);
+        end
+    endtask
+
+    real cycles_r, macs, mpc;
+
+    initial begin
+        if (!$value$plusargs("trace=%s", trace_name)) trace_name = "trace.txt";
+        if (!$value$plusargs("gap=%d", gap)) gap = 8;
+        if (!$value$plusargs("timeout=%d", timeout)) timeout = 200000;
+        if (!$value$plusargs("min_mpc=%d", min_mpc)) min_mpc = 0;
+        if ($test$plusargs("vcd")) begin
+            $dumpfile("tb_acc.vcd");
+            $dumpvars(0, tb_acc);
+        end
+        cpu.gap = gap;
+        done = 1'b0;
+        failed = 1'b0;
+        issue_time = 0;
+        trig = TRIG_OTHER;
+
+        fd = $fopen(trace_name, "r");
+        if (fd == 0) begin
+            $display("tb_acc: cannot open trace %0s", trace_name);
+            $display("tb_acc: FAIL");
+            $finish;
+        end
+
+        repeat (10) @(posedge ACLK);
+        ARESETN <= 1'b1;
+        repeat (10) @(posedge ACLK);
+
+        while (!done && !failed) begin
+            fields = $fscanf(fd, " %c %h %h", kind, a, b);
+            if (fields != 3) begin
+                done = 1'b1;
+            end else begin
+                case (kind)
+                    "W": begin
+                        cpu.write(a, b);
+                        n_writes = n_writes + 1;
+                        issue_time = cycle;
+                        trig = (a == 32'h14 || a == 32'h2C) ? TRIG_OP :
+                               (a == 32'h48) ? TRIG_DESC :
+                               (a == 32'h7C) ? TRIG_GEMV : TRIG_OTHER;
+                        if (a == 32'h80 && b[1]) begin
+                            measuring = 1'b1;
+                            t0 = cycle;
+                        end
+                    end
+                    "R": begin
+                        t = cycle;
+                        cpu.read(a, v);
+                        while (v !== b && cycle - t < timeout) cpu.read(a, v);
+                        poll_cycles = poll_cycles + (cycle - t);
+                        n_polls = n_polls + 1;
+                        if (v !== b) begin
+                            $display("tb_acc: register %h still reads %h after %0d cycles, expected %h",
+                                     a, v, timeout, b);
+                            failed = 1'b1;
+                        end
+                    end
+                    "M": begin
+                        ddr.poke(a, b);
+                        n_words = n_words + 1;
+                    end
+                    "E": begin
+                        while (sb_wr - sb_rd >= SB_DEPTH) @(posedge ACLK);
+                        slot = sb_wr % SB_DEPTH;
+                        sb_addr[slot] = a;
+                        sb_data[slot] = b;
+                        sb_time[slot] = issue_time;
+                        sb_trig[slot] = trig;
+                        sb_wr = sb_wr + 1;
+                    end
+                    "L": begin
+                        show_layer(a);
+                        n_layers = n_layers + 1;
+                    end
+                    "S": begin
+                        exp_ops = a;
+                        exp_beats = b;
+                        done = 1'b1;
+                    end
+                    default: begin
+                        $display("tb_acc: bad trace record '%c'", kind);
+                        failed = 1'b1;
+                    end
+                endcase
+            end
+        end
+        $fclose(fd);
+
+        // Let the last results drain.
+        sb_last = cycle;
+        while (sb_rd != sb_wr && cycle - sb_last < timeout) @(posedge ACLK);
+        repeat (64) @(posedge ACLK);
+        t_end = cycle;
+        cpu.write(32'h80, 32'h0);
+        measuring = 1'b0;
+        for (t = 0; t < 8; t = t + 1) cpu.read(32'h84 + 4 * t, perf[t]);
+
+        cycles_r = (perf[PERF_CYCLES] != 0) ? perf[PERF_CYCLES] : 1.0;
+        macs = 9.0 * perf[PERF_OPS] + 4.0 * perf[PERF_GEMV_BEATS];
+        mpc = macs / cycles_r;
+
+        $display("tb_acc: %0s: %0d register writes, %0d polls, %0d preloaded words, %0d layer marks",
+                 trace_name, n_writes, n_polls, n_words, n_layers);
+        $display("tb_acc: %0d results checked, %0d mismatches, %0d missing, %0d unexpected",
+                 checked, mismatches, sb_wr - sb_rd, unexpected);
+        $display("tb_acc: %0d cycles counted (busy %0d, idle %0d), %0d ops, %0d GEMV beats",
+                 perf[PERF_CYCLES], perf[PERF_BUSY], perf[PERF_IDLE], perf[PERF_OPS], perf[PERF_GEMV_BEATS]);
+        $display("tb_acc: %0.3f MACs/cycle", mpc);
+        $display("tb_acc: AXI read %0d bursts, %0d beats (%0.1f%% of cycles), %0d cycles waiting for data",
+                 ddr.rd_bursts, ddr.rd_beats, 100.0 * ddr.rd_beats / cycles_r, ddr.rd_wait);
+        $display("tb_acc: AXI write %0d bursts, %0d beats (%0.1f%% of cycles), %0d master stall cycles",
+                 ddr.wr_bursts, ddr.wr_beats, 100.0 * ddr.wr_beats / cycles_r, perf[PERF_STALL]);
+        show_latency(TRIG_OP, "register op");
+        show_latency(TRIG_DESC, "descriptor result");
+        show_latency(TRIG_GEMV, "GEMV result");
+        $display("tb_acc: %0d cycles polling, %0d cycles replayed", poll_cycles, t_end - t0);
+
+        if (ddr.unmapped_reads != 0) $display("tb_acc: %0d reads of words the trace never preloaded", ddr.unmapped_reads);
+        if (perf[PERF_RD_BYTES] != 4 * ddr.rd_beats || perf[PERF_WR_BYTES] != 4 * ddr.wr_beats) begin
+            $display("tb_acc: byte counters %0d/%0d disagree with the bus (%0d/%0d beats)",
+                     perf[PERF_RD_BYTES], perf[PERF_WR_BYTES], ddr.rd_beats, ddr.wr_beats);
+            failed = 1'b1;
+        end
+        if (exp_ops >= 0 && (perf[PERF_OPS] != exp_ops || perf[PERF_GEMV_BEATS] != exp_beats)) begin
+            $display("tb_acc: model expects %0d ops and %0d GEMV beats", exp_ops, exp_beats);
+            failed = 1'b1;
+        end
+        if (mpc * 1000.0 < min_mpc) begin
+            $display("tb_acc: below the required %0.3f MACs/cycle", min_mpc / 1000.0);
+            failed = 1'b1;
+        end
+        if (mismatches != 0 || unexpected != 0 || sb_rd != sb_wr || cpu.errors != 0 || ddr.errors != 0)
+            failed = 1'b1;
+        $display("tb_acc: %0s", failed ? "FAIL" : "PASS");
+        $finish;
+    end
+
+endmodule
@@ -1,14 +1,17 @@
-#include "xil_cache.h"
-#include "xemaclite.h"
-#include "xparameters.h"
-#include "xil_printf.h"
-#include "xtmrctr.h"
-#include "platform.h"
+#include "acc_hal.h"
+#include "acc_quant.h"
+#include "acc_sw.h"
+#include "acc_dma.h"
+#include "acc_perf.h"
+#include "acc_store.h"
+#include "acc_log.h"
+#include "acc_vad.h"
+#include "acc_arena.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <math.h>
-#include "xuartlite.h"
 
 
 //Add UARTLite globals
@@ -17,11 +20,14 @@ XUartLite UartLite;
 
 // Definitions for Reception and Inference
 #define MAX_PKT_LEN              1518    // Maximum Ethernet frame size (including padding)
-#define DRAM_BASE_ADDR           0x84030000  // DRAM base where tensor binary file is stored
 #define TOTAL_TENSORS            18     // Total number of tensors expected in the binary file
 #define ACK_ETHER_TYPE           0x88B7  // EtherType for ACK/NACK packets
 #define REQUEST_ETHER_TYPE       0x88B6  // EtherType for FPGA-to-PC request
-#define BUTTONS_BASE_ADDR        0x40000000  // Base address for buttons GPIO
+#define PERF_ETHER_TYPE          0x88B8  // EtherType for the per-inference PerfReport (acc_perf.h)
+#define MODEL_ETHER_TYPE         0x88B9  // EtherType for model slot control, both directions (acc_store.h)
+#define LOG_ETHER_TYPE           0x88BA  // EtherType for event ring dumps, both directions (acc_log.h)
+#define BATCH_ETHER_TYPE         0x88BB  // EtherType for the per-clip results of a batch
+#define VAD_ETHER_TYPE           0x88BC  // EtherType for voice activity gate settings, both directions (acc_vad.h)
 #define RAND_OUTPUT_BASE_ADDR    0x86000000
 #define DELAY_COUNT              0   // delay to give accelerator time to produce output
 
@@ -30,6 +36,28 @@ XUartLite UartLite;
 #define FRAGMENT_HEADER_SIZE_FIRST   20
 #define FRAGMENT_HEADER_SIZE         16
 
+// Sliding-window transfer (Input_weight.py send_tensor_fragments)
+#define FRAGMENT_SIZE                1400    // header + payload of every fragment but the last
+#define FRAGMENT_PAYLOAD_FIRST       (FRAGMENT_SIZE - FRAGMENT_HEADER_SIZE_FIRST)
+#define FRAGMENT_PAYLOAD             (FRAGMENT_SIZE - FRAGMENT_HEADER_SIZE)
+#define RX_MAX_FRAGMENTS             (2 + DRAM_REGION_SIZE / FRAGMENT_PAYLOAD)
+#define ACK_STATUS_NACK              0       // fragment rejected, the transfer cannot continue
+#define ACK_STATUS_ACK               1
+#define ACK_EVERY                    4       // in-order fragments per cumulative ACK
+#define ACK_DELAY_MS                 2
+#define REACK_MS                     100
+#define RX_MAX_REACKS                10
+
+// Model slot control (MODEL_ETHER_TYPE). The PC sends a u32 op and its
+// arguments; the board answers every request with a ModelReply.
+#define MODEL_OP_QUERY               1       // no arguments
+#define MODEL_OP_BEGIN               2       // model hash, tensor count, then (size, CRC) per tensor
+#define MODEL_OP_COMMIT              3       // model hash
+#define MODEL_STATUS_OK              0
+#define MODEL_STATUS_BAD_REQUEST     1
+#define MODEL_STATUS_MISSING         2       // tensors in ModelReply.mask are missing or damaged
+#define MODEL_STATUS_REJECTED        3       // does not fit a slot, or does not match the network
+
 
 // Inference parameters for the first convolution layer.
 #define INPUT_HEIGHT 124
@@ -52,51 +80,167 @@ XUartLite UartLite;
 #define CONV2_OUTPUT_WIDTH  (CONV2_INPUT_WIDTH - CONV2_KERNEL_WIDTH + 1)     // 125
 
 // Fully Connected layer
+// MaxPool2D (2x2, stride 2) after conv2; conv2 column 124 falls outside every window
+#define POOL_OUTPUT_HEIGHT (CONV2_OUTPUT_HEIGHT / 2)    // 60
+#define POOL_OUTPUT_WIDTH  (CONV2_OUTPUT_WIDTH / 2)     // 62
+#define POOL_INPUT_WIDTH   (POOL_OUTPUT_WIDTH * 2)      // 124 conv2 columns actually pooled
+#define POOL_OUTPUT_SIZE   (POOL_OUTPUT_HEIGHT * POOL_OUTPUT_WIDTH * CONV2_FILTERS)  // FC1 input
+
 #define FC1_OUTPUT_SIZE       128  // Number of neurons in FC1
 #define FC2_OUTPUT_SIZE       8    // 8 output classes
 
-// Accelerator Memory Map Definitions
-#define ACC_BASE_ADDR    0xC0000000  // Base address of accelerator IP
-#define ACC_FILTER_BASE   (ACC_BASE_ADDR)           // buffer 0 filter/input registers.
-#define ACC_INPUT_BASE    0xC000000C   // buffer 0 input registers.
-#define ACC_OUTPUT_ADDR   0x87E00000   // Accelerator outputs
+// Inference backends
+#define BACKEND_ACCEL    0   // conv/FC MACs issued to the ACC accelerator
+#define BACKEND_SW       1   // pure software kernels (acc_sw.c)
+#define BACKEND_CHECK    2   // run both, keep the accelerator result, report mismatches
+#ifndef ACC_DEFAULT_BACKEND
+#define ACC_DEFAULT_BACKEND BACKEND_ACCEL
+#endif
 
+// How the accelerator backend hands work to ACC
+#define ACC_FEED_MMIO    0   // six register writes per 3x3 MAC, three with banked weights
+#define ACC_FEED_RING    1   // command descriptors in DDR (acc_dma.h)
+#ifndef ACC_DEFAULT_FEED
+#define ACC_DEFAULT_FEED ACC_FEED_RING
+#endif
 
+// Accelerator, DRAM and peripheral memory map definitions live in acc_hal.h.
 
-// Seven Segment Display Map Definition & Variable
-#define SEVEN_SEG_ADDR   0x20000000
-volatile uint32_t* seg_ptr = (volatile uint32_t*) SEVEN_SEG_ADDR;
+
+// Seven Segment Display Variable
+volatile uint32_t* seg_ptr;
 
 // Global variable to track continuous accelerator output offset (in bytes).
 uint32_t acc_output_offset = 0;
 
+// Selected inference backend; can be changed at run time (XSDB, or ACC_HOST_BACKEND on the host).
+int inference_backend = ACC_DEFAULT_BACKEND;
+
+// Selected accelerator feed; falls back to ACC_FEED_MMIO if the ring cannot be set up.
+int accel_feed = ACC_DEFAULT_FEED;
+
+// Integer requantization tables, built once by prepare_requant_tables() after model reception.
+RequantTable conv1_requant;
+RequantTable conv2_requant;
+RequantTable fc1_requant;
+RequantTable fc2_requant;
+float fc2_logit_scale;       // FC2 output dequantization for softmax (tensor 13)
+int fc2_logit_zero_point;
+
 // Global Variables
 XEmacLite EmacLiteInstance;
-u8 RecvBuffer[MAX_PKT_LEN];
+XIntc IntcInstance;
+
+/*
+ * Interrupt-driven reception
+ *   The EmacLite receive interrupt copies each frame into rx_frames, a ring
+ *   of RX_RING_FRAMES buffers, and does nothing else. The main loop takes
+ *   frames out in order (rx_service), and so does the inference between rows
+ *   and layers (service_background), which lets the next utterance arrive
+ *   while the current one is classified. During inference only frames that
+ *   stay clear of the model are handled; a model fragment or model control
+ *   request waits at the head of the ring until the inference is over. With
+ *   the ring full the interrupt is masked, further frames wait in the
+ *   EmacLite buffers or are dropped by the MAC, and the PC resends them.
+ */
+#define RX_RING_FRAMES           32
 
-// Audio
+typedef struct {
+    u16 length;
+    u8 data[MAX_PKT_LEN];
+} RxFrame;
+
+RxFrame rx_frames[RX_RING_FRAMES];
+volatile u32 rx_ring_head = 0;       // frames received; written by the interrupt only
+volatile u32 rx_ring_tail = 0;       // frames handled; written by the main loop only
+volatile int rx_ring_stalled = 0;    // interrupt masked because the ring was full
+
+// Batches (offline labelling): up to BATCH_MAX_CLIPS recordings go out as
+// one batch, each clip its own transfer. Payload: u32 batch id, u32 clip
+// index, u32 clip count, then the spectrogram. Clips are queued in the audio
+// slots like utterances and run through the conv stack in turn; once all are
+// in, FC1 and FC2 run once for the whole batch (batch_finish) and the results
+// go back in one BATCH_ETHER_TYPE frame.
+#define BATCH_TENSOR_ID          97
+#define BATCH_HEADER_SIZE        12
+#define BATCH_MAX_CLIPS          ACC_GEMV_MAX_BATCH
+u32 batch_rx_id = 0xFFFFFFFF;        // last clip received, re-ACKed if the PC resends it
+u32 batch_rx_clip = 0;
+
+// Audio: spectrogram slots, so the next utterance can be received while the
+// current one is classified, and a whole batch can wait for its turn.
 #define AUDIO_TENSOR_ID 99
 #define AUDIO_BUFFER_SIZE (124 * 129)
-u8 AudioInputBuffer[AUDIO_BUFFER_SIZE];
-unsigned int audio_offset = 0;
-int audio_ready = 0;
+#define AUDIO_SLOTS BATCH_MAX_CLIPS
+#define AUDIO_SLOT_SIZE (BATCH_HEADER_SIZE + AUDIO_BUFFER_SIZE)
+u8 AudioInputBuffer[AUDIO_SLOTS][AUDIO_SLOT_SIZE];
+int audio_slot_tensor[AUDIO_SLOTS];  // AUDIO_TENSOR_ID, STREAM_TENSOR_ID or BATCH_TENSOR_ID
+int audio_busy_slot = -1;            // being classified
+int audio_queue[AUDIO_SLOTS];        // complete spectrograms, oldest first
+int audio_ready = 0;                 // entries in audio_queue
+int audio_requested = 0;             // requests sent whose audio has not arrived yet
+
+// Streaming: the PC sends only the spectrogram columns of new STFT frames
+// (stream_update). Payload: u32 sequence number, u32 column count (even, at
+// most STREAM_MAX_COLUMNS), then the columns one after the other, INPUT_HEIGHT
+// bytes each, low frequency first. An update always fits one fragment and is
+// queued in an audio slot like a full spectrogram.
+#define STREAM_TENSOR_ID         98
+#define STREAM_HEADER_SIZE       8
+#define STREAM_MAX_COLUMNS       10
+u32 stream_rx_sequence = 0xFFFFFFFF; // last update received, re-ACKed if the PC resends it
+
+static int is_audio_tensor(u32 tensor_id) {
+    return tensor_id == AUDIO_TENSOR_ID || tensor_id == STREAM_TENSOR_ID || tensor_id == BATCH_TENSOR_ID;
+}
 
 u8 FPGA_MAC[6] = {0x02,0xAA,0xBB,0xCC,0xDD,0xEE};
 u8 PC_MAC[6]   = {0x9C,0xEB,0xE8,0xAE,0x7E,0xF5};
 
-volatile unsigned int *button = (volatile unsigned int*)BUTTONS_BASE_ADDR;
+volatile unsigned int *button;
 
-// DRAM pointer for received tensor binary data
-volatile u8 *DRAM_ptr = (volatile u8 *)DRAM_BASE_ADDR;
-unsigned int current_offset = 0;  // Next free offset in DRAM
+// Model slot in use (acc_store.h); tensor offsets count from here.
+volatile u8 *DRAM_ptr;
 
-// Global arrays for tensor offsets and sizes
+// Global arrays for tensor offsets and sizes of the active model
 unsigned int tensor_offsets[TOTAL_TENSORS];
 unsigned int tensor_sizes[TOTAL_TENSORS];
 unsigned int tensor_count = 0;
+int model_ready = 0;
 
-// To track the expected fragment index
-unsigned int expected_fragment_index = 0;
+/*
+ * Sliding-window reception
+ *   Input_weight.py keeps up to WINDOW_FRAGMENTS fragments of one tensor in
+ *   flight. Every fragment but the last carries a full payload, so fragment
+ *   i lands at a fixed offset (fragment_offset) whatever order it arrives in;
+ *   rx_bitmap records which fragments are in place. The ACK reports the first
+ *   missing fragment (everything below it is in place) plus a bitmap of the
+ *   32 fragments after it, from which the PC resends only the holes. An ACK
+ *   goes out at once for a duplicate, a fragment past a hole, the last
+ *   fragment and every ACK_EVERY in-order fragments, otherwise after
+ *   ACK_DELAY_MS. While a transfer stalls the ACK is repeated every
+ *   REACK_MS, RX_MAX_REACKS times, in case the PC lost it.
+ */
+typedef struct {
+    int active;
+    u32 tensor_id;
+    u32 total_fragments;
+    u32 tensor_size;          // from fragment 0; 0 until it arrives
+    u8 *base;                 // staged model slot (store_tensor_dest), or an AudioInputBuffer slot
+    u32 capacity;
+    int audio_slot;           // AudioInputBuffer slot of an audio transfer
+    u32 next_missing;         // all fragments below are in place
+    u32 received;
+    u32 unacked;              // fragments since the last ACK
+    u32 last_ack;             // perf_now() of the last ACK
+    u32 reacks;
+    int done_valid;           // last completed transfer, re-ACKed if the PC resends it
+    u32 done_tensor_id;
+    u32 done_fragments;
+} RxTransfer;
+
+RxTransfer rx;
+u32 rx_bitmap[(RX_MAX_FRAGMENTS + 31) / 32];
 
 
 u32 get_u32(u8 *data) {
@@ -108,12 +252,13 @@ u32 get_u32(u8 *data) {
 
 typedef struct {
     u32 tensor_id;
-    u32 fragment_index;
-    u8 status;  // 1 for ACK, 0 for NACK
+    u32 fragment_index;     // first fragment not yet received
+    u8 status;              // ACK_STATUS_*
     u8 reserved[3];
+    u32 selective;          // bit i: fragment_index + 1 + i received
 } AckPacket;
 
-void send_ack(u32 tensor_id, u32 fragment_index, u8 status) {
+void send_ack(u32 tensor_id, u32 fragment_index, u8 status, u32 selective) {
     u8 ack_packet[14 + sizeof(AckPacket)];
     // Set Ethernet header: Destination = PC_MAC, Source = FPGA_MAC, EtherType = ACK_ETHER_TYPE.
     memcpy(ack_packet, PC_MAC, 6);
@@ -126,11 +271,153 @@ void send_ack(u32 tensor_id, u32 fragment_index, u8 status) {
     ack.fragment_index = fragment_index;
     ack.status = status;
     memset(ack.reserved, 0, sizeof(ack.reserved));
+    ack.selective = selective;
 
     memcpy(ack_packet + 14, &ack, sizeof(AckPacket));
 
     XEmacLite_Send(&EmacLiteInstance, ack_packet, 14 + sizeof(AckPacket));
-    xil_printf("Sent %s for tensor %d fragment %d\n", (status==1 ? "ACK" : "NACK"), tensor_id, fragment_index);
+}
+
+static int rx_has(u32 fragment) {
+    return (rx_bitmap[fragment >> 5] >> (fragment & 31)) & 1;
+}
+
+static u32 fragment_offset(u32 fragment) {
+    return fragment == 0 ? 0 : FRAGMENT_PAYLOAD_FIRST + (fragment - 1) * FRAGMENT_PAYLOAD;
+}
+
+/*
+ * rx_send_ack:
+ *   Cumulative + selective ACK for the current transfer.
+ */
+static void rx_send_ack(void) {
+    u32 selective = 0;
+    for (u32 i = 0; i < 32 && rx.next_missing + 1 + i < rx.total_fragments; i++) {
+        if (rx_has(rx.next_missing + 1 + i)) selective |= 1u << i;
+    }
+    send_ack(rx.tensor_id, rx.next_missing, ACK_STATUS_ACK, selective);
+    LOG_EVENT(LOG_EV_ACK, rx.tensor_id, rx.next_missing, selective);
+    rx.unacked = 0;
+    rx.last_ack = perf_now();
+}
+
+// An audio slot that is neither queued nor being classified, or -1.
+static int audio_free_slot(void) {
+    for (int slot = 0; slot < AUDIO_SLOTS; slot++) {
+        int used = (slot == audio_busy_slot);
+        for (int i = 0; i < audio_ready; i++) used |= (audio_queue[i] == slot);
+        if (!used) return slot;
+    }
+    return -1;
+}
+
+/*
+ * rx_start:
+ *   Starts receiving a tensor. Returns 0, -1 if the tensor has no place to
+ *   go, or 1 if it is audio and both slots are taken (the fragment is
+ *   ignored and resent by the PC once a slot frees up).
+ */
+static int rx_start(u32 tensor_id, u32 total_fragments) {
+    int audio_slot = -1;
+    if (is_audio_tensor(tensor_id)) {
+        audio_slot = audio_free_slot();
+        if (audio_slot < 0) return 1;
+    }
+    if (rx.active) {
+        LOG_EVENT(LOG_EV_ABANDON, rx.tensor_id, rx.next_missing, rx.total_fragments);
+        LOG_WARN("Tensor %d abandoned at fragment %d of %d, tensor %d started\n",
+                 rx.tensor_id, rx.next_missing, rx.total_fragments, tensor_id);
+    }
+    memset(rx_bitmap, 0, ((total_fragments + 31) / 32) * sizeof(u32));
+    rx.active = 1;
+    rx.tensor_id = tensor_id;
+    rx.total_fragments = total_fragments;
+    rx.tensor_size = 0;
+    rx.next_missing = 0;
+    rx.received = 0;
+    rx.unacked = 0;
+    rx.reacks = 0;
+    rx.last_ack = perf_now();
+    rx.done_valid = 0;
+    if (is_audio_tensor(tensor_id)) {
+        rx.base = AudioInputBuffer[audio_slot];
+        rx.audio_slot = audio_slot;
+        rx.capacity = AUDIO_SLOT_SIZE;
+    } else {
+        // Tensors sent without MODEL_OP_BEGIN are a complete legacy upload.
+        if (store_staging() == STORE_IDLE) store_begin_legacy();
+        rx.base = store_tensor_dest(tensor_id, &rx.capacity);
+    }
+    if (!rx.base) {
+        rx.active = 0;
+        return -1;
+    }
+    return 0;
+}
+
+static u32 model_commit(u32 *bad_mask);
+static void process_model_control(u8 *packet, int length);
+
+// Every fragment is in place: publish the tensor.
+static void rx_complete(void) {
+    rx.active = 0;
+    rx.done_valid = 1;
+    rx.done_tensor_id = rx.tensor_id;
+    rx.done_fragments = rx.total_fragments;
+    LOG_EVENT(LOG_EV_TENSOR_DONE, rx.tensor_id, rx.tensor_size, rx.total_fragments);
+    if (rx.tensor_id == AUDIO_TENSOR_ID) {
+        if (rx.tensor_size >= AUDIO_BUFFER_SIZE) {
+            LOG_DEBUG("Full audio spectrogram received. Ready for inference.\n");
+            audio_slot_tensor[rx.audio_slot] = AUDIO_TENSOR_ID;
+            audio_queue[audio_ready++] = rx.audio_slot;
+            if (audio_requested > 0) audio_requested--;
+        } else {
+            LOG_WARN("Short audio spectrogram (%d bytes) dropped.\n", rx.tensor_size);
+        }
+    } else if (rx.tensor_id == STREAM_TENSOR_ID) {
+        u32 columns = rx.tensor_size >= STREAM_HEADER_SIZE ? get_u32(rx.base + 4) : 0;
+        if (rx.tensor_size >= STREAM_HEADER_SIZE) stream_rx_sequence = get_u32(rx.base);
+        if (columns >= 2 && columns <= STREAM_MAX_COLUMNS && columns % 2 == 0 &&
+            rx.tensor_size == STREAM_HEADER_SIZE + columns * INPUT_HEIGHT) {
+            audio_slot_tensor[rx.audio_slot] = STREAM_TENSOR_ID;
+            audio_queue[audio_ready++] = rx.audio_slot;
+        } else {
+            LOG_WARN("Malformed stream update (%d bytes) dropped.\n", rx.tensor_size);
+        }
+    } else if (rx.tensor_id == BATCH_TENSOR_ID) {
+        u32 clips = rx.tensor_size >= BATCH_HEADER_SIZE ? get_u32(rx.base + 8) : 0;
+        if (rx.tensor_size >= BATCH_HEADER_SIZE) {
+            batch_rx_id = get_u32(rx.base);
+            batch_rx_clip = get_u32(rx.base + 4);
+        }
+        if (clips >= 1 && clips <= BATCH_MAX_CLIPS && batch_rx_clip < clips &&
+            rx.tensor_size == BATCH_HEADER_SIZE + AUDIO_BUFFER_SIZE) {
+            audio_slot_tensor[rx.audio_slot] = BATCH_TENSOR_ID;
+            audio_queue[audio_ready++] = rx.audio_slot;
+        } else {
+            LOG_WARN("Malformed batch clip (%d bytes) dropped.\n", rx.tensor_size);
+        }
+    } else {
+        store_tensor_received(rx.tensor_id, rx.tensor_size);
+        LOG_INFO("Tensor %d received: %d bytes in %d fragments into slot %d\n",
+                 rx.tensor_id, rx.tensor_size, rx.total_fragments, store_staged_slot());
+        // A legacy upload ends with the last tensor.
+        if (store_staging() == STORE_STAGING_LEGACY && rx.tensor_id == TOTAL_TENSORS - 1) {
+            u32 bad;
+            model_commit(&bad);
+        }
+    }
+}
+
+/*
+ * rx_forget:
+ *   Called before staging a new model, so that the next transfer of the
+ *   same tensor id is not mistaken for a resend of the previous one. Audio
+ *   counts its requests instead (audio_requested): the next one may go out
+ *   while the previous utterance is still arriving.
+ */
+static void rx_forget(void) {
+    rx.done_valid = 0;
 }
 
 void process_packet(u8 *packet, int length) {
@@ -144,7 +431,7 @@ void process_packet(u8 *packet, int length) {
 
     if (length < ETH_HEADER_SIZE + FRAGMENT_HEADER_SIZE)
     {
-        xil_printf("Packet too short, length %d\n", length);
+        LOG_WARN("Packet too short, length %d\n", length);
         return;
     }
 
@@ -152,92 +439,261 @@ void process_packet(u8 *packet, int length) {
     fragment_index = get_u32(header_ptr + 4);
     total_fragments = get_u32(header_ptr + 8);
 
-    xil_printf("Received fragment index %d (expected %d) for tensor %d, packet length %d\n",
-               fragment_index, expected_fragment_index, tensor_id, length);
-
     if (fragment_index == 0) {
         if (length < ETH_HEADER_SIZE + FRAGMENT_HEADER_SIZE_FIRST) {
-            xil_printf("First fragment packet too short, length %d\n", length);
+            LOG_WARN("First fragment packet too short, length %d\n", length);
             return;
         }
         tensor_size = get_u32(header_ptr + 12);
         actual_payload_length = get_u32(header_ptr + 16);
         header_size = FRAGMENT_HEADER_SIZE_FIRST;
-        xil_printf("Received first fragment for tensor %d, total fragments %d, tensor size %d, actual payload %d\n",
-                   tensor_id, total_fragments, tensor_size, actual_payload_length);
-
-        if (tensor_id == AUDIO_TENSOR_ID) {
-            audio_offset = 0;
-        } else if (tensor_count < TOTAL_TENSORS) {
-            tensor_count = tensor_id;
-            tensor_offsets[tensor_count] = current_offset;
-            tensor_sizes[tensor_count] = tensor_size;
-            xil_printf("Current Tensor count----------------%d\n", tensor_count);
-        }
-        expected_fragment_index = 1;
-        send_ack(tensor_id, 0, 1);
     } else {
-        if (length < ETH_HEADER_SIZE + FRAGMENT_HEADER_SIZE) {
-            xil_printf("Subsequent fragment packet too short, length %d\n", length);
-            return;
-        }
         actual_payload_length = get_u32(header_ptr + 12);
         header_size = FRAGMENT_HEADER_SIZE;
+    }
+
+    if (actual_payload_length > (unsigned int)(length - ETH_HEADER_SIZE - header_size)) {
+        LOG_WARN("Warning: actual payload length field (%d) exceeds available bytes (%d).\n",
+                 actual_payload_length, length - ETH_HEADER_SIZE - header_size);
+        actual_payload_length = length - ETH_HEADER_SIZE - header_size;
+    }
+
+    // Resend of a transfer that is already complete: the final ACK was lost.
+    // Audio that has been asked for since is the next utterance; stream
+    // updates are told apart by their sequence number, batch clips by batch
+    // id and clip index.
+    if (!(rx.active && rx.tensor_id == tensor_id) && rx.done_valid &&
+        rx.done_tensor_id == tensor_id && rx.done_fragments == total_fragments &&
+        !(tensor_id == AUDIO_TENSOR_ID && audio_requested > 0) &&
+        tensor_id != STREAM_TENSOR_ID && tensor_id != BATCH_TENSOR_ID) {
+        LOG_EVENT(LOG_EV_DUPLICATE, tensor_id, fragment_index, 0);
+        send_ack(tensor_id, total_fragments, ACK_STATUS_ACK, 0);
+        return;
+    }
+    if (tensor_id == STREAM_TENSOR_ID && fragment_index == 0 && actual_payload_length >= 4 &&
+        get_u32(header_ptr + header_size) == stream_rx_sequence) {
+        LOG_EVENT(LOG_EV_DUPLICATE, tensor_id, fragment_index, 0);
+        send_ack(tensor_id, total_fragments, ACK_STATUS_ACK, 0);
+        return;
+    }
+    if (tensor_id == BATCH_TENSOR_ID && fragment_index == 0 && actual_payload_length >= 8 &&
+        get_u32(header_ptr + header_size) == batch_rx_id &&
+        get_u32(header_ptr + header_size + 4) == batch_rx_clip) {
+        LOG_EVENT(LOG_EV_DUPLICATE, tensor_id, fragment_index, 0);
+        send_ack(tensor_id, total_fragments, ACK_STATUS_ACK, 0);
+        return;
+    }
+
+    if ((tensor_id >= TOTAL_TENSORS && !is_audio_tensor(tensor_id)) ||
+        total_fragments == 0 || total_fragments > RX_MAX_FRAGMENTS || fragment_index >= total_fragments) {
+        LOG_EVENT(LOG_EV_NACK, tensor_id, fragment_index, total_fragments);
+        LOG_WARN("Rejected fragment %d of %d for tensor %d\n", fragment_index, total_fragments, tensor_id);
+        send_ack(tensor_id, 0, ACK_STATUS_NACK, 0);
+        return;
+    }
 
-        if (fragment_index != expected_fragment_index) {
-            xil_printf("Fragment out of order for tensor %d: expected %d, got %d\n",
-                       tensor_id, expected_fragment_index, fragment_index);
-            send_ack(tensor_id, expected_fragment_index, 0);
+    if (!rx.active || rx.tensor_id != tensor_id || rx.total_fragments != total_fragments) {
+        int started = rx_start(tensor_id, total_fragments);
+        if (started > 0) return;
+        if (started < 0) {
+            LOG_EVENT(LOG_EV_NACK, tensor_id, fragment_index, total_fragments);
+            LOG_WARN("Tensor %d is not part of the model being loaded\n", tensor_id);
+            send_ack(tensor_id, 0, ACK_STATUS_NACK, 0);
             return;
-        } else {
-            xil_printf("Received fragment %d for tensor %d with actual payload %d\n",
-                       fragment_index, tensor_id, actual_payload_length);
-            send_ack(tensor_id, fragment_index, 1);
-            expected_fragment_index = fragment_index + 1;
         }
     }
+    rx.reacks = 0;
 
-    if (actual_payload_length > (unsigned int)(length - ETH_HEADER_SIZE - header_size)) {
-        xil_printf("Warning: actual payload length field (%d) exceeds available bytes (%d).\n",
-                   actual_payload_length, length - ETH_HEADER_SIZE - header_size);
-        actual_payload_length = length - ETH_HEADER_SIZE - header_size;
+    if (rx_has(fragment_index)) {
+        LOG_EVENT(LOG_EV_DUPLICATE, tensor_id, fragment_index, 0);
+        rx_send_ack();
+        return;
+    }
+
+    u32 offset = fragment_offset(fragment_index);
+    if (offset + actual_payload_length > rx.capacity ||
+        (fragment_index == 0 && tensor_size > rx.capacity)) {
+        LOG_EVENT(LOG_EV_NACK, tensor_id, fragment_index, total_fragments);
+        LOG_WARN("Fragment %d of tensor %d does not fit (%d bytes free)\n",
+                 fragment_index, tensor_id, rx.capacity);
+        send_ack(tensor_id, rx.next_missing, ACK_STATUS_NACK, 0);
+        return;
+    }
+    memcpy(rx.base + offset, packet + ETH_HEADER_SIZE + header_size, actual_payload_length);
+    rx_bitmap[fragment_index >> 5] |= 1u << (fragment_index & 31);
+    LOG_EVENT(LOG_EV_FRAGMENT, tensor_id, fragment_index, actual_payload_length);
+    rx.received++;
+    rx.unacked++;
+    if (fragment_index == 0) rx.tensor_size = tensor_size;
+
+    int in_order = (fragment_index == rx.next_missing);
+    while (rx.next_missing < rx.total_fragments && rx_has(rx.next_missing)) rx.next_missing++;
+
+    if (rx.next_missing == rx.total_fragments) {
+        rx_send_ack();
+        rx_complete();
+    } else if (!in_order || rx.unacked >= ACK_EVERY || rx.next_missing < rx.received) {
+        rx_send_ack();
     }
+}
+
+/*
+ * rx_poll:
+ *   Delayed and repeated ACKs; called on every receive_model_data().
+ */
+static void rx_poll(void) {
+    if (!rx.active) return;
+    u32 elapsed = perf_now() - rx.last_ack;
+    if (rx.unacked > 0 && elapsed >= ACK_DELAY_MS * (XPAR_TMRCTR_0_CLOCK_FREQ_HZ / 1000)) {
+        rx_send_ack();
+    } else if (elapsed >= REACK_MS * (XPAR_TMRCTR_0_CLOCK_FREQ_HZ / 1000) && rx.reacks < RX_MAX_REACKS) {
+        rx.reacks++;
+        LOG_EVENT(LOG_EV_REACK, rx.tensor_id, rx.next_missing, rx.reacks);
+        rx_send_ack();
+    }
+}
 
-    if (tensor_id != AUDIO_TENSOR_ID) {
-        memcpy((void*)(DRAM_ptr + current_offset), packet + ETH_HEADER_SIZE + header_size, actual_payload_length);
-         current_offset += actual_payload_length;
 
-         xil_printf("Copied %d bytes into DRAM; current_offset now 0x%08X\n", actual_payload_length, current_offset);
-    } else {
-    	if (audio_offset + actual_payload_length <= AUDIO_BUFFER_SIZE) {
-    	            memcpy(AudioInputBuffer + audio_offset, packet + ETH_HEADER_SIZE + header_size, actual_payload_length);
-    	            audio_offset += actual_payload_length;
-    	            xil_printf("Copied %d bytes into AudioInputBuffer; offset now %d\n", actual_payload_length, audio_offset);
+/*
+ * send_log_dump:
+ *   Answers a LOG_ETHER_TYPE request (u32 sequence number to start from)
+ *   with the events recorded since then, LOG_DUMP_EVENTS per frame. Each
+ *   frame starts with a LogDumpHeader; the PC asks again from first + count.
+ */
+#define LOG_DUMP_EVENTS  ((FRAGMENT_SIZE - sizeof(LogDumpHeader)) / sizeof(LogEvent))
+
+static void send_log_dump(u32 from) {
+    u8 dump_packet[14 + sizeof(LogDumpHeader) + LOG_DUMP_EVENTS * sizeof(LogEvent)];
+    LogEvent events[LOG_DUMP_EVENTS];
+    LogDumpHeader header;
+
+    memcpy(dump_packet, PC_MAC, 6);
+    memcpy(dump_packet + 6, FPGA_MAC, 6);
+    dump_packet[12] = (LOG_ETHER_TYPE >> 8) & 0xFF;
+    dump_packet[13] = LOG_ETHER_TYPE & 0xFF;
+    do {
+        u32 count = log_read(from, events, LOG_DUMP_EVENTS, &header);
+        memcpy(dump_packet + 14, &header, sizeof(header));
+        memcpy(dump_packet + 14 + sizeof(header), events, count * sizeof(LogEvent));
+        XEmacLite_Send(&EmacLiteInstance, dump_packet, 14 + sizeof(header) + count * sizeof(LogEvent));
+        from = header.first + count;
+    } while (header.count == LOG_DUMP_EVENTS);
+}
+
+/*
+ * process_vad_control:
+ *   A VAD_ETHER_TYPE frame carrying a VadConfig replaces the gate settings;
+ *   one starting with a zero word only asks for them (EmacLite does not
+ *   report the length of such frames, so the payload tells). The reply is
+ *   u32 status (0, or 1 for rejected settings), the VadConfig in use and the
+ *   VadStats.
+ */
+static void process_vad_control(const u8 *frame, int length) {
+    u8 reply_packet[14 + 4 + sizeof(VadConfig) + sizeof(VadStats)];
+    u32 status = 0;
+    if (length >= ETH_HEADER_SIZE + (int)sizeof(VadConfig) && get_u32((u8 *)frame + ETH_HEADER_SIZE) != 0) {
+        VadConfig config;
+        memcpy(&config, frame + ETH_HEADER_SIZE, sizeof(config));
+        status = vad_configure(&config, INPUT_HEIGHT) == 0 ? 0 : 1;
+    }
+    memcpy(reply_packet, PC_MAC, 6);
+    memcpy(reply_packet + 6, FPGA_MAC, 6);
+    reply_packet[12] = (VAD_ETHER_TYPE >> 8) & 0xFF;
+    reply_packet[13] = VAD_ETHER_TYPE & 0xFF;
+    memcpy(reply_packet + 14, &status, 4);
+    memcpy(reply_packet + 18, vad_config(), sizeof(VadConfig));
+    memcpy(reply_packet + 18 + sizeof(VadConfig), vad_stats(), sizeof(VadStats));
+    XEmacLite_Send(&EmacLiteInstance, reply_packet, sizeof(reply_packet));
+}
+
+/*
+ * emac_recv_handler:
+ *   EmacLite receive interrupt: moves one frame into the ring.
+ */
+static void emac_recv_handler(void *ref) {
+    XEmacLite *emac = (XEmacLite *)ref;
+    if (rx_ring_head - rx_ring_tail >= RX_RING_FRAMES) {
+        XEmacLite_DisableInterrupts(emac);
+        rx_ring_stalled = 1;
+        return;
+    }
+    RxFrame *frame = &rx_frames[rx_ring_head % RX_RING_FRAMES];
+    frame->length = XEmacLite_Recv(emac, frame->data);
+    if (frame->length > 0) rx_ring_head++;
+}
+
+/*
+ * rx_interrupt_setup:
+ *   Routes the EmacLite interrupt through the interrupt controller to
+ *   emac_recv_handler.
+ */
+static int rx_interrupt_setup(void) {
+    if (XIntc_Initialize(&IntcInstance, XPAR_INTC_0_DEVICE_ID) != XST_SUCCESS) return -1;
+    if (XIntc_Connect(&IntcInstance, XPAR_INTC_0_EMACLITE_0_VEC_ID,
+                      (XInterruptHandler)XEmacLite_InterruptHandler, &EmacLiteInstance) != XST_SUCCESS) return -1;
+    if (XIntc_Start(&IntcInstance, XIN_REAL_MODE) != XST_SUCCESS) return -1;
+    XIntc_Enable(&IntcInstance, XPAR_INTC_0_EMACLITE_0_VEC_ID);
+
+    Xil_ExceptionInit();
+    Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT, (Xil_ExceptionHandler)XIntc_InterruptHandler, &IntcInstance);
+    Xil_ExceptionEnable();
+
+    XEmacLite_SetRecvHandler(&EmacLiteInstance, &EmacLiteInstance, (XEmacLite_Handler)emac_recv_handler);
+    XEmacLite_FlushReceive(&EmacLiteInstance);
+    return XEmacLite_EnableInterrupts(&EmacLiteInstance) == XST_SUCCESS ? 0 : -1;
+}
+
+static int is_ether_type(const u8 *frame, int length, u16 ether_type) {
+    return length > ETH_HEADER_SIZE && frame[12] == ((ether_type >> 8) & 0xFF) && frame[13] == (ether_type & 0xFF);
+}
+
+// Frames that may not be handled while an inference uses the model.
+static int rx_frame_needs_model(const RxFrame *frame) {
+    if (is_ether_type(frame->data, frame->length, MODEL_ETHER_TYPE)) return 1;
+    return is_ether_type(frame->data, frame->length, 0x88B5) && frame->length >= ETH_HEADER_SIZE + 4 &&
+           !is_audio_tensor(get_u32((u8 *)frame->data + ETH_HEADER_SIZE));
+}
 
-    	            // Mark audio_ready when fully received
-    	            if (audio_offset >= AUDIO_BUFFER_SIZE) {
-    	                xil_printf("Full audio spectrogram received. Ready for inference.\n");
-    	                audio_ready = 1;
-    	            }
-    	        } else {
-    	            xil_printf("AudioInputBuffer overflow detected.\n");
-    	        }
+static void rx_dispatch(u8 *frame, int length) {
+    if (is_ether_type(frame, length, MODEL_ETHER_TYPE)) {
+        process_model_control(frame, length);
+    } else if (is_ether_type(frame, length, LOG_ETHER_TYPE)) {
+        send_log_dump(length >= ETH_HEADER_SIZE + 4 ? get_u32(frame + ETH_HEADER_SIZE) : 0);
+    } else if (is_ether_type(frame, length, VAD_ETHER_TYPE)) {
+        process_vad_control(frame, length);
+    } else {
+        process_packet(frame, length);
     }
 }
 
+/*
+ * rx_service:
+ *   Handles the frames in the ring, in order. During inference it stops at
+ *   the first one that needs the model.
+ */
+static void rx_service(int during_inference) {
+    while (rx_ring_tail != rx_ring_head) {
+        RxFrame *frame = &rx_frames[rx_ring_tail % RX_RING_FRAMES];
+        if (during_inference && rx_frame_needs_model(frame)) break;
+        rx_dispatch(frame->data, frame->length);
+        rx_ring_tail++;
+        if (rx_ring_stalled) {
+            rx_ring_stalled = 0;
+            XEmacLite_EnableInterrupts(&EmacLiteInstance);
+        }
+    }
+    rx_poll();
+}
 
 void receive_model_data() {
-    int recv_len = XEmacLite_Recv(&EmacLiteInstance, RecvBuffer);
-    if (recv_len > 0) {
-        process_packet(RecvBuffer, recv_len);
-    }
+    rx_service(0);
 }
 
 void print_tensor_data() {
     xil_printf("\n--- Tensor Data Verification ---\n");
-    for (int i = 0; i < tensor_count+1; i++) {
+    for (u32 i = 0; i < tensor_count; i++) {
         xil_printf("Tensor %d stored at offset: 0x%08X, size: %d bytes, DDR_ADDR: 0x%08x \n",
-                   i, tensor_offsets[i], tensor_sizes[i], (void*)&DRAM_ptr[tensor_offsets[i]]);
+                   i, tensor_offsets[i], tensor_sizes[i], (unsigned)(uintptr_t)&DRAM_ptr[tensor_offsets[i]]);
         xil_printf("First 50 bytes of tensor %d: ", i);
         for (int j = 0; j < 50; j++) {
             xil_printf("%02X ", DRAM_ptr[tensor_offsets[i] + j]);
@@ -254,8 +710,46 @@ void send_request_to_pc() {
     RequestPacket[12] = (REQUEST_ETHER_TYPE >> 8) & 0xFF;
     RequestPacket[13] = REQUEST_ETHER_TYPE & 0xFF;
 
+    audio_requested++;
     XEmacLite_Send(&EmacLiteInstance, RequestPacket, 14);
-    xil_printf("Request sent to PC for recording.\n");
+    LOG_EVENT(LOG_EV_REQUEST, 0, 0, 0);
+    LOG_DEBUG("Request sent to PC for recording.\n");
+}
+
+int last_button_state = 0;
+
+static void poll_button(void) {
+    int button_state = *button & 0x1;
+    if (button_state && !last_button_state) {  // Rising edge detected
+        LOG_INFO("Button Press Detected! Sending request to PC...\n");
+        send_request_to_pc();
+    }
+    last_button_state = button_state;
+}
+
+/*
+ * service_background:
+ *   Called between rows and layers of an inference: answers the button and
+ *   takes in audio for the next utterance.
+ */
+void service_background(void) {
+    poll_button();
+    rx_service(1);
+}
+
+/*
+ * send_perf_report:
+ *   Sends the timing report of the last inference to the PC.
+ */
+void send_perf_report(const PerfReport *report) {
+    u8 report_packet[14 + sizeof(PerfReport)];
+    memcpy(report_packet, PC_MAC, 6);
+    memcpy(report_packet + 6, FPGA_MAC, 6);
+    report_packet[12] = (PERF_ETHER_TYPE >> 8) & 0xFF;
+    report_packet[13] = PERF_ETHER_TYPE & 0xFF;
+    memcpy(report_packet + 14, report, sizeof(PerfReport));
+
+    XEmacLite_Send(&EmacLiteInstance, report_packet, 14 + sizeof(PerfReport));
 }
 
 // Tensor Structure and Helper Functions for Inference
@@ -263,98 +757,336 @@ const char* class_labels[] = {
     "down\n", "go\n", "left\n", "no\n", "right\n",
     "stop\n", "up\n", "yes\n"
 };
+#define SILENCE_CLASS  8     // reported for a clip the voice activity gate rejects
 
+#define TENSOR_MAX_DIMS        4
+#define TENSOR_ALIGN_COPY_MAX  4096   // payloads up to this size are re-homed when misaligned
+#define TENSOR_DTYPE_INT8                9
+#define TENSOR_DTYPE_INT8_BLOCK_SPARSE   10   // BlockSparseMatrix payload (acc_sw.h)
+
+/*
+ * TensorView:
+ *   Read-only description of one received tensor. Header fields are parsed once
+ *   by build_tensor_registry(); scales, zero points and data point straight
+ *   into the DRAM copy of the binary, so inference never copies weights.
+ */
 typedef struct {
     unsigned int tensor_id;
     unsigned int num_dims;
-    unsigned int *dims;
+    unsigned int dims[TENSOR_MAX_DIMS];
     unsigned int data_type;
     unsigned int num_scales;
-    float *scales;
+    const u8 *scales_q16;          // num_scales little-endian Q16 values in DRAM
     unsigned int num_zero_points;
-    int *zero_points;
+    const u8 *zero_points;         // num_zero_points little-endian int32 values in DRAM
     unsigned int data_length;
-    unsigned char *data;
-} Tensor;
+    const u8 *data;                // DRAM payload, or aligned_copy when re-homed
+    void *aligned_copy;            // heap copy owned by the registry (NULL if zero-copy)
+    BlockSparseMatrix sparse;      // TENSOR_DTYPE_INT8_BLOCK_SPARSE only; row_start owned by the registry
+} TensorView;
+
+TensorView tensor_registry[TOTAL_TENSORS];
+unsigned int tensor_registry_count = 0;
+
+// Layer parameters bound to registry views by bind_model_tensors().
+const int8_t *conv1_filters;
+const int32_t *conv1_biases;
+const int8_t *conv2_filters;
+const int32_t *conv2_biases;
+const int8_t *fc1_weights;               // NULL when fc1_sparse is used
+const BlockSparseMatrix *fc1_sparse;
+const int32_t *fc1_biases;
+const int8_t *fc2_weights;
+const BlockSparseMatrix *fc2_sparse;
+const int32_t *fc2_biases;
+
+float tensor_scale(const TensorView *view, unsigned int i) {
+    return ((float)get_u32((u8 *)view->scales_q16 + 4 * i)) / (1 << 16);
+}
 
-void free_tensor(Tensor *tensor) {
-    if (tensor) {
-        if (tensor->dims) free(tensor->dims);
-        if (tensor->scales) free(tensor->scales);
-        if (tensor->zero_points) free(tensor->zero_points);
-        if (tensor->data) free(tensor->data);
-        free(tensor);
+int tensor_zero_point(const TensorView *view, unsigned int i) {
+    return (int)get_u32((u8 *)view->zero_points + 4 * i);
+}
+
+void release_tensor_registry(void) {
+    for (unsigned int i = 0; i < tensor_registry_count; i++) {
+        free(tensor_registry[i].aligned_copy);
+        tensor_registry[i].aligned_copy = NULL;
+        free((void *)tensor_registry[i].sparse.row_start);
+        tensor_registry[i].sparse.row_start = NULL;
     }
+    tensor_registry_count = 0;
 }
 
-Tensor* load_tensor_from_dram(unsigned int tensor_index) {
-    if (tensor_index >= TOTAL_TENSORS) {
-        xil_printf("Invalid tensor index %d\n", tensor_index);
-        return NULL;
+/*
+ * parse_block_sparse:
+ *   Decodes a TENSOR_DTYPE_INT8_BLOCK_SPARSE payload
+ *     u32 block_elems, u32 stored blocks, bitmap, stored blocks
+ *   into view->sparse for a [rows][cols] tensor and builds its row index.
+ */
+static int parse_block_sparse(TensorView *view, unsigned int index) {
+    BlockSparseMatrix *w = &view->sparse;
+    const u8 *ptr = view->data;
+    if (view->num_dims != 2 || view->data_length < 8) {
+        xil_printf("Tensor %d: malformed block-sparse header\n", index);
+        return -1;
     }
-    unsigned char *ptr = (unsigned char*)(DRAM_ptr + tensor_offsets[tensor_index]);
-    Tensor *tensor = (Tensor*)malloc(sizeof(Tensor));
-    if (!tensor) {
-        xil_printf("Memory allocation failed for Tensor structure.\n");
-        return NULL;
+    u32 rows = view->dims[0];
+    u32 cols = view->dims[1];
+    u32 block_elems = get_u32((u8 *)ptr);
+    u32 stored = get_u32((u8 *)ptr + 4);
+    if (block_elems == 0 || block_elems % 9 || block_elems > SPARSE_BLOCK_MAX) {
+        xil_printf("Tensor %d: unsupported block size %d\n", index, block_elems);
+        return -1;
     }
-    tensor->tensor_id = get_u32(ptr);
-    ptr += 4;
-    tensor->num_dims = get_u32(ptr);
-    ptr += 4;
-    tensor->dims = (unsigned int*)malloc(tensor->num_dims * sizeof(unsigned int));
-    if (!tensor->dims) {
-        xil_printf("Memory allocation failed for dims.\n");
-        free(tensor);
-        return NULL;
+    // Sizes come from the wire: checked in 64 bits so they cannot wrap. A
+    // match bounds rows * blocks_per_row by 8 * data_length, which keeps the
+    // int fields below and the row index in range.
+    u32 blocks_per_row = cols / block_elems + (cols % block_elems != 0);
+    uint64_t bitmap_bytes = ((uint64_t)rows * blocks_per_row + 7) / 8;
+    uint64_t expected = 8 + bitmap_bytes + (uint64_t)stored * block_elems;
+    if (rows == 0 || cols == 0 || expected != view->data_length) {
+        xil_printf("Tensor %d: block-sparse header does not match its %d-byte payload\n",
+                   index, view->data_length);
+        return -1;
     }
-    for (unsigned int i = 0; i < tensor->num_dims; i++) {
-        tensor->dims[i] = get_u32(ptr);
-        ptr += 4;
+    w->rows = rows;
+    w->cols = cols;
+    w->block_elems = block_elems;
+    w->blocks_per_row = blocks_per_row;
+    w->bitmap = ptr + 8;
+    w->blocks = (const int8_t *)(ptr + 8 + bitmap_bytes);
+
+    uint32_t *row_start = (uint32_t *)malloc((w->rows + 1) * sizeof(uint32_t));
+    if (!row_start) {
+        xil_printf("Memory allocation failed for tensor %d row index.\n", index);
+        return -1;
     }
-    tensor->data_type = get_u32(ptr);
-    ptr += 4;
-    tensor->num_scales = get_u32(ptr);
-    ptr += 4;
-    tensor->scales = (float*)malloc(tensor->num_scales * sizeof(float));
-    if (!tensor->scales) {
-        xil_printf("Memory allocation failed for scales.\n");
-        free(tensor->dims);
-        free(tensor);
-        return NULL;
+    u32 count = 0;
+    for (int r = 0; r < w->rows; r++) {
+        row_start[r] = count;
+        for (int b = 0; b < w->blocks_per_row; b++) {
+            count += block_sparse_has(w, r, b);
+        }
+    }
+    row_start[w->rows] = count;
+    w->row_start = row_start;
+    if (count != stored) {
+        xil_printf("Tensor %d: bitmap marks %d blocks, header says %d\n", index, count, stored);
+        return -1;
     }
-    for (unsigned int i = 0; i < tensor->num_scales; i++) {
-        unsigned int fixed_scale = get_u32(ptr);
-        tensor->scales[i] = ((float)fixed_scale) / (1 << 16);
+    xil_printf("Tensor %d: block sparse, %d of %d blocks stored\n",
+               index, count, w->rows * w->blocks_per_row);
+    return 0;
+}
+
+/*
+ * build_tensor_registry:
+ *   Walks the received tensors once and fills tensor_registry[]. Small payloads
+ *   that do not start on a 4-byte boundary (the int32 bias tensors can land
+ *   anywhere in the stream) are copied once into heap storage, since the
+ *   MicroBlaze is not guaranteed to support unaligned word loads.
+ */
+int build_tensor_registry(void) {
+    release_tensor_registry();
+    for (unsigned int i = 0; i < tensor_count && i < TOTAL_TENSORS; i++) {
+        TensorView *view = &tensor_registry[i];
+        u8 *ptr = (u8 *)(DRAM_ptr + tensor_offsets[i]);
+        u8 *end = ptr + tensor_sizes[i];
+
+        memset(view, 0, sizeof(*view));
+        view->tensor_id = get_u32(ptr);
+        ptr += 4;
+        view->num_dims = get_u32(ptr);
+        ptr += 4;
+        if (view->num_dims > TENSOR_MAX_DIMS) {
+            xil_printf("Tensor %d has too many dims (%d)\n", i, view->num_dims);
+            return -1;
+        }
+        for (unsigned int d = 0; d < view->num_dims; d++) {
+            view->dims[d] = get_u32(ptr);
+            ptr += 4;
+        }
+        view->data_type = get_u32(ptr);
+        ptr += 4;
+        view->num_scales = get_u32(ptr);
+        ptr += 4;
+        view->scales_q16 = ptr;
+        ptr += 4 * view->num_scales;
+        view->num_zero_points = get_u32(ptr);
+        ptr += 4;
+        view->zero_points = ptr;
+        ptr += 4 * view->num_zero_points;
+        view->data_length = get_u32(ptr);
         ptr += 4;
+        if (ptr + view->data_length > end) {
+            xil_printf("Tensor %d is truncated (%d data bytes, %d received)\n",
+                       i, view->data_length, tensor_sizes[i]);
+            return -1;
+        }
+        view->data = ptr;
+
+        if (((uintptr_t)ptr & 3) && view->data_length <= TENSOR_ALIGN_COPY_MAX) {
+            view->aligned_copy = malloc(view->data_length);
+            if (!view->aligned_copy) {
+                xil_printf("Memory allocation failed for tensor %d aligned copy.\n", i);
+                return -1;
+            }
+            memcpy(view->aligned_copy, ptr, view->data_length);
+            view->data = (const u8 *)view->aligned_copy;
+        }
+        tensor_registry_count++;
+        if (view->data_type == TENSOR_DTYPE_INT8_BLOCK_SPARSE && parse_block_sparse(view, i) != 0) {
+            return -1;
+        }
     }
-    tensor->num_zero_points = get_u32(ptr);
-    ptr += 4;
-    tensor->zero_points = (int*)malloc(tensor->num_zero_points * sizeof(int));
-    if (!tensor->zero_points) {
-        xil_printf("Memory allocation failed for zero_points.\n");
-        free(tensor->scales);
-        free(tensor->dims);
-        free(tensor);
+    xil_printf("Tensor registry ready: %d tensors.\n", tensor_registry_count);
+    return 0;
+}
+
+/*
+ * require_tensor:
+ *   Returns the registry view for tensor_index if its payload is exactly
+ *   expected_length bytes (and word aligned when word_aligned is set), else NULL.
+ */
+const TensorView *require_tensor(unsigned int tensor_index, unsigned int expected_length,
+                                 int word_aligned, const char *what) {
+    if (tensor_index >= tensor_registry_count) {
+        xil_printf("Missing %s tensor (index %d)\n", what, tensor_index);
         return NULL;
     }
-    for (unsigned int i = 0; i < tensor->num_zero_points; i++) {
-        tensor->zero_points[i] = (int)get_u32(ptr);
-        ptr += 4;
+    const TensorView *view = &tensor_registry[tensor_index];
+    if (view->data_length != expected_length) {
+        xil_printf("Unexpected %s size: %d bytes (expected %d)\n", what, view->data_length, expected_length);
+        return NULL;
     }
-    tensor->data_length = get_u32(ptr);
-    ptr += 4;
-    tensor->data = (unsigned char*)malloc(tensor->data_length);
-    if (!tensor->data) {
-        xil_printf("Memory allocation failed for tensor raw data.\n");
-        free_tensor(tensor);
+    if (word_aligned && ((uintptr_t)view->data & 3)) {
+        xil_printf("%s payload is not word aligned\n", what);
         return NULL;
     }
-    memcpy(tensor->data, ptr, tensor->data_length);
+    return view;
+}
+
+/*
+ * require_weights:
+ *   Like require_tensor for a [rows][cols] int8 weight matrix that may also be
+ *   block sparse. Sets exactly one of *dense and *sparse on success.
+ */
+int require_weights(unsigned int tensor_index, int rows, int cols, const char *what,
+                    const int8_t **dense, const BlockSparseMatrix **sparse) {
+    *dense = NULL;
+    *sparse = NULL;
+    if (tensor_index < tensor_registry_count &&
+        tensor_registry[tensor_index].data_type == TENSOR_DTYPE_INT8_BLOCK_SPARSE) {
+        const BlockSparseMatrix *w = &tensor_registry[tensor_index].sparse;
+        if (w->rows != rows || w->cols != cols) {
+            xil_printf("Unexpected %s shape: %d x %d (expected %d x %d)\n", what, w->rows, w->cols, rows, cols);
+            return -1;
+        }
+        *sparse = w;
+        return 0;
+    }
+    const TensorView *view = require_tensor(tensor_index, rows * cols, 0, what);
+    if (!view) return -1;
+    *dense = (const int8_t *)view->data;
+    return 0;
+}
+
+/*
+ * bind_model_tensors:
+ *   Validates the filter, weight and bias tensors against the network shape and
+ *   points the layer parameter globals at their registry views.
+ */
+int bind_model_tensors(void) {
+    const TensorView *v[6];
+    v[0] = require_tensor(3, CONV1_FILTERS * 9 * INPUT_CHANNELS, 0, "conv1 filter");
+    v[1] = require_tensor(4, CONV1_FILTERS * sizeof(int32_t), 1, "conv1 bias");
+    v[2] = require_tensor(6, CONV2_FILTERS * 9 * CONV2_INPUT_CHANNELS, 0, "conv2 filter");
+    v[3] = require_tensor(7, CONV2_FILTERS * sizeof(int32_t), 1, "conv2 bias");
+    v[4] = require_tensor(12, FC1_OUTPUT_SIZE * sizeof(int32_t), 1, "FC1 bias");
+    v[5] = require_tensor(15, FC2_OUTPUT_SIZE * sizeof(int32_t), 1, "FC2 bias");
+    for (int i = 0; i < 6; i++) {
+        if (!v[i]) return -1;
+    }
+    // FC weights may arrive dense or block sparse.
+    if (require_weights(11, FC1_OUTPUT_SIZE, POOL_OUTPUT_HEIGHT * POOL_OUTPUT_WIDTH * CONV2_FILTERS,
+                        "FC1 weight", &fc1_weights, &fc1_sparse) != 0 ||
+        require_weights(14, FC2_OUTPUT_SIZE, FC1_OUTPUT_SIZE, "FC2 weight", &fc2_weights, &fc2_sparse) != 0) {
+        return -1;
+    }
+    conv1_filters = (const int8_t *)v[0]->data;
+    conv1_biases  = (const int32_t *)v[1]->data;
+    conv2_filters = (const int8_t *)v[2]->data;
+    conv2_biases  = (const int32_t *)v[3]->data;
+    fc1_biases    = (const int32_t *)v[4]->data;
+    fc2_biases    = (const int32_t *)v[5]->data;
+    return 0;
+}
+
+/*
+ * read_tensor_qparams:
+ *   Copies up to max_scales scales of a registered tensor as float and its
+ *   first zero point; returns the total number of scales in the tensor, or -1
+ *   if the index is invalid.
+ */
+int read_tensor_qparams(unsigned int tensor_index, float *scales, unsigned int max_scales, int *zero_point) {
+    if (tensor_index >= tensor_registry_count) {
+        xil_printf("Invalid tensor index %d\n", tensor_index);
+        return -1;
+    }
+    const TensorView *view = &tensor_registry[tensor_index];
+    for (unsigned int i = 0; i < view->num_scales && i < max_scales; i++) {
+        scales[i] = tensor_scale(view, i);
+    }
+    *zero_point = view->num_zero_points ? tensor_zero_point(view, 0) : 0;
+    return (int)view->num_scales;
+}
+
+/*
+ * build_layer_requant:
+ *   Folds a layer's input scale (in_index), weight scales (weight_index) and
+ *   output scale/zero point (out_index) into an integer requant table.
+ *   expected_scales == 0 means per-tensor: only the first weight scale is used,
+ *   as the FC layers always did.
+ */
+int build_layer_requant(RequantTable *table, const char *layer, unsigned int in_index,
+                        unsigned int weight_index, unsigned int out_index, unsigned int expected_scales) {
+    float S_x, S_y;
+    float weight_scales[REQUANT_MAX_CHANNELS];
+    int Z_x, Z_y, Z_w;
+
+    if (read_tensor_qparams(in_index, &S_x, 1, &Z_x) < 1 ||
+        read_tensor_qparams(out_index, &S_y, 1, &Z_y) < 1) {
+        xil_printf("%s: missing input/output quantization parameters\n", layer);
+        return -1;
+    }
+    int num_scales = read_tensor_qparams(weight_index, weight_scales, REQUANT_MAX_CHANNELS, &Z_w);
+    if (expected_scales == 0 && num_scales >= 1) {
+        num_scales = 1;
+    } else if (num_scales != (int)expected_scales) {
+        xil_printf("Unexpected number of %s weight scales: %d (expected %d)\n", layer, num_scales, expected_scales);
+        return -1;
+    }
+    if (requant_table_init(table, S_x, weight_scales, num_scales, S_y, Z_y) != 0) {
+        xil_printf("%s: invalid quantization parameters\n", layer);
+        return -1;
+    }
+    return 0;
+}
 
-    xil_printf("Loaded tensor %d: dims=%d, data_type=%d, data_length=%d\n",
-               tensor->tensor_id, tensor->num_dims, tensor->data_type, tensor->data_length);
-    return tensor;
+/*
+ * prepare_requant_tables:
+ *   Load-time pass over the quantization tensors. After this the inference
+ *   path never touches a float scale again (except the final softmax).
+ */
+int prepare_requant_tables(void) {
+    if (build_layer_requant(&conv1_requant, "conv1", 2, 3, 5, CONV1_FILTERS) != 0) return -1;
+    if (build_layer_requant(&conv2_requant, "conv2", 5, 6, 8, CONV2_FILTERS) != 0) return -1;
+    if (build_layer_requant(&fc1_requant, "fc1", 10, 11, 13, 0) != 0) return -1;
+    if (build_layer_requant(&fc2_requant, "fc2", 13, 14, 16, 0) != 0) return -1;
+    if (read_tensor_qparams(13, &fc2_logit_scale, 1, &fc2_logit_zero_point) < 1) return -1;
+    xil_printf("Requantization tables ready.\n");
+    return 0;
 }
 
 
@@ -370,26 +1102,8 @@ void accel_conv3x3_buffer(const int8_t *in_patch, const int8_t *filter,
                           unsigned int buffer_set, uint8_t pe_mask) {
 
 
-    volatile uint32_t *fptr0, *fptr1, *fptr2;
-    volatile uint32_t *iptr0, *iptr1, *iptr2;
-
-    if(buffer_set == 0){
-        fptr0 = (volatile uint32_t *)(ACC_FILTER_BASE);
-        fptr1 = (volatile uint32_t *)(ACC_FILTER_BASE + 4);
-        fptr2 = (volatile uint32_t *)(ACC_FILTER_BASE + 8);
-
-        iptr0 = (volatile uint32_t *)(ACC_INPUT_BASE);
-        iptr1 = (volatile uint32_t *)(ACC_INPUT_BASE + 4);
-        iptr2 = (volatile uint32_t *)(ACC_INPUT_BASE + 8);
-    } else {
-        fptr0 = (volatile uint32_t *)(ACC_FILTER_BASE + 24);
-        fptr1 = (volatile uint32_t *)(ACC_FILTER_BASE + 28);
-        fptr2 = (volatile uint32_t *)(ACC_FILTER_BASE + 32);
-
-        iptr0 = (volatile uint32_t *)(ACC_INPUT_BASE + 24);
-        iptr1 = (volatile uint32_t *)(ACC_INPUT_BASE + 28);
-        iptr2 = (volatile uint32_t *)(ACC_INPUT_BASE + 32);
-    }
+    u32 fbase = ACC_REG_FILTER0 + buffer_set * ACC_REG_BUFFER_STRIDE;
+    u32 ibase = ACC_REG_INPUT0 + buffer_set * ACC_REG_BUFFER_STRIDE;
 
     // Pack the 9 filter bytes into three 32-bit words.
     uint32_t filter_word0 = ((unsigned char)filter[0]) |
@@ -404,9 +1118,9 @@ void accel_conv3x3_buffer(const int8_t *in_patch, const int8_t *filter,
     uint32_t filter_word2 = (((uint32_t)( (unsigned char)filter[8] )) & 0x000000FF);
 
     // Write the 32-bit filter words.
-    *fptr0 = filter_word0;
-    *fptr1 = filter_word1;
-    *fptr2 = filter_word2;
+    ACC_REG_WRITE(fbase, filter_word0);
+    ACC_REG_WRITE(fbase + 4, filter_word1);
+    ACC_REG_WRITE(fbase + 8, filter_word2);
 
     // Pack the input patch.
     uint32_t input_word0 = ((unsigned char)in_patch[0]) |
@@ -418,50 +1132,179 @@ void accel_conv3x3_buffer(const int8_t *in_patch, const int8_t *filter,
                            (((unsigned char)in_patch[6]) << 16) |
                            (((unsigned char)in_patch[7]) << 24);
     // Write the first two 32-bit words of the input patch.
-    *iptr0 = input_word0;
-    *iptr1 = input_word1;
+    ACC_REG_WRITE(ibase, input_word0);
+    ACC_REG_WRITE(ibase + 4, input_word1);
 
     // Construct and write the control word into the third 32-bit word.
     // Bits [7:0]: 9th input value.
     // Bits [16:23]: must be set to the PE-selection (pe_mask).
     // Bit 24: enable (1).
     // Other bits: 0.
-    unsigned int ctrl_word = (pe_mask << 16) | (1 << 24) | (((unsigned char)in_patch[8]) & 0xFF);
-    *iptr2 = ctrl_word;
+    unsigned int ctrl_word = (pe_mask << ACC_CTRL_PE_SHIFT) | ACC_CTRL_ENABLE | (((unsigned char)in_patch[8]) & 0xFF);
+    ACC_REG_WRITE(ibase + 8, ctrl_word);
+}
+/*
+ * wait_accelerator_results:
+ *   Returns once the next 'bytes' of register-fed results are in DDR and
+ *   out of the data cache: the result pointer has moved past them, after
+ *   that nothing is left in the PEs or the write-combining FIFO (which holds
+ *   a partial burst for a few cycles before writing it), and only then is
+ *   the range invalidated, split where it wraps.
+ */
+static void wait_accelerator_results(u32 bytes) {
+    while (((ACC_REG_READ(ACC_REG_RESULT_PTR) - acc_output_offset) % ACC_OUTPUT_WINDOW) < bytes) {
+    }
+    while (ACC_REG_READ(ACC_REG_STATUS) & (ACC_STATUS_PENDING | ACC_STATUS_WRITEBACK)) {
+    }
+    u32 to_end = ACC_OUTPUT_WINDOW - acc_output_offset;
+    acc_cache_from_device(HAL_PTR(ACC_OUTPUT_ADDR + acc_output_offset), bytes < to_end ? bytes : to_end);
+    if (bytes > to_end) acc_cache_from_device(HAL_PTR(ACC_OUTPUT_ADDR), bytes - to_end);
 }
+
 /*
  * read_accelerator_results:
  *   Reads 'num_ops' 32-bit results from the accelerator's output region.
  *   Results are read from (ACC_OUTPUT_ADDR + acc_output_offset) and the offset is incremented.
+ *   The accelerator's write pointer is never reset and wraps inside ACC_OUTPUT_WINDOW,
+ *   so the read offset follows it across layers and inferences.
  */
 void read_accelerator_results(uint32_t *results, unsigned int num_ops) {
+    wait_accelerator_results(num_ops * 4);
     for (unsigned int i = 0; i < num_ops; i++) {
-        volatile uint32_t *out_ptr = (volatile uint32_t *)(ACC_OUTPUT_ADDR + acc_output_offset);
+        volatile uint32_t *out_ptr = (volatile uint32_t *)HAL_PTR(ACC_OUTPUT_ADDR + acc_output_offset);
         results[i] = *out_ptr;
-        acc_output_offset += 4;
+        acc_output_offset = (acc_output_offset + 4) % ACC_OUTPUT_WINDOW;
+    }
+}
+
+// Register buffer the accelerator consumes next (ACC.v alternates 0, 1, 0, ...).
+unsigned int accel_buffer_turn = 0;
+
+// Last value written to ACC_REG_PASSES (1 after reset).
+u32 accel_passes = 1;
+
+/*
+ * accel_set_passes:
+ *   Sets how many ops each PE accumulates before emitting a result. Only
+ *   called between layers/rows, when no op is in flight.
+ */
+void accel_set_passes(u32 passes) {
+    if (passes != accel_passes) {
+        ACC_REG_WRITE(ACC_REG_PASSES, passes);
+        accel_passes = passes;
+    }
+}
+
+/*
+ * accel_issue:
+ *   Queues one 3x3 MAC on the given PE into whichever register buffer the
+ *   accelerator expects next.
+ */
+static void accel_issue(const int8_t *in_patch, const int8_t *filter, int pe) {
+    accel_conv3x3_buffer(in_patch, filter, accel_buffer_turn, (uint8_t)(1 << pe));
+    accel_buffer_turn ^= 1;
+}
+
+
+// Weight bank
+// conv1 filter f sits in slot WBANK_CONV1_SLOT + f. conv2 is stored in the
+// order the MMIO feed issues it, [group of 8 filters][channel][filter in
+// group], which is also the [pass][inner] tile a descriptor expects.
+#define WBANK_CONV1_SLOT         0
+#define WBANK_CONV2_SLOT         CONV1_FILTERS
+#define WBANK_CONV2_GROUP_SLOTS  (CONV2_INPUT_CHANNELS * 8)
+#define WBANK_USED_SLOTS         (WBANK_CONV2_SLOT + CONV2_FILTERS * CONV2_INPUT_CHANNELS)
+
+// Filter tensors held in the weight bank; NULL until accel_load_weight_bank().
+const int8_t *wbank_conv1 = NULL;
+const int8_t *wbank_conv2 = NULL;
+
+static void accel_wbank_write(const int8_t *filter) {
+    ACC_REG_WRITE(ACC_REG_WBANK_DATA, (u32)(u8)filter[0] | ((u32)(u8)filter[1] << 8) |
+                                      ((u32)(u8)filter[2] << 16) | ((u32)(u8)filter[3] << 24));
+    ACC_REG_WRITE(ACC_REG_WBANK_DATA, (u32)(u8)filter[4] | ((u32)(u8)filter[5] << 8) |
+                                      ((u32)(u8)filter[6] << 16) | ((u32)(u8)filter[7] << 24));
+    ACC_REG_WRITE(ACC_REG_WBANK_DATA, (u32)(u8)filter[8]);
+}
+
+/*
+ * accel_load_weight_bank:
+ *   Copies the conv1 and conv2 filters into the accelerator weight bank once
+ *   per model, so conv ops only carry their input patch. Called while the
+ *   accelerator is idle.
+ */
+void accel_load_weight_bank(const int8_t *conv1_w, const int8_t *conv2_w) {
+    const int filter_size = CONV2_KERNEL_HEIGHT * CONV2_KERNEL_WIDTH * CONV2_INPUT_CHANNELS;
+    if (WBANK_USED_SLOTS > ACC_WBANK_SLOTS) return;
+
+    ACC_REG_WRITE(ACC_REG_WBANK_ADDR, WBANK_CONV1_SLOT);
+    for (int f = 0; f < CONV1_FILTERS; f++) {
+        accel_wbank_write(&conv1_w[f * 9]);
+    }
+    ACC_REG_WRITE(ACC_REG_WBANK_ADDR, WBANK_CONV2_SLOT);
+    for (int group = 0; group < CONV2_FILTERS; group += 8) {
+        for (int ch = 0; ch < CONV2_INPUT_CHANNELS; ch++) {
+            for (int j = 0; j < 8; j++) {
+                accel_wbank_write(&conv2_w[(group + j) * filter_size + ch * 9]);
+            }
+        }
     }
+    wbank_conv1 = conv1_w;
+    wbank_conv2 = conv2_w;
+}
+
+/*
+ * accel_conv3x3_banked:
+ *   accel_conv3x3_buffer for an op whose weights come from the weight bank:
+ *   only the two input words and the control word are written.
+ */
+void accel_conv3x3_banked(const int8_t *in_patch, unsigned int buffer_set, uint8_t pe_mask) {
+    u32 ibase = ACC_REG_INPUT0 + buffer_set * ACC_REG_BUFFER_STRIDE;
+    uint32_t input_word0 = ((unsigned char)in_patch[0]) |
+                           (((unsigned char)in_patch[1]) << 8) |
+                           (((unsigned char)in_patch[2]) << 16) |
+                           (((unsigned char)in_patch[3]) << 24);
+    uint32_t input_word1 = ((unsigned char)in_patch[4]) |
+                           (((unsigned char)in_patch[5]) << 8) |
+                           (((unsigned char)in_patch[6]) << 16) |
+                           (((unsigned char)in_patch[7]) << 24);
+    ACC_REG_WRITE(ibase, input_word0);
+    ACC_REG_WRITE(ibase + 4, input_word1);
+    ACC_REG_WRITE(ibase + 8, (pe_mask << ACC_CTRL_PE_SHIFT) | ACC_CTRL_ENABLE | ACC_CTRL_WBANK |
+                             ((unsigned char)in_patch[8]));
+}
+
+/*
+ * accel_issue_banked:
+ *   accel_issue with the weights taken from the next WBANK_SEQ slot.
+ */
+static void accel_issue_banked(const int8_t *in_patch, int pe) {
+    accel_conv3x3_banked(in_patch, accel_buffer_turn, (uint8_t)(1 << pe));
+    accel_buffer_turn ^= 1;
 }
 
 
 // Convolution with Accelerator
 /*
- * conv_with_accelerator_parallel:
+ * conv1_row_with_accelerator_parallel:
+ *   Computes the first out_width pixels (x 32 values) of conv1 output row oh;
+ *   a full row is 127. Pass input + column for a strip further right.
  *   For each output pixel, processes filters in pairs.
  *   The input patch is extracted once per output pixel.
  *   For each pair of filters, the first operation is queued into buffer 0 and the second into buffer 1,
  *   with appropriate PE-selection (pe_mask in control word).
  */
-void conv_with_accelerator_parallel(const int8_t* input, int input_width,
-                                    const int8_t* filters, const int32_t* biases,
-                                    float S_x, int Z_x, const float* filter_scales,
-                                    float S_y, int Z_y,
-                                    int8_t* output) {
-    // Reset the global accelerator output offset.
-    acc_output_offset = 0;
-
-    // For each output pixel.
-    for (int oh = 0; oh < CONV1_OUTPUT_HEIGHT; oh++) {
-        for (int ow = 0; ow < CONV1_OUTPUT_WIDTH; ow++) {
+void conv1_row_with_accelerator_parallel(const int8_t* input, int input_width,
+                                         const int8_t* filters, const int32_t* biases,
+                                         const RequantTable* requant,
+                                         int oh, int out_width, int8_t* output) {
+        int banked = (filters == wbank_conv1);
+        accel_set_passes(1);
+        if (banked) {
+            // Every pixel walks the 32 conv1 slots in filter order.
+            ACC_REG_WRITE(ACC_REG_WBANK_SEQ, ACC_WBANK_SEQ(WBANK_CONV1_SLOT, CONV1_FILTERS));
+        }
+        for (int ow = 0; ow < out_width; ow++) {
             // Extract the 3x3 input patch once for this output pixel.
             int8_t in_patch[9];
             for (int r = 0; r < CONV1_KERNEL_HEIGHT; r++) {
@@ -479,14 +1322,16 @@ void conv_with_accelerator_parallel(const int8_t* input, int input_width,
                 {
                     int f = group;
                     uint8_t pe_mask = 1 << (f % 8);  // Set PE-selection bits sequantially
-                    accel_conv3x3_buffer(in_patch, &filters[f * 9], 0, pe_mask);
+                    if (banked) accel_conv3x3_banked(in_patch, 0, pe_mask);
+                    else accel_conv3x3_buffer(in_patch, &filters[f * 9], 0, pe_mask);
                 }
 
                 // If there is a second filter in the pair, queue it into buffer 1.
                 if (num_ops == 2) {
                     int f = group + 1;
                     uint8_t pe_mask = 1 << (f % 8);
-                    accel_conv3x3_buffer(in_patch, &filters[f * 9], 1, pe_mask);
+                    if (banked) accel_conv3x3_banked(in_patch, 1, pe_mask);
+                    else accel_conv3x3_buffer(in_patch, &filters[f * 9], 1, pe_mask);
                 }
 
 
@@ -498,106 +1343,12 @@ void conv_with_accelerator_parallel(const int8_t* input, int input_width,
                 for (int j = 0; j < num_ops; j++) {
                     int f = group + j;
                     int mac = results[j] + biases[f];
-                    float multiplier = (S_x * filter_scales[f]) / S_y;
-                    int32_t scaled = (int32_t)round(multiplier * mac) + Z_y;
-                    if (scaled < 0) scaled = 0;
-                    if (scaled > 127) scaled = 127;
-                    int out_index = (oh * CONV1_OUTPUT_WIDTH + ow) * CONV1_FILTERS + f;
-                    output[out_index] = (int8_t)scaled;
+                    output[ow * CONV1_FILTERS + f] = requantize(mac, requant, f);
                 }
             }
         }
-    }
 }
 
-// New: conv2_with_accelerator_parallel for Second Convolution Layer
-/*
- * conv2_with_accelerator_parallel:
- *   Processes the second convolution layer, where:
- *     - Input: conv1 output, dimensions: 122 x 127 x 32.
- *     - Filters: from Tensor 6, shape: [64, 3, 3, 32] (flattened)
- *     - Biases: from Tensor 7, 64 values.
- *     - Input quantization for conv2: from Tensor 5.
- *     - Output quantization for conv2: from Tensor 8.
- *
- * For each output pixel (with spatial dimensions 120 x 125),
- * for each filter, the convolution is performed over all 32 input channels.
- * The accelerator (which performs a 3x3 MAC on one channel) is invoked for each channel,
- * and the results are accumulated across channels.
- *
- */
-void conv2_with_accelerator_parallel(const int8_t* input, int input_width,
-    const int8_t* filters, const int32_t* biases,
-    float S_x2, int Z_x2, const float* filter_scales,
-    float S_y2, int Z_y2,
-    int8_t* output) {
-    // Reset accelerator output offset.
-    // For each output spatial location (conv2 output dimensions: 120 x 125).
-    for (int oh = 0; oh < CONV2_OUTPUT_HEIGHT; oh++) {
-
-        for (int ow = 0; ow < CONV2_OUTPUT_WIDTH; ow++) {
-            // For each conv2 filter, initialize an accumulator.
-            int accumulators[CONV2_FILTERS];
-            for (int f = 0; f < CONV2_FILTERS; f++) {
-                accumulators[f] = 0;
-            }
-            // For each input channel (there are 32 channels in conv2 input).
-            for (int ch = 0; ch < CONV2_INPUT_CHANNELS; ch++) {
-                // Extract the 3x3 patch from the input for channel ch.
-                int8_t in_patch[9];
-                for (int r = 0; r < CONV2_KERNEL_HEIGHT; r++) {
-                    for (int c = 0; c < CONV2_KERNEL_WIDTH; c++) {
-                    // Assuming input is in channel-last order:
-                    // Index = ((oh + r)*input_width + (ow + c)) * CONV2_INPUT_CHANNELS + ch
-                    in_patch[r * CONV2_KERNEL_WIDTH + c] =
-                    input[((oh + r) * input_width + (ow + c)) * CONV2_INPUT_CHANNELS + ch];
-                    }
-                }
-                // Process filters in pairs.
-                for (int group = 0; group < CONV2_FILTERS; group += 2) {
-                    int num_ops = ((group + 2) <= CONV2_FILTERS) ? 2 : 1;
-                    // For the first filter in the pair, use buffer 0.
-                    {
-                    int f = group;
-                    // Compute pointer to filter weights for filter f and channel ch.
-                    // Each conv2 filter has size 3x3x32; thus for filter f, the weights for channel ch are at:
-                    // offset = f * (3*3*CONV2_INPUT_CHANNELS) + ch*9
-                    const int8_t *filter_ptr = &filters[f * (CONV2_KERNEL_HEIGHT * CONV2_KERNEL_WIDTH * CONV2_INPUT_CHANNELS) + ch * 9];
-                    uint8_t pe_mask = 1 << (f % 8);
-                    accel_conv3x3_buffer(in_patch, filter_ptr, 0, pe_mask);
-                    }
-                    // For the second filter in the pair, use buffer 1.
-                    if (num_ops == 2) {
-                        int f = group + 1;
-                        const int8_t *filter_ptr = &filters[f * (CONV2_KERNEL_HEIGHT * CONV2_KERNEL_WIDTH * CONV2_INPUT_CHANNELS) + ch * 9];
-                        uint8_t pe_mask = 1 << (f % 8);
-                        accel_conv3x3_buffer(in_patch, filter_ptr, 1, pe_mask);
-                        }
-
-                        uint32_t results[2];
-                        read_accelerator_results(results, num_ops);
-                        // Accumulate the results for the corresponding filters.
-                        for (int j = 0; j < num_ops; j++) {
-                        int f = group + j;
-                        accumulators[f] += results[j];
-                        }
-                }
-            } // End loop over channels.
-            // After processing all channels, finish computation for each filter.
-            for (int f = 0; f < CONV2_FILTERS; f++) {
-                int mac = accumulators[f] + biases[f];
-                float multiplier = (S_x2 * filter_scales[f]) / S_y2;
-                int32_t scaled = (int32_t)round(multiplier * mac) + Z_y2;
-                if (scaled < 0) scaled = 0;
-                if (scaled > 127) scaled = 127;
-                int out_index = (oh * CONV2_OUTPUT_WIDTH + ow) * CONV2_FILTERS + f;
-                output[out_index] = (int8_t)scaled;
-            }
-        }
-    }
-}
-
-
 void maxpool2d(const int8_t* input, int input_height, int input_width, int channels,
 int pool_height, int pool_width, int stride, int8_t* output) {
     int output_height = (input_height - pool_height) / stride + 1;
@@ -624,69 +1375,1067 @@ int pool_height, int pool_width, int stride, int8_t* output) {
     }
 }
 
+/*
+ * conv2_row_with_accelerator_parallel:
+ *   Processes one output row of the second convolution layer, where:
+ *     - Input: conv1 output, dimensions: 122 x 127 x 32.
+ *     - Filters: from Tensor 6, shape: [64, 3, 3, 32] (flattened)
+ *     - Biases: from Tensor 7, 64 values.
+ *     - Input quantization for conv2: from Tensor 5.
+ *     - Output quantization for conv2: from Tensor 8.
+ *
+ * rows[] are the three conv1 output rows (127 x 32 each) under the kernel.
+ * The PEs run in cross-channel accumulation mode (PASSES = 32): for each
+ * output pixel, eight filters at a time are mapped onto the eight PEs and
+ * all 32 input channels are streamed through them, so each PE emits one
+ * finished sum per filter instead of 32 per-channel partials.
+ * output receives out_width x 64 values.
+ */
+void conv2_row_with_accelerator_parallel(const int8_t* const rows[3],
+    const int8_t* filters, const int32_t* biases,
+    const RequantTable* requant,
+    int out_width,
+    int8_t* output) {
+        const int filter_size = CONV2_KERNEL_HEIGHT * CONV2_KERNEL_WIDTH * CONV2_INPUT_CHANNELS;
+        int banked = (filters == wbank_conv2);
+        accel_set_passes(CONV2_INPUT_CHANNELS);
+        if (banked) {
+            // The bank holds conv2 in exactly the issue order below.
+            ACC_REG_WRITE(ACC_REG_WBANK_SEQ, ACC_WBANK_SEQ(WBANK_CONV2_SLOT, CONV2_FILTERS * CONV2_INPUT_CHANNELS));
+        }
+        for (int ow = 0; ow < out_width; ow++) {
+            // Extract the 3x3 patch of every input channel once for this pixel.
+            int8_t in_patch[CONV2_INPUT_CHANNELS][9];
+            for (int ch = 0; ch < CONV2_INPUT_CHANNELS; ch++) {
+                for (int r = 0; r < CONV2_KERNEL_HEIGHT; r++) {
+                    for (int c = 0; c < CONV2_KERNEL_WIDTH; c++) {
+                    // Each input row is in channel-last order:
+                    // Index = (ow + c) * CONV2_INPUT_CHANNELS + ch
+                    in_patch[ch][r * CONV2_KERNEL_WIDTH + c] =
+                    rows[r][(ow + c) * CONV2_INPUT_CHANNELS + ch];
+                    }
+                }
+            }
+            // Filters group..group+7 occupy PEs 0..7 for all 32 channel passes.
+            for (int group = 0; group < CONV2_FILTERS; group += 8) {
+                for (int ch = 0; ch < CONV2_INPUT_CHANNELS; ch++) {
+                    for (int j = 0; j < 8; j++) {
+                        // Weights for filter f, channel ch: f * (3*3*CONV2_INPUT_CHANNELS) + ch*9
+                        if (banked) accel_issue_banked(in_patch[ch], j);
+                        else accel_issue(in_patch[ch], &filters[(group + j) * filter_size + ch * 9], j);
+                    }
+                }
+                uint32_t results[8];
+                read_accelerator_results(results, 8);
+                for (int j = 0; j < 8; j++) {
+                    int f = group + j;
+                    int mac = (int32_t)results[j] + biases[f];
+                    output[ow * CONV2_FILTERS + f] = requantize(mac, requant, f);
+                }
+            }
+        }
+}
+
+/*
+ * fc_with_accelerator_parallel:
+ *   Fully connected layer in cross-channel accumulation mode. Eight neurons
+ *   at a time are mapped onto the eight PEs; each input block of 9 (the last
+ *   one zero padded) is one pass, so every PE emits a neuron's whole dot
+ *   product. PASSES is 16 bits wide, longer inputs are split into segments
+ *   whose sums are added here.
+ */
 void fc_with_accelerator_parallel(const int8_t *input, int input_length,
     const int8_t *weights, const int32_t *biases,
-    float S_x, int Z_x, const float *weight_scales,
-    float S_y, int Z_y,
+    const RequantTable *requant,
     int num_outputs,
     int8_t *output) {
-    // Compute number of full blocks (each of 9 elements) and remainder.
+    // Number of 9-element blocks, counting a zero-padded remainder block.
     int num_full_blocks = input_length / 9;
     int remainder = input_length % 9;
+    int num_blocks = num_full_blocks + (remainder > 0);
+
+    int8_t padded_block[9];
+    memset(padded_block, 0, sizeof(padded_block));
+    memcpy(padded_block, &input[num_full_blocks * 9], remainder);
+
+    for (int m0 = 0; m0 < num_outputs; m0 += 8) {
+        int count = (num_outputs - m0 < 8) ? num_outputs - m0 : 8;
+        int32_t total_acc[8] = {0};
+
+        for (int b0 = 0; b0 < num_blocks; b0 += ACC_MAX_PASSES) {
+            int seg = (num_blocks - b0 < ACC_MAX_PASSES) ? num_blocks - b0 : ACC_MAX_PASSES;
+            accel_set_passes(seg);
+            for (int b = b0; b < b0 + seg; b++) {
+                const int8_t *in_block = (b < num_full_blocks) ? &input[b * 9] : padded_block;
+                for (int j = 0; j < count; j++) {
+                    const int8_t *w_row = &weights[(m0 + j) * input_length];
+                    if (b < num_full_blocks) {
+                        accel_issue(in_block, &w_row[b * 9], j);
+                    } else {
+                        int8_t padded_weights[9];
+                        memset(padded_weights, 0, sizeof(padded_weights));
+                        memcpy(padded_weights, &w_row[b * 9], remainder);
+                        accel_issue(in_block, padded_weights, j);
+                    }
+                }
+            }
+            uint32_t results[8];
+            read_accelerator_results(results, count);
+            for (int j = 0; j < count; j++) {
+                total_acc[j] += (int32_t)results[j];
+            }
+        }
+
+        for (int j = 0; j < count; j++) {
+            int m = m0 + j;
+            // Add the bias and compute the quantized output.
+            output[m] = requantize(total_acc[j] + biases[m], requant, m);
+        }
+    }
+}
+
+/*
+ * fc_block_sparse_with_accelerator_parallel:
+ *   fc_with_accelerator_parallel on block-sparse weights. Eight neurons are
+ *   in flight as before and a block column is issued, as block_elems / 9
+ *   passes, only when one of them stores that block; the others get zero
+ *   weights for it. Columns pruned in all eight neurons cost nothing.
+ */
+static int block_column_live(const BlockSparseMatrix *weights, int m0, int count, int b) {
+    for (int j = 0; j < count; j++) {
+        if (block_sparse_has(weights, m0 + j, b)) return 1;
+    }
+    return 0;
+}
+
+void fc_block_sparse_with_accelerator_parallel(const int8_t *input, const BlockSparseMatrix *weights,
+    const int32_t *biases, const RequantTable *requant, int8_t *output) {
+    static const int8_t zero_block[SPARSE_BLOCK_MAX];
+    int block = weights->block_elems;
+    int ops = block / 9;
+    int last = weights->blocks_per_row - 1;
+    int seg_max = ACC_MAX_PASSES / ops;   // block columns per PASSES segment
+
+    // The last block column of the input, zero padded like the stored blocks.
+    int8_t padded_block[SPARSE_BLOCK_MAX];
+    memset(padded_block, 0, sizeof(padded_block));
+    memcpy(padded_block, &input[last * block], weights->cols - last * block);
+
+    for (int m0 = 0; m0 < weights->rows; m0 += 8) {
+        int count = (weights->rows - m0 < 8) ? weights->rows - m0 : 8;
+        int32_t total_acc[8] = {0};
+        const int8_t *next[8];
+        for (int j = 0; j < count; j++) {
+            next[j] = &weights->blocks[(size_t)weights->row_start[m0 + j] * block];
+        }
+
+        int live = 0;
+        for (int b = 0; b <= last; b++) {
+            live += block_column_live(weights, m0, count, b);
+        }
+
+        int b = 0;
+        while (live > 0) {
+            int seg = (live < seg_max) ? live : seg_max;
+            accel_set_passes(seg * ops);
+            for (int issued = 0; issued < seg; b++) {
+                if (!block_column_live(weights, m0, count, b)) continue;
+                const int8_t *in_block = (b == last) ? padded_block : &input[b * block];
+                const int8_t *w[8];
+                for (int j = 0; j < count; j++) {
+                    w[j] = zero_block;
+                    if (block_sparse_has(weights, m0 + j, b)) {
+                        w[j] = next[j];
+                        next[j] += block;
+                    }
+                }
+                for (int k = 0; k < ops; k++) {
+                    for (int j = 0; j < count; j++) {
+                        accel_issue(&in_block[9 * k], &w[j][9 * k], j);
+                    }
+                }
+                issued++;
+            }
+            uint32_t results[8];
+            read_accelerator_results(results, count);
+            for (int j = 0; j < count; j++) {
+                total_acc[j] += (int32_t)results[j];
+            }
+            live -= seg;
+        }
+
+        for (int j = 0; j < count; j++) {
+            int m = m0 + j;
+            output[m] = requantize(total_acc[j] + biases[m], requant, m);
+        }
+    }
+}
+
+
+// Per-inference activations, in the arena planned by activation_arena_setup.
+int8_t (*conv1_ring)[CONV1_OUTPUT_WIDTH * CONV1_FILTERS];   // last three conv1 rows
+int8_t (*conv2_row_pair)[POOL_INPUT_WIDTH * CONV2_FILTERS];  // conv2 rows awaiting pooling
+int8_t *conv2_filters_packed;       // [F][3][3][C] for the software backend
+int8_t *check_row;                  // BACKEND_CHECK software conv row
+int8_t *stream_check;               // BACKEND_CHECK full recompute of a streaming update
+int8_t *fc_check;                   // BACKEND_CHECK software FC outputs
+int32_t *fc_acc;                    // fc_with_ring accumulators
+int8_t *fc1_output;                 // BATCH_MAX_CLIPS rows of FC1_OUTPUT_SIZE
+int8_t *fc2_output;
+
+#define FC_CHECK_SIZE  (BATCH_MAX_CLIPS * FC1_OUTPUT_SIZE)
+
+// Steps of an inference and the buffers they use, for the arena plan
+enum { STEP_CONV, STEP_STREAM_CHECK, STEP_FC1, STEP_FC2, STEP_SOFTMAX, INFERENCE_STEPS };
+enum {
+    BUF_CONV1_ROWS, BUF_CONV2_ROWS, BUF_CONV2_PACKED, BUF_CHECK_ROW, BUF_STREAM_CHECK, BUF_FC_CHECK,
+    BUF_FC_ACC, BUF_FC1_OUTPUT, BUF_FC2_OUTPUT, ACTIVATION_BUFFERS
+};
+#define BUF(b)  (1u << (b))
+#define CONV_BUFFERS  (BUF(BUF_CONV1_ROWS) | BUF(BUF_CONV2_ROWS) | BUF(BUF_CONV2_PACKED) | BUF(BUF_CHECK_ROW))
+
+u8 *activation_arena;
+int arena_backend = -1;             // inference_backend the arena is planned for
+
+/*
+ * activation_arena_setup:
+ *   Plans the per-inference activations for inference_backend, allocates
+ *   the arena and reports its peak. Buffers the backend does not use are
+ *   left out: the packed filters on the accelerator, the check buffers
+ *   outside BACKEND_CHECK. The FC buffers share space with the conv ones.
+ *   The old arena is kept, and -1 returned, if the new one cannot be
+ *   allocated.
+ */
+int activation_arena_setup(void) {
+    int sw = (inference_backend != BACKEND_ACCEL);
+    int check = (inference_backend == BACKEND_CHECK);
+    ArenaBuffer buffers[ACTIVATION_BUFFERS] = {
+        [BUF_CONV1_ROWS]   = { .name = "conv1 rows", .size = 3 * sizeof(*conv1_ring),
+                               .ptr = (void **)&conv1_ring },
+        [BUF_CONV2_ROWS]   = { .name = "conv2 rows", .size = 2 * sizeof(*conv2_row_pair),
+                               .ptr = (void **)&conv2_row_pair },
+        [BUF_CONV2_PACKED] = { .name = "conv2 packed", .size = sw ? CONV2_FILTERS * 9 * CONV2_INPUT_CHANNELS : 0,
+                               .ptr = (void **)&conv2_filters_packed },
+        [BUF_CHECK_ROW]    = { .name = "check row", .size = check ? POOL_INPUT_WIDTH * CONV2_FILTERS : 0,
+                               .ptr = (void **)&check_row },
+        [BUF_STREAM_CHECK] = { .name = "stream check", .size = check ? POOL_OUTPUT_SIZE : 0,
+                               .ptr = (void **)&stream_check },
+        [BUF_FC_CHECK]     = { .name = "fc check", .size = check ? FC_CHECK_SIZE : 0,
+                               .ptr = (void **)&fc_check },
+        [BUF_FC_ACC]       = { .name = "fc accumulators", .size = FC1_OUTPUT_SIZE * sizeof(int32_t),
+                               .ptr = (void **)&fc_acc },
+        [BUF_FC1_OUTPUT]   = { .name = "fc1 output", .size = BATCH_MAX_CLIPS * FC1_OUTPUT_SIZE,
+                               .ptr = (void **)&fc1_output },
+        [BUF_FC2_OUTPUT]   = { .name = "fc2 output", .size = BATCH_MAX_CLIPS * FC2_OUTPUT_SIZE,
+                               .ptr = (void **)&fc2_output },
+    };
+    static const u32 uses[INFERENCE_STEPS] = {
+        [STEP_CONV]         = CONV_BUFFERS,
+        // The full recompute runs the conv stack again, into stream_check.
+        [STEP_STREAM_CHECK] = CONV_BUFFERS | BUF(BUF_STREAM_CHECK),
+        [STEP_FC1]          = BUF(BUF_FC_CHECK) | BUF(BUF_FC_ACC) | BUF(BUF_FC1_OUTPUT),
+        [STEP_FC2]          = BUF(BUF_FC_CHECK) | BUF(BUF_FC_ACC) | BUF(BUF_FC1_OUTPUT) | BUF(BUF_FC2_OUTPUT),
+        [STEP_SOFTMAX]      = BUF(BUF_FC2_OUTPUT),
+    };
+    u32 size = arena_plan(buffers, ACTIVATION_BUFFERS, uses, INFERENCE_STEPS);
+    u8 *arena = (u8 *)malloc(size + ARENA_ALIGN);
+    if (!arena) return -1;
+    free(activation_arena);
+    activation_arena = arena;
+    arena_backend = inference_backend;
+    arena_bind(buffers, ACTIVATION_BUFFERS, (u8 *)(((uintptr_t)arena + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1)));
+    arena_print(buffers, ACTIVATION_BUFFERS, size);
+    return 0;
+}
+
+// Descriptor ring feed
+#define RING_ENTRIES        128
+#define RING_OPERAND_BYTES  (POOL_OUTPUT_HEIGHT * POOL_OUTPUT_WIDTH * CONV2_FILTERS + SPARSE_BLOCK_MAX)  // FC1 input + zero pad
+#define RING_RESULT_ADDR    ACC_OUTPUT_ADDR   // descriptor results carry their own address
+
+AccRing acc_ring;
+int8_t *ring_operands;      // im2col patches / FC input staged in the DMA window
+
+/*
+ * accel_ring_setup:
+ *   Allocates the descriptor ring and the operand staging buffer and enables
+ *   the engine. On failure the MMIO feed is used instead.
+ */
+void accel_ring_setup(void) {
+    if (accel_feed != ACC_FEED_RING) return;
+    if (acc_ring_init(&acc_ring, RING_ENTRIES) != 0 ||
+        (ring_operands = (int8_t *)acc_dma_alloc(RING_OPERAND_BYTES)) == NULL) {
+        xil_printf("Descriptor ring setup failed, using MMIO feed.\n");
+        accel_feed = ACC_FEED_MMIO;
+    }
+}
+
+/*
+ * ring_phys:
+ *   Physical address of a buffer the ACC AXI master may read (model DRAM or
+ *   the DMA window), or 0 for anything else (BRAM, heap copies).
+ */
+static u32 ring_phys(const void *ptr) {
+    const u8 *p = (const u8 *)ptr;
+    const u8 *dram = (const u8 *)HAL_PTR(DRAM_BASE_ADDR);
+    const u8 *dma = (const u8 *)HAL_PTR(ACC_DMA_BASE);
+    if ((p >= dram && p < dram + DRAM_REGION_SIZE) || (p >= dma && p < dma + ACC_DMA_SIZE)) {
+        return HAL_PHYS(ptr);
+    }
+    return 0;
+}
+
+static inline int32_t ring_result(u32 index) {
+    return *(volatile int32_t *)HAL_PTR(RING_RESULT_ADDR + 4 * index);
+}
+
+/*
+ * ring_stage / ring_results:
+ *   Cache maintenance around a ring run: ring_stage writes the first 'bytes'
+ *   of ring_operands back before the descriptors are pushed, ring_results
+ *   drops the first 'count' results from the data cache once they are done.
+ */
+static inline void ring_stage(u32 bytes) {
+    acc_cache_to_device(ring_operands, bytes);
+}
+
+static inline void ring_results(u32 count) {
+    acc_cache_from_device(HAL_PTR(RING_RESULT_ADDR), 4 * count);
+}
+
+/*
+ * conv1_row_with_ring:
+ *   Same result as conv1_row_with_accelerator_parallel. The out_width input
+ *   patches are staged back to back and one descriptor runs every (pixel, filter)
+ *   pair: outer walks the patches, inner walks the 32 filters, in the weight
+ *   bank when it holds them and in place otherwise.
+ */
+void conv1_row_with_ring(const int8_t* input, int input_width,
+                         const int8_t* filters, const int32_t* biases,
+                         const RequantTable* requant,
+                         int oh, int out_width, int8_t* output) {
+    for (int ow = 0; ow < out_width; ow++) {
+        for (int r = 0; r < CONV1_KERNEL_HEIGHT; r++) {
+            for (int c = 0; c < CONV1_KERNEL_WIDTH; c++) {
+                ring_operands[ow * 9 + r * CONV1_KERNEL_WIDTH + c] = input[(oh + r) * input_width + (ow + c)];
+            }
+        }
+    }
+    ring_stage(out_width * 9);
+
+    int banked = (filters == wbank_conv1);
+    AccDescriptor desc = {
+        .in_addr = ring_phys(ring_operands),
+        .w_addr = banked ? WBANK_CONV1_SLOT : ring_phys(filters),
+        .out_addr = RING_RESULT_ADDR,
+        .counts = ACC_DESC_COUNTS(out_width, CONV1_FILTERS),
+        .in_outer_stride = 9,
+        .in_inner_stride = 0,
+        .w_outer_stride = 0,
+        .w_inner_stride = banked ? 1 : 9,
+    };
+    acc_ring_use_weight_bank(&acc_ring, banked);
+    accel_set_passes(1);
+    acc_ring_push(&acc_ring, &desc);
+    acc_ring_wait(&acc_ring);
+    ring_results(out_width * CONV1_FILTERS);
+
+    for (int i = 0; i < out_width * CONV1_FILTERS; i++) {
+        int f = i % CONV1_FILTERS;
+        output[i] = requantize(ring_result(i) + biases[f], requant, f);
+    }
+}
+
+/*
+ * conv2_row_with_ring:
+ *   Same result as conv2_row_with_accelerator_parallel. Patches are staged as
+ *   [ow][ch][9], the layout of a filter's [ch][9] weights, so with PASSES = 32
+ *   a single descriptor walks every (pixel, filter) pair and the PEs sum the
+ *   channels themselves: one int32 per output comes back. With the filters in
+ *   the weight bank each group of eight filters is its own descriptor (the
+ *   bank tile is [channel][filter in group]), and results come back grouped.
+ */
+void conv2_row_with_ring(const int8_t* const rows[3],
+                         const int8_t* filters, const int32_t* biases,
+                         const RequantTable* requant,
+                         int out_width,
+                         int8_t* output) {
+    const int patch_stride = CONV2_INPUT_CHANNELS * 9;
+
+    for (int ow = 0; ow < out_width; ow++) {
+        for (int ch = 0; ch < CONV2_INPUT_CHANNELS; ch++) {
+            int8_t *patch = &ring_operands[ow * patch_stride + ch * 9];
+            for (int r = 0; r < CONV2_KERNEL_HEIGHT; r++) {
+                for (int c = 0; c < CONV2_KERNEL_WIDTH; c++) {
+                    patch[r * CONV2_KERNEL_WIDTH + c] = rows[r][(ow + c) * CONV2_INPUT_CHANNELS + ch];
+                }
+            }
+        }
+    }
+    ring_stage(out_width * patch_stride);
+
+    accel_set_passes(CONV2_INPUT_CHANNELS);
+    if (filters == wbank_conv2) {
+        acc_ring_use_weight_bank(&acc_ring, 1);
+        for (int group = 0; group < CONV2_FILTERS; group += 8) {
+            AccDescriptor desc = {
+                .in_addr = ring_phys(ring_operands),
+                .w_addr = WBANK_CONV2_SLOT + (group / 8) * WBANK_CONV2_GROUP_SLOTS,
+                .out_addr = RING_RESULT_ADDR + 4 * group * out_width,
+                .counts = ACC_DESC_COUNTS(out_width, 8),
+                .in_outer_stride = patch_stride,
+                .in_inner_stride = 0,
+                .w_outer_stride = 0,
+                .w_inner_stride = 1,
+            };
+            acc_ring_push(&acc_ring, &desc);
+        }
+        acc_ring_wait(&acc_ring);
+        ring_results(out_width * CONV2_FILTERS);
+
+        // Group g holds [ow][8] starting at result g * 8 * out_width.
+        for (int ow = 0; ow < out_width; ow++) {
+            for (int f = 0; f < CONV2_FILTERS; f++) {
+                int32_t mac = ring_result((f & ~7) * out_width + ow * 8 + (f & 7));
+                output[ow * CONV2_FILTERS + f] = requantize(mac + biases[f], requant, f);
+            }
+        }
+        return;
+    }
+
+    AccDescriptor desc = {
+        .in_addr = ring_phys(ring_operands),
+        .w_addr = ring_phys(filters),
+        .out_addr = RING_RESULT_ADDR,
+        .counts = ACC_DESC_COUNTS(out_width, CONV2_FILTERS),
+        .in_outer_stride = patch_stride,
+        .in_inner_stride = 0,
+        .w_outer_stride = 0,
+        .w_inner_stride = patch_stride,
+    };
+    acc_ring_use_weight_bank(&acc_ring, 0);
+    acc_ring_push(&acc_ring, &desc);
+    acc_ring_wait(&acc_ring);
+    ring_results(out_width * CONV2_FILTERS);
+
+    for (int i = 0; i < out_width * CONV2_FILTERS; i++) {
+        int f = i % CONV2_FILTERS;
+        output[i] = requantize(ring_result(i) + biases[f], requant, f);
+    }
+}
+
+/*
+ * fc_with_ring:
+ *   Same result as fc_with_accelerator_parallel. The input is staged with
+ *   nine zero bytes of padding, so the last partial block can read past the
+ *   end of a weight row. One descriptor runs every neuron, each block being
+ *   one pass; inputs longer than ACC_MAX_PASSES blocks run in segments.
+ */
+void fc_with_ring(const int8_t *input, int input_length,
+                  const int8_t *weights, const int32_t *biases,
+                  const RequantTable *requant,
+                  int num_outputs,
+                  int8_t *output) {
+    int num_blocks = (input_length + 8) / 9;
+
+    memcpy(ring_operands, input, input_length);
+    memset(ring_operands + input_length, 0, 9);
+    ring_stage(input_length + 9);
+    u32 in_phys = ring_phys(ring_operands);
+    u32 w_phys = ring_phys(weights);
+
+    int32_t *total_acc = fc_acc;
+    memset(total_acc, 0, num_outputs * sizeof(int32_t));
+    for (int b0 = 0; b0 < num_blocks; b0 += ACC_MAX_PASSES) {
+        int seg = (num_blocks - b0 < ACC_MAX_PASSES) ? num_blocks - b0 : ACC_MAX_PASSES;
+        AccDescriptor desc = {
+            .in_addr = in_phys + b0 * 9,
+            .w_addr = w_phys + b0 * 9,
+            .out_addr = RING_RESULT_ADDR,
+            .counts = ACC_DESC_COUNTS(num_outputs, 1),
+            .in_outer_stride = 0,
+            .in_inner_stride = 0,
+            .w_outer_stride = input_length,
+            .w_inner_stride = 0,
+        };
+        acc_ring_use_weight_bank(&acc_ring, 0);
+        accel_set_passes(seg);
+        acc_ring_push(&acc_ring, &desc);
+        acc_ring_wait(&acc_ring);
+        ring_results(num_outputs);
+        for (int m = 0; m < num_outputs; m++) {
+            total_acc[m] += ring_result(m);
+        }
+    }
 
-    // For each output neuron.
     for (int m = 0; m < num_outputs; m++) {
-        int total_acc = 0;
-        // Process each full 9-element block in pairs if possible.
-        for (int b = 0; b < num_full_blocks; b += 2) {
-            int num_ops = ((b + 2) <= num_full_blocks) ? 2 : 1;
-            uint32_t results[2] = {0, 0};
-            // Process first block (buffer 0).
-            const int8_t *in_block = &input[b * 9];
-            const int8_t *w_block = &weights[m * input_length + b * 9];
-            // Use a fixed PE-selection mask (modify as needed)
-            uint8_t pe_mask = 1 << (m % 8);
-            accel_conv3x3_buffer(in_block, w_block, 0, pe_mask);
-            // If available, process second block (buffer 1).
-            if (num_ops == 2) {
-                const int8_t *in_block = &input[(b + 1) * 9];
-                const int8_t *w_block = &weights[m * input_length + (b + 1) * 9];
-                uint8_t pe_mask = 1 << (m % 8);
-                accel_conv3x3_buffer(in_block, w_block, 1, pe_mask);
+        output[m] = requantize(total_acc[m] + biases[m], requant, m);
+    }
+}
+
+/*
+ * fc_block_sparse_with_ring:
+ *   Same result as fc_block_sparse_with_accelerator_parallel. A run of
+ *   consecutive stored blocks in a row is contiguous in both the staged input
+ *   and the weights, so each run is one descriptor whose outer count walks
+ *   its blocks, every block being block_elems / 9 passes. Block sums come
+ *   back in storage order and are added here, as many rows at a time as fit
+ *   in the result window.
+ */
+void fc_block_sparse_with_ring(const int8_t *input, const BlockSparseMatrix *weights,
+                               const int32_t *biases, const RequantTable *requant,
+                               int8_t *output) {
+    int block = weights->block_elems;
+    const uint32_t *row_start = weights->row_start;
+    const u32 window = ACC_OUTPUT_WINDOW / 4;
+
+    memcpy(ring_operands, input, weights->cols);
+    memset(ring_operands + weights->cols, 0, SPARSE_BLOCK_MAX);
+    ring_stage(weights->cols + SPARSE_BLOCK_MAX);
+    u32 in_phys = ring_phys(ring_operands);
+    u32 w_phys = ring_phys(weights->blocks);
+
+    acc_ring_use_weight_bank(&acc_ring, 0);
+    accel_set_passes(block / 9);
+    int first = 0;          // first row whose results are in the window
+    for (int m = 0; m <= weights->rows; m++) {
+        if (m == weights->rows || row_start[m + 1] - row_start[first] > window) {
+            acc_ring_wait(&acc_ring);
+            ring_results(row_start[m] - row_start[first]);
+            for (int r = first; r < m; r++) {
+                int32_t acc = 0;
+                for (u32 k = row_start[r]; k < row_start[r + 1]; k++) {
+                    acc += ring_result(k - row_start[first]);
+                }
+                output[r] = requantize(acc + biases[r], requant, r);
+            }
+            first = m;
+            if (m == weights->rows) break;
+        }
+
+        u32 stored = row_start[m];
+        for (int b = 0; b < weights->blocks_per_row; ) {
+            if (!block_sparse_has(weights, m, b)) {
+                b++;
+                continue;
+            }
+            int run = 1;
+            while (b + run < weights->blocks_per_row && run < ACC_DESC_MAX_COUNT &&
+                   block_sparse_has(weights, m, b + run)) {
+                run++;
             }
+            AccDescriptor desc = {
+                .in_addr = in_phys + b * block,
+                .w_addr = w_phys + stored * block,
+                .out_addr = RING_RESULT_ADDR + 4 * (stored - row_start[first]),
+                .counts = ACC_DESC_COUNTS(run, 1),
+                .in_outer_stride = block,
+                .in_inner_stride = 0,
+                .w_outer_stride = block,
+                .w_inner_stride = 0,
+            };
+            acc_ring_push(&acc_ring, &desc);
+            stored += run;
+            b += run;
+        }
+    }
+}
+
+/*
+ * fc_with_gemv:
+ *   Same result as fc_with_accelerator_parallel on the GEMV engine: the input
+ *   is staged in the DMA window, the engine streams the weight matrix from
+ *   DDR once and writes one int32 per neuron. Returns -1 (nothing done) if
+ *   the layer does not fit the engine, e.g. unaligned weights or too many
+ *   neurons; the caller then uses the descriptor ring.
+ */
+int fc_with_gemv(const int8_t *input, int input_length,
+                 const int8_t *weights, const int32_t *biases,
+                 const RequantTable *requant,
+                 int num_outputs,
+                 int8_t *output) {
+    if (input_length % 4 != 0 || input_length > RING_OPERAND_BYTES) return -1;
+    memcpy(ring_operands, input, input_length);
+    if (acc_gemv_run(ring_phys(weights), ring_phys(ring_operands), RING_RESULT_ADDR,
+                     num_outputs, input_length) != 0) {
+        return -1;
+    }
+    for (int m = 0; m < num_outputs; m++) {
+        output[m] = requantize(ring_result(m) + biases[m], requant, m);
+    }
+    return 0;
+}
+
+/*
+ * fc_batch_with_gemv:
+ *   fc_with_gemv for 'batch' inputs of input_length bytes back to back, in
+ *   one GEMV run: the weight matrix is streamed once for all of them.
+ *   Inputs already in the DMA window are read in place, others are staged.
+ *   Outputs are batch vectors of num_outputs back to back. Returns -1
+ *   (nothing done) if the batch does not fit the engine.
+ */
+int fc_batch_with_gemv(const int8_t *inputs, int batch, int input_length,
+                       const int8_t *weights, const int32_t *biases,
+                       const RequantTable *requant,
+                       int num_outputs,
+                       int8_t *outputs) {
+    if (input_length % 4 != 0 || batch > ACC_GEMV_MAX_BATCH) return -1;
+    u32 x_phys = ring_phys(inputs);
+    if (x_phys == 0) {
+        if (batch * input_length > RING_OPERAND_BYTES) return -1;
+        memcpy(ring_operands, inputs, batch * input_length);
+        x_phys = ring_phys(ring_operands);
+    }
+    if (acc_gemv_run_batch(ring_phys(weights), x_phys, RING_RESULT_ADDR,
+                           num_outputs, input_length, batch) != 0) {
+        return -1;
+    }
+    for (int b = 0; b < batch; b++) {
+        for (int m = 0; m < num_outputs; m++) {
+            outputs[b * num_outputs + m] = requantize(ring_result(b * num_outputs + m) + biases[m], requant, m);
+        }
+    }
+    return 0;
+}
+
+/*
+ * ring_feed_ok:
+ *   The ring feed is used when selected and every buffer the engine reads has
+ *   a physical address; otherwise the caller keeps the MMIO path.
+ */
+static int ring_feed_ok(const void *weights, int num_outputs) {
+    if (accel_feed != ACC_FEED_RING || ring_phys(weights) == 0) return 0;
+    return num_outputs <= ACC_DESC_MAX_COUNT;
+}
+
+
+// Backend dispatch
+/*
+ * compare_layer_outputs:
+ *   BACKEND_CHECK helper. Counts elements where the accelerator and software
+ *   results differ and prints the first mismatch.
+ */
+int compare_layer_outputs(const char *layer, const int8_t *accel, const int8_t *sw, int size) {
+    int mismatches = 0;
+    for (int i = 0; i < size; i++) {
+        if (accel[i] != sw[i]) {
+            if (mismatches == 0) {
+                xil_printf("%s: first mismatch at %d (accel %d, sw %d)\n", layer, i, accel[i], sw[i]);
+            }
+            mismatches++;
+        }
+    }
+    xil_printf("%s: %d of %d outputs differ between accelerator and software backends\n",
+               layer, mismatches, size);
+    if (mismatches) {
+        LOG_EVENT(LOG_EV_BACKEND_MISMATCH, strcmp(layer, "fc1") == 0 ? PERF_FC1 : PERF_FC2, mismatches, size);
+    }
+    return mismatches;
+}
+
+// Depth-first conv1 -> conv2 -> maxpool working set kept between inferences.
+#define CONV1_TAIL_COLUMNS  3       // conv1 columns 124..126 of every row, kept for streaming
+int8_t conv1_tail[CONV1_OUTPUT_HEIGHT][CONV1_TAIL_COLUMNS * CONV1_FILTERS];  // see ConvStackColumns
+
+/*
+ * check_scratch:
+ *   'buffer', which holds 'capacity' outputs, as the software side of a
+ *   BACKEND_CHECK comparison of 'size' outputs, or NULL (and the comparison
+ *   is skipped) if it is missing or too small.
+ */
+static int8_t *check_scratch(const char *layer, int8_t *buffer, int capacity, int size) {
+    if (!buffer || size > capacity) {
+        xil_printf("%s: no memory for backend check, skipping comparison\n", layer);
+        return NULL;
+    }
+    return buffer;
+}
+
+/*
+ * check_row_outputs:
+ *   BACKEND_CHECK helper for row-wise layers: accumulates mismatches into
+ *   *mismatches and prints the first one.
+ */
+static void check_row_outputs(const char *layer, int row, const int8_t *accel, const int8_t *sw,
+                              int size, int *mismatches) {
+    for (int i = 0; i < size; i++) {
+        if (accel[i] != sw[i]) {
+            if (*mismatches == 0) {
+                xil_printf("%s: first mismatch in row %d at %d (accel %d, sw %d)\n", layer, row, i, accel[i], sw[i]);
+            }
+            (*mismatches)++;
+        }
+    }
+}
+
+void run_conv1_row(const int8_t* input, const int8_t* filters, const int32_t* biases,
+                   const RequantTable* requant, int oh, int col, int width,
+                   int8_t* output, int *mismatches) {
+    ACC_TRACE_LAYER("conv1");
+    const int8_t *row0 = &input[oh * INPUT_WIDTH + col];
+    int size = width * CONV1_FILTERS;
+    if (inference_backend == BACKEND_SW) {
+        sw_conv3x3_row(row0, row0 + INPUT_WIDTH, row0 + 2 * INPUT_WIDTH, INPUT_CHANNELS,
+                       filters, biases, CONV1_FILTERS, requant, width, output);
+        return;
+    }
+    if (ring_feed_ok(filters, 0)) {
+        conv1_row_with_ring(input + col, INPUT_WIDTH, filters, biases, requant, oh, width, output);
+    } else {
+        conv1_row_with_accelerator_parallel(input + col, INPUT_WIDTH, filters, biases, requant, oh, width, output);
+    }
+    if (inference_backend == BACKEND_CHECK) {
+        sw_conv3x3_row(row0, row0 + INPUT_WIDTH, row0 + 2 * INPUT_WIDTH, INPUT_CHANNELS,
+                       filters, biases, CONV1_FILTERS, requant, width, check_row);
+        check_row_outputs("conv1", oh, output, check_row, size, mismatches);
+    }
+}
+
+void run_conv2_row(const int8_t* const rows[3], const int8_t* filters, const int32_t* biases,
+                   const RequantTable* requant, int oh, int width, int8_t* output, int *mismatches) {
+    ACC_TRACE_LAYER("conv2");
+    int size = width * CONV2_FILTERS;
+    if (inference_backend == BACKEND_SW) {
+        sw_conv3x3_row(rows[0], rows[1], rows[2], CONV2_INPUT_CHANNELS, conv2_filters_packed, biases,
+                       CONV2_FILTERS, requant, width, output);
+        return;
+    }
+    if (ring_feed_ok(filters, 0)) {
+        conv2_row_with_ring(rows, filters, biases, requant, width, output);
+    } else {
+        conv2_row_with_accelerator_parallel(rows, filters, biases, requant, width, output);
+    }
+    if (inference_backend == BACKEND_CHECK) {
+        sw_conv3x3_row(rows[0], rows[1], rows[2], CONV2_INPUT_CHANNELS, conv2_filters_packed, biases,
+                       CONV2_FILTERS, requant, width, check_row);
+        check_row_outputs("conv2", oh, output, check_row, size, mismatches);
+    }
+}
+
+/*
+ * ConvStackColumns:
+ *   The columns run_conv_stack computes. A full pass starts at pooled column
+ *   0; a streaming update (stream_update) starts further right and takes
+ *   the three conv1 columns left of its first computed one from conv1_tail.
+ */
+typedef struct {
+    int pool_col;           // first pooled column written
+    int conv1_first;        // conv1 column at the start of a conv1_ring row
+    int conv1_col;          // first conv1 column computed
+    int conv2_width;        // conv2 columns computed, from conv1_first
+} ConvStackColumns;
+
+static ConvStackColumns conv_stack_columns(int pool_col) {
+    ConvStackColumns cols;
+    cols.pool_col = pool_col;
+    cols.conv1_first = 2 * pool_col;
+    cols.conv1_col = pool_col > 0 ? cols.conv1_first + CONV1_TAIL_COLUMNS : 0;
+    cols.conv2_width = POOL_INPUT_WIDTH - cols.conv1_first;
+    return cols;
+}
 
-            read_accelerator_results(results, num_ops);
-            for (int j = 0; j < num_ops; j++) {
-            total_acc += results[j];
+// conv1 row oh into a conv1_ring slot, and its last columns into conv1_tail.
+static void run_conv1_ring_row(const int8_t* input, const ConvStackColumns *cols,
+                               const int8_t* filters, const int32_t* biases, const RequantTable* requant,
+                               int oh, int8_t* ring_row, int *mismatches) {
+    if (cols->conv1_col > cols->conv1_first) {
+        memcpy(ring_row, conv1_tail[oh], CONV1_TAIL_COLUMNS * CONV1_FILTERS);
+    }
+    u32 t = perf_now();
+    run_conv1_row(input, filters, biases, requant, oh, cols->conv1_col, CONV1_OUTPUT_WIDTH - cols->conv1_col,
+                  ring_row + (cols->conv1_col - cols->conv1_first) * CONV1_FILTERS, mismatches);
+    perf_add(PERF_CONV1, t);
+    memcpy(conv1_tail[oh], ring_row + (CONV1_OUTPUT_WIDTH - CONV1_TAIL_COLUMNS - cols->conv1_first) * CONV1_FILTERS,
+           CONV1_TAIL_COLUMNS * CONV1_FILTERS);
+}
+
+/*
+ * run_conv_stack:
+ *   conv1 -> conv2 -> 2x2 max pool, executed depth-first. conv1 rows go into
+ *   a three-row ring; as soon as the three rows under a conv2 output row are
+ *   present that row is computed and the oldest conv1 row is recycled. Pairs
+ *   of conv2 rows are pooled straight into the 60 x 62 x 64 output. Neither
+ *   the 122 x 127 x 32 conv1 nor the conv2 activation is ever materialized;
+ *   layer boundaries and requantization are unchanged. Column 124 of conv2,
+ *   which no pooling window covers, is not computed. Received frames are
+ *   handled after every pooled row (service_background).
+ *
+ *   Only pooled columns pool_col .. 61 are written, from conv1 columns
+ *   2 * pool_col on; see ConvStackColumns.
+ */
+void run_conv_stack(const int8_t* input, int pool_col,
+                    const int8_t* conv1_w, const int32_t* conv1_b, const RequantTable* conv1_rq,
+                    const int8_t* conv2_w, const int32_t* conv2_b, const RequantTable* conv2_rq,
+                    int8_t* output) {
+    int conv1_mismatches = 0, conv2_mismatches = 0;
+    ConvStackColumns cols = conv_stack_columns(pool_col);
+
+    if (inference_backend != BACKEND_ACCEL) {
+        sw_pack_filters(conv2_w, CONV2_FILTERS, CONV2_INPUT_CHANNELS, conv2_filters_packed);
+    }
+
+    for (int r = 0; r < 3; r++) {
+        run_conv1_ring_row(input, &cols, conv1_w, conv1_b, conv1_rq, r, conv1_ring[r], &conv1_mismatches);
+    }
+    for (int ph = 0; ph < POOL_OUTPUT_HEIGHT; ph++) {
+        for (int k = 0; k < 2; k++) {
+            int oh = 2 * ph + k;
+            const int8_t *rows[3] = { conv1_ring[oh % 3], conv1_ring[(oh + 1) % 3], conv1_ring[(oh + 2) % 3] };
+            u32 t = perf_now();
+            // The pair is pooled as one 2 x conv2_width tensor.
+            run_conv2_row(rows, conv2_w, conv2_b, conv2_rq, oh, cols.conv2_width,
+                          conv2_row_pair[0] + k * cols.conv2_width * CONV2_FILTERS, &conv2_mismatches);
+            perf_add(PERF_CONV2, t);
+            // conv1 row oh is no longer needed; refill its slot with row oh + 3.
+            if (oh + 3 < CONV1_OUTPUT_HEIGHT) {
+                run_conv1_ring_row(input, &cols, conv1_w, conv1_b, conv1_rq, oh + 3, conv1_ring[oh % 3],
+                                   &conv1_mismatches);
             }
         }
+        u32 t = perf_now();
+        int8_t *pooled = &output[(ph * POOL_OUTPUT_WIDTH + pool_col) * CONV2_FILTERS];
+        if (inference_backend == BACKEND_SW) {
+            sw_maxpool2x2(conv2_row_pair[0], 2, cols.conv2_width, CONV2_FILTERS, pooled);
+        } else {
+            maxpool2d(conv2_row_pair[0], 2, cols.conv2_width, CONV2_FILTERS, 2, 2, 2, pooled);
+        }
+        perf_add(PERF_MAXPOOL, t);
+        service_background();
+    }
+
+    if (inference_backend == BACKEND_CHECK) {
+        int conv1_outputs = CONV1_OUTPUT_HEIGHT * (CONV1_OUTPUT_WIDTH - cols.conv1_col) * CONV1_FILTERS;
+        int conv2_outputs = CONV2_OUTPUT_HEIGHT * cols.conv2_width * CONV2_FILTERS;
+        xil_printf("conv1: %d of %d outputs differ between accelerator and software backends\n",
+                   conv1_mismatches, conv1_outputs);
+        xil_printf("conv2: %d of %d outputs differ between accelerator and software backends\n",
+                   conv2_mismatches, conv2_outputs);
+        if (conv1_mismatches) {
+            LOG_EVENT(LOG_EV_BACKEND_MISMATCH, PERF_CONV1, conv1_mismatches, conv1_outputs);
+        }
+        if (conv2_mismatches) {
+            LOG_EVENT(LOG_EV_BACKEND_MISMATCH, PERF_CONV2, conv2_mismatches, conv2_outputs);
+        }
+    }
+}
+
+// Input of the last inference. pool_output is the FC1 input and is kept
+// between inferences: a streaming update recomputes only its right edge.
+u8 stream_image[AUDIO_BUFFER_SIZE];
+int8_t pool_output[POOL_OUTPUT_SIZE];
+int stream_valid = 0;                   // pool_output and conv1_tail belong to stream_image
+int stream_last_class = -1;             // last keyword detected while streaming
+u32 stream_columns_since = 0;           // columns received since then
+
+#define STREAM_DETECT_PERCENT    90      // a streaming hop this confident is a detection
+
+/*
+ * stream_seed:
+ *   A full spectrogram: classified from scratch, and the window streaming
+ *   updates slide from.
+ */
+static void stream_seed(const u8 *spectrogram) {
+    memcpy(stream_image, spectrogram, AUDIO_BUFFER_SIZE);
+    run_conv_stack((const int8_t*)stream_image, 0,
+                   conv1_filters, conv1_biases, &conv1_requant,
+                   conv2_filters, conv2_biases, &conv2_requant,
+                   pool_output);
+    stream_valid = 1;
+}
+
+/*
+ * stream_slide:
+ *   Slides stream_image left by the columns of an update and appends them.
+ *   pool_output still holds the old window until stream_update.
+ */
+static void stream_slide(const u8 *update) {
+    u32 columns = get_u32((u8 *)update + 4);
+    const u8 *data = update + STREAM_HEADER_SIZE;
+
+    for (int h = 0; h < INPUT_HEIGHT; h++) {
+        u8 *row = &stream_image[h * INPUT_WIDTH];
+        memmove(row, row + columns, INPUT_WIDTH - columns);
+        for (u32 c = 0; c < columns; c++) {
+            row[INPUT_WIDTH - columns + c] = data[c * INPUT_HEIGHT + h];
+        }
+    }
+}
+
+/*
+ * stream_update:
+ *   Brings pool_output up to stream_image after stream_slide moved it by
+ *   'columns'. Columns are time, so conv1, conv2 and the pool move left with
+ *   the image and keep their values: pool_output is shifted by half the
+ *   column count and run_conv_stack computes only the pooled columns the new
+ *   ones reach, from the new conv1 columns and the cached conv1_tail. An even
+ *   count keeps the 2x2 pooling windows aligned. Without a valid window
+ *   (first update, new model, gated update) everything is computed once.
+ *   BACKEND_CHECK compares the result with a full recompute.
+ */
+static void stream_update(u32 columns) {
+    int pool_col = 0;
+    if (stream_valid) {
+        int shift = columns / 2;
+        pool_col = POOL_OUTPUT_WIDTH - shift;
+        for (int ph = 0; ph < POOL_OUTPUT_HEIGHT; ph++) {
+            int8_t *row = &pool_output[ph * POOL_OUTPUT_WIDTH * CONV2_FILTERS];
+            memmove(row, row + shift * CONV2_FILTERS, pool_col * CONV2_FILTERS);
+        }
+    }
+    run_conv_stack((const int8_t*)stream_image, pool_col,
+                   conv1_filters, conv1_biases, &conv1_requant,
+                   conv2_filters, conv2_biases, &conv2_requant,
+                   pool_output);
+    stream_valid = 1;
+
+    if (inference_backend == BACKEND_CHECK && pool_col > 0) {
+        int8_t *full = check_scratch("stream", stream_check, POOL_OUTPUT_SIZE, POOL_OUTPUT_SIZE);
+        if (!full) return;
+        run_conv_stack((const int8_t*)stream_image, 0,
+                       conv1_filters, conv1_biases, &conv1_requant,
+                       conv2_filters, conv2_biases, &conv2_requant,
+                       full);
+        int mismatches = 0;
+        check_row_outputs("stream", 0, pool_output, full, POOL_OUTPUT_SIZE, &mismatches);
+        xil_printf("stream: %d of %d pooled outputs differ from a full recompute\n", mismatches, POOL_OUTPUT_SIZE);
+        if (mismatches) {
+            LOG_EVENT(LOG_EV_BACKEND_MISMATCH, PERF_MAXPOOL, mismatches, POOL_OUTPUT_SIZE);
+        }
+    }
+}
+
+/*
+ * stream_detected:
+ *   Whether a streaming hop is worth acting on: the network is confident and
+ *   it is not the keyword detected last, still inside the window.
+ */
+static int stream_detected(int predicted_class, u32 probability, u32 columns) {
+    stream_columns_since += columns;
+    if (probability < STREAM_DETECT_PERCENT) return 0;
+    if (predicted_class == stream_last_class && stream_columns_since < INPUT_WIDTH) return 0;
+    stream_last_class = predicted_class;
+    stream_columns_since = 0;
+    return 1;
+}
+
+/*
+ * vad_pass:
+ *   Runs the voice activity gate (acc_vad.h) on a spectrogram about to be
+ *   classified. A rejected one is reported as SILENCE_CLASS at 0% in place
+ *   of an inference and returns 0. A rejected streaming update leaves
+ *   pool_output behind stream_image, so the next update recomputes it.
+ */
+static int vad_pass(const u8 *spectrogram, int streaming, u32 columns) {
+    int decision = vad_check(spectrogram, INPUT_HEIGHT, INPUT_WIDTH);
+    const VadStats *stats = vad_stats();
+    LOG_EVENT(LOG_EV_VAD, decision, (stats->peak << 16) | stats->floor, stats->voiced_columns);
+    if (decision != VAD_SILENT) return 1;
+
+    if (streaming) {
+        stream_valid = 0;
+        stream_columns_since += columns;
+        LOG_DEBUG("Stream hop: silence\n");
+    } else {
+        *seg_ptr = 0;
+        LOG_INFO("Silence (level %d, floor %d, %d voiced columns), not classified\n",
+                 stats->peak, stats->floor, stats->voiced_columns);
+    }
+    LOG_EVENT(LOG_EV_INFERENCE_END, SILENCE_CLASS, 0, 0);
+    PerfReport report;
+    perf_end_inference(&report, SILENCE_CLASS, 0);
+    send_perf_report(&report);
+    return 0;
+}
 
-        // If there's a remainder block, process it with padding.
-        if (remainder > 0) {
-            int8_t padded_block[9];
-            int8_t padded_weights[9];
-            // Initialize padded_block and padded_weights with zeros.
-            memset(padded_block, 0, 9 * sizeof(int8_t));
-            memset(padded_weights, 0, 9 * sizeof(int8_t));
-            // Copy the remainder values.
-            memcpy(padded_block, &input[num_full_blocks * 9], remainder * sizeof(int8_t));
-            memcpy(padded_weights, &weights[m * input_length + num_full_blocks * 9], remainder * sizeof(int8_t));
-            // Process the padded block.
-            uint8_t pe_mask = 0x01;
-            accel_conv3x3_buffer(padded_block, padded_weights, 0, pe_mask);
-            uint32_t result = 0;
-            read_accelerator_results(&result, 1);
-            total_acc += result;
+/*
+ * run_fc_block_sparse:
+ *   run_fc for block-sparse weights. The GEMV engine needs dense rows, so the
+ *   accelerator runs the stored blocks through the descriptor ring or MMIO.
+ */
+void run_fc_block_sparse(const char *layer, const int8_t *input, const BlockSparseMatrix *weights,
+                         const int32_t *biases, const RequantTable *requant, int8_t *output) {
+    if (inference_backend == BACKEND_SW) {
+        sw_fc_block_sparse(input, weights, biases, requant, output);
+        return;
+    }
+    if (ring_feed_ok(weights->blocks, weights->rows)) {
+        fc_block_sparse_with_ring(input, weights, biases, requant, output);
+    } else {
+        fc_block_sparse_with_accelerator_parallel(input, weights, biases, requant, output);
+    }
+    if (inference_backend == BACKEND_CHECK) {
+        int8_t *sw = check_scratch(layer, fc_check, FC_CHECK_SIZE, weights->rows);
+        if (!sw) return;
+        sw_fc_block_sparse(input, weights, biases, requant, sw);
+        compare_layer_outputs(layer, output, sw, weights->rows);
+    }
+}
+
+/*
+ * run_fc:
+ *   Fully connected layer on the selected backend. Dense weights are given
+ *   in weights, block-sparse ones in sparse (the other one NULL).
+ */
+void run_fc(const char *layer, const int8_t *input, int input_length,
+            const int8_t *weights, const BlockSparseMatrix *sparse, const int32_t *biases,
+            const RequantTable *requant, int num_outputs, int8_t *output) {
+    ACC_TRACE_LAYER(layer);
+    if (sparse) {
+        run_fc_block_sparse(layer, input, sparse, biases, requant, output);
+        return;
+    }
+    if (inference_backend == BACKEND_SW) {
+        sw_fc(input, input_length, weights, biases, num_outputs, requant, output);
+        return;
+    }
+    if (ring_feed_ok(weights, num_outputs)) {
+        if (fc_with_gemv(input, input_length, weights, biases, requant, num_outputs, output) != 0) {
+            fc_with_ring(input, input_length, weights, biases, requant, num_outputs, output);
         }
+    } else {
+        fc_with_accelerator_parallel(input, input_length, weights, biases, requant, num_outputs, output);
+    }
+    if (inference_backend == BACKEND_CHECK) {
+        int8_t *sw = check_scratch(layer, fc_check, FC_CHECK_SIZE, num_outputs);
+        if (!sw) return;
+        sw_fc(input, input_length, weights, biases, num_outputs, requant, sw);
+        compare_layer_outputs(layer, output, sw, num_outputs);
+    }
+}
 
-        // Add the bias.
-        total_acc += biases[m];
-        // Compute the quantized output.
-        float multiplier = (S_x * weight_scales[0]) / S_y;
-        int32_t scaled = (int32_t)round(multiplier * total_acc) + Z_y;
-        if (scaled < 0) scaled = 0;
-        if (scaled > 127) scaled = 127;
-        output[m] = (int8_t)scaled;
+/*
+ * run_fc_batch:
+ *   run_fc for 'batch' inputs of input_length bytes back to back, outputs
+ *   back to back. Dense weights on the ring feed go through the GEMV engine
+ *   once for the whole batch; the software backend walks each weight row
+ *   once per batch. Block-sparse weights on the accelerator, which the GEMV
+ *   engine cannot take, and the MMIO feed run the inputs one by one.
+ */
+void run_fc_batch(const char *layer, const int8_t *inputs, int batch, int input_length,
+                  const int8_t *weights, const BlockSparseMatrix *sparse, const int32_t *biases,
+                  const RequantTable *requant, int num_outputs, int8_t *outputs) {
+    ACC_TRACE_LAYER(layer);
+    if (inference_backend == BACKEND_SW) {
+        if (sparse) {
+            sw_fc_block_sparse_batch(inputs, batch, sparse, biases, requant, outputs);
+        } else {
+            sw_fc_batch(inputs, batch, input_length, weights, biases, num_outputs, requant, outputs);
+        }
+        return;
+    }
+    if (sparse || !ring_feed_ok(weights, num_outputs) ||
+        fc_batch_with_gemv(inputs, batch, input_length, weights, biases, requant, num_outputs, outputs) != 0) {
+        for (int b = 0; b < batch; b++) {
+            run_fc(layer, &inputs[b * input_length], input_length, weights, sparse, biases,
+                   requant, num_outputs, &outputs[b * num_outputs]);
+        }
+        return;
+    }
+    if (inference_backend == BACKEND_CHECK) {
+        int8_t *sw = check_scratch(layer, fc_check, FC_CHECK_SIZE, batch * num_outputs);
+        if (!sw) return;
+        sw_fc_batch(inputs, batch, input_length, weights, biases, num_outputs, requant, sw);
+        compare_layer_outputs(layer, outputs, sw, batch * num_outputs);
     }
 }
 
@@ -708,10 +2457,343 @@ void softmax(const float *logits, float *probabilities, int num_classes) {
     }
 }
 
+/*
+ * classify:
+ *   Dequantizes the FC2 outputs, applies softmax and returns the most likely
+ *   class; *percent receives its probability in percent.
+ */
+static int classify(const int8_t *fc2_output, float *percent) {
+    float fc2_logits[FC2_OUTPUT_SIZE];
+    for (int i = 0; i < FC2_OUTPUT_SIZE; i++) {
+        fc2_logits[i] = fc2_logit_scale * ((int)fc2_output[i] - fc2_logit_zero_point);
+    }
+    float probabilities[FC2_OUTPUT_SIZE];
+    softmax(fc2_logits, probabilities, FC2_OUTPUT_SIZE);
+
+    int predicted_class = 0;
+    for (int i = 1; i < FC2_OUTPUT_SIZE; i++) {
+        if (probabilities[i] > probabilities[predicted_class]) predicted_class = i;
+    }
+    *percent = probabilities[predicted_class] * 100;
+    return predicted_class;
+}
+
+// Batch being collected (see BATCH_TENSOR_ID): the FC1 inputs of its clips,
+// back to back in the DMA window so the GEMV engine reads them in place.
+int8_t *batch_pool;
+u32 batch_id;
+u32 batch_clips = 0;                    // clips in the batch, 0 while none is open
+u32 batch_done = 0;                     // bitmap of the clips through the conv stack
+
+/*
+ * batch_setup:
+ *   Allocates batch_pool, from the DMA window if there is room.
+ */
+void batch_setup(void) {
+    batch_pool = (int8_t *)acc_dma_alloc(BATCH_MAX_CLIPS * POOL_OUTPUT_SIZE);
+    if (!batch_pool) batch_pool = (int8_t *)malloc(BATCH_MAX_CLIPS * POOL_OUTPUT_SIZE);
+}
+
+/*
+ * batch_clip:
+ *   Runs one clip through the conv stack into its place in batch_pool. A
+ *   clip of another batch drops the one being collected. Returns 1 once
+ *   every clip of the batch is in.
+ */
+static int batch_clip(const u8 *clip) {
+    u32 id = get_u32((u8 *)clip);
+    u32 index = get_u32((u8 *)clip + 4);
+    u32 clips = get_u32((u8 *)clip + 8);
+    if (!batch_pool) return 0;
+    if (batch_clips == 0 || id != batch_id || clips != batch_clips) {
+        if (batch_clips) {
+            LOG_WARN("Batch %d dropped before all of its %d clips arrived\n", batch_id, batch_clips);
+        }
+        batch_id = id;
+        batch_clips = clips;
+        batch_done = 0;
+        perf_begin_inference();
+        LOG_EVENT(LOG_EV_INFERENCE_BEGIN, 0, 0, 0);
+    }
+    run_conv_stack((const int8_t*)(clip + BATCH_HEADER_SIZE), 0,
+                   conv1_filters, conv1_biases, &conv1_requant,
+                   conv2_filters, conv2_biases, &conv2_requant,
+                   &batch_pool[index * POOL_OUTPUT_SIZE]);
+    stream_valid = 0;                   // conv1_tail now belongs to this clip
+    batch_done |= 1u << index;
+    LOG_EVENT(LOG_EV_LAYER_DONE, PERF_MAXPOOL, 0, 0);
+    return batch_done == (1u << batch_clips) - 1;
+}
+
+/*
+ * batch_finish:
+ *   FC1 and FC2 for every clip of the batch at once (run_fc_batch), then the
+ *   class of each clip: to the PC in one BATCH_ETHER_TYPE frame (u32 batch
+ *   id, u32 clip count, then u32 class and u32 percent per clip) and one
+ *   PerfReport covering the whole batch.
+ */
+static void batch_finish(void) {
+    int clips = (int)batch_clips;
+
+    u32 fc_start = perf_now();
+    run_fc_batch("fc1", batch_pool, clips, POOL_OUTPUT_SIZE,
+                 fc1_weights, fc1_sparse, fc1_biases, &fc1_requant,
+                 FC1_OUTPUT_SIZE, fc1_output);
+    perf_add(PERF_FC1, fc_start);
+    LOG_EVENT(LOG_EV_LAYER_DONE, PERF_FC1, 0, 0);
+    service_background();
+
+    fc_start = perf_now();
+    run_fc_batch("fc2", fc1_output, clips, FC1_OUTPUT_SIZE,
+                 fc2_weights, fc2_sparse, fc2_biases, &fc2_requant,
+                 FC2_OUTPUT_SIZE, fc2_output);
+    perf_add(PERF_FC2, fc_start);
+    LOG_EVENT(LOG_EV_LAYER_DONE, PERF_FC2, 0, 0);
+
+    u8 frame[14 + 8 + 8 * BATCH_MAX_CLIPS];
+    memcpy(frame, PC_MAC, 6);
+    memcpy(frame + 6, FPGA_MAC, 6);
+    frame[12] = (BATCH_ETHER_TYPE >> 8) & 0xFF;
+    frame[13] = BATCH_ETHER_TYPE & 0xFF;
+    memcpy(frame + 14, &batch_id, 4);
+    memcpy(frame + 18, &batch_clips, 4);
+    u32 first_class = 0, first_percent = 0;
+    for (int c = 0; c < clips; c++) {
+        u32 softmax_start = perf_now();
+        float percent;
+        u32 predicted_class = (u32)classify(&fc2_output[c * FC2_OUTPUT_SIZE], &percent);
+        u32 probability = (u32)percent;
+        perf_add(PERF_SOFTMAX, softmax_start);
+        LOG_EVENT(LOG_EV_INFERENCE_END, predicted_class, probability, 0);
+        LOG_INFO("Batch %d clip %d: %s (probability: %d)\n", batch_id, c, class_labels[predicted_class], probability);
+        memcpy(frame + 22 + 8 * c, &predicted_class, 4);
+        memcpy(frame + 26 + 8 * c, &probability, 4);
+        if (c == 0) {
+            first_class = predicted_class;
+            first_percent = probability;
+        }
+    }
+    XEmacLite_Send(&EmacLiteInstance, frame, 22 + 8 * clips);
+    *seg_ptr = first_percent;
+
+    PerfReport report;
+    perf_end_inference(&report, first_class, first_percent);
+    report.clips = batch_clips;
+    perf_print(&report);
+    send_perf_report(&report);
+    batch_clips = 0;
+}
+
+/*
+ * model_activate:
+ *   Makes the model in 'slot' the one inference uses: registry, layer
+ *   bindings, requant tables and the weight bank. Only between utterances.
+ */
+static int model_activate(int slot, const StoreManifest *manifest) {
+    u32 load_start = perf_now();
+    if (manifest->tensor_count > TOTAL_TENSORS) return -1;
+    model_ready = 0;
+    stream_valid = 0;
+    batch_clips = 0;
+    DRAM_ptr = (volatile u8 *)store_slot_base(slot);
+    for (unsigned int i = 0; i < manifest->tensor_count; i++) {
+        tensor_offsets[i] = manifest->tensors[i].offset;
+        tensor_sizes[i] = manifest->tensors[i].size;
+    }
+    tensor_count = manifest->tensor_count;
+
+    if (build_tensor_registry() != 0 || bind_model_tensors() != 0) {
+        xil_printf("Received model does not match the network.\n");
+        return -1;
+    }
+    if (prepare_requant_tables() != 0) {
+        xil_printf("Failed to prepare requantization tables.\n");
+        return -1;
+    }
+
+    // The accelerator reads the weights straight from DRAM; the data cache
+    // may still hold what the receive path and the bindings wrote there.
+    for (unsigned int i = 0; i < tensor_count; i++) {
+        acc_cache_to_device((const void *)&DRAM_ptr[tensor_offsets[i]], tensor_sizes[i]);
+    }
+
+    // conv filters stay resident in the accelerator from here on.
+    if (inference_backend != BACKEND_SW) {
+        accel_load_weight_bank(conv1_filters, conv2_filters);
+    }
+    perf_clear(PERF_LOAD);
+    perf_add(PERF_LOAD, load_start);
+    model_ready = 1;
+    return 0;
+}
+
+/*
+ * model_commit:
+ *   Checks the staged model and switches to it. A model that fails to load
+ *   is dropped and the previous one is restored. Returns a MODEL_STATUS_*;
+ *   *bad_mask lists missing or damaged tensors.
+ */
+static u32 model_commit(u32 *bad_mask) {
+    *bad_mask = store_verify_staged();
+    if (*bad_mask) {
+        xil_printf("Staged model incomplete, tensors %08X missing or damaged\n", *bad_mask);
+        return MODEL_STATUS_MISSING;
+    }
+    int previous = store_active_slot();
+    if (model_activate(store_staged_slot(), store_staged_manifest()) != 0) {
+        xil_printf("Staged model rejected, keeping the current one.\n");
+        store_abort();
+        if (previous >= 0) model_activate(previous, store_active_manifest());
+        return MODEL_STATUS_REJECTED;
+    }
+    store_commit();
+    LOG_EVENT(LOG_EV_MODEL_ACTIVE, store_active_slot(), store_active_manifest()->model_hash,
+              store_active_manifest()->generation);
+    xil_printf("Model %08X active in slot %d (generation %d).\n", store_active_manifest()->model_hash,
+               store_active_slot(), store_active_manifest()->generation);
+    return MODEL_STATUS_OK;
+}
+
+typedef struct {
+    u32 op;                 // request answered
+    u32 status;             // MODEL_STATUS_*
+    u32 active_slot;        // 0xFFFFFFFF before the first model
+    u32 generation;
+    u32 model_hash;         // of the active model, 0 if none
+    u32 mask;               // BEGIN: tensors to send; COMMIT: tensors missing or damaged
+    u32 tensor_count;
+    u32 tensors[2 * STORE_MAX_TENSORS];  // size and CRC of each active tensor
+} ModelReply;
+
+static void send_model_reply(u32 op, u32 status, u32 mask) {
+    u8 reply_packet[14 + sizeof(ModelReply)];
+    const StoreManifest *m = store_active_manifest();
+    ModelReply reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.op = op;
+    reply.status = status;
+    reply.active_slot = m ? (u32)store_active_slot() : 0xFFFFFFFFu;
+    reply.mask = mask;
+    if (m) {
+        reply.generation = m->generation;
+        reply.model_hash = m->model_hash;
+        reply.tensor_count = m->tensor_count;
+        for (u32 i = 0; i < m->tensor_count; i++) {
+            reply.tensors[2 * i] = m->tensors[i].size;
+            reply.tensors[2 * i + 1] = m->tensors[i].crc;
+        }
+    }
+    u32 length = sizeof(reply) - sizeof(reply.tensors) + 8 * reply.tensor_count;
+
+    memcpy(reply_packet, PC_MAC, 6);
+    memcpy(reply_packet + 6, FPGA_MAC, 6);
+    reply_packet[12] = (MODEL_ETHER_TYPE >> 8) & 0xFF;
+    reply_packet[13] = MODEL_ETHER_TYPE & 0xFF;
+    memcpy(reply_packet + 14, &reply, length);
+    XEmacLite_Send(&EmacLiteInstance, reply_packet, 14 + length);
+}
+
+/*
+ * process_model_control:
+ *   QUERY reports the active model; BEGIN stages a model into the inactive
+ *   slot and answers with the tensors the PC still has to send; COMMIT
+ *   verifies and switches to it. Every request may be repeated.
+ */
+static void process_model_control(u8 *packet, int length) {
+    u8 *p = packet + ETH_HEADER_SIZE;
+    int size = length - ETH_HEADER_SIZE;
+    u32 op = size >= 4 ? get_u32(p) : 0;
+    u32 status = MODEL_STATUS_OK;
+    u32 mask = 0;
+
+    if (op == MODEL_OP_QUERY) {
+        // reply only
+    } else if (op == MODEL_OP_BEGIN && size >= 12) {
+        u32 hash = get_u32(p + 4);
+        u32 count = get_u32(p + 8);
+        u32 sizes[STORE_MAX_TENSORS], crcs[STORE_MAX_TENSORS];
+        if (count == 0 || count > TOTAL_TENSORS || size < 12 + 8 * (int)count) {
+            status = MODEL_STATUS_BAD_REQUEST;
+        } else {
+            for (u32 i = 0; i < count; i++) {
+                sizes[i] = get_u32(p + 12 + 8 * i);
+                crcs[i] = get_u32(p + 16 + 8 * i);
+            }
+            rx_forget();
+            if (store_begin(hash, count, sizes, crcs, &mask) != 0) {
+                status = MODEL_STATUS_REJECTED;
+            } else {
+                xil_printf("Staging model %08X in slot %d, tensors %08X needed\n", hash, store_staged_slot(), mask);
+            }
+        }
+    } else if (op == MODEL_OP_COMMIT && size >= 8) {
+        u32 hash = get_u32(p + 4);
+        const StoreManifest *m = store_active_manifest();
+        if (store_staging() == STORE_STAGING && store_staged_manifest()->model_hash == hash) {
+            status = model_commit(&mask);
+        } else if (!(m && m->model_hash == hash)) {   // else a repeated COMMIT
+            status = MODEL_STATUS_BAD_REQUEST;
+        }
+    } else {
+        status = MODEL_STATUS_BAD_REQUEST;
+    }
+    LOG_EVENT(LOG_EV_MODEL_CONTROL, op, status, mask);
+    send_model_reply(op, status, mask);
+}
+
 int main() {
 
     init_platform();
-    Xil_DCacheDisable();
+    // Caches on: everything the accelerator shares with the CPU goes through
+    // acc_cache_to_device / acc_cache_from_device (acc_dma.h).
+    Xil_ICacheEnable();
+    Xil_DCacheEnable();
+
+    DRAM_ptr = (volatile u8 *)HAL_PTR(DRAM_BASE_ADDR);
+    button = (volatile unsigned int *)HAL_PTR(BUTTONS_BASE_ADDR);
+    seg_ptr = (volatile uint32_t *)HAL_PTR(SEVEN_SEG_ADDR);
+
+    const char *backend = hal_get_option("ACC_HOST_BACKEND");
+    if (backend) {
+        if (strcmp(backend, "sw") == 0) inference_backend = BACKEND_SW;
+        else if (strcmp(backend, "check") == 0) inference_backend = BACKEND_CHECK;
+        else inference_backend = BACKEND_ACCEL;
+    }
+    xil_printf("Inference backend: %s\n", inference_backend == BACKEND_SW ? "software" :
+               (inference_backend == BACKEND_CHECK ? "accelerator + software check" : "accelerator"));
+    // "off", or energy,contrast,voiced columns,hangover for the gate.
+    const char *vad = hal_get_option("ACC_HOST_VAD");
+    if (vad) {
+        VadConfig config = *vad_config();
+        if (strcmp(vad, "off") == 0) {
+            config.enabled = 0;
+        } else {
+            u32 *fields[] = { &config.energy_threshold, &config.contrast_threshold,
+                              &config.min_voiced_columns, &config.hangover };
+            const char *p = vad;
+            for (int i = 0; i < 4 && *p; i++) {
+                char *end;
+                *fields[i] = (u32)strtoul(p, &end, 10);
+                p = (*end == ',') ? end + 1 : end;
+            }
+        }
+        vad_configure(&config, INPUT_HEIGHT);
+    }
+    const char *feed = hal_get_option("ACC_HOST_FEED");
+    if (feed) {
+        accel_feed = (strcmp(feed, "mmio") == 0) ? ACC_FEED_MMIO : ACC_FEED_RING;
+    }
+    if (inference_backend != BACKEND_SW) {
+        accel_ring_setup();
+        xil_printf("Accelerator feed: %s\n", accel_feed == ACC_FEED_RING ? "descriptor ring" : "MMIO");
+    }
+    batch_setup();
+    if (activation_arena_setup() != 0) {
+        xil_printf("Failed to allocate the activation arena.\n");
+        return XST_FAILURE;
+    }
+    perf_init();
+    LOG_EVENT(LOG_EV_BOOT, 0, 0, 0);
     //Initialize UARTLite before inference
 	int status = XUartLite_Initialize(&UartLite, UARTLITE_DEVICE_ID);
 		if (status != XST_SUCCESS) {
@@ -721,406 +2803,156 @@ int main() {
 
     XEmacLite_Initialize(&EmacLiteInstance, XPAR_AXI_ETHERNETLITE_0_DEVICE_ID);
     XEmacLite_SetMacAddress(&EmacLiteInstance, FPGA_MAC);
+    if (rx_interrupt_setup() != 0) {
+        xil_printf("EmacLite interrupt setup failed\n");
+        return XST_FAILURE;
+    }
 
     xil_printf("FPGA MAC Address Set to: %02X:%02X:%02X:%02X:%02X:%02X\n",
                FPGA_MAC[0], FPGA_MAC[1], FPGA_MAC[2],
                FPGA_MAC[3], FPGA_MAC[4], FPGA_MAC[5]);
     xil_printf("FPGA ready to receive TFLite model data into DRAM at 0x%08X...\n", DRAM_BASE_ADDR);
 
-    // Model param transmission
-    // Continuously receive packets until all 18 tensors have been received
-    while(1) {
+    // A model kept in DRAM across a reset is used as is; otherwise receive
+    // packets until the PC has uploaded one. Later uploads go to the other
+    // slot and replace the model between two utterances.
+    int slot = store_init();
+    if (slot >= 0 && model_activate(slot, store_active_manifest()) == 0) {
+        LOG_EVENT(LOG_EV_MODEL_ACTIVE, slot, store_active_manifest()->model_hash,
+                  store_active_manifest()->generation);
+        xil_printf("Model %08X restored from DRAM slot %d.\n", store_active_manifest()->model_hash, slot);
+    }
+    while (!model_ready) {
         receive_model_data();
-        if (tensor_count >= (TOTAL_TENSORS - 1)) {
-            xil_printf("All tensors received. Stopping reception.\n", TOTAL_TENSORS);
-            break;
-        }
     }
 
     // Ready to receive audio and inference
-    int last_button_state = 0;
-    while (1) {
-        int button_state = *button & 0x1;
-        if (button_state && !last_button_state) {  // Rising edge detected
-            xil_printf("Button Press Detected! Sending request to PC...\n");
-            send_request_to_pc();
-        }
-        last_button_state = button_state;
-
+    while (hal_keep_running()) {
+        poll_button();
         receive_model_data();
 
 
-        // Start Conv
-        if(audio_ready == 1)
+        // Start Conv: oldest queued spectrogram first
+        if(audio_ready > 0)
         {
-            //Conv
-            int input_size = INPUT_HEIGHT * INPUT_WIDTH;
-
-            Tensor *input_qparams = load_tensor_from_dram(2);
-            if (!input_qparams) {
-                xil_printf("Failed to load input quantization parameters.\n");
-                return -1;
-            }
-            float S_x = input_qparams->scales[0];
-            int Z_x = input_qparams->zero_points[0];
-            free_tensor(input_qparams);
-            input_qparams = NULL;
-
-            Tensor *filter_tensor = load_tensor_from_dram(3);
-            if (!filter_tensor) {
-                xil_printf("Failed to load filter tensor.\n");
-                return -1;
-            }
-            if (filter_tensor->num_scales != CONV1_FILTERS) {
-                xil_printf("Unexpected number of filter scales: %d (expected %d)\n",
-                           filter_tensor->num_scales, CONV1_FILTERS);
-                free_tensor(filter_tensor);
-                filter_tensor = NULL;
-                return -1;
-            }
-            const float *filter_scales = filter_tensor->scales;
-
-            Tensor *bias_tensor = load_tensor_from_dram(4);
-            if (!bias_tensor) {
-                xil_printf("Failed to load bias tensor.\n");
-                free_tensor(filter_tensor);
-                filter_tensor = NULL;
-                return -1;
+            // inference_backend may have been changed since the arena was planned.
+            if (inference_backend != arena_backend && activation_arena_setup() != 0) {
+                xil_printf("No memory for the activation arena of this backend, keeping the old one.\n");
+                inference_backend = arena_backend;
             }
-
-            Tensor *output_qparams = load_tensor_from_dram(5);
-            if (!output_qparams) {
-                xil_printf("Failed to load output quantization parameters.\n");
-                free_tensor(filter_tensor);
-                free_tensor(bias_tensor);
-                filter_tensor = NULL;
-                bias_tensor = NULL;
-                return -1;
-            }
-            float S_y = output_qparams->scales[0];
-            int Z_y = output_qparams->zero_points[0];
-            free_tensor(output_qparams);
-            output_qparams = NULL;
-
-            // Allocate output buffer.
-            int output_size = CONV1_OUTPUT_HEIGHT * CONV1_OUTPUT_WIDTH * CONV1_FILTERS;
-            int8_t *conv1_output = (int8_t*)malloc(output_size * sizeof(int8_t));
-            if (!conv1_output) {
-                xil_printf("Failed to allocate output buffer.\n");
-                free(input);
-                input = NULL;
-                return -1;
+            audio_busy_slot = audio_queue[0];
+            for (int i = 1; i < audio_ready; i++) audio_queue[i - 1] = audio_queue[i];
+            audio_ready--;
+            const u8 *input = AudioInputBuffer[audio_busy_slot];
+            if (audio_slot_tensor[audio_busy_slot] == BATCH_TENSOR_ID) {
+                // One clip of a batch: conv stack now, FC1/FC2 once all are in.
+                if (batch_clip(input)) batch_finish();
+                audio_busy_slot = -1;
+                continue;
             }
-            memset(conv1_output, 0, output_size * sizeof(int8_t));
-
-            // Run the convolution using the accelerator with double buffering (pairwise processing).
-            conv_with_accelerator_parallel(AudioInputBuffer, INPUT_WIDTH,
-                                           (int8_t*)filter_tensor->data, (int32_t*)bias_tensor->data,
-                                           S_x, Z_x, filter_scales,
-                                           S_y, Z_y,
-                                           conv1_output);
-
-            xil_printf("Conv1 layer completed.\n");
-
-            free_tensor(filter_tensor);
-            free_tensor(bias_tensor);
-            free(input);
-            filter_tensor = NULL;
-            bias_tensor = NULL;
-            input = NULL;
-
-            // Inference Phase: Second Convolution Layer (conv2)
-            // For conv2, the input is the conv1 output.
-            // Load conv2 tensors:
-            // Tensor 5 is already used for conv1 output quantization.
-            // For conv2, we use:
-            //   - Tensor 5's quantization for conv2 input quantization.
-            //   - Tensor 6: conv2 filter weights and per-channel scales.
-            //   - Tensor 7: conv2 biases.
-            //   - Tensor 8: conv2 output quantization.
-
-            Tensor *input_qparams2 = load_tensor_from_dram(5);
-            if (!input_qparams2) {
-                xil_printf("Failed to load conv2 input quantization parameters (from Tensor 5).\n");
-                free(conv1_output);
-                conv1_output = NULL;
-                return -1;
-            }
-            float S_x2 = input_qparams2->scales[0];
-            int Z_x2 = input_qparams2->zero_points[0];
-            free_tensor(input_qparams2);
-            input_qparams2 = NULL;
-
-            Tensor *filter_tensor2 = load_tensor_from_dram(6);
-            if (!filter_tensor2) {
-                xil_printf("Failed to load conv2 filter tensor.\n");
-                free(conv1_output);
-                conv1_output = NULL;
-                return -1;
-            }
-            if (filter_tensor2->num_scales != CONV2_FILTERS) {
-                xil_printf("Unexpected number of conv2 filter scales: %d (expected %d)\n",
-                           filter_tensor2->num_scales, CONV2_FILTERS);
-                free_tensor(filter_tensor2);
-                free(conv1_output);
-                filter_tensor2 = NULL;
-                conv1_output = NULL;
-                return -1;
-            }
-            const float *filter_scales2 = filter_tensor2->scales;
-
-            Tensor *bias_tensor2 = load_tensor_from_dram(7);
-            if (!bias_tensor2) {
-                xil_printf("Failed to load conv2 bias tensor.\n");
-                free_tensor(filter_tensor2);
-                free(conv1_output);
-                filter_tensor2 = NULL;
-                conv1_output = NULL;
-                return -1;
+            int streaming = (audio_slot_tensor[audio_busy_slot] == STREAM_TENSOR_ID);
+            u32 stream_columns = streaming ? get_u32((u8 *)input + 4) : 0;
+            perf_begin_inference();
+            LOG_EVENT(LOG_EV_INFERENCE_BEGIN, 0, 0, 0);
+
+            // Voice activity gate: silence and steady noise skip the network.
+            // A streaming update is judged on the window it slides in.
+            if (streaming) stream_slide(input);
+            if (!vad_pass(streaming ? stream_image : input, streaming, stream_columns)) {
+                audio_busy_slot = -1;
+                continue;
             }
 
-            Tensor *output_qparams2 = load_tensor_from_dram(8);
-            if (!output_qparams2) {
-                xil_printf("Failed to load conv2 output quantization parameters.\n");
-                free_tensor(filter_tensor2);
-                free_tensor(bias_tensor2);
-                free(conv1_output);
-                filter_tensor2 = NULL;
-                bias_tensor2 = NULL;
-                conv1_output = NULL;
-                return -1;
-            }
-            float S_y2 = output_qparams2->scales[0];
-            int Z_y2 = output_qparams2->zero_points[0];
-            free_tensor(output_qparams2);
-            output_qparams2 = NULL;
-
-            // Allocate output buffer for conv2.
-            int conv2_output_size = CONV2_OUTPUT_HEIGHT * CONV2_OUTPUT_WIDTH * CONV2_FILTERS;
-            int8_t *conv2_output = (int8_t*)malloc(conv2_output_size * sizeof(int8_t));
-            if (!conv2_output) {
-                xil_printf("Failed to allocate conv2 output buffer.\n");
-                free(conv1_output);
-                free_tensor(filter_tensor2);
-                free_tensor(bias_tensor2);
-                conv1_output = NULL;
-                filter_tensor2 = NULL;
-                bias_tensor2 = NULL;
-                return -1;
-            }
-            memset(conv2_output, 0, conv2_output_size * sizeof(int8_t));
-
-            conv2_with_accelerator_parallel(conv1_output, CONV1_OUTPUT_WIDTH,
-                                            (int8_t*)filter_tensor2->data, (int32_t*)bias_tensor2->data,
-                                            S_x2, Z_x2, filter_scales2,
-                                            S_y2, Z_y2,
-                                            conv2_output);
-
-            xil_printf("Conv2 layer completed.\n");
-
-            free(conv1_output);
-            free_tensor(filter_tensor2);
-            free_tensor(bias_tensor2);
-            conv1_output = NULL;
-            filter_tensor2 = NULL;
-            bias_tensor2 = NULL;
-
-
-            // MaxPool2D and Flatten Layers
-            // For conv2 output dimensions: 120 x 125 x 64
-            // Using a 2x2 pool with stride 2 produces:
-            int pool_height = 2, pool_width = 2, pool_stride = 2;
-            int pool_output_height = (CONV2_OUTPUT_HEIGHT - pool_height) / pool_stride + 1; // should be 60
-            int pool_output_width = (CONV2_OUTPUT_WIDTH - pool_width) / pool_stride + 1;    // should be 62
-            int pool_output_size = pool_output_height * pool_output_width * CONV2_FILTERS;
-            int8_t *pool_output = (int8_t*)malloc(pool_output_size * sizeof(int8_t));
-            if (!pool_output) {
-                xil_printf("Failed to allocate pool output buffer.\n");
-                free(conv2_output);
-                conv2_output = NULL;
-                return -1;
+            //Conv
+            // Filters, weights and biases are registry views bound at model load
+            // (bind_model_tensors); quantization lives in the requant tables.
+
+            // conv1, conv2 and MaxPool2D run depth-first through a three-row
+            // conv1 ring (run_conv_stack), so only the 60 x 62 x 64 pooled
+            // tensor is stored; it is already the flattened FC1 input. A
+            // streaming update recomputes only the columns it reaches.
+            // conv1 uses tensors 3/4, conv2 tensors 6/7.
+            if (streaming) {
+                stream_update(stream_columns);
+            } else {
+                stream_seed(input);
             }
 
-            maxpool2d(conv2_output, CONV2_OUTPUT_HEIGHT, CONV2_OUTPUT_WIDTH, CONV2_FILTERS,
-                      pool_height, pool_width, pool_stride, pool_output);
-
-            free(conv2_output);
-            conv2_output = NULL;
-
-
-            xil_printf("MaxPool2D and Flatten layers completed.\n");
+            LOG_EVENT(LOG_EV_LAYER_DONE, PERF_MAXPOOL, 0, 0);
+            LOG_DEBUG("Conv1, Conv2, MaxPool2D and Flatten layers completed.\n");
 
             /* Fully Connected Layer # 1 */
-            // For the FC layer:
-            //   - Tensor 10: FC input quantization parameters.
-            //   - Tensor 11: FC weights, with dimensions 128 x flattened_size.
-            //   - Tensor 12: FC biases (128 values).
-            //   - Tensor 13: FC output quantization parameters.
-
-           Tensor *fc_in_qparams = load_tensor_from_dram(10);
-            if (!fc_in_qparams) { xil_printf("Failed to load FC input quantization (Tensor 10).\n"); free(pool_output); return -1; }
-                float S_x_fc = fc_in_qparams->scales[0];
-                int Z_x_fc = fc_in_qparams->zero_points[0];
-                free_tensor(fc_in_qparams);
-                fc_in_qparams = NULL;
-
-           Tensor *fc_weight_tensor = load_tensor_from_dram(11);
-            if (!fc_weight_tensor) {
-               xil_printf("Failed to load FC weight tensor (Tensor 11).\n");
-               free(pool_output);
-               return -1; }
-
-            const float *fc_weight_scales = fc_weight_tensor->scales;
-
-            Tensor *fc_bias_tensor = load_tensor_from_dram(12);
-            if (!fc_bias_tensor) {
-               xil_printf("Failed to load FC bias tensor (Tensor 12).\n");
-               free(pool_output);
-               free_tensor(fc_weight_tensor);
-               return -1; }
-
-            int flattened_size = pool_output_height * pool_output_width * CONV2_FILTERS;
-
-            Tensor *fc_out_qparams = load_tensor_from_dram(13);
-            if (!fc_out_qparams) {
-               xil_printf("Failed to load FC output quantization (Tensor 13).\n");
-               free(pool_output);
-               free_tensor(fc_weight_tensor);
-               free_tensor(fc_bias_tensor);
-               return -1;
-            }
-            float S_y_fc = fc_out_qparams->scales[0];
-            int Z_y_fc = fc_out_qparams->zero_points[0];
-            free_tensor(fc_out_qparams);
-            fc_out_qparams = NULL;
-
-            // Allocate FC output buffer: FC layer has 128 outputs.
-            int8_t *fc1_output = (int8_t*)malloc(FC1_OUTPUT_SIZE * sizeof(int8_t));
-            if (!fc1_output) {
-                xil_printf("Failed to allocate FC output buffer.\n");
-                free(pool_output);
-            }
+            // FC1 weights (tensor 11, 128 x flattened_size) are read in place
+            // from DRAM; biases are tensor 12.
 
-            fc_with_accelerator_parallel(pool_output, flattened_size,
-                                         (int8_t*)fc_weight_tensor->data, (int32_t*)fc_bias_tensor->data,
-                                         S_x_fc, Z_x_fc, fc_weight_scales,
-                                         S_y_fc, Z_y_fc,
-                                         FC1_OUTPUT_SIZE,
-                                         fc1_output);
+            // FC1 and FC2 outputs live in the activation arena.
+            int flattened_size = POOL_OUTPUT_SIZE;
 
-            xil_printf("Fully Connected 1 completed.\n");
-            free(pool_output);
+            u32 fc_start = perf_now();
+            run_fc("fc1", pool_output, flattened_size,
+                   fc1_weights, fc1_sparse, fc1_biases,
+                   &fc1_requant,
+                   FC1_OUTPUT_SIZE,
+                   fc1_output);
+            perf_add(PERF_FC1, fc_start);
 
-            pool_output = NULL;
+            LOG_EVENT(LOG_EV_LAYER_DONE, PERF_FC1, 0, 0);
+            LOG_DEBUG("Fully Connected 1 completed.\n");
+            service_background();
 
             /* Fully Connected Layer 2 */
-            // FC2 uses:
-            // - Tensor 13 (reinterpreted): FC2 input quantization.
-            // - Tensor 14: FC2 weights, dimensions: [FC2_OUTPUT_SIZE, FC1_OUTPUT_SIZE].
-            // - Tensor 15: FC2 biases (FC2_OUTPUT_SIZE values).
-            // - Tensor 16: FC2 output quantization.
-        
-           Tensor *fc2_in_qparams = load_tensor_from_dram(13);
-           if (!fc2_in_qparams) {
-               xil_printf("Failed to load FC2 input quantization (Tensor 13).\n");
-               free(fc1_output); return -1;
-           }
-           float S_x_fc2 = fc2_in_qparams->scales[0];
-           int Z_x_fc2 = fc2_in_qparams->zero_points[0];
-           free_tensor(fc2_in_qparams);
-           fc2_in_qparams = NULL;
-
-            Tensor *fc2_weight_tensor = load_tensor_from_dram(14);
-            if (!fc2_weight_tensor) {
-               xil_printf("Failed to load FC2 weight tensor (Tensor 14).\n");
-               free(fc1_output);
-               return -1;
-            }
-            const float *fc2_weight_scales = fc2_weight_tensor->scales;
-
-            Tensor *fc2_bias_tensor = load_tensor_from_dram(15);
-            if (!fc2_bias_tensor) {
-               xil_printf("Failed to load FC2 bias tensor (Tensor 15).\n");
-               free(fc1_output); f
-               ree_tensor(fc2_weight_tensor);
-               return -1;
-            }
-
-            Tensor *fc2_out_qparams = load_tensor_from_dram(16);
-            if (!fc2_out_qparams) {
-               xil_printf("Failed to load FC2 output quantization (Tensor 16).\n");
-               free(fc1_output);
-               free_tensor(fc2_weight_tensor);
-               free_tensor(fc2_bias_tensor);
-               return -1;
-            }
-            float S_y_fc2 = fc2_out_qparams->scales[0];
-            int Z_y_fc2 = fc2_out_qparams->zero_points[0];
-            free_tensor(fc2_out_qparams);
+            // FC2 uses tensor 14 weights [FC2_OUTPUT_SIZE, FC1_OUTPUT_SIZE]
+            // and tensor 15 biases.
 
+            fc_start = perf_now();
+            run_fc("fc2", fc1_output, FC1_OUTPUT_SIZE,
+                   fc2_weights, fc2_sparse, fc2_biases,
+                   &fc2_requant,
+                   FC2_OUTPUT_SIZE,
+                   fc2_output);
+            perf_add(PERF_FC2, fc_start);
 
-
-            int8_t *fc2_output = (int8_t*)malloc(FC2_OUTPUT_SIZE * sizeof(int8_t));
-            if (!fc2_output) {
-                xil_printf("Failed to allocate FC2 output buffer.\n");
-                free(fc1_output);
-                return -1;
-            }
-
-            fc_with_accelerator_parallel(fc1_output, FC1_OUTPUT_SIZE,
-                                         (int8_t*)fc2_weight_tensor->data, (int32_t*)fc2_bias_tensor->data,
-                                         S_x_fc2, Z_x_fc2, fc2_weight_scales,
-                                         S_y_fc2, Z_y_fc2,
-                                         FC2_OUTPUT_SIZE,
-                                         fc2_output);
-
-            xil_printf("Fully Connected 2 completed.\n");
+            LOG_EVENT(LOG_EV_LAYER_DONE, PERF_FC2, 0, 0);
+            LOG_DEBUG("Fully Connected 2 completed.\n");
+            service_background();
 
             /* ----- Output Prediction ----- */
             // Convert FC2 outputs to probabilities using softmax.
-            float fc2_logits[FC2_OUTPUT_SIZE];
-            // Dequantize FC2 output
-            for (int i = 0; i < FC2_OUTPUT_SIZE; i++) {
-                fc2_logits[i] = S_x_fc2 * ((int)fc2_output[i] - Z_x_fc2);
-            }
-            float probabilities[FC2_OUTPUT_SIZE];
-            softmax(fc2_logits, probabilities, FC2_OUTPUT_SIZE);
-
-            xil_printf("Inference completed.\n");
-
-            // Choose predicted class (argmax).
-            int predicted_class = 0;
-            float max_prob = probabilities[0];
-            for (int i = 1; i < FC2_OUTPUT_SIZE; i++) {
-                if (probabilities[i] > max_prob) {
-                    max_prob = probabilities[i];
-                    predicted_class = i;
-                }
-            }
-            // convert probability to percentage and write to seven segment display
-            max_prob = max_prob * 100;
-            *seg_ptr = (uint32_t) max_prob;
+            u32 softmax_start = perf_now();
+            float max_prob;
+            int predicted_class = classify(fc2_output, &max_prob);
 
-			// Send predicted command string over Bluetooth 10 times aviod miss packet
-            const char *cmd = class_labels[predicted_class];;
-            for(int i = 0; i < 10; i++) {
-            	XUartLite_Send(&UartLite, (u8 *)cmd, strlen(cmd));
-            	usleep(1000);
-            }
+            LOG_DEBUG("Inference completed.\n");
 
-            xil_printf("Predicted class: %s (probability: %d)\n", class_labels[predicted_class], (int)(max_prob));
+            // write the probability (in percent) to the seven segment display
+            perf_add(PERF_SOFTMAX, softmax_start);
+            *seg_ptr = (uint32_t) max_prob;
+            LOG_EVENT(LOG_EV_INFERENCE_END, predicted_class, (u32)max_prob, 0);
+
+            // While streaming, every hop is classified but only detections act.
+            const char *cmd = class_labels[predicted_class];
+            if (!streaming || stream_detected(predicted_class, (u32)max_prob, stream_columns)) {
+                // Send predicted command string over Bluetooth 10 times aviod miss packet
+                for(int i = 0; i < 10; i++) {
+                    XUartLite_Send(&UartLite, (u8 *)cmd, strlen(cmd));
+                    usleep(1000);
+                }
 
-			// Debug print (optional)
-			xil_printf("Command sent to GUI: %s\n", cmd);
+                xil_printf("Predicted class: %s (probability: %d)\n", class_labels[predicted_class], (int)(max_prob));
 
-            // Free remaining FC2 tensors.
-            free(fc1_output);
-            free(fc2_output);
+                // Debug print (optional)
+                LOG_DEBUG("Command sent to GUI: %s\n", cmd);
+            } else {
+                LOG_DEBUG("Stream hop: %s (probability: %d)\n", class_labels[predicted_class], (int)(max_prob));
+            }
 
+            // Where the time went, on the console and to the PC.
+            PerfReport report;
+            perf_end_inference(&report, predicted_class, (u32)max_prob);
+            perf_print(&report);
+            send_perf_report(&report);
 
-            audio_offset = 0; // Clear to receive next audio
-            audio_ready = 0;
-            expected_fragment_index = 0;
+            audio_busy_slot = -1; // Slot free to receive the next audio
         }
     }
 
@@ -0,0 +1,79 @@
+#include "acc_arena.h"
+
+static u32 aligned(u32 size) {
+    return (size + ARENA_ALIGN - 1) & ~(u32)(ARENA_ALIGN - 1);
+}
+
+static int lifetimes_overlap(const ArenaBuffer *a, const ArenaBuffer *b) {
+    return a->first <= b->last && b->first <= a->last;
+}
+
+u32 arena_plan(ArenaBuffer *buffers, int count, const u32 *uses, int steps) {
+    int order[ARENA_MAX_BUFFERS];
+    int placed = 0;
+    u32 peak = 0;
+
+    if (count > ARENA_MAX_BUFFERS) count = ARENA_MAX_BUFFERS;
+    for (int i = 0; i < count; i++) {
+        buffers[i].first = -1;
+        buffers[i].last = -1;
+        buffers[i].offset = 0;
+        for (int s = 0; s < steps; s++) {
+            if (!(uses[s] & (1u << i))) continue;
+            if (buffers[i].first < 0) buffers[i].first = s;
+            buffers[i].last = s;
+        }
+    }
+
+    // Largest first; each at the lowest offset clear of the buffers already
+    // placed that are live at the same time. 'order' keeps the placed ones
+    // sorted by offset.
+    for (int n = 0; n < count; n++) {
+        int next = -1;
+        for (int i = 0; i < count; i++) {
+            int done = 0;
+            for (int k = 0; k < placed; k++) done |= (order[k] == i);
+            if (done || buffers[i].size == 0 || buffers[i].first < 0) continue;
+            if (next < 0 || buffers[i].size > buffers[next].size) next = i;
+        }
+        if (next < 0) break;
+
+        ArenaBuffer *b = &buffers[next];
+        u32 offset = 0;
+        for (int k = 0; k < placed; k++) {
+            const ArenaBuffer *other = &buffers[order[k]];
+            if (!lifetimes_overlap(b, other)) continue;
+            if (offset + aligned(b->size) <= other->offset) break;
+            if (other->offset + aligned(other->size) > offset) offset = other->offset + aligned(other->size);
+        }
+        b->offset = offset;
+        if (offset + aligned(b->size) > peak) peak = offset + aligned(b->size);
+
+        int k = placed++;
+        while (k > 0 && buffers[order[k - 1]].offset > offset) {
+            order[k] = order[k - 1];
+            k--;
+        }
+        order[k] = next;
+    }
+    return peak;
+}
+
+void arena_bind(const ArenaBuffer *buffers, int count, u8 *arena) {
+    for (int i = 0; i < count; i++) {
+        int planned = buffers[i].size != 0 && buffers[i].first >= 0;
+        if (buffers[i].ptr) *buffers[i].ptr = planned ? arena + buffers[i].offset : NULL;
+    }
+}
+
+void arena_print(const ArenaBuffer *buffers, int count, u32 arena_size) {
+    u32 separate = 0;
+    xil_printf("Activation arena:\n");
+    for (int i = 0; i < count; i++) {
+        if (buffers[i].size == 0 || buffers[i].first < 0) continue;
+        xil_printf("  %-16s offset %7d size %7d steps %d..%d\n", buffers[i].name, buffers[i].offset,
+                   buffers[i].size, buffers[i].first, buffers[i].last);
+        separate += aligned(buffers[i].size);
+    }
+    xil_printf("  peak %d bytes (%d as separate buffers)\n", arena_size, separate);
+}
@@ -0,0 +1,54 @@
+#ifndef ACC_ARENA_H
+#define ACC_ARENA_H
+
+#include "acc_hal.h"
+
+/*
+ * acc_arena.h
+ *   Static memory plan for the activation buffers of one inference.
+ *
+ *   The inference is a fixed sequence of steps (layers); each buffer is
+ *   live from the first step that uses it to the last. arena_plan() works
+ *   those lifetimes out from a per-step use mask and gives every buffer an
+ *   offset in one arena, largest first at the lowest offset that does not
+ *   overlap a buffer live at the same time, so buffers of different layers
+ *   share memory. The arena is allocated before the first inference
+ *   (arena_bind); an inference then allocates nothing. Buffers kept from one inference to
+ *   the next (the streaming window, the pooled activations) are not part
+ *   of the plan.
+ */
+
+#define ARENA_MAX_BUFFERS  16
+#define ARENA_ALIGN        32       // buffer offsets, a cache line
+
+typedef struct {
+    const char *name;
+    u32 size;                       // bytes; 0 leaves the buffer out of the plan
+    void **ptr;                     // set by arena_bind, NULL for a buffer left out
+    int first, last;                // steps it is live in (arena_plan)
+    u32 offset;                     // in the arena (arena_plan)
+} ArenaBuffer;
+
+/*
+ * arena_plan:
+ *   Step s uses the buffers whose bits are set in uses[s] (bit i: buffers[i]).
+ *   Fills in first, last and offset of every buffer and returns the arena
+ *   size needed, the peak of the plan.
+ */
+u32 arena_plan(ArenaBuffer *buffers, int count, const u32 *uses, int steps);
+
+/*
+ * arena_bind:
+ *   Points every planned buffer into an arena of the size arena_plan
+ *   returned, ARENA_ALIGN aligned.
+ */
+void arena_bind(const ArenaBuffer *buffers, int count, u8 *arena);
+
+/*
+ * arena_print:
+ *   Prints the plan: every buffer's offset, size and lifetime, the arena
+ *   size and what separate buffers would take.
+ */
+void arena_print(const ArenaBuffer *buffers, int count, u32 arena_size);
+
+#endif
@@ -0,0 +1,110 @@
+#include "acc_dma.h"
+
+// Data cache size, above which a whole-cache write back beats a range walk.
+#ifdef XPAR_MICROBLAZE_DCACHE_BYTE_SIZE
+#define DCACHE_BYTES  XPAR_MICROBLAZE_DCACHE_BYTE_SIZE
+#else
+#define DCACHE_BYTES  0x2000
+#endif
+
+static u32 dma_used = 0;
+
+void *acc_dma_alloc(u32 size) {
+    u32 offset = (dma_used + 31) & ~31u;
+    if (offset + size > ACC_DMA_SIZE) return NULL;
+    dma_used = offset + size;
+    return HAL_PTR(ACC_DMA_BASE + offset);
+}
+
+void acc_cache_to_device(const void *ptr, u32 size) {
+    if (size == 0) return;
+    if (size >= DCACHE_BYTES) {
+        Xil_DCacheFlush();
+        return;
+    }
+    Xil_DCacheFlushRange((uintptr_t)ptr, size);
+}
+
+void acc_cache_from_device(const void *ptr, u32 size) {
+    if (size == 0) return;
+    Xil_DCacheInvalidateRange((uintptr_t)ptr, size);
+}
+
+int acc_ring_init(AccRing *ring, u32 entries) {
+    if (entries == 0 || entries > 0xFFFF) return -1;
+    ring->entries = (volatile AccDescriptor *)acc_dma_alloc(entries * sizeof(AccDescriptor));
+    if (!ring->entries) return -1;
+    ring->size = entries;
+    ring->reserved = 0;
+    ring->submitted = 0;
+    ring->completed = 0;
+
+    ACC_REG_WRITE(ACC_REG_RING_CTRL, ACC_RING_CTRL_RESET);
+    ACC_REG_WRITE(ACC_REG_RING_BASE, HAL_PHYS((const void *)ring->entries));
+    ACC_REG_WRITE(ACC_REG_RING_SIZE, entries);
+    ring->ctrl = ACC_RING_CTRL_ENABLE;
+    ACC_REG_WRITE(ACC_REG_RING_CTRL, ring->ctrl);
+    return 0;
+}
+
+void acc_ring_use_weight_bank(AccRing *ring, int enable) {
+    u32 ctrl = enable ? (ACC_RING_CTRL_ENABLE | ACC_RING_CTRL_WBANK) : ACC_RING_CTRL_ENABLE;
+    if (ctrl == ring->ctrl) return;
+    // The engine latches the mode for every descriptor it starts.
+    acc_ring_wait(ring);
+    ring->ctrl = ctrl;
+    ACC_REG_WRITE(ACC_REG_RING_CTRL, ctrl);
+}
+
+void acc_ring_push(AccRing *ring, const AccDescriptor *desc) {
+    // A slot is free once the engine has completed the descriptor that used it.
+    while (ring->reserved - ring->completed >= ring->size) {
+        if (ring->submitted != ring->reserved) acc_ring_doorbell(ring);
+        ring->completed = ACC_REG_READ(ACC_REG_COMPLETION);
+    }
+    volatile AccDescriptor *slot = &ring->entries[ring->reserved % ring->size];
+    slot->in_addr = desc->in_addr;
+    slot->w_addr = desc->w_addr;
+    slot->out_addr = desc->out_addr;
+    slot->counts = desc->counts;
+    slot->in_outer_stride = desc->in_outer_stride;
+    slot->in_inner_stride = desc->in_inner_stride;
+    slot->w_outer_stride = desc->w_outer_stride;
+    slot->w_inner_stride = desc->w_inner_stride;
+    acc_cache_to_device((const void *)slot, sizeof(*slot));
+    ring->reserved++;
+}
+
+void acc_ring_doorbell(AccRing *ring) {
+    ring->submitted = ring->reserved;
+    ACC_REG_WRITE(ACC_REG_DOORBELL, ring->submitted);
+}
+
+void acc_ring_wait(AccRing *ring) {
+    if (ring->submitted != ring->reserved) acc_ring_doorbell(ring);
+    while (ring->completed != ring->submitted) {
+        ring->completed = ACC_REG_READ(ACC_REG_COMPLETION);
+    }
+}
+
+int acc_gemv_run(u32 w_phys, u32 x_phys, u32 y_phys, u32 rows, u32 cols) {
+    return acc_gemv_run_batch(w_phys, x_phys, y_phys, rows, cols, 1);
+}
+
+int acc_gemv_run_batch(u32 w_phys, u32 x_phys, u32 y_phys, u32 rows, u32 cols, u32 batch) {
+    if (rows == 0 || rows > ACC_GEMV_MAX_ROWS || cols == 0 || (cols & 3) ||
+        batch == 0 || batch > ACC_GEMV_MAX_BATCH || ((w_phys | x_phys | y_phys) & 3)) {
+        return -1;
+    }
+    acc_cache_to_device(HAL_PTR(x_phys), batch * cols);
+    ACC_REG_WRITE(ACC_REG_GEMV_W, w_phys);
+    ACC_REG_WRITE(ACC_REG_GEMV_X, x_phys);
+    ACC_REG_WRITE(ACC_REG_GEMV_Y, y_phys);
+    ACC_REG_WRITE(ACC_REG_GEMV_ROWS, ACC_GEMV_ROWS(rows, batch));
+    ACC_REG_WRITE(ACC_REG_GEMV_COLS, cols);
+    ACC_REG_WRITE(ACC_REG_GEMV_CTRL, ACC_GEMV_START);
+    while (ACC_REG_READ(ACC_REG_GEMV_CTRL) & ACC_GEMV_BUSY) {
+    }
+    acc_cache_from_device(HAL_PTR(y_phys), batch * rows * 4);
+    return 0;
+}
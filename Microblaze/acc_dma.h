@@ -0,0 +1,144 @@
+#ifndef ACC_DMA_H
+#define ACC_DMA_H
+
+#include "acc_hal.h"
+
+/*
+ * acc_dma.h
+ *   Command descriptor ring and GEMV engine of the ACC accelerator.
+ *
+ *   Instead of six register writes per 3x3 MAC, the firmware writes
+ *   descriptors into a ring in DDR and rings the doorbell once. ACC.v fetches
+ *   each descriptor through its AXI master and runs
+ *
+ *     for outer in [0, outer_count):
+ *       for inner in [0, inner_count):
+ *         in  = in_addr + outer * in_outer_stride + inner * in_inner_stride
+ *         w   = w_addr  + outer * w_outer_stride  + inner * w_inner_stride
+ *         out_addr[outer * inner_count + inner] = dot(in[0..8], w[0..8])
+ *
+ *   on 9 signed bytes at any byte alignment, writing raw int32 sums. With
+ *   acc_ring_use_weight_bank() the weight address and strides count weight
+ *   bank slots instead, and pass p uses the slot p * inner_count further on.
+ *   The completion register counts finished descriptors; a descriptor is
+ *   finished once all of its results are in DDR.
+ *
+ *   Everything the engine reads (ring, staged operands) must be reachable at a
+ *   physical address: acc_dma_alloc() hands out memory from the ACC_DMA_BASE
+ *   window, and model tensors are read in place from DRAM.
+ *
+ *   The MicroBlaze data cache is on and the engine's AXI master does not
+ *   snoop it, so the memory the two share is kept coherent by hand: what the
+ *   CPU writes for the engine is written back (acc_cache_to_device) before
+ *   the doorbell or GEMV start, and what the engine writes is dropped from
+ *   the cache (acc_cache_from_device) before the CPU reads it. Descriptors
+ *   and GEMV operands are handled here; ACC.c does the staged ring operands,
+ *   the result window and the model tensors, once per model. The model slots
+ *   are also shared, with the next boot rather than the engine: acc_store.c
+ *   writes tensors and manifests back so a committed model survives a
+ *   MicroBlaze reset. The register file lies outside the cacheable range and
+ *   is never cached.
+ */
+
+#define ACC_DESC_MAX_COUNT      0xFFFF
+#define ACC_DESC_COUNTS(outer, inner)  ((((u32)(inner)) << 16) | ((u32)(outer) & 0xFFFF))
+
+typedef struct {
+    u32 in_addr;
+    u32 w_addr;
+    u32 out_addr;
+    u32 counts;             // ACC_DESC_COUNTS(outer, inner)
+    u32 in_outer_stride;
+    u32 in_inner_stride;
+    u32 w_outer_stride;
+    u32 w_inner_stride;
+} AccDescriptor;
+
+typedef struct {
+    volatile AccDescriptor *entries;
+    u32 size;
+    u32 reserved;           // descriptors written into the ring
+    u32 submitted;          // descriptors published through the doorbell
+    u32 completed;          // last completion count read back
+    u32 ctrl;               // value last written to ACC_REG_RING_CTRL
+} AccRing;
+
+/*
+ * acc_dma_alloc:
+ *   32-byte aligned memory from the DMA window. Allocations live for the whole
+ *   run; returns NULL once the window is exhausted.
+ */
+void *acc_dma_alloc(u32 size);
+
+/*
+ * acc_cache_to_device:
+ *   Writes back the cached lines of [ptr, ptr + size) so the engine reads
+ *   what the CPU wrote. Ranges larger than the data cache write back the
+ *   whole cache instead, which is cheaper.
+ */
+void acc_cache_to_device(const void *ptr, u32 size);
+
+/*
+ * acc_cache_from_device:
+ *   Invalidates the cached lines of [ptr, ptr + size) so the CPU reads what
+ *   the engine wrote. Only for memory the CPU never writes (the result
+ *   window): a dirty line in the range would be lost.
+ */
+void acc_cache_from_device(const void *ptr, u32 size);
+
+/*
+ * acc_ring_init:
+ *   Allocates 'entries' descriptors, programs the ring registers and enables
+ *   the engine. Returns 0 on success, -1 if the ring does not fit.
+ */
+int acc_ring_init(AccRing *ring, u32 entries);
+
+/*
+ * acc_ring_use_weight_bank:
+ *   Switches the engine between byte-addressed weights in memory (0) and
+ *   weight bank slots (1). Waits for every submitted descriptor first.
+ */
+void acc_ring_use_weight_bank(AccRing *ring, int enable);
+
+/*
+ * acc_ring_push:
+ *   Copies one descriptor into the next free slot and writes it back to DDR,
+ *   waiting for the engine if the ring is full. Nothing runs until
+ *   acc_ring_doorbell().
+ */
+void acc_ring_push(AccRing *ring, const AccDescriptor *desc);
+
+/*
+ * acc_ring_doorbell:
+ *   Publishes every pushed descriptor with a single register write.
+ */
+void acc_ring_doorbell(AccRing *ring);
+
+/*
+ * acc_ring_wait:
+ *   Polls the completion register until every submitted descriptor is done.
+ */
+void acc_ring_wait(AccRing *ring);
+
+/*
+ * acc_gemv_run:
+ *   y[r] = sum_k W[r * cols + k] * x[k] for r < rows on the GEMV engine,
+ *   using physical addresses. The engine streams W once in bursts and keeps
+ *   x and the accumulators on chip. Returns -1 without starting anything if
+ *   the shape or alignment is not supported, 0 once y is in DDR and out of
+ *   the data cache. x is written back first; W must already be in DDR. The
+ *   PE array and the descriptor ring must be idle.
+ */
+int acc_gemv_run(u32 w_phys, u32 x_phys, u32 y_phys, u32 rows, u32 cols);
+
+/*
+ * acc_gemv_run_batch:
+ *   acc_gemv_run for 'batch' input vectors of cols bytes stored back to back
+ *   at x_phys; the results are batch vectors of rows int32 back to back at
+ *   y_phys. W is still streamed once, each weight word feeding one MAC lane
+ *   per vector, so up to ACC_GEMV_MAX_BATCH inputs cost the weight traffic of
+ *   one.
+ */
+int acc_gemv_run_batch(u32 w_phys, u32 x_phys, u32 y_phys, u32 rows, u32 cols, u32 batch);
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef ACC_HAL_H
+#define ACC_HAL_H
+
+/*
+ * acc_hal.h
+ *   Hardware abstraction layer for the keyword-recognition firmware.
+ *
+ *   On the board (default) this pulls in the Xilinx BSP headers and maps
+ *   every peripheral straight onto its physical address, exactly like the
+ *   original firmware did.
+ *
+ *   With -DACC_HOST_BUILD the same ACC.c builds as a native Linux program.
+ *   acc_host.c then provides stand-ins for the BSP drivers (EmacLite, UartLite,
+ *   platform init) plus a DRAM/peripheral address map, and acc_model.c provides
+ *   a transaction-level model of the accelerator register file.
+ *
+ *   Host build:
+ *     gcc -O2 -DACC_HOST_BUILD -o acc_host ACC.c acc_dma.c acc_perf.c acc_quant.c acc_sw.c acc_store.c acc_log.c acc_vad.c acc_arena.c acc_host.c acc_model.c -lm
+ *   Host run:
+ *     ACC_HOST_MODEL=model_params.bin ACC_HOST_AUDIO=spectrogram.bin \
+ *     ACC_HOST_RUNS=3 ./acc_host
+ *   ACC_TRACE_LAYER marks where a layer starts; with ACC_HOST_TRACE set the
+ *   model records an RTL replay trace from there (see acc_model.c).
+ */
+
+// Board memory map
+#define DRAM_BASE_ADDR           0x84030000  // DRAM base where tensor binary file is stored
+#define DRAM_REGION_SIZE         0x03C50000  // Up to the DMA staging window
+#define BUTTONS_BASE_ADDR        0x40000000  // Base address for buttons GPIO
+#define SEVEN_SEG_ADDR           0x20000000
+#define ACC_BASE_ADDR            0xC0000000  // Base address of accelerator IP
+#define ACC_FILTER_BASE          (ACC_BASE_ADDR)           // buffer 0 filter/input registers.
+#define ACC_INPUT_BASE           0xC000000C   // buffer 0 input registers.
+#define ACC_OUTPUT_ADDR          0x87E00000   // Accelerator outputs
+#define ACC_OUTPUT_WINDOW        0x00200000   // Result write pointer wraps inside this window (see ACC.v)
+#define ACC_DMA_BASE             0x87C80000   // Descriptor ring and operand staging read by the accelerator
+#define ACC_DMA_SIZE             0x00180000   // Ends where the accelerator output window starts
+
+// Accelerator register offsets from ACC_BASE_ADDR (see ACC.v reg_write_addr[5:2])
+#define ACC_REG_FILTER0          0x00    // buffer 0: filter bytes 0-3, 4-7, 8
+#define ACC_REG_INPUT0           0x0C    // buffer 0: input bytes 0-3, 4-7, control word
+#define ACC_REG_BUFFER_STRIDE    0x18    // buffer 1 registers follow buffer 0
+#define ACC_CTRL_ENABLE          (1u << 24)
+#define ACC_CTRL_STORE           (1u << 25)  // PE keeps its partial sum instead of writing it out
+#define ACC_CTRL_WBANK           (1u << 26)  // weights come from the next WBANK_SEQ slot, filter registers unused
+#define ACC_CTRL_PE_SHIFT        16
+
+// Descriptor ring registers (ACC.v reg_write_addr[6] = 1, see acc_dma.h)
+#define ACC_REG_RING_BASE        0x40    // physical address of descriptor 0
+#define ACC_REG_RING_SIZE        0x44    // number of descriptors in the ring
+#define ACC_REG_DOORBELL         0x48    // descriptors submitted (free-running count)
+#define ACC_REG_COMPLETION       0x4C    // descriptors finished (free-running count), read only
+#define ACC_REG_STATUS           0x50    // read only
+#define ACC_REG_RING_CTRL        0x54
+#define ACC_REG_PASSES           0x58    // ops each PE accumulates per result; write only while idle
+#define ACC_MAX_PASSES           0xFFFF
+#define ACC_RING_CTRL_ENABLE     (1u << 0)
+#define ACC_RING_CTRL_RESET      (1u << 1)   // clears doorbell/completion counts; only while idle
+#define ACC_RING_CTRL_WBANK      (1u << 2)   // descriptor weight addresses are weight bank slots
+#define ACC_STATUS_BUSY          (1u << 0)   // a descriptor is being processed
+#define ACC_STATUS_PENDING       (1u << 1)   // descriptor results still inside the PEs
+#define ACC_STATUS_WRITEBACK     (1u << 2)   // results queued in the write-combining FIFO or in flight
+
+// Weight bank: 9-byte filter slots held in the accelerator (ACC.v WBANK_AW)
+#define ACC_REG_WBANK_ADDR       0x5C    // slot the next WBANK_DATA triple is written to
+#define ACC_REG_RESULT_PTR       0x5C    // read: offset in ACC_OUTPUT_WINDOW of the next register-fed result
+#define ACC_REG_WBANK_DATA       0x60    // filter bytes 0-3, 4-7, 8; the third write advances the slot
+#define ACC_REG_WBANK_SEQ        0x64    // slot sequence used by ACC_CTRL_WBANK ops
+#define ACC_WBANK_SLOTS          4096
+#define ACC_WBANK_SEQ(start, count)  ((((u32)(count)) << 16) | ((u32)(start) & 0xFFFF))
+
+// GEMV engine: y = W x on int8 with int32 results, weights burst-read from DDR
+#define ACC_REG_GEMV_W           0x68    // weight matrix, row major, word aligned
+#define ACC_REG_GEMV_X           0x6C    // input vectors, back to back, word aligned
+#define ACC_REG_GEMV_Y           0x70    // int32 result vectors
+#define ACC_REG_GEMV_ROWS        0x74    // ACC_GEMV_ROWS(1..ACC_GEMV_MAX_ROWS, 1..ACC_GEMV_MAX_BATCH)
+#define ACC_REG_GEMV_COLS        0x78    // bytes per row, a multiple of 4
+#define ACC_REG_GEMV_CTRL        0x7C
+#define ACC_GEMV_MAX_ROWS        128     // ACC.v GEMV_MAX_ROWS
+#define ACC_GEMV_MAX_BATCH       4       // ACC.v 1 << GEMV_BATCH_AW
+#define ACC_GEMV_ROWS(rows, batch)  ((((u32)(batch)) << 16) | ((u32)(rows) & 0xFFFF))
+#define ACC_GEMV_START           (1u << 0)
+#define ACC_GEMV_BUSY            (1u << 0)
+
+// Performance counters (ACC.v addr[7] = 1); 32 bits, wrapping
+#define ACC_REG_PERF_CTRL        0x80    // ACC_PERF_CLEAR / ACC_PERF_RUN
+#define ACC_REG_PERF_CYCLES      0x84    // cycles counted
+#define ACC_REG_PERF_BUSY        0x88    // ... with an engine, the PE feed or write-back active
+#define ACC_REG_PERF_IDLE        0x8C    // ... with nothing to do
+#define ACC_REG_PERF_OPS         0x90    // 3x3 ops fed to the PE array
+#define ACC_REG_PERF_GEMV_BEATS  0x94    // GEMV weight words, four MACs per input vector each
+#define ACC_REG_PERF_STALL       0x98    // AXI master cycles waiting on a handshake
+#define ACC_REG_PERF_RD_BYTES    0x9C    // AXI master bytes read
+#define ACC_REG_PERF_WR_BYTES    0xA0    // AXI master bytes written
+#define ACC_PERF_COUNTERS        8       // ACC_REG_PERF_CYCLES .. ACC_REG_PERF_WR_BYTES
+#define ACC_PERF_CLEAR           (1u << 0)
+#define ACC_PERF_RUN             (1u << 1)
+
+#ifdef ACC_HOST_BUILD
+
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+
+#define xil_printf printf
+
+#define XST_SUCCESS 0
+#define XST_FAILURE 1
+
+#define XPAR_UARTLITE_0_DEVICE_ID          0
+#define XPAR_AXI_ETHERNETLITE_0_DEVICE_ID  0
+#define XPAR_TMRCTR_0_DEVICE_ID            0
+#define XPAR_TMRCTR_0_CLOCK_FREQ_HZ        100000000
+#define XTC_AUTO_RELOAD_OPTION             0x00000010UL
+#define XPAR_INTC_0_DEVICE_ID              0
+#define XPAR_INTC_0_EMACLITE_0_VEC_ID      0
+#define XIN_REAL_MODE                      1
+#define XIL_EXCEPTION_ID_INT               0
+
+typedef void (*XInterruptHandler)(void *ref);
+typedef void (*Xil_ExceptionHandler)(void *ref);
+typedef void (*XEmacLite_Handler)(void *ref);
+
+typedef struct {
+    u8 mac[6];
+    XEmacLite_Handler recv_handler;
+    void *recv_ref;
+    volatile int interrupts_enabled;
+} XEmacLite;
+
+typedef struct {
+    XInterruptHandler handler;
+    void *ref;
+    volatile int enabled;
+} XIntc;
+
+typedef struct {
+    u32 bytes_sent;
+} XUartLite;
+
+typedef struct {
+    int started;
+} XTmrCtr;
+
+int  XEmacLite_Initialize(XEmacLite *instance, u32 device_id);
+void XEmacLite_SetMacAddress(XEmacLite *instance, u8 *address);
+int  XEmacLite_Send(XEmacLite *instance, u8 *frame, unsigned byte_count);
+u16  XEmacLite_Recv(XEmacLite *instance, u8 *frame);
+void XEmacLite_SetRecvHandler(XEmacLite *instance, void *ref, XEmacLite_Handler handler);
+int  XEmacLite_EnableInterrupts(XEmacLite *instance);
+void XEmacLite_DisableInterrupts(XEmacLite *instance);
+void XEmacLite_FlushReceive(XEmacLite *instance);
+void XEmacLite_InterruptHandler(void *instance);
+
+// Interrupt controller: a host interval timer raises the EmacLite interrupt
+// whenever a frame is waiting, as a signal that preempts the firmware.
+int  XIntc_Initialize(XIntc *instance, u16 device_id);
+int  XIntc_Connect(XIntc *instance, u8 id, XInterruptHandler handler, void *ref);
+int  XIntc_Start(XIntc *instance, u8 mode);
+void XIntc_Enable(XIntc *instance, u8 id);
+void XIntc_InterruptHandler(void *instance);
+void Xil_ExceptionInit(void);
+void Xil_ExceptionRegisterHandler(u32 id, Xil_ExceptionHandler handler, void *ref);
+void Xil_ExceptionEnable(void);
+
+int      XUartLite_Initialize(XUartLite *instance, u16 device_id);
+unsigned XUartLite_Send(XUartLite *instance, u8 *data, unsigned num_bytes);
+
+// AXI timer: counts up at XPAR_TMRCTR_0_CLOCK_FREQ_HZ of host monotonic time.
+int  XTmrCtr_Initialize(XTmrCtr *instance, u16 device_id);
+void XTmrCtr_SetOptions(XTmrCtr *instance, u8 timer, u32 options);
+void XTmrCtr_Start(XTmrCtr *instance, u8 timer);
+u32  XTmrCtr_GetValue(XTmrCtr *instance, u8 timer);
+
+void init_platform(void);
+void cleanup_platform(void);
+
+// Data/instruction cache. The host has no cache to manage; the maintenance
+// calls are counted and reported at exit.
+void Xil_ICacheEnable(void);
+void Xil_DCacheEnable(void);
+void Xil_DCacheFlush(void);
+void Xil_DCacheFlushRange(uintptr_t addr, u32 len);
+void Xil_DCacheInvalidateRange(uintptr_t addr, u32 len);
+
+/*
+ * hal_map:
+ *   Translates a board physical address into a pointer into the host
+ *   stand-in for that region. Unknown addresses abort the run.
+ */
+void *hal_map(uintptr_t phys_addr);
+
+/*
+ * hal_phys:
+ *   Inverse of hal_map for pointers into the mapped host regions; 0 for
+ *   anything the accelerator could not reach.
+ */
+u32 hal_phys(const void *ptr);
+
+/*
+ * hal_keep_running:
+ *   Called once per main-loop iteration. Returns 0 when the host run has
+ *   delivered all requested utterances and the receive queue is drained.
+ */
+int hal_keep_running(void);
+
+/*
+ * hal_get_option:
+ *   Run-time option lookup (environment variable on the host). NULL if unset.
+ */
+const char *hal_get_option(const char *name);
+
+// Accelerator register file model (acc_model.c).
+void acc_model_write(u32 offset, u32 value);
+u32  acc_model_read(u32 offset);
+void acc_model_report(void);
+void acc_model_trace_layer(const char *layer);
+
+#define HAL_PTR(addr)                 hal_map((uintptr_t)(addr))
+#define HAL_PHYS(ptr)                 hal_phys(ptr)
+#define ACC_REG_WRITE(offset, value)  acc_model_write((offset), (value))
+#define ACC_REG_READ(offset)          acc_model_read(offset)
+#define ACC_TRACE_LAYER(layer)        acc_model_trace_layer(layer)
+
+#else
+
+#include "xil_cache.h"
+#include "xil_exception.h"
+#include "xemaclite.h"
+#include "xintc.h"
+#include "xparameters.h"
+#include "xil_printf.h"
+#include "xtmrctr.h"
+#include "xuartlite.h"
+#include "platform.h"
+#include "sleep.h"
+
+#define HAL_PTR(addr)                 ((void *)(addr))
+#define HAL_PHYS(ptr)                 ((u32)(uintptr_t)(ptr))
+#define ACC_REG_WRITE(offset, value)  (*(volatile u32 *)(ACC_BASE_ADDR + (offset)) = (value))
+#define ACC_REG_READ(offset)          (*(volatile u32 *)(ACC_BASE_ADDR + (offset)))
+#define ACC_TRACE_LAYER(layer)        ((void)0)
+
+#define hal_keep_running()            1
+#define hal_get_option(name)          ((const char *)0)
+
+// Accelerator registers are read and written through volatile pointers with
+// no cache maintenance, so they must lie outside the cached address range.
+#if defined(XPAR_MICROBLAZE_DCACHE_BASEADDR) && defined(XPAR_MICROBLAZE_DCACHE_HIGHADDR)
+#if ACC_BASE_ADDR >= XPAR_MICROBLAZE_DCACHE_BASEADDR && ACC_BASE_ADDR <= XPAR_MICROBLAZE_DCACHE_HIGHADDR
+#error "ACC_BASE_ADDR is inside the cacheable range of the data cache"
+#endif
+#endif
+
+#endif
+
+#endif
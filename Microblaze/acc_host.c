@@ -0,0 +1,672 @@
+#ifdef ACC_HOST_BUILD
+
+/*
+ * acc_host.c
+ *   Host (Linux) stand-ins for the board peripherals used by ACC.c.
+ *
+ *   - DRAM, the DMA staging window, accelerator output window, buttons and
+ *     seven segment display are plain host buffers reached through hal_map().
+ *   - XEmacLite_Recv replays the PC side of Input_weight.py: every tensor of
+ *     ACC_HOST_MODEL is fragmented exactly like send_tensor_fragments, and each
+ *     request frame from the board queues one copy of the ACC_HOST_AUDIO
+ *     spectrogram (or a fixed pseudo-random one when unset).
+ *   - With ACC_HOST_IFACE set the board is on a real link instead: frames go
+ *     to and from that interface through a raw packet socket, so the real
+ *     Input_weight.py can drive it, e.g. over a veth pair:
+ *       ip link add pc0 type veth peer name fpga0
+ *       ip link set pc0 up; ip link set fpga0 up
+ *       ACC_HOST_IFACE=fpga0 ACC_HOST_DROP=5 ./acc_host
+ *       ACC_PC_IFACE=pc0 python3 Input_weight.py
+ *     ACC_HOST_DROP discards that percentage of the frames received to
+ *     exercise retransmission. ACC_HOST_MODEL is not needed then.
+ *   - ACC_HOST_DRAM names a file that backs the model region, so a model
+ *     stays in "DRAM" from one run to the next like it does across a board
+ *     reset (acc_store.h). ACC_HOST_MODEL may then be left unset.
+ *   - ACC_HOST_EVENTS names a file the event ring (acc_log.h) is written to
+ *     on exit, in the dump format PC_code/event_log.py decodes.
+ *   - The button is pressed ACC_HOST_RUNS times (default 1), after which
+ *     hal_keep_running() ends the main loop. A press waits until the
+ *     previous utterance has been delivered and fewer than ACC_HOST_QUEUE
+ *     (default 1) utterances are waiting for their report frame; with 2 the
+ *     next utterance is requested and received while one is classified.
+ *   - ACC_HOST_STREAM=n (even, 2..10) streams after the first utterance:
+ *     instead of pressing the button again, each run sends a streaming
+ *     update of n spectrogram columns, taken in turn from the audio
+ *     spectrogram, under the same ACC_HOST_QUEUE limit.
+ *   - ACC_HOST_BATCH=n (1..4) sends every run as one batch of n clips
+ *     (BATCH_TENSOR_ID in ACC.c) without pressing the button, once the
+ *     previous batch has been answered: the audio spectrogram and, for the
+ *     other clips, copies of it rotated in time by 32 columns per clip.
+ *   - The interrupt controller is an interval timer whose SIGALRM preempts
+ *     the firmware like an interrupt: every HOST_TICK_US it raises the
+ *     EmacLite interrupt while a frame is waiting and moves the button.
+ *     Host state it shares with the firmware's main loop is only touched
+ *     with the signal blocked.
+ *   - The AXI timer runs off the host monotonic clock.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include "acc_hal.h"
+#include "acc_log.h"
+
+#define HOST_FRAGMENT_SIZE          1400
+#define HOST_HEADER_SIZE_FIRST      20
+#define HOST_HEADER_SIZE            16
+#define HOST_MODEL_ETHER_TYPE       0x88B5
+#define HOST_REQUEST_ETHER_TYPE     0x88B6
+#define HOST_PERF_ETHER_TYPE        0x88B8
+#define HOST_CONTROL_ETHER_TYPE     0x88B9
+#define HOST_LOG_ETHER_TYPE         0x88BA
+#define HOST_VAD_ETHER_TYPE         0x88BC
+#define HOST_AUDIO_TENSOR_ID        99
+#define HOST_STREAM_TENSOR_ID       98
+#define HOST_BATCH_TENSOR_ID        97
+#define HOST_BATCH_MAX_CLIPS        4       // ACC.c BATCH_MAX_CLIPS
+#define HOST_STREAM_MAX_COLUMNS     10
+#define HOST_AUDIO_SIZE             (124 * 129)
+#define HOST_MAX_TRANSFERS          64
+#define MAX_FRAME_LEN               1518    // ACC.c MAX_PKT_LEN
+#define HOST_TICK_US                100
+#define HOST_FRAMES_PER_TICK        32
+#define HOST_BUTTON_RELEASE_NS      50000000ull   // between two presses
+
+typedef struct {
+    u32 tensor_id;
+    const u8 *payload;
+    u32 length;
+    u32 total_fragments;
+    u32 next_fragment;
+} HostTransfer;
+
+static u8 *host_dram;
+static u8 *host_dma;
+static u8 *host_acc_output;
+static u32 host_buttons;
+static u32 host_seven_seg;
+
+static u8 *model_file;
+static u8 audio_payload[HOST_AUDIO_SIZE];
+static u8 stream_payload[8 + HOST_STREAM_MAX_COLUMNS * 124];
+static u32 stream_columns = 0;                // ACC_HOST_STREAM
+static u32 stream_sequence = 0;
+static u8 batch_payload[HOST_BATCH_MAX_CLIPS][12 + HOST_AUDIO_SIZE];
+static u32 batch_clips = 0;                   // ACC_HOST_BATCH
+static u32 batch_id = 0;
+
+static HostTransfer transfers[HOST_MAX_TRANSFERS];
+static int transfer_head = 0;
+static int transfer_tail = 0;
+
+static int runs_remaining = 1;
+static int runs_requested = 0;
+static int runs_answered = 0;
+static int runs_queue = 1;                    // ACC_HOST_QUEUE
+static unsigned long long button_released = 0;
+
+static XIntc *host_intc;
+static volatile int host_exceptions_enabled = 0;
+static void *host_exception_ref;
+static sigset_t tick_signal;
+
+static int link_fd = -1;             // raw socket on ACC_HOST_IFACE, -1 to replay
+static u32 link_drop_percent = 0;
+static u32 link_drop_seed = 1;
+
+static unsigned long long frames_received = 0;
+static unsigned long long frames_dropped = 0;
+static unsigned long long frames_sent = 0;
+static unsigned long long uart_bytes = 0;
+static unsigned long long cache_flushes = 0;
+static unsigned long long cache_flushed_bytes = 0;
+static unsigned long long cache_invalidates = 0;
+static unsigned long long cache_invalidated_bytes = 0;
+static struct timespec start_time;
+
+static void host_fatal(const char *msg) {
+    fprintf(stderr, "acc_host: %s\n", msg);
+    exit(1);
+}
+
+static unsigned long long host_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+// Brackets main-loop code that shares state with host_tick().
+static void tick_block(void) {
+    sigprocmask(SIG_BLOCK, &tick_signal, NULL);
+}
+
+static void tick_unblock(void) {
+    sigprocmask(SIG_UNBLOCK, &tick_signal, NULL);
+}
+
+static u32 host_get_u32(const u8 *p) {
+    return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static void host_put_u32(u8 *p, u32 v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static void queue_transfer(u32 tensor_id, const u8 *payload, u32 length) {
+    if (transfer_tail - transfer_head >= HOST_MAX_TRANSFERS) host_fatal("transfer queue full");
+    u32 max_first = HOST_FRAGMENT_SIZE - HOST_HEADER_SIZE_FIRST;
+    u32 max_normal = HOST_FRAGMENT_SIZE - HOST_HEADER_SIZE;
+    HostTransfer *t = &transfers[transfer_tail % HOST_MAX_TRANSFERS];
+    t->tensor_id = tensor_id;
+    t->payload = payload;
+    t->length = length;
+    t->total_fragments = (length <= max_first) ? 1 : 1 + (length - max_first + max_normal - 1) / max_normal;
+    t->next_fragment = 0;
+    transfer_tail++;
+}
+
+// Walks the model binary the same way send_tensors_from_binary does.
+static void load_model_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) host_fatal("cannot open ACC_HOST_MODEL");
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    model_file = (u8 *)malloc(size);
+    if (!model_file || fread(model_file, 1, size, f) != (size_t)size) host_fatal("cannot read ACC_HOST_MODEL");
+    fclose(f);
+
+    u32 num_tensors = host_get_u32(model_file);
+    long pos = 4;
+    for (u32 t = 0; t < num_tensors; t++) {
+        long start = pos;
+        u32 tensor_id = host_get_u32(model_file + pos);
+        pos += 4;
+        u32 num_dims = host_get_u32(model_file + pos);
+        pos += 4 + 4 * num_dims + 4;
+        u32 num_scales = host_get_u32(model_file + pos);
+        pos += 4 + 4 * num_scales;
+        u32 num_zero_points = host_get_u32(model_file + pos);
+        pos += 4 + 4 * num_zero_points;
+        u32 data_length = host_get_u32(model_file + pos);
+        pos += 4 + data_length;
+        if (pos > size) host_fatal("truncated model file");
+        queue_transfer(tensor_id, model_file + start, (u32)(pos - start));
+    }
+}
+
+static void load_audio(const char *path) {
+    if (path) {
+        FILE *f = fopen(path, "rb");
+        if (!f || fread(audio_payload, 1, HOST_AUDIO_SIZE, f) != HOST_AUDIO_SIZE) host_fatal("cannot read ACC_HOST_AUDIO");
+        fclose(f);
+    } else {
+        u32 seed = 12345;
+        for (int i = 0; i < HOST_AUDIO_SIZE; i++) {
+            seed = seed * 1103515245u + 12345u;
+            audio_payload[i] = (u8)(seed >> 16);
+        }
+    }
+}
+
+static u8 *map_dram_file(const char *path) {
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || ftruncate(fd, DRAM_REGION_SIZE) != 0) host_fatal("cannot open ACC_HOST_DRAM");
+    void *p = mmap(NULL, DRAM_REGION_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) host_fatal("cannot map ACC_HOST_DRAM");
+    return (u8 *)p;
+}
+
+static void open_link(const char *iface) {
+    unsigned index = if_nametoindex(iface);
+    if (!index) host_fatal("unknown ACC_HOST_IFACE");
+    link_fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (link_fd < 0) host_fatal("cannot open a packet socket (needs CAP_NET_RAW)");
+    struct sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = index;
+    if (bind(link_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) host_fatal("cannot bind to ACC_HOST_IFACE");
+    fcntl(link_fd, F_SETFL, O_NONBLOCK);
+}
+
+void init_platform(void) {
+    const char *model_path = getenv("ACC_HOST_MODEL");
+    const char *runs = getenv("ACC_HOST_RUNS");
+    const char *iface = getenv("ACC_HOST_IFACE");
+    const char *drop = getenv("ACC_HOST_DROP");
+    const char *dram_file = getenv("ACC_HOST_DRAM");
+    const char *queue_depth = getenv("ACC_HOST_QUEUE");
+    const char *stream = getenv("ACC_HOST_STREAM");
+    const char *batch = getenv("ACC_HOST_BATCH");
+    if (!model_path && !iface && !dram_file) host_fatal("set ACC_HOST_MODEL to the tensor binary file");
+
+    host_dram = dram_file ? map_dram_file(dram_file) : (u8 *)calloc(1, DRAM_REGION_SIZE);
+    host_dma = (u8 *)calloc(1, ACC_DMA_SIZE);
+    host_acc_output = (u8 *)calloc(1, ACC_OUTPUT_WINDOW);
+    if (!host_dram || !host_dma || !host_acc_output) host_fatal("out of memory");
+
+    if (runs) runs_remaining = atoi(runs);
+    if (queue_depth && atoi(queue_depth) > 0) runs_queue = atoi(queue_depth);
+    if (stream && *stream) {
+        stream_columns = (u32)atoi(stream);
+        if (stream_columns < 2 || stream_columns > HOST_STREAM_MAX_COLUMNS || stream_columns % 2)
+            host_fatal("ACC_HOST_STREAM must be an even column count from 2 to 10");
+    }
+    if (batch && *batch) {
+        batch_clips = (u32)atoi(batch);
+        if (batch_clips < 1 || batch_clips > HOST_BATCH_MAX_CLIPS)
+            host_fatal("ACC_HOST_BATCH must be a clip count from 1 to 4");
+    }
+    sigemptyset(&tick_signal);
+    sigaddset(&tick_signal, SIGALRM);
+    if (iface) {
+        open_link(iface);
+        if (drop) link_drop_percent = (u32)atoi(drop);
+    } else {
+        if (model_path) load_model_file(model_path);
+        load_audio(getenv("ACC_HOST_AUDIO"));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+// The whole event ring as one LogDumpHeader followed by its events.
+static void write_events(const char *path) {
+    static LogEvent events[LOG_RING_ENTRIES];
+    LogDumpHeader header;
+    u32 count = log_read(0, events, LOG_RING_ENTRIES, &header);
+    FILE *f = fopen(path, "wb");
+    if (!f || fwrite(&header, sizeof(header), 1, f) != 1 ||
+        fwrite(events, sizeof(LogEvent), count, f) != count) {
+        fprintf(stderr, "acc_host: cannot write ACC_HOST_EVENTS\n");
+    } else {
+        printf("acc_host: %u of %u events written to %s\n", count, header.written, path);
+    }
+    if (f) fclose(f);
+}
+
+void cleanup_platform(void) {
+    const char *events_path = getenv("ACC_HOST_EVENTS");
+    struct itimerval off;
+    memset(&off, 0, sizeof(off));
+    setitimer(ITIMER_REAL, &off, NULL);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (now.tv_sec - start_time.tv_sec) + (now.tv_nsec - start_time.tv_nsec) / 1e9;
+    printf("acc_host: %llu frames received, %llu frames sent, %llu UART bytes\n",
+           frames_received, frames_sent, uart_bytes);
+    if (link_fd >= 0) {
+        printf("acc_host: %llu received frames dropped on purpose\n", frames_dropped);
+        close(link_fd);
+    }
+    printf("acc_host: %d utterances in %.3f s", runs_requested, elapsed);
+    if (runs_requested) printf(" (%.3f s each incl. model upload)", elapsed / runs_requested);
+    printf(", seven segment shows %u\n", host_seven_seg);
+    printf("acc_host: D-cache maintenance: %llu write backs (%llu bytes), %llu invalidates (%llu bytes)\n",
+           cache_flushes, cache_flushed_bytes, cache_invalidates, cache_invalidated_bytes);
+    acc_model_report();
+    if (events_path) write_events(events_path);
+}
+
+void Xil_ICacheEnable(void) {
+}
+
+void Xil_DCacheEnable(void) {
+}
+
+void Xil_DCacheFlush(void) {
+    cache_flushes++;
+}
+
+void Xil_DCacheFlushRange(uintptr_t addr, u32 len) {
+    (void)addr;
+    cache_flushes++;
+    cache_flushed_bytes += len;
+}
+
+void Xil_DCacheInvalidateRange(uintptr_t addr, u32 len) {
+    (void)addr;
+    cache_invalidates++;
+    cache_invalidated_bytes += len;
+}
+
+void *hal_map(uintptr_t phys_addr) {
+    if (phys_addr >= DRAM_BASE_ADDR && phys_addr < DRAM_BASE_ADDR + DRAM_REGION_SIZE)
+        return host_dram + (phys_addr - DRAM_BASE_ADDR);
+    if (phys_addr >= ACC_DMA_BASE && phys_addr < ACC_DMA_BASE + ACC_DMA_SIZE)
+        return host_dma + (phys_addr - ACC_DMA_BASE);
+    if (phys_addr >= ACC_OUTPUT_ADDR && phys_addr < ACC_OUTPUT_ADDR + ACC_OUTPUT_WINDOW)
+        return host_acc_output + (phys_addr - ACC_OUTPUT_ADDR);
+    if (phys_addr == BUTTONS_BASE_ADDR)
+        return &host_buttons;
+    if (phys_addr == SEVEN_SEG_ADDR)
+        return &host_seven_seg;
+    fprintf(stderr, "acc_host: unmapped physical address 0x%08lX\n", (unsigned long)phys_addr);
+    exit(1);
+}
+
+u32 hal_phys(const void *ptr) {
+    const u8 *p = (const u8 *)ptr;
+    if (p >= host_dram && p < host_dram + DRAM_REGION_SIZE)
+        return DRAM_BASE_ADDR + (u32)(p - host_dram);
+    if (p >= host_dma && p < host_dma + ACC_DMA_SIZE)
+        return ACC_DMA_BASE + (u32)(p - host_dma);
+    if (p >= host_acc_output && p < host_acc_output + ACC_OUTPUT_WINDOW)
+        return ACC_OUTPUT_ADDR + (u32)(p - host_acc_output);
+    return 0;
+}
+
+int hal_keep_running(void) {
+    tick_block();
+    int idle = (transfer_head == transfer_tail) && runs_answered == runs_requested;
+    int done = idle && runs_remaining <= 0;
+    tick_unblock();
+    return !done;
+}
+
+// The next stream_columns columns of the audio spectrogram (HWC, 124 x 129), column after column.
+static void queue_stream_update(void) {
+    host_put_u32(stream_payload, stream_sequence);
+    host_put_u32(stream_payload + 4, stream_columns);
+    for (u32 c = 0; c < stream_columns; c++) {
+        u32 column = (stream_sequence * stream_columns + c) % 129;
+        for (u32 h = 0; h < 124; h++) stream_payload[8 + c * 124 + h] = audio_payload[h * 129 + column];
+    }
+    stream_sequence++;
+    runs_remaining--;
+    runs_requested++;
+    queue_transfer(HOST_STREAM_TENSOR_ID, stream_payload, 8 + stream_columns * 124);
+}
+
+// One batch of batch_clips clips: clip c is the audio spectrogram (HWC, 124 x 129) rotated left by 32 * c columns.
+static void queue_batch(void) {
+    for (u32 c = 0; c < batch_clips; c++) {
+        u8 *clip = batch_payload[c];
+        host_put_u32(clip, batch_id);
+        host_put_u32(clip + 4, c);
+        host_put_u32(clip + 8, batch_clips);
+        for (u32 h = 0; h < 124; h++) {
+            for (u32 w = 0; w < 129; w++) clip[12 + h * 129 + w] = audio_payload[h * 129 + (w + 32 * c) % 129];
+        }
+        queue_transfer(HOST_BATCH_TENSOR_ID, clip, 12 + HOST_AUDIO_SIZE);
+    }
+    batch_id++;
+    runs_remaining--;
+    runs_requested++;
+}
+
+// Presses button 0 when the next utterance may be requested; the request frame releases it.
+// When streaming, runs after the first send an update instead; batches are sent
+// one at a time, without the button.
+static void button_tick(void) {
+    if (host_buttons || runs_remaining <= 0) return;
+    if (transfer_head != transfer_tail || runs_requested - runs_answered >= runs_queue) return;
+    if (batch_clips && link_fd < 0) {
+        if (runs_requested == runs_answered) queue_batch();
+        return;
+    }
+    if (stream_columns && runs_requested > 0 && link_fd < 0) {
+        queue_stream_update();
+        return;
+    }
+    if (host_now_ns() - button_released < HOST_BUTTON_RELEASE_NS) return;
+    host_buttons = 1;
+}
+
+static int frame_waiting(void) {
+    if (link_fd < 0) return transfer_head != transfer_tail;
+    struct pollfd pfd = { link_fd, POLLIN, 0 };
+    return poll(&pfd, 1, 0) > 0;
+}
+
+static void host_tick(int sig) {
+    (void)sig;
+    int saved_errno = errno;
+    button_tick();
+    if (host_exceptions_enabled && host_intc && host_intc->enabled && host_intc->handler && frame_waiting()) {
+        XIntc_InterruptHandler(host_exception_ref);
+    }
+    errno = saved_errno;
+}
+
+const char *hal_get_option(const char *name) {
+    return getenv(name);
+}
+
+int XEmacLite_Initialize(XEmacLite *instance, u32 device_id) {
+    (void)device_id;
+    memset(instance, 0, sizeof(*instance));
+    return XST_SUCCESS;
+}
+
+void XEmacLite_SetMacAddress(XEmacLite *instance, u8 *address) {
+    memcpy(instance->mac, address, 6);
+}
+
+int XEmacLite_Send(XEmacLite *instance, u8 *frame, unsigned byte_count) {
+    u8 padded[60];
+    (void)instance;
+    tick_block();
+    frames_sent++;
+    if (byte_count >= 14) {
+        u32 ether_type = ((u32)frame[12] << 8) | frame[13];
+        if (ether_type == HOST_REQUEST_ETHER_TYPE) {
+            host_buttons = 0;
+            button_released = host_now_ns();
+            if (runs_remaining > 0) {
+                runs_remaining--;
+                runs_requested++;
+                if (link_fd < 0) queue_transfer(HOST_AUDIO_TENSOR_ID, audio_payload, HOST_AUDIO_SIZE);
+            }
+        }
+        if (ether_type == HOST_PERF_ETHER_TYPE) runs_answered++;
+    }
+    if (link_fd >= 0) {
+        // EmacLite pads short frames to the Ethernet minimum.
+        if (byte_count < sizeof(padded)) {
+            memset(padded, 0, sizeof(padded));
+            memcpy(padded, frame, byte_count);
+            frame = padded;
+            byte_count = sizeof(padded);
+        }
+        if (send(link_fd, frame, byte_count, 0) < 0 && errno != EAGAIN) host_fatal("send on ACC_HOST_IFACE failed");
+    }
+    tick_unblock();
+    return XST_SUCCESS;
+}
+
+// Next data, model control or log request frame for this MAC from ACC_HOST_IFACE, 0 if none.
+static u16 link_recv(XEmacLite *instance, u8 *frame) {
+    for (;;) {
+        struct sockaddr_ll from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(link_fd, frame, MAX_FRAME_LEN, MSG_TRUNC, (struct sockaddr *)&from, &from_len);
+        if (n < 0) return 0;
+        if (from.sll_pkttype == PACKET_OUTGOING || n < 14 || n > MAX_FRAME_LEN) continue;
+        if (memcmp(frame, instance->mac, 6) != 0) continue;
+        u32 ether_type = ((u32)frame[12] << 8) | frame[13];
+        if (ether_type != HOST_MODEL_ETHER_TYPE && ether_type != HOST_CONTROL_ETHER_TYPE &&
+            ether_type != HOST_LOG_ETHER_TYPE && ether_type != HOST_VAD_ETHER_TYPE) continue;
+        link_drop_seed = link_drop_seed * 1103515245u + 12345u;
+        if ((link_drop_seed >> 16) % 100 < link_drop_percent) {
+            frames_dropped++;
+            continue;
+        }
+        frames_received++;
+        return (u16)n;
+    }
+}
+
+u16 XEmacLite_Recv(XEmacLite *instance, u8 *frame) {
+    if (link_fd >= 0) return link_recv(instance, frame);
+    if (transfer_head == transfer_tail) return 0;
+
+    HostTransfer *t = &transfers[transfer_head % HOST_MAX_TRANSFERS];
+    u32 max_first = HOST_FRAGMENT_SIZE - HOST_HEADER_SIZE_FIRST;
+    u32 max_normal = HOST_FRAGMENT_SIZE - HOST_HEADER_SIZE;
+    u32 frag = t->next_fragment;
+    u32 start, len, header;
+
+    if (frag == 0) {
+        start = 0;
+        len = (t->length < max_first) ? t->length : max_first;
+        header = HOST_HEADER_SIZE_FIRST;
+    } else {
+        start = max_first + (frag - 1) * max_normal;
+        len = (t->length - start < max_normal) ? t->length - start : max_normal;
+        header = HOST_HEADER_SIZE;
+    }
+
+    memcpy(frame, instance->mac, 6);
+    memset(frame + 6, 0, 6);
+    frame[12] = (HOST_MODEL_ETHER_TYPE >> 8) & 0xFF;
+    frame[13] = HOST_MODEL_ETHER_TYPE & 0xFF;
+    u8 *h = frame + 14;
+    host_put_u32(h, t->tensor_id);
+    host_put_u32(h + 4, frag);
+    host_put_u32(h + 8, t->total_fragments);
+    if (frag == 0) {
+        host_put_u32(h + 12, t->length);
+        host_put_u32(h + 16, len);
+    } else {
+        host_put_u32(h + 12, len);
+    }
+    memcpy(h + header, t->payload + start, len);
+
+    if (++t->next_fragment == t->total_fragments) transfer_head++;
+    frames_received++;
+    return (u16)(14 + header + len);
+}
+
+void XEmacLite_SetRecvHandler(XEmacLite *instance, void *ref, XEmacLite_Handler handler) {
+    instance->recv_ref = ref;
+    instance->recv_handler = handler;
+}
+
+int XEmacLite_EnableInterrupts(XEmacLite *instance) {
+    instance->interrupts_enabled = 1;
+    return XST_SUCCESS;
+}
+
+void XEmacLite_DisableInterrupts(XEmacLite *instance) {
+    instance->interrupts_enabled = 0;
+}
+
+void XEmacLite_FlushReceive(XEmacLite *instance) {
+    (void)instance;
+}
+
+// Calls the receive handler while frames wait, like the level-triggered EmacLite interrupt.
+void XEmacLite_InterruptHandler(void *ref) {
+    XEmacLite *instance = (XEmacLite *)ref;
+    for (int n = 0; n < HOST_FRAMES_PER_TICK; n++) {
+        if (!instance->interrupts_enabled || !instance->recv_handler || !frame_waiting()) break;
+        instance->recv_handler(instance->recv_ref);
+    }
+}
+
+int XIntc_Initialize(XIntc *instance, u16 device_id) {
+    (void)device_id;
+    memset(instance, 0, sizeof(*instance));
+    return XST_SUCCESS;
+}
+
+int XIntc_Connect(XIntc *instance, u8 id, XInterruptHandler handler, void *ref) {
+    (void)id;
+    instance->handler = handler;
+    instance->ref = ref;
+    return XST_SUCCESS;
+}
+
+int XIntc_Start(XIntc *instance, u8 mode) {
+    struct sigaction action;
+    struct itimerval tick;
+    (void)mode;
+    host_intc = instance;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = host_tick;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGALRM, &action, NULL) != 0) return XST_FAILURE;
+    memset(&tick, 0, sizeof(tick));
+    tick.it_interval.tv_usec = HOST_TICK_US;
+    tick.it_value.tv_usec = HOST_TICK_US;
+    return setitimer(ITIMER_REAL, &tick, NULL) == 0 ? XST_SUCCESS : XST_FAILURE;
+}
+
+void XIntc_Enable(XIntc *instance, u8 id) {
+    (void)id;
+    instance->enabled = 1;
+}
+
+void XIntc_InterruptHandler(void *ref) {
+    XIntc *instance = (XIntc *)ref;
+    instance->handler(instance->ref);
+}
+
+void Xil_ExceptionInit(void) {
+}
+
+void Xil_ExceptionRegisterHandler(u32 id, Xil_ExceptionHandler handler, void *ref) {
+    (void)id;
+    (void)handler;   // always XIntc_InterruptHandler here
+    host_exception_ref = ref;
+}
+
+void Xil_ExceptionEnable(void) {
+    host_exceptions_enabled = 1;
+}
+
+int XUartLite_Initialize(XUartLite *instance, u16 device_id) {
+    (void)device_id;
+    instance->bytes_sent = 0;
+    return XST_SUCCESS;
+}
+
+unsigned XUartLite_Send(XUartLite *instance, u8 *data, unsigned num_bytes) {
+    (void)data;
+    instance->bytes_sent += num_bytes;
+    uart_bytes += num_bytes;
+    return num_bytes;
+}
+
+int XTmrCtr_Initialize(XTmrCtr *instance, u16 device_id) {
+    (void)device_id;
+    instance->started = 0;
+    return XST_SUCCESS;
+}
+
+void XTmrCtr_SetOptions(XTmrCtr *instance, u8 timer, u32 options) {
+    (void)instance;
+    (void)timer;
+    (void)options;
+}
+
+void XTmrCtr_Start(XTmrCtr *instance, u8 timer) {
+    (void)timer;
+    instance->started = 1;
+}
+
+u32 XTmrCtr_GetValue(XTmrCtr *instance, u8 timer) {
+    (void)timer;
+    if (!instance->started) return 0;
+    return (u32)(host_now_ns() / (1000000000ull / XPAR_TMRCTR_0_CLOCK_FREQ_HZ));
+}
+
+#endif
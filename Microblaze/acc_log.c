@@ -0,0 +1,32 @@
+#include "acc_log.h"
+#include "acc_perf.h"
+
+static LogEvent log_ring[LOG_RING_ENTRIES];
+static u32 log_written = 0;
+
+void log_event(LogEventId id, u32 arg0, u32 arg1, u32 arg2) {
+    LogEvent *e = &log_ring[log_written & (LOG_RING_ENTRIES - 1)];
+    e->timestamp = perf_now();
+    e->id = (u16)id;
+    e->arg0 = (u16)arg0;
+    e->arg1 = arg1;
+    e->arg2 = arg2;
+    log_written++;
+}
+
+u32 log_read(u32 from, LogEvent *out, u32 max, LogDumpHeader *header) {
+    u32 oldest = log_written > LOG_RING_ENTRIES ? log_written - LOG_RING_ENTRIES : 0;
+    if (from < oldest) from = oldest;
+    if (from > log_written) from = log_written;
+    u32 count = log_written - from;
+    if (count > max) count = max;
+    for (u32 i = 0; i < count; i++) {
+        out[i] = log_ring[(from + i) & (LOG_RING_ENTRIES - 1)];
+    }
+    header->version = LOG_DUMP_VERSION;
+    header->timer_hz = XPAR_TMRCTR_0_CLOCK_FREQ_HZ;
+    header->written = log_written;
+    header->first = from;
+    header->count = count;
+    return count;
+}
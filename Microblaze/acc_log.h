@@ -0,0 +1,102 @@
+#ifndef ACC_LOG_H
+#define ACC_LOG_H
+
+#include "acc_hal.h"
+
+/*
+ * acc_log.h
+ *   Console log levels and a binary event ring.
+ *
+ *   LOG_ERROR .. LOG_DEBUG print through xil_printf when ACC_LOG_LEVEL is at
+ *   least their level and compile to nothing otherwise. At 115200 baud every
+ *   printed line costs milliseconds, so the packet and inference paths only
+ *   print at LOG_LEVEL_DEBUG and record LOG_EVENT()s instead: a timestamp,
+ *   an event id and three arguments written into a ring of LOG_RING_ENTRIES
+ *   in memory, a few stores each. The ring is read back with log_read(), sent
+ *   to the PC on request (LOG_ETHER_TYPE in ACC.c) and decoded there by
+ *   PC_code/event_log.py. -DACC_LOG_EVENTS=0 compiles the events out.
+ */
+
+#define LOG_LEVEL_NONE    0
+#define LOG_LEVEL_ERROR   1
+#define LOG_LEVEL_WARN    2
+#define LOG_LEVEL_INFO    3
+#define LOG_LEVEL_DEBUG   4
+
+#ifndef ACC_LOG_LEVEL
+#define ACC_LOG_LEVEL     LOG_LEVEL_INFO
+#endif
+#ifndef ACC_LOG_EVENTS
+#define ACC_LOG_EVENTS    1
+#endif
+#ifndef LOG_RING_ENTRIES
+#define LOG_RING_ENTRIES  1024      // power of two
+#endif
+
+#define LOG_AT(level, ...)  do { if (ACC_LOG_LEVEL >= (level)) xil_printf(__VA_ARGS__); } while (0)
+#define LOG_ERROR(...)      LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)       LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...)       LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...)      LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#if ACC_LOG_EVENTS
+#define LOG_EVENT(id, a0, a1, a2)  log_event((id), (a0), (a1), (a2))
+#else
+#define LOG_EVENT(id, a0, a1, a2)  ((void)0)
+#endif
+
+// Event ids; the argument meaning is listed per event. Keep event_log.py in step.
+typedef enum {
+    LOG_EV_BOOT = 1,            // -, -, -
+    LOG_EV_FRAGMENT,            // tensor, fragment, payload bytes
+    LOG_EV_DUPLICATE,           // tensor, fragment, -
+    LOG_EV_ACK,                 // tensor, first missing fragment, selective bitmap
+    LOG_EV_REACK,               // tensor, first missing fragment, repeat count
+    LOG_EV_NACK,                // tensor, fragment, total fragments
+    LOG_EV_ABANDON,             // tensor, first missing fragment, total fragments
+    LOG_EV_TENSOR_DONE,         // tensor, bytes, fragments
+    LOG_EV_MODEL_CONTROL,       // op, status, tensor mask
+    LOG_EV_MODEL_ACTIVE,        // slot, model hash, generation
+    LOG_EV_REQUEST,             // -, -, -
+    LOG_EV_INFERENCE_BEGIN,     // -, -, -
+    LOG_EV_LAYER_DONE,          // PerfStage, -, -
+    LOG_EV_INFERENCE_END,       // class, probability, -
+    LOG_EV_BACKEND_MISMATCH,    // PerfStage, outputs that differ, outputs
+    LOG_EV_VAD                  // decision (acc_vad.h), peak << 16 | floor, voiced columns
+} LogEventId;
+
+// One ring entry; also the wire format of a dump, little endian.
+typedef struct {
+    u32 timestamp;              // perf_now()
+    u16 id;                     // LogEventId
+    u16 arg0;
+    u32 arg1;
+    u32 arg2;
+} LogEvent;
+
+// Precedes the events of a dump frame or file.
+typedef struct {
+    u32 version;                // LOG_DUMP_VERSION
+    u32 timer_hz;               // tick rate of LogEvent.timestamp
+    u32 written;                // events recorded since boot
+    u32 first;                  // sequence number of the first event that follows
+    u32 count;                  // events that follow
+} LogDumpHeader;
+
+#define LOG_DUMP_VERSION  1
+
+/*
+ * log_event:
+ *   Records one event; use LOG_EVENT so it can be compiled out.
+ */
+void log_event(LogEventId id, u32 arg0, u32 arg1, u32 arg2);
+
+/*
+ * log_read:
+ *   Copies up to max events from sequence number 'from' on (or the oldest
+ *   still in the ring, if 'from' has been overwritten). Fills *header for
+ *   them and returns the number copied.
+ */
+u32 log_read(u32 from, LogEvent *out, u32 max, LogDumpHeader *header);
+
+#endif
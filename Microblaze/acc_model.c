@@ -0,0 +1,629 @@
+#ifdef ACC_HOST_BUILD
+
+/*
+ * acc_model.c
+ *   Transaction-level model of the ACC register file (Hardware_Design/ACC.v).
+ *
+ *   Two register buffers of six words each. Writing a control word with the
+ *   enable bit set runs one 3x3 MAC on the PE selected by bits [23:16]:
+ *     - the PE adds the 9-element int8 dot product to its partial sum
+ *     - with the store bit (25) clear the partial sum is written to
+ *       ACC_OUTPUT_ADDR + write pointer and the PE is cleared
+ *   The write pointer is free running and wraps inside ACC_OUTPUT_WINDOW,
+ *   matching the AXI master address counter in ACC.v.
+ *
+ *   PASSES (0x58) is the cross-channel accumulation count of PE_ARRAY.v: a PE
+ *   only treats every PASSES-th op as the end of its result, and holds the
+ *   partial sum for the ones before it exactly as if the store bit were set.
+ *   Descriptors run PASSES ops per result, stepping both operands by 9 bytes.
+ *
+ *   The weight bank (0x5C-0x64) holds ACC_WBANK_SLOTS filters. A control word
+ *   with ACC_CTRL_WBANK copies the next WBANK_SEQ slot into the buffer's
+ *   filter registers before the op runs; in ring bank mode descriptor weight
+ *   addresses are slots, pass p uses the slot p * inner count further on, and
+ *   no AXI weight reads happen.
+ *
+ *   The GEMV engine (0x68-0x7C) computes y = W x when started, reading x in
+ *   ACC_GEMV_XBUF_WORDS chunks and every weight row slice of a chunk in
+ *   bursts of up to 256 beats that never cross 4 KB. A batch of input
+ *   vectors shares xbuf (ACC_GEMV_XBUF_WORDS / ACC_GEMV_MAX_BATCH words each)
+ *   and the weight stream.
+ *
+ *   The descriptor ring registers (0x40-0x54) are modelled too: a doorbell
+ *   write runs every pending descriptor to completion before returning, with
+ *   the same operand reuse as the ACC.v engine (an operand whose address did
+ *   not change since the previous op is not fetched again).
+ *
+ *   AXI traffic is counted the way ACC.v issues it: descriptors and operands
+ *   are read as bursts, and results go through the write-combining FIFO, which
+ *   merges consecutive addresses into bursts of up to ACC_WC_DEPTH beats that
+ *   never cross 4 KB. Register-fed results are assumed to be flushed singly
+ *   (the firmware feeds them slower than the FIFO idle timeout). Until that
+ *   timeout STATUS shows them as ACC_STATUS_WRITEBACK: the first STATUS read
+ *   after a register-fed result reports the bit, the next one sees the FIFO
+ *   drained, so the firmware's completion wait polls at least once.
+ *
+ *   Of the performance counters (0x80-0xA0) ops, GEMV beats and bytes moved
+ *   follow the statistics above; cycle and stall counts are not modelled and
+ *   read as 0.
+ *
+ *   With ACC_HOST_TRACE=<file> the model also writes a replay trace for the
+ *   RTL testbench (Hardware_Design/sim/tb_acc.v), one record per line:
+ *     W <offset> <value>   register write
+ *     R <offset> <value>   register read; the testbench polls until it matches
+ *     M <addr> <value>     DDR word the accelerator is about to read
+ *     E <addr> <value>     result word the accelerator must write, in order
+ *     L <layer> 0          ACC_TRACE_LAYER mark (0 conv1, 1 conv2, 2 fc1, 3 fc2)
+ *     S <ops> <beats>      end of trace: expected PERF_OPS and PERF_GEMV_BEATS
+ *   Recording starts at the first mark of ACC_HOST_TRACE_LAYER (any layer if
+ *   unset) with a snapshot of the register state, and stops at a mark of
+ *   another layer or once ACC_HOST_TRACE_RECORDS (default 200000) records are
+ *   written. The testbench starts from reset, so ring doorbell/completion
+ *   counts, ring slots and the register-fed result pointer are rebased to the
+ *   start of the trace. Performance counter accesses are not recorded.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "acc_hal.h"
+
+#define ACC_NUM_PES     8
+#define ACC_NUM_REGS    12
+#define ACC_WC_DEPTH    32      // ACC.v WC_DEPTH
+#define ACC_GEMV_XBUF_WORDS 4096 // ACC.v 1 << GEMV_XBUF_AW
+#define TRACE_SEEN_SLOTS 65536
+
+static u32 acc_regs[ACC_NUM_REGS];
+static int32_t pe_partial[ACC_NUM_PES];
+static u32 acc_write_ptr = 0;
+static u32 acc_passes = 1;
+static u32 pe_pass[ACC_NUM_PES];
+
+// Weight bank
+static u8 wbank[ACC_WBANK_SLOTS][9];
+static u32 wbank_ptr = 0;
+static u32 wbank_word = 0;
+static u32 wbank_seq_start = 0;
+static u32 wbank_seq_count = 0;
+static u32 wbank_seq_idx = 0;
+
+// Descriptor ring engine state
+static u32 ring_base = 0;
+static u32 ring_size = 0;
+static u32 ring_slot = 0;
+static u32 ring_tail = 0;
+static u32 ring_head = 0;
+static u32 ring_enable = 0;
+static u32 ring_wbank = 0;
+
+// GEMV engine registers
+static u32 gemv_w = 0, gemv_x = 0, gemv_y = 0, gemv_rows = 0, gemv_batch = 0, gemv_cols = 0;
+
+// Write-combining run being built
+static int wc_run_open = 0;
+static int wc_result_held = 0;          // register-fed result waiting for the idle flush
+static u32 wc_next_addr = 0;
+static u32 wc_run_len = 0;
+
+// Statistics reported at exit.
+static unsigned long long stat_reg_writes = 0;
+static unsigned long long stat_reg_reads = 0;
+static unsigned long long stat_macs = 0;
+static unsigned long long stat_results = 0;
+static unsigned long long stat_bad_mask = 0;
+static unsigned long long stat_descriptors = 0;
+static unsigned long long stat_desc_ops = 0;
+static unsigned long long stat_desc_word_reads = 0;
+static unsigned long long stat_read_bursts = 0;
+static unsigned long long stat_write_bursts = 0;
+static unsigned long long stat_gemv_runs = 0;
+static unsigned long long stat_gemv_word_reads = 0;
+static unsigned long long stat_gemv_read_bursts = 0;
+static unsigned long long stat_gemv_beats = 0;
+
+// Performance counters: statistics at the last clear, and whether they run
+static int perf_run = 0;
+static unsigned long long perf_base_ops, perf_base_gemv_beats, perf_base_rd_words, perf_base_wr_words;
+
+// Replay trace (ACC_HOST_TRACE)
+enum { TRACE_UNCONFIGURED, TRACE_WAITING, TRACE_RECORDING, TRACE_DONE };
+static const char *const trace_layers[] = { "conv1", "conv2", "fc1", "fc2" };
+static int trace_state = TRACE_UNCONFIGURED;
+static FILE *trace_file = NULL;
+static const char *trace_path = NULL;
+static const char *trace_layer = NULL;
+static unsigned long trace_limit = 200000;
+static unsigned long trace_records = 0;
+static u32 trace_tail0, trace_slot0, trace_wptr0;
+static unsigned long long trace_ops0, trace_beats0;
+static u32 *trace_expect_buf = NULL;     // E records held back until their trigger is written
+static u32 *trace_seen = NULL;           // {addr | 1, value} of recent M records, direct mapped
+static size_t trace_expect_len = 0, trace_expect_cap = 0;
+static int wbank_loaded = 0;
+static u32 mmio_turn = 0;                // register buffer ACC.v consumes next
+
+static void trace_record(char kind, u32 a, u32 b) {
+    fprintf(trace_file, "%c %08x %08x\n", kind, (unsigned)a, (unsigned)b);
+    trace_records++;
+}
+
+// Words [addr, addr + 4 * words) as the accelerator will read them; a word
+// already recorded with the same value is not repeated.
+static void trace_mem(u32 addr, u32 words) {
+    if (trace_state != TRACE_RECORDING) return;
+    addr &= ~3u;
+    for (u32 i = 0; i < words; i++, addr += 4) {
+        u32 value = *(const u32 *)hal_map(addr);
+        u32 *seen = &trace_seen[2 * ((addr >> 2) % TRACE_SEEN_SLOTS)];
+        if (seen[0] == (addr | 1) && seen[1] == value) continue;
+        seen[0] = addr | 1;
+        seen[1] = value;
+        trace_record('M', addr, value);
+    }
+}
+
+static void trace_expect(u32 addr, u32 value) {
+    if (trace_state != TRACE_RECORDING) return;
+    trace_seen[2 * ((addr >> 2) % TRACE_SEEN_SLOTS)] = 0;     // the testbench memory now holds the result
+    if (trace_expect_len + 2 > trace_expect_cap) {
+        size_t cap = trace_expect_cap ? 2 * trace_expect_cap : 1024;
+        u32 *buf = (u32 *)realloc(trace_expect_buf, cap * sizeof(u32));
+        if (!buf) {
+            printf("acc_model: out of memory, trace truncated\n");
+            return;
+        }
+        trace_expect_buf = buf;
+        trace_expect_cap = cap;
+    }
+    trace_expect_buf[trace_expect_len++] = addr;
+    trace_expect_buf[trace_expect_len++] = value;
+}
+
+static void trace_flush_expect(void) {
+    for (size_t i = 0; i < trace_expect_len; i += 2) {
+        trace_record('E', trace_expect_buf[i], trace_expect_buf[i + 1]);
+    }
+    trace_expect_len = 0;
+}
+
+static void acc_model_wc_push(u32 addr) {
+    if (!wc_run_open || addr != wc_next_addr || (addr & 0xFFF) == 0 || wc_run_len == ACC_WC_DEPTH) {
+        stat_write_bursts++;
+        wc_run_open = 1;
+        wc_run_len = 0;
+    }
+    wc_run_len++;
+    wc_next_addr = addr + 4;
+}
+
+static void acc_model_wc_flush(void) {
+    wc_run_open = 0;
+}
+
+// Three-word operand fetch at addr; split in two when it would cross 4 KB.
+static void acc_model_fetch(u8 *bytes, u32 addr) {
+    memcpy(bytes, hal_map(addr), 9);
+    trace_mem(addr, 3);
+    stat_desc_word_reads += 3;
+    stat_read_bursts += (((addr >> 2) & 0x3FF) > 0x3FD) ? 2 : 1;
+}
+
+static int32_t dot9(u32 w0, u32 w1, u32 w2, u32 a0, u32 a1, u32 a2) {
+    u32 w[3] = {w0, w1, w2};
+    u32 a[3] = {a0, a1, a2};
+    int32_t sum = 0;
+    for (int i = 0; i < 9; i++) {
+        int8_t wb = (int8_t)((w[i / 4] >> (8 * (i % 4))) & 0xFF);
+        int8_t ab = (int8_t)((a[i / 4] >> (8 * (i % 4))) & 0xFF);
+        sum += (int32_t)wb * (int32_t)ab;
+    }
+    return sum;
+}
+
+static void acc_model_emit(int32_t value) {
+    u32 *out = (u32 *)hal_map(ACC_OUTPUT_ADDR + acc_write_ptr);
+    *out = (u32)value;
+    trace_expect(ACC_OUTPUT_ADDR + (acc_write_ptr - trace_wptr0) % ACC_OUTPUT_WINDOW, (u32)value);
+    acc_model_wc_push(ACC_OUTPUT_ADDR + acc_write_ptr);
+    acc_model_wc_flush();
+    wc_result_held = 1;
+    acc_write_ptr = (acc_write_ptr + 4) % ACC_OUTPUT_WINDOW;
+    stat_results++;
+}
+
+static void acc_model_execute(unsigned int buffer_set) {
+    const u32 *r = &acc_regs[buffer_set * 6];
+    u32 ctrl = r[5];
+    u8 pe_mask = (ctrl >> ACC_CTRL_PE_SHIFT) & 0xFF;
+
+    mmio_turn = buffer_set ^ 1;
+    // PE_ARRAY only routes operands for a one-hot PE selection.
+    if (pe_mask == 0 || (pe_mask & (pe_mask - 1)) != 0) {
+        stat_bad_mask++;
+        return;
+    }
+    int pe = 0;
+    while (!(pe_mask & (1 << pe))) pe++;
+
+    if (ctrl & ACC_CTRL_WBANK) {
+        u32 *w = &acc_regs[buffer_set * 6];
+        const u8 *slot = wbank[(wbank_seq_start + wbank_seq_idx) % ACC_WBANK_SLOTS];
+        w[0] = slot[0] | (slot[1] << 8) | (slot[2] << 16) | ((u32)slot[3] << 24);
+        w[1] = slot[4] | (slot[5] << 8) | (slot[6] << 16) | ((u32)slot[7] << 24);
+        w[2] = (w[2] & ~0xFFu) | slot[8];
+        wbank_seq_idx = (wbank_seq_idx + 1 >= wbank_seq_count) ? 0 : wbank_seq_idx + 1;
+    }
+
+    pe_partial[pe] += dot9(r[0], r[1], r[2] & 0xFF, r[3], r[4], ctrl & 0xFF);
+    stat_macs++;
+
+    int last_pass = ++pe_pass[pe] >= acc_passes;
+    if (last_pass) pe_pass[pe] = 0;
+    if (!(ctrl & ACC_CTRL_STORE) && last_pass) {
+        acc_model_emit(pe_partial[pe]);
+        pe_partial[pe] = 0;
+    }
+}
+
+static int32_t dot9_bytes(const u8 *a, const u8 *w) {
+    int32_t sum = 0;
+    for (int i = 0; i < 9; i++) {
+        sum += (int32_t)(int8_t)a[i] * (int32_t)(int8_t)w[i];
+    }
+    return sum;
+}
+
+static void acc_model_run_descriptor(const u32 *d) {
+    u32 outer_count = d[3] & 0xFFFF;
+    u32 inner_count = d[3] >> 16;
+    u32 passes = acc_passes ? acc_passes : 1;
+    u32 w_pass_step = ring_wbank ? inner_count : 9;
+    u32 out = d[2];
+    u32 in_cached = 0, w_cached = 0;
+    int in_valid = 0, w_valid = 0;
+    u8 in_bytes[9] = {0}, w_bytes[9] = {0};
+
+    stat_descriptors++;
+    for (u32 o = 0; o < outer_count; o++) {
+        for (u32 i = 0; i < inner_count; i++) {
+            int32_t sum = 0;
+            for (u32 p = 0; p < passes; p++) {
+                u32 in_addr = d[0] + o * d[4] + i * d[5] + p * 9;
+                u32 w_addr = d[1] + o * d[6] + i * d[7] + p * w_pass_step;
+                if (ring_wbank) {
+                    memcpy(w_bytes, wbank[w_addr % ACC_WBANK_SLOTS], 9);
+                } else if (!w_valid || w_addr != w_cached) {
+                    acc_model_fetch(w_bytes, w_addr);
+                    w_cached = w_addr;
+                    w_valid = 1;
+                }
+                if (!in_valid || in_addr != in_cached) {
+                    acc_model_fetch(in_bytes, in_addr);
+                    in_cached = in_addr;
+                    in_valid = 1;
+                }
+                sum += dot9_bytes(in_bytes, w_bytes);
+                stat_desc_ops++;
+                stat_macs++;
+            }
+            *(u32 *)hal_map(out) = (u32)sum;
+            trace_expect(out, (u32)sum);
+            acc_model_wc_push(out);
+            out += 4;
+            stat_results++;
+        }
+    }
+}
+
+// Bursts the GEMV engine needs for 'words' words at addr.
+static void acc_model_gemv_stream(u32 addr, u32 words) {
+    trace_mem(addr, words);
+    stat_gemv_word_reads += words;
+    while (words) {
+        u32 page = 1024 - ((addr >> 2) & 0x3FF);
+        u32 beats = words < 256 ? words : 256;
+        if (beats > page) beats = page;
+        stat_gemv_read_bursts++;
+        addr += beats * 4;
+        words -= beats;
+    }
+}
+
+static void acc_model_run_gemv(void) {
+    u32 batch = gemv_batch ? gemv_batch : 1;
+    if (gemv_rows == 0 || gemv_rows > ACC_GEMV_MAX_ROWS || batch > ACC_GEMV_MAX_BATCH ||
+        gemv_cols == 0 || (gemv_cols & 3)) return;
+    const int8_t *w = (const int8_t *)hal_map(gemv_w);
+    u32 xbuf = batch == 1 ? ACC_GEMV_XBUF_WORDS : ACC_GEMV_XBUF_WORDS / ACC_GEMV_MAX_BATCH;
+    stat_gemv_runs++;
+    for (u32 off = 0; off < gemv_cols; off += xbuf * 4) {
+        u32 chunk = (gemv_cols - off) / 4;
+        if (chunk > xbuf) chunk = xbuf;
+        for (u32 b = 0; b < batch; b++) acc_model_gemv_stream(gemv_x + b * gemv_cols + off, chunk);
+        for (u32 r = 0; r < gemv_rows; r++) {
+            acc_model_gemv_stream(gemv_w + r * gemv_cols + off, chunk);
+            stat_gemv_beats += chunk;
+        }
+    }
+    u32 y = gemv_y;
+    for (u32 b = 0; b < batch; b++) {
+        const int8_t *x = (const int8_t *)hal_map(gemv_x + b * gemv_cols);
+        for (u32 r = 0; r < gemv_rows; r++) {
+            int32_t sum = 0;
+            for (u32 k = 0; k < gemv_cols; k++) {
+                sum += (int32_t)w[(size_t)r * gemv_cols + k] * (int32_t)x[k];
+            }
+            *(u32 *)hal_map(y) = (u32)sum;
+            trace_expect(y, (u32)sum);
+            acc_model_wc_push(y);
+            stat_results++;
+            y += 4;
+        }
+    }
+    acc_model_wc_flush();
+}
+
+static void acc_model_run_ring(void) {
+    while (ring_enable && ring_size && ring_head != ring_tail) {
+        const u32 *d = (const u32 *)hal_map(ring_base + ring_slot * 32);
+        u32 desc[8];
+        memcpy(desc, d, sizeof(desc));
+        if (trace_state == TRACE_RECORDING) {
+            u32 slot = (ring_slot + ring_size - trace_slot0) % ring_size;
+            for (int i = 0; i < 8; i++) trace_record('M', ring_base + slot * 32 + 4 * i, desc[i]);
+        }
+        stat_desc_word_reads += 8;
+        stat_read_bursts++;
+        acc_model_run_descriptor(desc);
+        acc_model_wc_flush();
+        ring_head++;
+        ring_slot = (ring_slot + 1 == ring_size) ? 0 : ring_slot + 1;
+    }
+}
+
+static void acc_model_ring_write(u32 offset, u32 value) {
+    switch (offset & 0x3C) {
+    case ACC_REG_RING_BASE & 0x3C: ring_base = value; break;
+    case ACC_REG_RING_SIZE & 0x3C: ring_size = value & 0xFFFF; break;
+    case ACC_REG_DOORBELL & 0x3C: ring_tail = value; break;
+    case ACC_REG_RING_CTRL & 0x3C:
+        ring_enable = value & ACC_RING_CTRL_ENABLE;
+        ring_wbank = value & ACC_RING_CTRL_WBANK;
+        if (value & ACC_RING_CTRL_RESET) {
+            ring_head = ring_tail = ring_slot = 0;
+            trace_tail0 = trace_slot0 = 0;
+        }
+        break;
+    case ACC_REG_PASSES & 0x3C:
+        acc_passes = value & 0xFFFF;
+        memset(pe_pass, 0, sizeof(pe_pass));
+        break;
+    case ACC_REG_WBANK_ADDR & 0x3C:
+        wbank_ptr = value % ACC_WBANK_SLOTS;
+        wbank_word = 0;
+        break;
+    case ACC_REG_WBANK_DATA & 0x3C: {
+        u8 *slot = wbank[wbank_ptr];
+        wbank_loaded = 1;
+        int bytes = (wbank_word == 2) ? 1 : 4;
+        for (int b = 0; b < bytes; b++) slot[wbank_word * 4 + b] = (value >> (8 * b)) & 0xFF;
+        if (++wbank_word == 3) {
+            wbank_word = 0;
+            wbank_ptr = (wbank_ptr + 1) % ACC_WBANK_SLOTS;
+        }
+        break;
+    }
+    case ACC_REG_WBANK_SEQ & 0x3C:
+        wbank_seq_start = value & 0xFFFF;
+        wbank_seq_count = value >> 16;
+        wbank_seq_idx = 0;
+        break;
+    case ACC_REG_GEMV_W & 0x3C: gemv_w = value; break;
+    case ACC_REG_GEMV_X & 0x3C: gemv_x = value; break;
+    case ACC_REG_GEMV_Y & 0x3C: gemv_y = value; break;
+    case ACC_REG_GEMV_ROWS & 0x3C:
+        gemv_rows = value & 0xFFFF;
+        gemv_batch = (value >> 16) & 0xFF;
+        break;
+    case ACC_REG_GEMV_COLS & 0x3C: gemv_cols = value; break;
+    case ACC_REG_GEMV_CTRL & 0x3C:
+        if (value & ACC_GEMV_START) acc_model_run_gemv();
+        break;
+    default: break;
+    }
+    acc_model_run_ring();
+}
+
+static unsigned long long acc_model_rd_words(void) {
+    return stat_desc_word_reads + stat_gemv_word_reads;
+}
+
+static void acc_model_perf_write(u32 offset, u32 value) {
+    if ((offset & 0x3C) != (ACC_REG_PERF_CTRL & 0x3C)) return;
+    perf_run = (value & ACC_PERF_RUN) != 0;
+    if (value & ACC_PERF_CLEAR) {
+        perf_base_ops = stat_macs;
+        perf_base_gemv_beats = stat_gemv_beats;
+        perf_base_rd_words = acc_model_rd_words();
+        perf_base_wr_words = stat_results;
+    }
+}
+
+static u32 acc_model_perf_read(u32 offset) {
+    switch (offset & 0x3C) {
+    case ACC_REG_PERF_CTRL & 0x3C: return perf_run ? ACC_PERF_RUN : 0;
+    case ACC_REG_PERF_OPS & 0x3C: return (u32)(stat_macs - perf_base_ops);
+    case ACC_REG_PERF_GEMV_BEATS & 0x3C: return (u32)(stat_gemv_beats - perf_base_gemv_beats);
+    case ACC_REG_PERF_RD_BYTES & 0x3C: return (u32)(4 * (acc_model_rd_words() - perf_base_rd_words));
+    case ACC_REG_PERF_WR_BYTES & 0x3C: return (u32)(4 * (stat_results - perf_base_wr_words));
+    default: return 0;
+    }
+}
+
+/*
+ * Register state at the start of the trace, written so that ACC.v out of
+ * reset ends up where the model is. ACC.v alternates the register buffers
+ * from buffer 0; if the firmware is on buffer 1 a zero op with the store bit
+ * set moves it along without producing a result (the PASSES write after it
+ * clears the PE pass counts again).
+ */
+static void acc_model_trace_begin(void) {
+    trace_file = fopen(trace_path, "w");
+    trace_seen = (u32 *)calloc(2 * TRACE_SEEN_SLOTS, sizeof(u32));
+    if (!trace_file || !trace_seen) {
+        printf("acc_model: cannot write trace %s\n", trace_path);
+        trace_state = TRACE_DONE;
+        return;
+    }
+    trace_state = TRACE_RECORDING;
+    if (mmio_turn) {
+        trace_record('W', ACC_REG_INPUT0 + 8, ACC_CTRL_ENABLE | ACC_CTRL_STORE | (1u << ACC_CTRL_PE_SHIFT));
+    }
+    trace_record('W', ACC_REG_RING_BASE, ring_base);
+    trace_record('W', ACC_REG_RING_SIZE, ring_size);
+    trace_record('W', ACC_REG_RING_CTRL, ring_enable | ring_wbank | ACC_RING_CTRL_RESET);
+    trace_record('W', ACC_REG_RING_CTRL, ring_enable | ring_wbank);
+    if (wbank_loaded) {
+        trace_record('W', ACC_REG_WBANK_ADDR, 0);
+        for (int i = 0; i < ACC_WBANK_SLOTS; i++) {
+            const u8 *slot = wbank[i];
+            trace_record('W', ACC_REG_WBANK_DATA,
+                         slot[0] | (slot[1] << 8) | (slot[2] << 16) | ((u32)slot[3] << 24));
+            trace_record('W', ACC_REG_WBANK_DATA,
+                         slot[4] | (slot[5] << 8) | (slot[6] << 16) | ((u32)slot[7] << 24));
+            trace_record('W', ACC_REG_WBANK_DATA, slot[8]);
+        }
+    }
+    trace_record('W', ACC_REG_WBANK_SEQ, ACC_WBANK_SEQ(wbank_seq_start, wbank_seq_count));
+    trace_record('W', ACC_REG_GEMV_W, gemv_w);
+    trace_record('W', ACC_REG_GEMV_X, gemv_x);
+    trace_record('W', ACC_REG_GEMV_Y, gemv_y);
+    trace_record('W', ACC_REG_GEMV_ROWS, ACC_GEMV_ROWS(gemv_rows, gemv_batch));
+    trace_record('W', ACC_REG_GEMV_COLS, gemv_cols);
+    for (int i = 0; i < ACC_NUM_REGS; i++) {
+        u32 v = acc_regs[i];
+        if (i == 5 || i == 11) v &= ~(ACC_CTRL_ENABLE | ACC_CTRL_WBANK);
+        trace_record('W', 4 * i, v);
+    }
+    trace_record('W', ACC_REG_PASSES, acc_passes);
+    trace_record('W', ACC_REG_PERF_CTRL, ACC_PERF_CLEAR | ACC_PERF_RUN);
+    trace_tail0 = ring_tail;
+    trace_slot0 = ring_slot;
+    trace_wptr0 = acc_write_ptr;
+    trace_ops0 = stat_macs;
+    trace_beats0 = stat_gemv_beats;
+}
+
+static void acc_model_trace_end(void) {
+    trace_record('S', (u32)(stat_macs - trace_ops0), (u32)(stat_gemv_beats - trace_beats0));
+    fclose(trace_file);
+    trace_file = NULL;
+    trace_state = TRACE_DONE;
+    printf("acc_model: %lu trace records written to %s\n", trace_records, trace_path);
+}
+
+// Called before every recorded access, so the trace ends between two of them.
+static int acc_model_tracing(void) {
+    if (trace_state == TRACE_RECORDING && trace_records >= trace_limit) acc_model_trace_end();
+    return trace_state == TRACE_RECORDING;
+}
+
+void acc_model_trace_layer(const char *layer) {
+    u32 id = 0;
+    while (id < 4 && strcmp(layer, trace_layers[id]) != 0) id++;
+    if (trace_state == TRACE_UNCONFIGURED) {
+        const char *limit = hal_get_option("ACC_HOST_TRACE_RECORDS");
+        trace_path = hal_get_option("ACC_HOST_TRACE");
+        trace_layer = hal_get_option("ACC_HOST_TRACE_LAYER");
+        if (limit) trace_limit = strtoul(limit, NULL, 0);
+        trace_state = trace_path ? TRACE_WAITING : TRACE_DONE;
+    }
+    if (trace_state == TRACE_WAITING && (!trace_layer || strcmp(layer, trace_layer) == 0)) {
+        acc_model_trace_begin();
+    } else if (trace_state == TRACE_RECORDING && trace_layer && strcmp(layer, trace_layer) != 0) {
+        acc_model_trace_end();
+    }
+    if (acc_model_tracing()) trace_record('L', id, 0);
+}
+
+void acc_model_write(u32 offset, u32 value) {
+    unsigned int index = (offset >> 2) & 0xF;
+    stat_reg_writes++;
+    if (offset & 0x80) {
+        acc_model_perf_write(offset, value);
+        return;
+    }
+    int tracing = acc_model_tracing();
+    if (offset & 0x40) {
+        acc_model_ring_write(offset, value);
+    } else if (index < ACC_NUM_REGS) {
+        acc_regs[index] = value;
+        // Control words live in the last register of each buffer.
+        if ((index == 5 || index == 11) && (value & ACC_CTRL_ENABLE)) {
+            acc_model_execute(index / 6);
+        }
+    }
+    if (tracing) {
+        // Operands were recorded while the write ran; results follow it.
+        u32 traced = ((offset & 0xFC) == ACC_REG_DOORBELL) ? value - trace_tail0 : value;
+        trace_record('W', offset & 0xFC, traced);
+        trace_flush_expect();
+    }
+}
+
+static u32 acc_model_reg_read(u32 offset) {
+    // ACC.v only drives read data for the ring registers, the result pointer
+    // and the counters.
+    if (!(offset & 0x40)) return 0;
+    switch (offset & 0x3C) {
+    case ACC_REG_RING_BASE & 0x3C: return ring_base;
+    case ACC_REG_RING_SIZE & 0x3C: return ring_size;
+    case ACC_REG_DOORBELL & 0x3C: return ring_tail;
+    case ACC_REG_COMPLETION & 0x3C: return ring_head;
+    case ACC_REG_STATUS & 0x3C: {
+        // Descriptors complete synchronously; a held result is flushed now.
+        u32 status = wc_result_held ? ACC_STATUS_WRITEBACK : 0;
+        wc_result_held = 0;
+        return status;
+    }
+    case ACC_REG_RING_CTRL & 0x3C: return ring_enable | ring_wbank;
+    case ACC_REG_PASSES & 0x3C: return acc_passes;
+    case ACC_REG_RESULT_PTR & 0x3C: return acc_write_ptr;
+    default: return 0;
+    }
+}
+
+u32 acc_model_read(u32 offset) {
+    stat_reg_reads++;
+    if (offset & 0x80) return acc_model_perf_read(offset);
+    u32 value = acc_model_reg_read(offset);
+    if (acc_model_tracing()) {
+        u32 reg = offset & 0xFC;
+        u32 traced = value;
+        if (reg == ACC_REG_DOORBELL || reg == ACC_REG_COMPLETION) traced = value - trace_tail0;
+        if (reg == ACC_REG_RESULT_PTR) traced = (value - trace_wptr0) % ACC_OUTPUT_WINDOW;
+        // Only the read that ends a STATUS poll is replayed: the testbench
+        // polls until it matches and may never see the busy value.
+        if (reg != ACC_REG_STATUS || value == 0) trace_record('R', reg, traced);
+    }
+    return value;
+}
+
+void acc_model_report(void) {
+    if (trace_state == TRACE_RECORDING) acc_model_trace_end();
+    printf("acc_model: %llu register writes, %llu register reads\n", stat_reg_writes, stat_reg_reads);
+    printf("acc_model: %llu MACs issued, %llu results written", stat_macs, stat_results);
+    if (stat_bad_mask) printf(", %llu ops dropped (PE mask not one-hot)", stat_bad_mask);
+    printf("\n");
+    if (stat_descriptors) {
+        printf("acc_model: %llu descriptors, %llu descriptor ops, %llu AXI master word reads in %llu bursts\n",
+               stat_descriptors, stat_desc_ops, stat_desc_word_reads, stat_read_bursts);
+    }
+    if (stat_gemv_runs) {
+        printf("acc_model: %llu GEMV runs, %llu AXI master word reads in %llu bursts\n",
+               stat_gemv_runs, stat_gemv_word_reads, stat_gemv_read_bursts);
+    }
+    printf("acc_model: %llu result words in %llu AXI write bursts\n", stat_results, stat_write_bursts);
+}
+
+#endif
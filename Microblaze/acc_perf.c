@@ -0,0 +1,76 @@
+#include <string.h>
+#include "acc_perf.h"
+
+#define PERF_TIMER   0      // counter 0 of the AXI timer
+
+static XTmrCtr perf_timer;
+static int perf_timer_ok = 0;
+static u32 stage_ticks[PERF_STAGES];
+static u32 inference_count = 0;
+
+static const char *const stage_names[PERF_STAGES] = {
+    "load", "conv1", "conv2", "maxpool", "fc1", "fc2", "softmax"
+};
+
+static const char *const counter_names[ACC_PERF_COUNTERS] = {
+    "cycles", "busy", "idle", "ops", "gemv beats", "axi stall", "bytes read", "bytes written"
+};
+
+int perf_init(void) {
+    if (XTmrCtr_Initialize(&perf_timer, XPAR_TMRCTR_0_DEVICE_ID) != XST_SUCCESS) {
+        xil_printf("Timer init failed, stage times will read 0\n");
+        return -1;
+    }
+    XTmrCtr_SetOptions(&perf_timer, PERF_TIMER, XTC_AUTO_RELOAD_OPTION);
+    XTmrCtr_Start(&perf_timer, PERF_TIMER);
+    perf_timer_ok = 1;
+    return 0;
+}
+
+u32 perf_now(void) {
+    return perf_timer_ok ? XTmrCtr_GetValue(&perf_timer, PERF_TIMER) : 0;
+}
+
+void perf_add(PerfStage stage, u32 since) {
+    stage_ticks[stage] += perf_now() - since;
+}
+
+void perf_clear(PerfStage stage) {
+    stage_ticks[stage] = 0;
+}
+
+void perf_begin_inference(void) {
+    for (int i = 0; i < PERF_STAGES; i++) {
+        if (i != PERF_LOAD) stage_ticks[i] = 0;
+    }
+    ACC_REG_WRITE(ACC_REG_PERF_CTRL, ACC_PERF_CLEAR | ACC_PERF_RUN);
+}
+
+void perf_end_inference(PerfReport *report, u32 predicted_class, u32 probability) {
+    ACC_REG_WRITE(ACC_REG_PERF_CTRL, 0);
+    memset(report, 0, sizeof(*report));
+    report->version = PERF_REPORT_VERSION;
+    report->inference = ++inference_count;
+    report->predicted_class = predicted_class;
+    report->probability = probability;
+    report->timer_hz = XPAR_TMRCTR_0_CLOCK_FREQ_HZ;
+    report->clips = 1;
+    memcpy(report->stage_ticks, stage_ticks, sizeof(stage_ticks));
+    for (int i = 0; i < ACC_PERF_COUNTERS; i++) {
+        report->acc_counters[i] = ACC_REG_READ(ACC_REG_PERF_CYCLES + 4 * i);
+    }
+}
+
+void perf_print(const PerfReport *report) {
+    u32 ticks_per_ms = report->timer_hz / 1000;
+    xil_printf("Inference %d stage times (ms):", report->inference);
+    if (report->clips > 1) xil_printf(" [batch of %d]", report->clips);
+    for (int i = 0; i < PERF_STAGES; i++) {
+        xil_printf(" %s %d", stage_names[i], report->stage_ticks[i] / ticks_per_ms);
+    }
+    xil_printf("\nAccelerator counters:");
+    for (int i = 0; i < ACC_PERF_COUNTERS; i++) {
+        xil_printf(" %s %d", counter_names[i], report->acc_counters[i]);
+    }
+    xil_printf("\n");
+}
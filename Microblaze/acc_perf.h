@@ -0,0 +1,89 @@
+#ifndef ACC_PERF_H
+#define ACC_PERF_H
+
+#include "acc_hal.h"
+
+/*
+ * acc_perf.h
+ *   Per-utterance performance report.
+ *
+ *   Stage times come from the AXI timer (XTmrCtr, 32-bit, wraps after
+ *   2^32 / PerfReport.timer_hz seconds); the accelerator side comes from the
+ *   ACC performance counters (ACC_REG_PERF_*), which run from
+ *   perf_begin_inference() to perf_end_inference(). conv1, conv2 and the max
+ *   pool run interleaved (run_conv_stack), so their times are the sums over
+ *   all rows. The load stage is the preparation of the current model after
+ *   it was received or restored and is repeated in every report. A batch
+ *   (BATCH_TENSOR_ID in ACC.c) gets one report for all of its clips, with
+ *   the class of the first.
+ */
+
+#define PERF_REPORT_VERSION   2
+
+typedef enum {
+    PERF_LOAD,
+    PERF_CONV1,
+    PERF_CONV2,
+    PERF_MAXPOOL,
+    PERF_FC1,
+    PERF_FC2,
+    PERF_SOFTMAX,
+    PERF_STAGES
+} PerfStage;
+
+// Sent as the payload of the report frame, little endian.
+typedef struct {
+    u32 version;                        // PERF_REPORT_VERSION
+    u32 inference;                      // utterances since boot, from 1
+    u32 predicted_class;
+    u32 probability;                    // percent
+    u32 timer_hz;                       // tick rate of stage_ticks
+    u32 stage_ticks[PERF_STAGES];
+    u32 acc_counters[ACC_PERF_COUNTERS];  // ACC_REG_PERF_CYCLES onwards
+    u32 clips;                          // utterances covered, 1 unless batched (version 2)
+} PerfReport;
+
+/*
+ * perf_init:
+ *   Starts the AXI timer. Returns -1 (stage times then read 0) on failure.
+ */
+int perf_init(void);
+
+/*
+ * perf_now:
+ *   Current timer value, for a later perf_add().
+ */
+u32 perf_now(void);
+
+/*
+ * perf_add:
+ *   Adds the time since 'since' to a stage.
+ */
+void perf_add(PerfStage stage, u32 since);
+
+/*
+ * perf_clear:
+ *   Zeroes one stage, e.g. PERF_LOAD before a new model is prepared.
+ */
+void perf_clear(PerfStage stage);
+
+/*
+ * perf_begin_inference:
+ *   Clears every stage except PERF_LOAD, and clears and starts the ACC
+ *   counters.
+ */
+void perf_begin_inference(void);
+
+/*
+ * perf_end_inference:
+ *   Stops the ACC counters and fills the report for this utterance.
+ */
+void perf_end_inference(PerfReport *report, u32 predicted_class, u32 probability);
+
+/*
+ * perf_print:
+ *   Prints the report on the console in milliseconds and counter values.
+ */
+void perf_print(const PerfReport *report);
+
+#endif
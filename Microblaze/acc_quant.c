@@ -0,0 +1,46 @@
+#include <math.h>
+#include "acc_quant.h"
+
+/*
+ * quantize_multiplier:
+ *   Splits a real multiplier into mantissa * 2^-shift with the mantissa in
+ *   Q31. Runs once per channel at model load, so double math is fine here.
+ */
+static void quantize_multiplier(double real_multiplier, int32_t *multiplier, int32_t *shift) {
+    if (real_multiplier <= 0.0) {
+        *multiplier = 0;
+        *shift = 1;
+        return;
+    }
+    int exponent;
+    double mantissa = frexp(real_multiplier, &exponent);   // mantissa in [0.5, 1)
+    int64_t q = (int64_t)llround(mantissa * (double)(1LL << 31));
+    if (q == (1LL << 31)) {
+        q /= 2;
+        exponent++;
+    }
+    int s = 31 - exponent;
+    if (s < 1) {
+        // Multipliers >= 2^30 never occur in this model; saturate instead of overflowing.
+        q = 0x7FFFFFFF;
+        s = 1;
+    }
+    if (s > 62) {
+        q = 0;
+        s = 1;
+    }
+    *multiplier = (int32_t)q;
+    *shift = s;
+}
+
+int requant_table_init(RequantTable *table, float S_x, const float *weight_scales,
+                       unsigned int num_channels, float S_y, int Z_y) {
+    if (num_channels == 0 || num_channels > REQUANT_MAX_CHANNELS || S_y <= 0.0f) return -1;
+    table->num_channels = num_channels;
+    table->zero_point = Z_y;
+    for (unsigned int ch = 0; ch < num_channels; ch++) {
+        double real_multiplier = ((double)S_x * (double)weight_scales[ch]) / (double)S_y;
+        quantize_multiplier(real_multiplier, &table->multiplier[ch], &table->shift[ch]);
+    }
+    return 0;
+}
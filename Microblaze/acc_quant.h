@@ -0,0 +1,59 @@
+#ifndef ACC_QUANT_H
+#define ACC_QUANT_H
+
+#include <stdint.h>
+
+/*
+ * acc_quant.h
+ *   Integer-only requantization.
+ *
+ *   Each layer's effective multiplier (S_x * S_w[ch]) / S_y is turned into a
+ *   Q31 mantissa and a right shift once, when the model is loaded. Per output
+ *   element requantize() then needs one 32x32->64 multiply, an add and a
+ *   shift; no float or round() on the MicroBlaze.
+ *
+ *   Tolerance: the multiplier is exact to 2^-31 relative and the product is
+ *   rounded half away from zero like round(), so outputs match the former
+ *   float path ((int32_t)round(float_multiplier * acc) + Z_y) within +/-1 LSB.
+ *   Differences only occur where the float path itself lost precision, i.e.
+ *   near .5 ties or for accumulators above 2^24.
+ */
+
+#define REQUANT_MAX_CHANNELS  64
+
+typedef struct {
+    unsigned int num_channels;
+    int32_t multiplier[REQUANT_MAX_CHANNELS];  // Q31 mantissa in [2^30, 2^31), 0 for a zero scale
+    int32_t shift[REQUANT_MAX_CHANNELS];       // right shift applied to acc * multiplier
+    int zero_point;                            // output zero point Z_y
+} RequantTable;
+
+/*
+ * requant_table_init:
+ *   Builds the table for one layer from its input scale, per-channel (or a
+ *   single per-tensor) weight scales and output scale. Returns 0 on success,
+ *   -1 if there are more channels than REQUANT_MAX_CHANNELS.
+ */
+int requant_table_init(RequantTable *table, float S_x, const float *weight_scales,
+                       unsigned int num_channels, float S_y, int Z_y);
+
+/*
+ * requantize:
+ *   Scales an int32 accumulator (bias already added) into the output
+ *   quantization of channel ch and clamps to [0, 127], the ReLU range of every
+ *   layer. Per-tensor tables (num_channels == 1) ignore ch. Shared by the
+ *   accelerator path and the software backend so both round identically.
+ */
+static inline int8_t requantize(int32_t acc, const RequantTable *table, int ch) {
+    if (table->num_channels == 1) ch = 0;
+    int64_t prod = (int64_t)acc * table->multiplier[ch];
+    int shift = table->shift[ch];
+    int64_t half = (int64_t)1 << (shift - 1);
+    int64_t scaled = (prod >= 0) ? (prod + half) >> shift : -((-prod + half) >> shift);
+    scaled += table->zero_point;
+    if (scaled < 0) scaled = 0;
+    if (scaled > 127) scaled = 127;
+    return (int8_t)scaled;
+}
+
+#endif
@@ -0,0 +1,277 @@
+#include <stddef.h>
+#include <string.h>
+#include "acc_store.h"
+#include "acc_dma.h"
+
+static u32 crc_table[256];
+static int crc_table_ready = 0;
+
+static int active_slot = -1;
+static StoreManifest active;         // copy of the active slot's manifest
+
+static int staging = STORE_IDLE;
+static int staged_slot = 0;
+static StoreManifest staged;
+static u32 staged_have;              // tensors in place (received or reused)
+static u32 staged_unverified;        // received tensors whose CRC is not checked yet
+static u32 legacy_next;              // next free offset of a legacy model
+
+static void crc_init(void) {
+    for (u32 i = 0; i < 256; i++) {
+        u32 c = i;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+    crc_table_ready = 1;
+}
+
+u32 store_crc32(u32 crc, const u8 *data, u32 length) {
+    if (!crc_table_ready) crc_init();
+    crc = ~crc;
+    for (u32 i = 0; i < length; i++) {
+        crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static u32 crc_u32(u32 crc, u32 value) {
+    u8 bytes[4] = { value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, (value >> 24) & 0xFF };
+    return store_crc32(crc, bytes, 4);
+}
+
+u32 store_model_hash(const StoreManifest *manifest) {
+    u32 hash = crc_u32(0, manifest->tensor_count);
+    for (u32 i = 0; i < manifest->tensor_count; i++) {
+        hash = crc_u32(hash, manifest->tensors[i].size);
+        hash = crc_u32(hash, manifest->tensors[i].crc);
+    }
+    return hash;
+}
+
+static u32 manifest_crc(const StoreManifest *manifest) {
+    return store_crc32(0, (const u8 *)manifest, offsetof(StoreManifest, manifest_crc));
+}
+
+static u32 tensor_mask(u32 count) {
+    return count >= 32 ? 0xFFFFFFFFu : (1u << count) - 1;
+}
+
+static u32 align_offset(u32 offset) {
+    return (offset + STORE_ALIGN - 1) & ~(u32)(STORE_ALIGN - 1);
+}
+
+u8 *store_slot_base(int slot) {
+    return (u8 *)HAL_PTR(DRAM_BASE_ADDR + (u32)slot * STORE_SLOT_SIZE);
+}
+
+static StoreManifest *slot_manifest(int slot) {
+    return (StoreManifest *)store_slot_base(slot);
+}
+
+// Manifest fields only; the tensors are checked by slot_tensors_ok().
+static int manifest_ok(const StoreManifest *m) {
+    if (m->magic != STORE_MAGIC || m->version != STORE_VERSION) return 0;
+    if (m->tensor_count == 0 || m->tensor_count > STORE_MAX_TENSORS) return 0;
+    if (m->manifest_crc != manifest_crc(m)) return 0;
+    for (u32 i = 0; i < m->tensor_count; i++) {
+        const StoreTensor *t = &m->tensors[i];
+        if (t->offset < STORE_HEADER_SIZE || t->offset > STORE_SLOT_SIZE || t->size > STORE_SLOT_SIZE - t->offset) return 0;
+    }
+    return m->model_hash == store_model_hash(m);
+}
+
+static int slot_tensors_ok(int slot, const StoreManifest *m) {
+    const u8 *base = store_slot_base(slot);
+    for (u32 i = 0; i < m->tensor_count; i++) {
+        if (store_crc32(0, base + m->tensors[i].offset, m->tensors[i].size) != m->tensors[i].crc) {
+            xil_printf("Slot %d: tensor %d fails its checksum\n", slot, i);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int store_init(void) {
+    StoreManifest m[STORE_SLOTS];
+    int order[STORE_SLOTS] = { 0, 1 };
+
+    for (int slot = 0; slot < STORE_SLOTS; slot++) {
+        memcpy(&m[slot], slot_manifest(slot), sizeof(StoreManifest));
+    }
+    // Newest first; fall back to the other slot if its tensors are damaged.
+    if (manifest_ok(&m[1]) && (!manifest_ok(&m[0]) || m[1].generation > m[0].generation)) {
+        order[0] = 1;
+        order[1] = 0;
+    }
+    active_slot = -1;
+    for (int i = 0; i < STORE_SLOTS; i++) {
+        int slot = order[i];
+        if (!manifest_ok(&m[slot])) continue;
+        xil_printf("Slot %d: model %08X, generation %d, %d tensors; checking...\n",
+                   slot, m[slot].model_hash, m[slot].generation, m[slot].tensor_count);
+        if (slot_tensors_ok(slot, &m[slot])) {
+            active_slot = slot;
+            active = m[slot];
+            break;
+        }
+    }
+    staging = STORE_IDLE;
+    return active_slot;
+}
+
+int store_active_slot(void) {
+    return active_slot;
+}
+
+const StoreManifest *store_active_manifest(void) {
+    return active_slot < 0 ? NULL : &active;
+}
+
+// Picks the inactive slot and invalidates its manifest in DDR before it is overwritten.
+static void staging_start(int mode) {
+    staged_slot = active_slot < 0 ? 0 : 1 - active_slot;
+    StoreManifest *m = slot_manifest(staged_slot);
+    m->magic = 0;
+    acc_cache_to_device(&m->magic, sizeof(m->magic));
+    memset(&staged, 0, sizeof(staged));
+    staged_have = 0;
+    staged_unverified = 0;
+    legacy_next = STORE_HEADER_SIZE;
+    staging = mode;
+}
+
+int store_begin(u32 model_hash, u32 count, const u32 *sizes, const u32 *crcs, u32 *needed) {
+    if (staging == STORE_STAGING && staged.model_hash == model_hash && staged.tensor_count == count) {
+        *needed = tensor_mask(count) & ~staged_have;
+        return 0;
+    }
+    if (count == 0 || count > STORE_MAX_TENSORS) return -1;
+
+    u32 offset = STORE_HEADER_SIZE;
+    for (u32 i = 0; i < count; i++) {
+        if (sizes[i] > STORE_SLOT_SIZE - offset) {
+            staging = STORE_IDLE;
+            return -1;
+        }
+        offset = align_offset(offset + sizes[i]);
+    }
+
+    staging_start(STORE_STAGING);
+    staged.model_hash = model_hash;
+    staged.tensor_count = count;
+    offset = STORE_HEADER_SIZE;
+    for (u32 i = 0; i < count; i++) {
+        staged.tensors[i].offset = offset;
+        staged.tensors[i].size = sizes[i];
+        staged.tensors[i].crc = crcs[i];
+        offset = align_offset(offset + sizes[i]);
+    }
+
+    // Unchanged tensors come from the active slot, whose CRCs have been checked.
+    if (active_slot >= 0) {
+        const u8 *from = store_slot_base(active_slot);
+        u8 *to = store_slot_base(staged_slot);
+        for (u32 i = 0; i < count && i < active.tensor_count; i++) {
+            if (active.tensors[i].size == sizes[i] && active.tensors[i].crc == crcs[i]) {
+                memcpy(to + staged.tensors[i].offset, from + active.tensors[i].offset, sizes[i]);
+                staged_have |= 1u << i;
+            }
+        }
+    }
+    *needed = tensor_mask(count) & ~staged_have;
+    return 0;
+}
+
+void store_begin_legacy(void) {
+    staging_start(STORE_STAGING_LEGACY);
+}
+
+int store_staging(void) {
+    return staging;
+}
+
+u8 *store_tensor_dest(u32 id, u32 *capacity) {
+    if (id >= STORE_MAX_TENSORS) return NULL;
+    if (staging == STORE_STAGING) {
+        if (id >= staged.tensor_count) return NULL;
+        *capacity = staged.tensors[id].size;
+    } else if (staging == STORE_STAGING_LEGACY) {
+        if (legacy_next >= STORE_SLOT_SIZE) return NULL;
+        staged.tensors[id].offset = legacy_next;
+        staged.tensors[id].size = 0;
+        *capacity = STORE_SLOT_SIZE - legacy_next;
+    } else {
+        return NULL;
+    }
+    return store_slot_base(staged_slot) + staged.tensors[id].offset;
+}
+
+void store_tensor_received(u32 id, u32 size) {
+    if (id >= STORE_MAX_TENSORS) return;
+    if (staging == STORE_STAGING) {
+        if (id >= staged.tensor_count || size != staged.tensors[id].size) return;
+    } else if (staging == STORE_STAGING_LEGACY) {
+        staged.tensors[id].size = size;
+        legacy_next = align_offset(staged.tensors[id].offset + size);
+        if (id >= staged.tensor_count) staged.tensor_count = id + 1;
+    } else {
+        return;
+    }
+    staged_have |= 1u << id;
+    staged_unverified |= 1u << id;
+}
+
+u32 store_verify_staged(void) {
+    const u8 *base = store_slot_base(staged_slot);
+    if (staging == STORE_IDLE) return 0xFFFFFFFFu;
+    for (u32 i = 0; i < staged.tensor_count; i++) {
+        u32 bit = 1u << i;
+        if (!(staged_unverified & bit)) continue;
+        u32 crc = store_crc32(0, base + staged.tensors[i].offset, staged.tensors[i].size);
+        if (staging == STORE_STAGING_LEGACY) {
+            staged.tensors[i].crc = crc;
+        } else if (crc != staged.tensors[i].crc) {
+            xil_printf("Staged tensor %d fails its checksum\n", i);
+            staged_have &= ~bit;
+        }
+        staged_unverified &= ~bit;
+    }
+    if (staging == STORE_STAGING_LEGACY) staged.model_hash = store_model_hash(&staged);
+    return tensor_mask(staged.tensor_count) & ~staged_have;
+}
+
+int store_staged_slot(void) {
+    return staged_slot;
+}
+
+const StoreManifest *store_staged_manifest(void) {
+    return &staged;
+}
+
+void store_commit(void) {
+    staged.magic = STORE_MAGIC;
+    staged.version = STORE_VERSION;
+    staged.generation = (active_slot < 0 ? 0 : active.generation) + 1;
+    staged.manifest_crc = manifest_crc(&staged);
+
+    // The data cache writes lines back in any order, so each step is pushed
+    // to DDR before the next: the tensors, the manifest with magic still 0,
+    // then magic. A reset halfway leaves the slot invalid.
+    u8 *base = store_slot_base(staged_slot);
+    for (u32 i = 0; i < staged.tensor_count; i++) {
+        acc_cache_to_device(base + staged.tensors[i].offset, staged.tensors[i].size);
+    }
+    StoreManifest *m = slot_manifest(staged_slot);
+    memcpy((u8 *)m + sizeof(m->magic), (const u8 *)&staged + sizeof(staged.magic),
+           sizeof(staged) - sizeof(staged.magic));
+    acc_cache_to_device(m, sizeof(*m));
+    m->magic = STORE_MAGIC;
+    acc_cache_to_device(&m->magic, sizeof(m->magic));
+    active = staged;
+    active_slot = staged_slot;
+    staging = STORE_IDLE;
+}
+
+void store_abort(void) {
+    staging = STORE_IDLE;
+}
@@ -0,0 +1,148 @@
+#ifndef ACC_STORE_H
+#define ACC_STORE_H
+
+#include "acc_hal.h"
+
+/*
+ * acc_store.h
+ *   Model slots in DRAM.
+ *
+ *   The tensor region at DRAM_BASE_ADDR holds two slots of STORE_SLOT_SIZE.
+ *   Each slot starts with a StoreManifest (model hash, generation, and the
+ *   offset, size and CRC-32 of every tensor) followed by the tensors. The
+ *   model in use lives in the active slot; a new one is staged in the other
+ *   slot while the active one keeps serving, and store_commit() makes it the
+ *   active slot with a single manifest write. DRAM survives a MicroBlaze
+ *   reset, so store_init() finds the newest slot whose manifest and tensors
+ *   check out and the model does not have to be uploaded again.
+ *
+ *   CRCs are CRC-32 (IEEE, as zlib.crc32); the model hash is the CRC-32 of
+ *   tensor_count followed by the size and CRC of every tensor, all u32 little
+ *   endian, so the PC can compute both without talking to the board.
+ */
+
+#define STORE_MAX_TENSORS     32
+#define STORE_SLOTS           2
+#define STORE_SLOT_SIZE       ((DRAM_REGION_SIZE / STORE_SLOTS) & ~0xFFFu)
+#define STORE_HEADER_SIZE     512       // manifest; the first tensor follows
+#define STORE_ALIGN           32        // tensor offsets within a slot
+#define STORE_MAGIC           0x4C444F4Du  // "MODL"
+#define STORE_VERSION         1
+
+// Staging state (store_staging)
+#define STORE_IDLE            0
+#define STORE_STAGING         1   // store_begin(): sizes and CRCs known up front
+#define STORE_STAGING_LEGACY  2   // tensors arrive without a manifest, laid out in order
+
+typedef struct {
+    u32 offset;             // from the slot base
+    u32 size;
+    u32 crc;
+} StoreTensor;
+
+typedef struct {
+    u32 magic;              // STORE_MAGIC; written last
+    u32 version;            // STORE_VERSION
+    u32 generation;         // the valid slot with the highest generation is active
+    u32 model_hash;         // store_model_hash()
+    u32 tensor_count;
+    StoreTensor tensors[STORE_MAX_TENSORS];
+    u32 manifest_crc;       // CRC-32 of everything above
+} StoreManifest;
+
+/*
+ * store_crc32:
+ *   Continues a CRC-32 over 'length' bytes; start with crc = 0.
+ */
+u32 store_crc32(u32 crc, const u8 *data, u32 length);
+
+/*
+ * store_model_hash:
+ *   Hash of a model from the sizes and CRCs in its manifest.
+ */
+u32 store_model_hash(const StoreManifest *manifest);
+
+/*
+ * store_init:
+ *   Checks both slots and makes the newest valid one active. Returns its
+ *   index, or -1 if DRAM holds no usable model.
+ */
+int store_init(void);
+
+/*
+ * store_slot_base:
+ *   First byte of a slot; tensor offsets count from here.
+ */
+u8 *store_slot_base(int slot);
+
+/*
+ * store_active_slot / store_active_manifest:
+ *   The slot in use, or -1 / NULL before the first model.
+ */
+int store_active_slot(void);
+const StoreManifest *store_active_manifest(void);
+
+/*
+ * store_begin:
+ *   Starts staging a model of 'count' tensors with the given sizes and CRCs
+ *   into the inactive slot. Tensors the active model already holds with the
+ *   same size and CRC are copied over; the others are returned in *needed
+ *   (bit i for tensor i). Calling it again for the same hash keeps what has
+ *   been staged. Returns -1 if the model does not fit a slot.
+ */
+int store_begin(u32 model_hash, u32 count, const u32 *sizes, const u32 *crcs, u32 *needed);
+
+/*
+ * store_begin_legacy:
+ *   Starts staging a model whose tensors arrive without a manifest.
+ */
+void store_begin_legacy(void);
+
+/*
+ * store_staging:
+ *   STORE_IDLE, STORE_STAGING or STORE_STAGING_LEGACY.
+ */
+int store_staging(void);
+
+/*
+ * store_tensor_dest:
+ *   Where tensor 'id' of the staged model goes and how many bytes fit there;
+ *   NULL if the staged model has no such tensor.
+ */
+u8 *store_tensor_dest(u32 id, u32 *capacity);
+
+/*
+ * store_tensor_received:
+ *   Records that tensor 'id' (of 'size' bytes) is in place.
+ */
+void store_tensor_received(u32 id, u32 size);
+
+/*
+ * store_verify_staged:
+ *   Checks the CRC of every received tensor and completes the staged
+ *   manifest (a legacy model gets its CRCs and hash here). Returns the mask
+ *   of tensors that are missing or damaged, 0 when the model is complete.
+ */
+u32 store_verify_staged(void);
+
+/*
+ * store_staged_slot / store_staged_manifest:
+ *   The slot being staged and its manifest so far.
+ */
+int store_staged_slot(void);
+const StoreManifest *store_staged_manifest(void);
+
+/*
+ * store_commit:
+ *   Writes the staged manifest; the staged slot becomes the active one.
+ *   Only after store_verify_staged() returned 0.
+ */
+void store_commit(void);
+
+/*
+ * store_abort:
+ *   Drops the staged model; the active slot is untouched.
+ */
+void store_abort(void);
+
+#endif
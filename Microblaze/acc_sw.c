@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include "acc_sw.h"
+#include "acc_quant.h"
+
+/*
+ * sw_dot_i8:
+ *   int8 x int8 dot product with int32 accumulation. Kept branch-free over
+ *   contiguous memory so the compiler can turn it into widening SIMD MACs.
+ */
+static int32_t sw_dot_i8(const int8_t *restrict a, const int8_t *restrict b, int n) {
+    int32_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += (int32_t)a[i] * (int32_t)b[i];
+    }
+    return sum;
+}
+
+void sw_pack_filters(const int8_t *filters, int num_filters, int in_c, int8_t *packed) {
+    int filter_size = 9 * in_c;
+    for (int f = 0; f < num_filters; f++) {
+        for (int c = 0; c < in_c; c++) {
+            for (int k = 0; k < 9; k++) {
+                packed[f * filter_size + k * in_c + c] = filters[f * filter_size + c * 9 + k];
+            }
+        }
+    }
+}
+
+void sw_conv3x3_row(const int8_t *row0, const int8_t *row1, const int8_t *row2, int in_c,
+                    const int8_t *packed_filters, const int32_t *biases, int num_filters,
+                    const RequantTable *requant, int out_w, int8_t *output) {
+    int filter_size = 9 * in_c;
+    // One kernel row covers three adjacent pixels, i.e. 3 * in_c contiguous bytes
+    // in both the HWC input and the packed [F][3][3][C] filter.
+    int row_len = 3 * in_c;
+
+    for (int ow = 0; ow < out_w; ow++) {
+        const int8_t *p0 = &row0[ow * in_c];
+        const int8_t *p1 = &row1[ow * in_c];
+        const int8_t *p2 = &row2[ow * in_c];
+        int8_t *out = &output[ow * num_filters];
+
+        for (int f = 0; f < num_filters; f++) {
+            const int8_t *w = &packed_filters[f * filter_size];
+            int32_t acc = sw_dot_i8(p0, w, row_len)
+                        + sw_dot_i8(p1, w + row_len, row_len)
+                        + sw_dot_i8(p2, w + 2 * row_len, row_len);
+            out[f] = requantize(acc + biases[f], requant, f);
+        }
+    }
+}
+
+void sw_maxpool2x2(const int8_t *input, int in_h, int in_w, int channels, int8_t *output) {
+    int out_h = in_h / 2;
+    int out_w = in_w / 2;
+    for (int h = 0; h < out_h; h++) {
+        for (int w = 0; w < out_w; w++) {
+            const int8_t *p00 = &input[((2 * h) * in_w + 2 * w) * channels];
+            const int8_t *p01 = p00 + channels;
+            const int8_t *p10 = p00 + in_w * channels;
+            const int8_t *p11 = p10 + channels;
+            int8_t *out = &output[(h * out_w + w) * channels];
+            for (int ch = 0; ch < channels; ch++) {
+                int8_t m0 = p00[ch] > p01[ch] ? p00[ch] : p01[ch];
+                int8_t m1 = p10[ch] > p11[ch] ? p10[ch] : p11[ch];
+                out[ch] = m0 > m1 ? m0 : m1;
+            }
+        }
+    }
+}
+
+void sw_fc(const int8_t *input, int input_length,
+           const int8_t *weights, const int32_t *biases, int num_outputs,
+           const RequantTable *requant, int8_t *output) {
+    for (int m = 0; m < num_outputs; m++) {
+        int32_t acc = sw_dot_i8(input, &weights[m * input_length], input_length);
+        output[m] = requantize(acc + biases[m], requant, m);
+    }
+}
+
+void sw_fc_block_sparse(const int8_t *input, const BlockSparseMatrix *weights,
+                        const int32_t *biases, const RequantTable *requant, int8_t *output) {
+    int block = weights->block_elems;
+    for (int m = 0; m < weights->rows; m++) {
+        const int8_t *w = &weights->blocks[(size_t)weights->row_start[m] * block];
+        int32_t acc = 0;
+        for (int b = 0; b < weights->blocks_per_row; b++) {
+            if (!block_sparse_has(weights, m, b)) continue;
+            int len = weights->cols - b * block;
+            acc += sw_dot_i8(&input[b * block], w, len < block ? len : block);
+            w += block;
+        }
+        output[m] = requantize(acc + biases[m], requant, m);
+    }
+}
+
+void sw_fc_batch(const int8_t *inputs, int batch, int input_length,
+                 const int8_t *weights, const int32_t *biases, int num_outputs,
+                 const RequantTable *requant, int8_t *outputs) {
+    for (int b0 = 0; b0 < batch; b0 += SW_FC_MAX_BATCH) {
+        int n = (batch - b0 < SW_FC_MAX_BATCH) ? batch - b0 : SW_FC_MAX_BATCH;
+        const int8_t *x = &inputs[(size_t)b0 * input_length];
+        for (int m = 0; m < num_outputs; m++) {
+            const int8_t *w = &weights[(size_t)m * input_length];
+            int32_t acc[SW_FC_MAX_BATCH] = {0};
+            for (int k = 0; k < input_length; k += SW_FC_TILE) {
+                int len = (input_length - k < SW_FC_TILE) ? input_length - k : SW_FC_TILE;
+                for (int b = 0; b < n; b++) {
+                    acc[b] += sw_dot_i8(&x[(size_t)b * input_length + k], &w[k], len);
+                }
+            }
+            for (int b = 0; b < n; b++) {
+                outputs[(size_t)(b0 + b) * num_outputs + m] = requantize(acc[b] + biases[m], requant, m);
+            }
+        }
+    }
+}
+
+void sw_fc_block_sparse_batch(const int8_t *inputs, int batch, const BlockSparseMatrix *weights,
+                              const int32_t *biases, const RequantTable *requant, int8_t *outputs) {
+    int block = weights->block_elems;
+    int cols = weights->cols;
+    for (int b0 = 0; b0 < batch; b0 += SW_FC_MAX_BATCH) {
+        int n = (batch - b0 < SW_FC_MAX_BATCH) ? batch - b0 : SW_FC_MAX_BATCH;
+        const int8_t *x = &inputs[(size_t)b0 * cols];
+        for (int m = 0; m < weights->rows; m++) {
+            const int8_t *w = &weights->blocks[(size_t)weights->row_start[m] * block];
+            int32_t acc[SW_FC_MAX_BATCH] = {0};
+            for (int k = 0; k < weights->blocks_per_row; k++) {
+                if (!block_sparse_has(weights, m, k)) continue;
+                int len = cols - k * block;
+                if (len > block) len = block;
+                for (int b = 0; b < n; b++) {
+                    acc[b] += sw_dot_i8(&x[(size_t)b * cols + k * block], w, len);
+                }
+                w += block;
+            }
+            for (int b = 0; b < n; b++) {
+                outputs[(size_t)(b0 + b) * weights->rows + m] = requantize(acc[b] + biases[m], requant, m);
+            }
+        }
+    }
+}
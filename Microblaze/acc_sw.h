@@ -0,0 +1,104 @@
+#ifndef ACC_SW_H
+#define ACC_SW_H
+
+#include <stdint.h>
+#include "acc_quant.h"
+
+/*
+ * acc_sw.h
+ *   Pure software int8 backend for the keyword CNN.
+ *
+ *   Every kernel accumulates in int32 and requantizes through requantize()
+ *   (acc_quant.h), so its outputs are bit-identical to the accelerator path in
+ *   ACC.c. Activations are HWC with channels innermost, conv filters are
+ *   indexed [F][C][3][3] exactly like conv2_row_with_accelerator_parallel, and
+ *   FC weights are [outputs][inputs]. Multi-channel filters are repacked once
+ *   per conv stack (sw_pack_filters) so the inner loops are contiguous int8
+ *   dot products that GCC/Clang vectorize at -O3.
+ */
+
+#define SPARSE_BLOCK_MAX    36      // longest supported block, four 9-byte PE ops
+#define SW_FC_MAX_BATCH     8       // inputs sharing one walk over a weight row (sw_fc_batch)
+#define SW_FC_TILE          4096    // weight bytes they share while cached
+
+/*
+ * BlockSparseMatrix:
+ *   rows x cols int8 matrix (model dtype 10) cut into row blocks of
+ *   block_elems bytes, a multiple of 9. Bit r * blocks_per_row + b of bitmap
+ *   (LSB first) is set when block b of row r is stored; stored blocks follow
+ *   in row-major order, the last block of a row zero padded to block_elems.
+ *   row_start[r] is the index of row r's first stored block.
+ */
+typedef struct {
+    int rows;
+    int cols;
+    int block_elems;
+    int blocks_per_row;
+    const uint8_t *bitmap;
+    const int8_t *blocks;
+    const uint32_t *row_start;      // rows + 1 entries
+} BlockSparseMatrix;
+
+static inline int block_sparse_has(const BlockSparseMatrix *w, int row, int block) {
+    unsigned int bit = (unsigned int)row * w->blocks_per_row + block;
+    return (w->bitmap[bit >> 3] >> (bit & 7)) & 1;
+}
+
+/*
+ * sw_pack_filters:
+ *   Reorders [F][C][3][3] filters into the [F][3][3][C] layout expected by
+ *   sw_conv3x3_row (num_filters * 9 * in_c bytes at packed).
+ */
+void sw_pack_filters(const int8_t *filters, int num_filters, int in_c, int8_t *packed);
+
+/*
+ * sw_conv3x3_row:
+ *   One output row of a valid 3x3 convolution from three consecutive HWC
+ *   input rows, which may live anywhere (e.g. a row ring buffer). Filters must
+ *   already be packed; single-channel filters need no packing. Writes the
+ *   first out_w pixels x num_filters.
+ */
+void sw_conv3x3_row(const int8_t *row0, const int8_t *row1, const int8_t *row2, int in_c,
+                    const int8_t *packed_filters, const int32_t *biases, int num_filters,
+                    const RequantTable *requant, int out_w, int8_t *output);
+
+/*
+ * sw_maxpool2x2:
+ *   2x2 max pooling with stride 2 over an HWC tensor.
+ */
+void sw_maxpool2x2(const int8_t *input, int in_h, int in_w, int channels, int8_t *output);
+
+/*
+ * sw_fc:
+ *   Fully connected layer with a single (per-tensor) requant entry.
+ */
+void sw_fc(const int8_t *input, int input_length,
+           const int8_t *weights, const int32_t *biases, int num_outputs,
+           const RequantTable *requant, int8_t *output);
+
+/*
+ * sw_fc_block_sparse:
+ *   sw_fc on block-sparse weights; blocks that are not stored are skipped.
+ */
+void sw_fc_block_sparse(const int8_t *input, const BlockSparseMatrix *weights,
+                        const int32_t *biases, const RequantTable *requant, int8_t *output);
+
+/*
+ * sw_fc_batch:
+ *   sw_fc for 'batch' inputs of input_length bytes back to back; outputs are
+ *   batch vectors of num_outputs back to back. Each weight row is walked once
+ *   per SW_FC_MAX_BATCH inputs, in SW_FC_TILE pieces that every input uses
+ *   while the piece is still in the data cache.
+ */
+void sw_fc_batch(const int8_t *inputs, int batch, int input_length,
+                 const int8_t *weights, const int32_t *biases, int num_outputs,
+                 const RequantTable *requant, int8_t *outputs);
+
+/*
+ * sw_fc_block_sparse_batch:
+ *   sw_fc_batch on block-sparse weights; inputs are weights->cols bytes apart.
+ */
+void sw_fc_block_sparse_batch(const int8_t *inputs, int batch, const BlockSparseMatrix *weights,
+                              const int32_t *biases, const RequantTable *requant, int8_t *outputs);
+
+#endif
@@ -0,0 +1,78 @@
+#include "acc_vad.h"
+#include "acc_perf.h"
+
+// Defaults for the PC's quantization (zero point 128, 1/128 per unit of the
+// normalized log magnitude): rows 5 .. 52 are about 300 Hz .. 3.4 kHz, and
+// digital silence sits near 131.
+static VadConfig config = {
+    VAD_CONFIG_VERSION,
+    1,              // enabled
+    5, 52,          // speech band
+    144,            // energy_threshold
+    24,             // contrast_threshold
+    6,              // min_voiced_columns, about 50 ms
+    1               // hangover
+};
+static VadStats stats;
+static u32 hangover_left = 0;
+
+int vad_configure(const VadConfig *c, int height) {
+    if (c->version != VAD_CONFIG_VERSION || c->band_lo > c->band_hi || c->band_hi >= (u32)height) return -1;
+    config = *c;
+    hangover_left = 0;
+    return 0;
+}
+
+const VadConfig *vad_config(void) {
+    return &config;
+}
+
+const VadStats *vad_stats(void) {
+    return &stats;
+}
+
+int vad_check(const u8 *spectrogram, int height, int width) {
+    u32 start = perf_now();
+    u32 rows = config.band_hi - config.band_lo + 1;
+    u32 sums[VAD_MAX_COLUMNS];
+    int stride = width;
+    if (width > VAD_MAX_COLUMNS) width = VAD_MAX_COLUMNS;
+
+    // Column sums over the band, row by row so the reads stay sequential.
+    for (int w = 0; w < width; w++) sums[w] = 0;
+    for (u32 h = config.band_lo; h <= config.band_hi && h < (u32)height; h++) {
+        const u8 *row = &spectrogram[h * stride];
+        for (int w = 0; w < width; w++) sums[w] += row[w];
+    }
+    u32 peak = 0, floor = ~0u;
+    for (int w = 0; w < width; w++) {
+        if (sums[w] > peak) peak = sums[w];
+        if (sums[w] < floor) floor = sums[w];
+    }
+    u32 voiced_columns = 0;
+    u32 voiced_sum = floor + config.contrast_threshold * rows;
+    for (int w = 0; w < width; w++) {
+        if (sums[w] >= voiced_sum) voiced_columns++;
+    }
+
+    int decision;
+    if (!config.enabled ||
+        (peak >= config.energy_threshold * rows && voiced_columns >= config.min_voiced_columns)) {
+        decision = VAD_VOICED;
+        hangover_left = config.hangover;
+        stats.voiced++;
+    } else if (hangover_left > 0) {
+        decision = VAD_HANGOVER;
+        hangover_left--;
+        stats.hangover++;
+    } else {
+        decision = VAD_SILENT;
+        stats.silent++;
+    }
+    stats.clips++;
+    stats.peak = peak / rows;
+    stats.floor = floor / rows;
+    stats.voiced_columns = voiced_columns;
+    stats.ticks = perf_now() - start;
+    return decision;
+}
@@ -0,0 +1,77 @@
+#ifndef ACC_VAD_H
+#define ACC_VAD_H
+
+#include "acc_hal.h"
+
+/*
+ * acc_vad.h
+ *   Energy-based voice activity gate in front of the CNN.
+ *
+ *   Works on the quantized spectrogram as the PC sends it (HWC, rows are
+ *   frequency, columns time, one byte each: the normalized log magnitude
+ *   around its zero point). The level of a column is the mean of the rows
+ *   band_lo .. band_hi, the speech band; the floor of a clip is its quietest
+ *   column. A clip is voiced when its loudest column reaches
+ *   energy_threshold and at least min_voiced_columns columns are
+ *   contrast_threshold or more above the floor: silence fails the first
+ *   test, steady noise the second. After a voiced clip the next 'hangover'
+ *   clips pass whatever their levels, so the tail of a word is not cut off.
+ *   One pass over the band, no multiplications: tens of microseconds where
+ *   the network takes seconds.
+ *
+ *   Thresholds are in spectrogram units (bytes). They are set at run time
+ *   (vad_configure, VAD_ETHER_TYPE in ACC.c) so they can be tuned on the
+ *   board against the counters in VadStats.
+ */
+
+#define VAD_CONFIG_VERSION  1
+#define VAD_MAX_COLUMNS     256     // widest spectrogram vad_check measures
+
+// Decisions, as returned by vad_check and logged with LOG_EV_VAD
+#define VAD_SILENT          0       // rejected, no inference
+#define VAD_VOICED          1
+#define VAD_HANGOVER        2       // not voiced, passed within the hangover
+
+// Sent and received as the payload of a VAD_ETHER_TYPE frame, little endian.
+typedef struct {
+    u32 version;                    // VAD_CONFIG_VERSION
+    u32 enabled;                    // 0: every clip passes (still measured)
+    u32 band_lo;                    // first and last row of the speech band
+    u32 band_hi;
+    u32 energy_threshold;           // band level the loudest column must reach
+    u32 contrast_threshold;         // above the floor for a column to count as voiced
+    u32 min_voiced_columns;
+    u32 hangover;                   // clips passed after a voiced one
+} VadConfig;
+
+typedef struct {
+    u32 clips;                      // clips checked since boot
+    u32 voiced;
+    u32 hangover;                   // passed within the hangover
+    u32 silent;                     // rejected
+    u32 peak;                       // last clip: loudest and quietest column level
+    u32 floor;
+    u32 voiced_columns;
+    u32 ticks;                      // last clip: time the check took (perf_now ticks)
+} VadStats;
+
+/*
+ * vad_configure:
+ *   Replaces the configuration. Returns -1 and keeps the old one if the
+ *   version is wrong or the band is empty or outside 'height' rows.
+ */
+int vad_configure(const VadConfig *config, int height);
+
+const VadConfig *vad_config(void);
+const VadStats *vad_stats(void);
+
+/*
+ * vad_check:
+ *   Measures a height x width spectrogram (columns past VAD_MAX_COLUMNS
+ *   are ignored), updates the stats and returns
+ *   VAD_SILENT, VAD_VOICED or VAD_HANGOVER. With the gate disabled every
+ *   clip comes back VAD_VOICED.
+ */
+int vad_check(const u8 *spectrogram, int height, int width);
+
+#endif
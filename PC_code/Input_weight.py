@@ -6,7 +6,12 @@ import cv2
 import os
 import time
 import struct
-from scapy.all import Ether, sendp, sniff
+import queue
+import zlib
+import wave
+from scapy.all import Ether, AsyncSniffer, conf
+import frontend
+from block_sparse import BLOCK_SPARSE_DTYPE, SPARSE_BLOCK_ELEMS, encode_block_sparse
 
 RATE = 16000
 FRAME_LEN = 255
@@ -18,20 +23,76 @@ NORM_STD = 9.5
 INPUT_SCALE = 0.0078125
 INPUT_ZERO_POINT = 128
 
-interface = "\\Device\\NPF_{FB02CD7F-5E2D-4937-9D17-ADF4E6CA12C5}"
+# ACC_PC_IFACE overrides the adapter, e.g. one end of a veth pair to acc_host
+interface = os.environ.get("ACC_PC_IFACE", "\\Device\\NPF_{FB02CD7F-5E2D-4937-9D17-ADF4E6CA12C5}")
 dest_mac = "02:AA:BB:CC:DD:EE"
 src_mac = "9C:EB:E8:AE:7E:F5"
 ethertype = 0x88B5
 request_type = 0x88B6
 ACK_ETHER_TYPE = 0x88B7
+PERF_ETHER_TYPE = 0x88B8
+MODEL_ETHER_TYPE = 0x88B9
+BATCH_ETHER_TYPE = 0x88BB
+VAD_ETHER_TYPE = 0x88BC
 
 FRAGMENT_SIZE = 1400
 FRAGMENT_HEADER_FORMAT_FIRST = "<IIIII"
 FRAGMENT_HEADER_SIZE_FIRST = struct.calcsize(FRAGMENT_HEADER_FORMAT_FIRST)
 FRAGMENT_HEADER_FORMAT = "<IIII"
 FRAGMENT_HEADER_SIZE = struct.calcsize(FRAGMENT_HEADER_FORMAT)
-ACK_FORMAT = "<IIB3x"
-DELAY_BETWEEN_PACKETS = 0.005
+# AckPacket in ACC.c: tensor id, first missing fragment, status, bitmap of the
+# 32 fragments after it
+ACK_FORMAT = "<IIB3xI"
+ACK_SIZE = struct.calcsize(ACK_FORMAT)
+ACK_STATUS_ACK = 1
+# PerfReport in Microblaze/acc_perf.h: version, inference, class, probability,
+# timer_hz, 7 stage tick counts, 8 accelerator counters
+PERF_FORMAT = "<5I7I8I"
+PERF_STAGES = ("load", "conv1", "conv2", "maxpool", "fc1", "fc2", "softmax")
+PERF_COUNTERS = ("cycles", "busy", "idle", "ops", "gemv beats", "axi stall", "bytes read", "bytes written")
+PERF_TIMEOUT = 60
+WINDOW_FRAGMENTS = 16          # fragments in flight per tensor
+RETRANSMIT_TIMEOUT = 0.2       # seconds, doubled on every retry of a fragment
+MAX_RETRANSMITS = 10
+
+# Streaming (stream_keywords): spectrogram columns of new STFT frames only
+STREAM_TENSOR_ID = 98
+STREAM_COLUMNS = 4             # frames per update, even, at most 10 (8 ms each)
+STREAM_DETECT_PERCENT = 90     # same threshold as the FPGA
+CLASS_LABELS = ("down", "go", "left", "no", "right", "stop", "up", "yes")
+
+# Batches (label_spectrograms): clips classified together, FC weights read once
+BATCH_TENSOR_ID = 97
+BATCH_MAX_CLIPS = 4            # ACC.c BATCH_MAX_CLIPS
+BATCH_TIMEOUT = 120            # seconds for a whole batch to be classified
+
+# Voice activity gate (acc_vad.h): a rejected utterance is reported as this class at 0%
+SILENCE_CLASS = 8
+VAD_CONFIG_VERSION = 1
+# VadConfig, then VadStats; the reply starts with a u32 status (0 ok, 1 rejected)
+VAD_CONFIG_FIELDS = ("version", "enabled", "band_lo", "band_hi", "energy_threshold",
+                     "contrast_threshold", "min_voiced_columns", "hangover")
+VAD_STATS_FIELDS = ("clips", "voiced", "hangover", "silent", "peak", "floor", "voiced_columns", "ticks")
+VAD_REPLY_TIMEOUT = 2
+
+# Model slot control (process_model_control in ACC.c, acc_store.h)
+MODEL_OP_QUERY = 1
+MODEL_OP_BEGIN = 2
+MODEL_OP_COMMIT = 3
+MODEL_STATUS_OK = 0
+MODEL_STATUS_MISSING = 2
+# ModelReply: op, status, active slot, generation, model hash, tensor mask,
+# tensor count, then (size, CRC) per tensor of the active model
+MODEL_REPLY_FORMAT = "<7I"
+MODEL_REPLY_SIZE = struct.calcsize(MODEL_REPLY_FORMAT)
+MODEL_REPLY_TIMEOUT = 2
+MODEL_COMMIT_TIMEOUT = 20      # the FPGA checks every received tensor first
+MODEL_REQUEST_TRIES = 5
+MODEL_COMMIT_TRIES = 3
+
+# Block-sparse weight encoding (block_sparse.py), read by parse_block_sparse in ACC.c
+INT8_DTYPE = 9
+SPARSE_TENSOR_IDS = (11, 14)      # FC1 and FC2 weights
 
 def plot_waveform(audio_data):
     plt.figure(figsize=(10, 4))
@@ -87,108 +148,397 @@ def preprocess_for_fpga(waveform):
     quantized = np.clip(resized / INPUT_SCALE + INPUT_ZERO_POINT, 0, 255).astype(np.uint8)
     return quantized, resized
 
+def record_spectrogram(duration=1):
+    """Records an utterance and returns what preprocess_for_fpga would. With
+       the native frontend (frontend.c) built, columns are computed while the
+       audio comes in and the spectrogram is ready right after the last
+       sample; otherwise the whole recording goes through numpy and cv2."""
+    frames = (duration * RATE - FRAME_LEN) // FRAME_STEP + 1
+    fe = frontend.create(frames, TARGET_SHAPE[1], NORM_MEAN, NORM_STD, INPUT_SCALE, INPUT_ZERO_POINT)
+    if fe is None:
+        return preprocess_for_fpga(record_audio(duration))
+    audio = pyaudio.PyAudio()
+    stream = audio.open(format=pyaudio.paInt16, channels=1, rate=RATE, input=True, frames_per_buffer=FRAME_STEP)
+    columns = []
+    count = 0
+    print("Start recording...")
+    while count < TARGET_SHAPE[1]:
+        data = stream.read(FRAME_STEP, exception_on_overflow=False)
+        ready = fe.push(np.frombuffer(data, dtype=np.int16))
+        columns.append(ready)
+        count += ready.shape[1]
+    print("Recording finished.")
+    stream.stop_stream()
+    stream.close()
+    audio.terminate()
+    quantized = np.concatenate(columns, axis=1)
+    return quantized, (quantized.astype(np.float32) - INPUT_ZERO_POINT) * INPUT_SCALE
+
+def spectrogram_column(frame):
+    """The quantized spectrogram column of one FRAME_LEN frame, low frequency
+       first, computed like preprocess_for_fpga except that the time axis is
+       not resampled: streaming sends one column per FRAME_STEP."""
+    mag = np.abs(np.fft.rfft(frame * get_window('hann', FRAME_LEN), n=FFT_LEN))
+    normalized = (np.log(mag + 1e-8) - NORM_MEAN) / NORM_STD
+    resized = cv2.resize(normalized.reshape(-1, 1), (1, TARGET_SHAPE[0]), interpolation=cv2.INTER_CUBIC)
+    return np.clip(resized[:, 0] / INPUT_SCALE + INPUT_ZERO_POINT, 0, 255).astype(np.uint8)
 
-def send_frame(payload):
-    """Creates and sends an Ethernet frame with the given payload,
-       then waits briefly."""
-    frame = Ether(dst=dest_mac, src=src_mac, type=ethertype) / payload
-    sendp(frame, iface=interface, verbose=True)
-    time.sleep(DELAY_BETWEEN_PACKETS)
-
-def wait_for_ack(tensor_id, fragment_index, timeout=1):
-    def ack_filter(pkt):
-        if pkt.haslayer(Ether) and pkt.type == ACK_ETHER_TYPE:
-            payload = bytes(pkt.payload)
-            # Expect at least 9 bytes: 4 for tensor_id, 4 for fragment_index, 1 for status.
-            if len(payload) >= 9:
-                ack_tensor_id, ack_frag_idx, status = struct.unpack("<IIB", payload[:9])
-                return (ack_tensor_id == tensor_id)
-        return False
 
-    pkts = sniff(iface=interface, timeout=timeout, lfilter=ack_filter, count=1)
-    if pkts:
-        payload = bytes(pkts[0].payload)
-        ack_tensor_id, ack_frag_idx, status = struct.unpack("<IIB", payload[:9])
-        if ack_frag_idx == fragment_index and status == 1:
-            return (True, fragment_index)
-        else:
-            print(f"Received NACK for tensor {tensor_id} fragment {fragment_index}. Receiver expects fragment {ack_frag_idx}.")
-            return (False, ack_frag_idx)
-    return (False, fragment_index)
+class FragmentLink:
+    """Raw Ethernet link to the FPGA: sends frames on one persistent socket
+       and collects ACKs, model control replies, requests and performance
+       reports in the background."""
+    def __init__(self, iface):
+        self.socket = conf.L2socket(iface=iface)
+        self.frames = {ACK_ETHER_TYPE: queue.Queue(), MODEL_ETHER_TYPE: queue.Queue(),
+                       request_type: queue.Queue(), PERF_ETHER_TYPE: queue.Queue(),
+                       BATCH_ETHER_TYPE: queue.Queue(), VAD_ETHER_TYPE: queue.Queue()}
+        self.sniffer = AsyncSniffer(iface=iface, store=False,
+                                    lfilter=lambda pkt: pkt.haslayer(Ether) and pkt[Ether].type in self.frames,
+                                    prn=lambda pkt: self.frames[pkt[Ether].type].put(bytes(pkt[Ether].payload)))
+        self.sniffer.start()
+
+    def send(self, payload, type=ethertype):
+        self.socket.send(Ether(dst=dest_mac, src=src_mac, type=type) / payload)
 
-def send_tensor_fragments(tensor_id, tensor_payload):
+    def next_frame(self, type, timeout):
+        try:
+            return self.frames[type].get(timeout=max(timeout, 0))
+        except queue.Empty:
+            return None
+
+    def next_ack(self, timeout):
+        """Returns (tensor_id, next_missing, status, selective), or None."""
+        payload = self.next_frame(ACK_ETHER_TYPE, timeout)
+        if payload is None or len(payload) < ACK_SIZE:
+            return None
+        return struct.unpack(ACK_FORMAT, payload[:ACK_SIZE])
+
+    def drain(self, type=ACK_ETHER_TYPE):
+        while not self.frames[type].empty():
+            self.frames[type].get_nowait()
+
+_link = None
+
+def get_link():
+    global _link
+    if _link is None:
+        _link = FragmentLink(interface)
+    return _link
+
+def build_fragments(tensor_id, tensor_payload):
+    """Splits a tensor into data frame payloads. Every fragment but the last
+       is FRAGMENT_SIZE bytes, which is what lets the FPGA place fragment i
+       before the ones ahead of it have arrived."""
     total_length = len(tensor_payload)
-    
-    # Compute available payload sizes:
-    # For the first fragment:
     max_payload_first = FRAGMENT_SIZE - FRAGMENT_HEADER_SIZE_FIRST
-    # For subsequent fragments:
     max_payload_normal = FRAGMENT_SIZE - FRAGMENT_HEADER_SIZE
-
-    # Calculate total number of fragments based on actual data length.
     if total_length <= max_payload_first:
         total_fragments = 1
     else:
         remaining = total_length - max_payload_first
         total_fragments = 1 + (remaining + max_payload_normal - 1) // max_payload_normal
 
-    current_frag = 0
-    while current_frag < total_fragments:
-        if current_frag == 0:
+    fragments = []
+    for index in range(total_fragments):
+        if index == 0:
             data = tensor_payload[:max_payload_first]
-            header = struct.pack(
-                FRAGMENT_HEADER_FORMAT_FIRST,
-                tensor_id,         # Tensor ID.
-                0,                 # Fragment index 0.
-                total_fragments,   # Total fragments.
-                total_length,      # Overall tensor size.
-                len(data)          # Actual payload length in this fragment.
-            )
-        else:
-            start = max_payload_first + (current_frag - 1) * max_payload_normal
-            end = min(start + max_payload_normal, total_length)
-            data = tensor_payload[start:end]
-            header = struct.pack(
-                FRAGMENT_HEADER_FORMAT,
-                tensor_id,
-                current_frag,
-                total_fragments,
-                len(data)          # Actual payload length in this fragment.
-            )
-        full_payload = header + data
-
-        # Send the fragment first.
-        send_frame(full_payload)
-        print(f"Sent fragment {current_frag+1}/{total_fragments} for tensor {tensor_id}.")
-        
-        # Now wait for ACK for the current fragment.
-        ack_received, new_frag = wait_for_ack(tensor_id, current_frag)
-        if ack_received:
-            print(f"ACK received for tensor {tensor_id} fragment {current_frag}.")
-            current_frag += 1  # Move to next fragment.
+            header = struct.pack(FRAGMENT_HEADER_FORMAT_FIRST, tensor_id, 0, total_fragments, total_length, len(data))
         else:
-            # If the receiver indicates a different fragment is expected, update current_frag.
-            if new_frag != current_frag:
-                print(f"Receiver expects fragment {new_frag} for tensor {tensor_id}. Resending that fragment.")
-                current_frag = new_frag
-            else:
-                print(f"No ACK for tensor {tensor_id} fragment {current_frag}. Resending...")
-            # The while loop will repeat and resend the current fragment.
+            start = max_payload_first + (index - 1) * max_payload_normal
+            data = tensor_payload[start:start + max_payload_normal]
+            header = struct.pack(FRAGMENT_HEADER_FORMAT, tensor_id, index, total_fragments, len(data))
+        fragments.append(header + data)
+    return fragments
+
+def send_tensor_fragments(tensor_id, tensor_payload, window=WINDOW_FRAGMENTS, verbose=True):
+    """Sends one tensor with up to 'window' fragments in flight. The FPGA ACKs
+       the first fragment it is missing plus a bitmap of the 32 after it; a
+       hole reported behind received fragments is resent at once, anything
+       else unacknowledged after the retransmit timeout (doubling per try)."""
+    link = get_link()
+    link.drain()
+    fragments = build_fragments(tensor_id, tensor_payload)
+    total_fragments = len(fragments)
+    acked = [False] * total_fragments
+    sent_at = [0.0] * total_fragments
+    tries = [0] * total_fragments
+    base = 0          # every fragment below is acknowledged
+    next_new = 0      # first fragment never sent
+    resent = 0
+
+    def transmit(index):
+        link.send(fragments[index])
+        sent_at[index] = time.monotonic()
+        tries[index] += 1
+
+    while base < total_fragments:
+        while next_new < min(base + window, total_fragments):
+            transmit(next_new)
+            next_new += 1
+
+        now = time.monotonic()
+        deadline = min(sent_at[i] + RETRANSMIT_TIMEOUT * 2 ** (tries[i] - 1)
+                       for i in range(base, next_new) if not acked[i])
+        ack = link.next_ack(deadline - now)
+        if ack is not None and ack[0] == tensor_id:
+            _, next_missing, status, selective = ack
+            if status != ACK_STATUS_ACK:
+                raise RuntimeError(f"FPGA rejected tensor {tensor_id} at fragment {next_missing}")
+            for i in range(base, min(next_missing, total_fragments)):
+                acked[i] = True
+            highest = -1
+            for bit in range(32):
+                if selective >> bit & 1 and next_missing + 1 + bit < total_fragments:
+                    acked[next_missing + 1 + bit] = True
+                    highest = next_missing + 1 + bit
+            while base < total_fragments and acked[base]:
+                base += 1
+            # Holes behind a received fragment are lost, not late: resend once
+            # per retransmit timeout.
+            now = time.monotonic()
+            for i in range(base, highest):
+                if not acked[i] and now - sent_at[i] >= RETRANSMIT_TIMEOUT / 4:
+                    transmit(i)
+                    resent += 1
+
+        now = time.monotonic()
+        for i in range(base, next_new):
+            if not acked[i] and now - sent_at[i] >= RETRANSMIT_TIMEOUT * 2 ** (tries[i] - 1):
+                if tries[i] > MAX_RETRANSMITS:
+                    raise TimeoutError(f"No ACK for tensor {tensor_id} fragment {i} after {tries[i]} tries")
+                transmit(i)
+                resent += 1
+
+    if verbose or resent:
+        print(f"Sent tensor {tensor_id}: {total_fragments} fragments, {resent} resent.")
+
+def wait_for_perf_report(timeout=PERF_TIMEOUT):
+    """Waits for the report the FPGA sends after each inference and prints
+       where the time went. Returns the decoded fields, or None."""
+    payload = get_link().next_frame(PERF_ETHER_TYPE, timeout)
+    if payload is None:
+        print("No performance report received.")
+        return None
+    return print_perf_report(payload)
+
+def print_perf_report(payload):
+    if len(payload) < struct.calcsize(PERF_FORMAT):
+        print(f"Short performance report ({len(payload)} bytes).")
+        return None
+    fields = struct.unpack(PERF_FORMAT, payload[:struct.calcsize(PERF_FORMAT)])
+    version, inference, predicted_class, probability, timer_hz = fields[:5]
+    stages = dict(zip(PERF_STAGES, fields[5:12]))
+    counters = dict(zip(PERF_COUNTERS, fields[12:20]))
+    # Version 2 appends the number of clips a batch report covers.
+    clips = struct.unpack_from("<I", payload, struct.calcsize(PERF_FORMAT))[0] \
+        if version >= 2 and len(payload) >= struct.calcsize(PERF_FORMAT) + 4 else 1
+    batch = f" (batch of {clips})" if clips > 1 else ""
+    if predicted_class == SILENCE_CLASS:
+        print(f"Inference {inference}: silence, not classified")
+    else:
+        print(f"Inference {inference}: class {predicted_class} ({probability}%){batch}")
+    print("  stage times (ms): " + ", ".join(f"{k} {v * 1000.0 / timer_hz:.1f}" for k, v in stages.items()))
+    print("  accelerator: " + ", ".join(f"{k} {v}" for k, v in counters.items()))
+    if counters["cycles"]:
+        print(f"  accelerator busy {100.0 * counters['busy'] / counters['cycles']:.1f}% of its cycles, "
+              f"AXI stalled {100.0 * counters['axi stall'] / counters['cycles']:.1f}%")
+    return {"version": version, "inference": inference, "class": predicted_class,
+            "probability": probability, "timer_hz": timer_hz, "stages": stages, "counters": counters,
+            "clips": clips}
+
+def vad_control(**settings):
+    """Reads the FPGA's voice activity gate settings and counters, after
+       changing the VAD_CONFIG_FIELDS given, e.g. vad_control(energy_threshold=160)
+       or vad_control(enabled=0). Thresholds are in spectrogram bytes.
+       Returns (status, settings, counters), or None."""
+    link = get_link()
+    request = b""
+    if settings:
+        current = vad_control()
+        if current is None:
+            return None
+        config = dict(current[1], version=VAD_CONFIG_VERSION, **settings)
+        request = struct.pack("<8I", *(config[name] for name in VAD_CONFIG_FIELDS))
+    link.drain(VAD_ETHER_TYPE)
+    link.send(request or struct.pack("<I", 0), VAD_ETHER_TYPE)
+    payload = link.next_frame(VAD_ETHER_TYPE, VAD_REPLY_TIMEOUT)
+    if payload is None or len(payload) < 4 + 64:
+        print("No reply from the FPGA to the voice gate request.")
+        return None
+    fields = struct.unpack_from("<17I", payload)
+    status = fields[0]
+    config = dict(zip(VAD_CONFIG_FIELDS, fields[1:9]))
+    stats = dict(zip(VAD_STATS_FIELDS, fields[9:17]))
+    if status:
+        print(f"Voice gate settings {settings} rejected.")
+    print("Voice gate: " + ", ".join(f"{k} {v}" for k, v in config.items() if k != "version"))
+    print("  counters: " + ", ".join(f"{k} {v}" for k, v in stats.items()))
+    return status, config, stats
 
 def listen_for_fpga_request():
+    """Answers every button press with a recording. The FPGA holds a second
+       spectrogram while it classifies one, so a request may arrive before
+       the previous report; reports are printed as they come in."""
     print("Listening for FPGA button press requests...")
+    link = get_link()
+    while True:
+        while link.next_frame(request_type, 0.1) is None:
+            report = link.next_frame(PERF_ETHER_TYPE, 0)
+            if report is not None:
+                print_perf_report(report)
+        print("Received FPGA request. Starting recording...")
+        spectrogram, processed_spectrogram = record_spectrogram()
+        payload = spectrogram.flatten().tobytes()
+        tensor_id = 99  # Use a different ID for input audio than model weights
+        send_tensor_fragments(tensor_id, payload)
+        # Plotted once the FPGA has it: the plot window blocks.
+        plot_spectrogram(processed_spectrogram)
+
+def stream_keywords(columns=STREAM_COLUMNS):
+    """Continuous keyword spotting, no button: the microphone is read one
+       FRAME_STEP at a time and every 'columns' new STFT frames go out as a
+       streaming update (sequence number, column count, columns). The FPGA
+       slides its spectrogram window, recomputes only the new edge and
+       classifies after every update; a confident class is printed once
+       until it leaves the window. An update waits for the FPGA's ACK, so
+       audio recorded meanwhile may be dropped when it falls behind."""
+    link = get_link()
+    fe = frontend.create(0, 0, NORM_MEAN, NORM_STD, INPUT_SCALE, INPUT_ZERO_POINT)
+    audio = pyaudio.PyAudio()
+    stream = audio.open(format=pyaudio.paInt16, channels=1, rate=RATE, input=True, frames_per_buffer=FRAME_STEP)
+    samples = np.zeros(0, dtype=np.float32)
+    pending = []
+    sequence = 0
+    last_class, columns_since = None, 0
+    print(f"Streaming {columns} frames per update, Ctrl+C to stop...")
+    try:
+        while True:
+            data = stream.read(FRAME_STEP, exception_on_overflow=False)
+            if fe is not None:
+                pending.extend(fe.push(np.frombuffer(data, dtype=np.int16)).T)
+            else:
+                samples = np.concatenate((samples, np.frombuffer(data, dtype=np.int16) / 32768.0))
+                while len(samples) >= FRAME_LEN:
+                    pending.append(spectrogram_column(samples[:FRAME_LEN]))
+                    samples = samples[FRAME_STEP:]
+            if len(pending) >= columns:
+                payload = struct.pack("<II", sequence, columns) + np.concatenate(pending[:columns]).tobytes()
+                del pending[:columns]
+                send_tensor_fragments(STREAM_TENSOR_ID, payload, verbose=False)
+                sequence += 1
+                columns_since += columns
+            report = link.next_frame(PERF_ETHER_TYPE, 0)
+            while report is not None:
+                _, inference, predicted_class, probability = struct.unpack_from("<4I", report)
+                if probability >= STREAM_DETECT_PERCENT and (predicted_class != last_class or
+                                                             columns_since >= TARGET_SHAPE[1]):
+                    print(f"Detected '{CLASS_LABELS[predicted_class]}' ({probability}%) (inference {inference})")
+                    last_class, columns_since = predicted_class, 0
+                report = link.next_frame(PERF_ETHER_TYPE, 0)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        stream.stop_stream()
+        stream.close()
+        audio.terminate()
+
+_batch_id = int(time.time()) & 0xFFFFFFFF   # a new session does not reuse the ids of the last
+
+def label_spectrograms(spectrograms):
+    """Classifies up to BATCH_MAX_CLIPS quantized spectrograms in one batch:
+       each goes out as a clip (batch id, clip index, clip count,
+       spectrogram), the FPGA runs the conv layers per clip and FC1/FC2 once
+       for all of them, then answers with the class and probability of every
+       clip. Returns [(class, percent), ...] in clip order, or None."""
+    global _batch_id
+    if not 1 <= len(spectrograms) <= BATCH_MAX_CLIPS:
+        raise ValueError(f"a batch holds 1 to {BATCH_MAX_CLIPS} clips")
+    link = get_link()
+    link.drain(BATCH_ETHER_TYPE)
+    batch_id = _batch_id
+    _batch_id = (_batch_id + 1) & 0xFFFFFFFF
+    for index, spectrogram in enumerate(spectrograms):
+        header = struct.pack("<III", batch_id, index, len(spectrograms))
+        send_tensor_fragments(BATCH_TENSOR_ID, header + spectrogram.flatten().tobytes(), verbose=False)
+    deadline = time.time() + BATCH_TIMEOUT
     while True:
-        def packet_callback(packet):
-            if packet.haslayer(Ether) and packet[Ether].type == request_type:
-                print("Received FPGA request. Starting recording...")
-                audio_data = record_audio()
-                spectrogram, processed_spectrogram = preprocess_for_fpga(audio_data)
-                plot_spectrogram(processed_spectrogram)
-                payload = spectrogram.flatten().tobytes()
-                tensor_id = 99  # Use a different ID for input audio than model weights
-                send_tensor_fragments(tensor_id, payload)
-
-        sniff(iface=interface, prn=packet_callback, store=0, count=1)
+        payload = link.next_frame(BATCH_ETHER_TYPE, deadline - time.time())
+        if payload is None:
+            print(f"No result for batch {batch_id}.")
+            return None
+        result_id, clips = struct.unpack_from("<II", payload)
+        if result_id == batch_id and clips == len(spectrograms):
+            wait_for_perf_report()
+            return [struct.unpack_from("<II", payload, 8 + 8 * c) for c in range(clips)]
+
+def read_wav(path):
+    """A 16-bit mono RATE Hz recording as float samples, cut or zero padded
+       to the one second record_audio returns."""
+    total_samples = FRAME_LEN + (RATE - FRAME_LEN) // FRAME_STEP * FRAME_STEP
+    with wave.open(path, "rb") as w:
+        if w.getsampwidth() != 2 or w.getnchannels() != 1 or w.getframerate() != RATE:
+            raise ValueError(f"{path}: expected 16-bit mono {RATE} Hz")
+        samples = np.frombuffer(w.readframes(w.getnframes()), dtype=np.int16)
+    samples = np.pad(samples[:total_samples], (0, max(0, total_samples - len(samples))))
+    return samples.astype(np.float32) / 32768.0
+
+def label_recordings(paths):
+    """Labels WAV files (or every .wav in a directory) BATCH_MAX_CLIPS at a
+       time. Returns {path: (label, percent)}."""
+    if isinstance(paths, str) and os.path.isdir(paths):
+        paths = sorted(os.path.join(paths, name) for name in os.listdir(paths) if name.lower().endswith(".wav"))
+    labels = {}
+    for start in range(0, len(paths), BATCH_MAX_CLIPS):
+        group = paths[start:start + BATCH_MAX_CLIPS]
+        results = label_spectrograms([preprocess_for_fpga(read_wav(path))[0] for path in group])
+        if results is None:
+            continue
+        for path, (predicted_class, percent) in zip(group, results):
+            labels[path] = (CLASS_LABELS[predicted_class], percent)
+            print(f"{path}: {CLASS_LABELS[predicted_class]} ({percent}%)")
+    return labels
+
+def sparsify_model_binary(src_file, dst_file, tensor_ids=SPARSE_TENSOR_IDS, block_elems=SPARSE_BLOCK_ELEMS):
+    """Copies a tensor binary, re-encoding the listed 2-D int8 tensors as block
+       sparse wherever that is smaller (i.e. the model was pruned). Returns
+       dst_file."""
+    with open(src_file, "rb") as f:
+        data = f.read()
+    num_tensors = struct.unpack_from("<I", data, 0)[0]
+    out = [data[:4]]
+    pos = 4
+    for _ in range(num_tensors):
+        start = pos
+        tensor_id, num_dims = struct.unpack_from("<II", data, pos)
+        dims = struct.unpack_from("<%dI" % num_dims, data, pos + 8)
+        pos += 8 + 4 * num_dims
+        dtype_pos = pos
+        dtype = struct.unpack_from("<I", data, pos)[0]
+        num_scales = struct.unpack_from("<I", data, pos + 4)[0]
+        pos += 8 + 4 * num_scales
+        num_zero_points = struct.unpack_from("<I", data, pos)[0]
+        pos += 4 + 4 * num_zero_points
+        length_pos = pos
+        data_length = struct.unpack_from("<I", data, pos)[0]
+        pos += 4 + data_length
+
+        payload = None
+        if tensor_id in tensor_ids and dtype == INT8_DTYPE and num_dims == 2:
+            weights = np.frombuffer(data, dtype=np.int8, count=data_length, offset=length_pos + 4)
+            payload = encode_block_sparse(weights.reshape(dims), block_elems)
+        if payload is not None and len(payload) < data_length:
+            print(f"Tensor {tensor_id}: block sparse, {len(payload)} bytes instead of {data_length}.")
+            out.append(data[start:dtype_pos])
+            out.append(struct.pack("<I", BLOCK_SPARSE_DTYPE))
+            out.append(data[dtype_pos + 4:length_pos])
+            out.append(struct.pack("<I", len(payload)))
+            out.append(payload)
+        else:
+            out.append(data[start:pos])
+    with open(dst_file, "wb") as f:
+        f.write(b"".join(out))
+    return dst_file
 
 def send_tensors_from_binary(binary_file):
     """
@@ -244,29 +594,120 @@ def send_tensors_from_binary(binary_file):
             tensor_payload = f.read(tensor_size)
             f.seek(tensor_end)
 
-            if len(tensor_payload) <= FRAGMENT_SIZE - FRAGMENT_HEADER_SIZE_FIRST:
-                # Tensor fits in one frame.
-                header = struct.pack(
-                    FRAGMENT_HEADER_FORMAT_FIRST,
-                    tensor_id,
-                    0,
-                    1,  # Only one fragment.
-                    len(tensor_payload),  # Overall tensor size.
-                    len(tensor_payload)   # Actual payload length.
-                )
-                full_payload = header + tensor_payload
-                ack_received, new_frag = wait_for_ack(tensor_id, 0)
-                while not ack_received:
-                    send_frame(full_payload)
-                    print(f"Sent tensor {tensor_id} in one frame, size {len(tensor_payload)} bytes.")
-                    ack_received, new_frag = wait_for_ack(tensor_id, 0)
-                    if not ack_received:
-                        print(f"No ACK for tensor {tensor_id} (single frame). Resending...")
-            else:
-                send_tensor_fragments(tensor_id, tensor_payload)
+            send_tensor_fragments(tensor_id, tensor_payload)
             print(f"Finished sending tensor {tensor_id}.")
 
+def read_tensors_from_binary(binary_file):
+    """Returns [(tensor_id, tensor_payload)] in file order, each payload being
+       the tensor's block exactly as send_tensors_from_binary sends it."""
+    with open(binary_file, "rb") as f:
+        data = f.read()
+    num_tensors = struct.unpack_from("<I", data, 0)[0]
+    tensors = []
+    pos = 4
+    for _ in range(num_tensors):
+        start = pos
+        tensor_id, num_dims = struct.unpack_from("<II", data, pos)
+        pos += 8 + 4 * num_dims + 4
+        num_scales = struct.unpack_from("<I", data, pos)[0]
+        pos += 4 + 4 * num_scales
+        num_zero_points = struct.unpack_from("<I", data, pos)[0]
+        pos += 4 + 4 * num_zero_points
+        data_length = struct.unpack_from("<I", data, pos)[0]
+        pos += 4 + data_length
+        tensors.append((tensor_id, data[start:pos]))
+    return tensors
+
+def model_manifest(tensors):
+    """Sizes, CRC-32s and model hash as acc_store.h computes them."""
+    sizes = [len(payload) for _, payload in tensors]
+    crcs = [zlib.crc32(payload) for _, payload in tensors]
+    table = struct.pack("<I", len(tensors)) + b"".join(struct.pack("<II", s, c) for s, c in zip(sizes, crcs))
+    return sizes, crcs, zlib.crc32(table)
+
+def model_request(request, timeout=MODEL_REPLY_TIMEOUT):
+    """Sends a model control request until the FPGA answers it. Returns the
+       decoded ModelReply, or None."""
+    link = get_link()
+    op = struct.unpack_from("<I", request)[0]
+    for _ in range(MODEL_REQUEST_TRIES):
+        link.drain(MODEL_ETHER_TYPE)
+        link.send(request, MODEL_ETHER_TYPE)
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            payload = link.next_frame(MODEL_ETHER_TYPE, deadline - time.monotonic())
+            if payload is None or len(payload) < MODEL_REPLY_SIZE:
+                continue
+            fields = struct.unpack_from(MODEL_REPLY_FORMAT, payload)
+            if fields[0] != op:
+                continue
+            count = min(fields[6], (len(payload) - MODEL_REPLY_SIZE) // 8)
+            pairs = struct.unpack_from("<%dI" % (2 * count), payload, MODEL_REPLY_SIZE)
+            return {"status": fields[1], "slot": fields[2], "generation": fields[3],
+                    "model_hash": fields[4], "mask": fields[5],
+                    "sizes": pairs[0::2], "crcs": pairs[1::2]}
+    print(f"No reply from the FPGA to model request {op}.")
+    return None
+
+def upload_model(binary_file):
+    """Brings the FPGA to the model in binary_file with as little traffic as
+       possible: nothing if it already holds it (e.g. after a board reset),
+       otherwise only the tensors that differ from its current model. The new
+       model is staged in the spare DRAM slot while the current one keeps
+       serving and is switched to in one step. Returns True on success."""
+    tensors = read_tensors_from_binary(binary_file)
+    if [tensor_id for tensor_id, _ in tensors] != list(range(len(tensors))):
+        raise ValueError("tensor ids must run from 0 in file order")
+    sizes, crcs, model_hash = model_manifest(tensors)
+
+    status = model_request(struct.pack("<I", MODEL_OP_QUERY))
+    if status is None:
+        return False
+    if status["model_hash"] == model_hash:
+        print(f"FPGA already holds model {model_hash:08X} (slot {status['slot']}), nothing to send.")
+        return True
+
+    begin = struct.pack("<III", MODEL_OP_BEGIN, model_hash, len(tensors))
+    begin += b"".join(struct.pack("<II", s, c) for s, c in zip(sizes, crcs))
+    reply = model_request(begin)
+    if reply is None or reply["status"] != MODEL_STATUS_OK:
+        print("FPGA cannot stage this model.")
+        return False
+    needed = reply["mask"]
+    for _ in range(MODEL_COMMIT_TRIES):
+        ids = [i for i in range(len(tensors)) if needed >> i & 1]
+        print(f"Sending {len(ids)} of {len(tensors)} tensors: {ids}")
+        for i in ids:
+            send_tensor_fragments(i, tensors[i][1])
+        reply = model_request(struct.pack("<II", MODEL_OP_COMMIT, model_hash), MODEL_COMMIT_TIMEOUT)
+        if reply is None:
+            return False
+        if reply["status"] == MODEL_STATUS_OK:
+            print(f"FPGA switched to model {model_hash:08X} (slot {reply['slot']}, generation {reply['generation']}).")
+            return True
+        if reply["status"] != MODEL_STATUS_MISSING:
+            print(f"FPGA rejected model {model_hash:08X} (status {reply['status']}), previous model kept.")
+            return False
+        needed = reply["mask"]
+    return False
+
 if __name__ == "__main__":
     binary_file_path = "C:/Users/Zhenz/OneDrive/Desktop/ECE532/model_paramsNew.bin"
-    send_tensors_from_binary(binary_file_path)
-    listen_for_fpga_request()
\ No newline at end of file
+    # Pruned FC weights go out block sparse; a dense model is sent unchanged.
+    binary_file_path = sparsify_model_binary(binary_file_path, binary_file_path.replace(".bin", "_sparse.bin"))
+    upload_model(binary_file_path)
+    # ACC_PC_VAD=off, or energy,contrast,voiced columns,hangover: voice gate settings.
+    vad = os.environ.get("ACC_PC_VAD")
+    if vad == "off":
+        vad_control(enabled=0)
+    elif vad:
+        names = ("energy_threshold", "contrast_threshold", "min_voiced_columns", "hangover")
+        vad_control(enabled=1, **dict(zip(names, map(int, vad.split(",")))))
+    # ACC_PC_STREAM=<frames per update> streams instead of waiting for the button;
+    # ACC_PC_BATCH=<directory of WAV files> labels those recordings in batches.
+    if os.environ.get("ACC_PC_BATCH"):
+        label_recordings(os.environ["ACC_PC_BATCH"])
+    elif os.environ.get("ACC_PC_STREAM"):
+        stream_keywords(int(os.environ["ACC_PC_STREAM"]))
+    else:
+        listen_for_fpga_request()
\ No newline at end of file
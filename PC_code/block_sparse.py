@@ -0,0 +1,37 @@
+"""Block-sparse int8 weight encoding (dtype 10), read by parse_block_sparse in
+Microblaze/ACC.c.
+
+The one definition of the format, shared by the uploader (Input_weight.py)
+and the exporter and reader in ECE532Model.ipynb. A payload is the block
+size and the number of stored blocks (u32 little endian), an LSB-first bitmap
+with one bit per row block, and the stored blocks in row-major order, the
+last block of each row zero padded.
+"""
+import struct
+import numpy as np
+
+BLOCK_SPARSE_DTYPE = 10
+SPARSE_BLOCK_ELEMS = 36           # four 9-byte accelerator ops
+
+def encode_block_sparse(weights, block_elems=SPARSE_BLOCK_ELEMS):
+    """Block-sparse payload of a 2-D int8 matrix."""
+    rows, cols = weights.shape
+    blocks_per_row = -(-cols // block_elems)
+    padded = np.zeros((rows, blocks_per_row * block_elems), dtype=np.int8)
+    padded[:, :cols] = weights
+    blocks = padded.reshape(rows, blocks_per_row, block_elems)
+    keep = np.any(blocks != 0, axis=2)
+    bitmap = np.packbits(keep.reshape(-1), bitorder='little')
+    return struct.pack("<II", block_elems, int(keep.sum())) + bitmap.tobytes() + blocks[keep].tobytes()
+
+def decode_block_sparse(payload, shape):
+    """Dense int8 matrix of the given 2-D shape from a block-sparse payload."""
+    rows, cols = shape
+    block_elems, stored = struct.unpack("<II", payload[:8])
+    blocks_per_row = -(-cols // block_elems)
+    bitmap_bytes = (rows * blocks_per_row + 7) // 8
+    keep = np.unpackbits(np.frombuffer(payload[8:8 + bitmap_bytes], dtype=np.uint8),
+                         bitorder='little')[:rows * blocks_per_row].astype(bool)
+    blocks = np.zeros((rows * blocks_per_row, block_elems), dtype=np.int8)
+    blocks[keep] = np.frombuffer(payload[8 + bitmap_bytes:], dtype=np.int8).reshape(stored, block_elems)
+    return blocks.reshape(rows, blocks_per_row * block_elems)[:, :cols]
@@ -0,0 +1,118 @@
+"""Decodes the FPGA event ring (Microblaze/acc_log.h).
+
+    python event_log.py              fetch the ring from the board and print it
+    python event_log.py events.bin   print a dump written by acc_host (ACC_HOST_EVENTS)
+
+A dump is a LogDumpHeader followed by LogEvents. Over Ethernet the PC sends
+the sequence number to start from on LOG_ETHER_TYPE and the board answers
+with as many dump frames as it takes, the last one holding fewer than
+LOG_DUMP_EVENTS events.
+"""
+import os
+import sys
+import struct
+import queue
+
+LOG_ETHER_TYPE = 0x88BA
+LOG_DUMP_VERSION = 1
+# LogDumpHeader: version, timer_hz, events written since boot, sequence
+# number of the first event that follows, events that follow
+LOG_HEADER_FORMAT = "<5I"
+LOG_HEADER_SIZE = struct.calcsize(LOG_HEADER_FORMAT)
+# LogEvent: timestamp, id, arg0, arg1, arg2
+LOG_EVENT_FORMAT = "<IHHII"
+LOG_EVENT_SIZE = struct.calcsize(LOG_EVENT_FORMAT)
+LOG_DUMP_EVENTS = (1400 - LOG_HEADER_SIZE) // LOG_EVENT_SIZE
+LOG_FETCH_TIMEOUT = 2
+
+PERF_STAGES = ("load", "conv1", "conv2", "maxpool", "fc1", "fc2", "softmax")
+
+VAD_DECISIONS = ("silent", "voiced", "hangover")   # acc_vad.h
+
+def stage_name(stage):
+    return PERF_STAGES[stage] if stage < len(PERF_STAGES) else "stage %d" % stage
+
+# LogEventId in acc_log.h: name and how to print the three arguments
+EVENTS = {
+    1: ("boot", lambda a, b, c: ""),
+    2: ("fragment", lambda a, b, c: "tensor %d fragment %d, %d bytes" % (a, b, c)),
+    3: ("duplicate", lambda a, b, c: "tensor %d fragment %d" % (a, b)),
+    4: ("ack", lambda a, b, c: "tensor %d next %d selective %08X" % (a, b, c)),
+    5: ("reack", lambda a, b, c: "tensor %d next %d, repeat %d" % (a, b, c)),
+    6: ("nack", lambda a, b, c: "tensor %d fragment %d of %d" % (a, b, c)),
+    7: ("abandon", lambda a, b, c: "tensor %d at fragment %d of %d" % (a, b, c)),
+    8: ("tensor done", lambda a, b, c: "tensor %d, %d bytes in %d fragments" % (a, b, c)),
+    9: ("model control", lambda a, b, c: "op %d status %d mask %08X" % (a, b, c)),
+    10: ("model active", lambda a, b, c: "slot %d model %08X generation %d" % (a, b, c)),
+    11: ("request", lambda a, b, c: ""),
+    12: ("inference begin", lambda a, b, c: ""),
+    13: ("layer done", lambda a, b, c: stage_name(a)),
+    14: ("inference end", lambda a, b, c: "class %d, probability %d" % (a, b)),
+    15: ("backend mismatch", lambda a, b, c: "%s: %d of %d outputs differ" % (stage_name(a), b, c)),
+    16: ("voice gate", lambda a, b, c: "%s, level %d floor %d, %d voiced columns"
+                                       % (VAD_DECISIONS[a] if a < len(VAD_DECISIONS) else a, b >> 16, b & 0xFFFF, c)),
+}
+
+def parse_dump(data):
+    """Header fields and the (timestamp, id, arg0, arg1, arg2) events of one dump."""
+    if len(data) < LOG_HEADER_SIZE:
+        raise ValueError("dump shorter than its header")
+    header = struct.unpack_from(LOG_HEADER_FORMAT, data)
+    version, timer_hz, written, first, count = header
+    if version != LOG_DUMP_VERSION:
+        raise ValueError("unknown dump version %d" % version)
+    count = min(count, (len(data) - LOG_HEADER_SIZE) // LOG_EVENT_SIZE)
+    events = [struct.unpack_from(LOG_EVENT_FORMAT, data, LOG_HEADER_SIZE + i * LOG_EVENT_SIZE)
+              for i in range(count)]
+    return header, events
+
+def fetch_events(iface, dest_mac, src_mac, first=0):
+    """Reads the ring from the board; returns a header covering all events and the events."""
+    from scapy.all import Ether, AsyncSniffer, sendp
+    frames = queue.Queue()
+    sniffer = AsyncSniffer(iface=iface, store=False,
+                           lfilter=lambda pkt: pkt.haslayer(Ether) and pkt[Ether].type == LOG_ETHER_TYPE
+                                               and pkt[Ether].src.lower() == dest_mac.lower(),
+                           prn=lambda pkt: frames.put(bytes(pkt[Ether].payload)))
+    sniffer.start()
+    try:
+        sendp(Ether(dst=dest_mac, src=src_mac, type=LOG_ETHER_TYPE) / struct.pack("<I", first),
+              iface=iface, verbose=False)
+        start, events = None, []
+        while True:
+            try:
+                header, chunk = parse_dump(frames.get(timeout=LOG_FETCH_TIMEOUT))
+            except queue.Empty:
+                raise TimeoutError("no event dump from the FPGA")
+            if start is None:
+                start = header[3]
+            events.extend(chunk)
+            if len(chunk) < LOG_DUMP_EVENTS:
+                return header[:3] + (start, len(events)), events
+    finally:
+        sniffer.stop()
+
+def print_events(header, events):
+    version, timer_hz, written, first, count = header
+    print("%d events since boot, showing %d from #%d" % (written, len(events), first))
+    elapsed = 0
+    previous = events[0][0] if events else 0
+    for i, (timestamp, event_id, a, b, c) in enumerate(events):
+        # The timer is 32 bits; unwrap it from one event to the next.
+        delta = (timestamp - previous) & 0xFFFFFFFF
+        elapsed += delta
+        previous = timestamp
+        name, describe = EVENTS.get(event_id, ("event %d" % event_id, lambda a, b, c: "%d %d %d" % (a, b, c)))
+        print("#%-7d %12.3f ms  +%9.3f ms  %-16s %s" % (first + i, 1000.0 * elapsed / timer_hz,
+                                                        1000.0 * delta / timer_hz, name, describe(a, b, c)))
+    if first > 0:
+        print("(%d older events were overwritten)" % first)
+
+if __name__ == "__main__":
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], "rb") as f:
+            header, events = parse_dump(f.read())
+    else:
+        interface = os.environ.get("ACC_PC_IFACE", "\\Device\\NPF_{FB02CD7F-5E2D-4937-9D17-ADF4E6CA12C5}")
+        header, events = fetch_events(interface, "02:AA:BB:CC:DD:EE", "9C:EB:E8:AE:7E:F5")
+    print_events(header, events)
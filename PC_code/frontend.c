@@ -0,0 +1,225 @@
+/*
+ * frontend.c
+ *   Incremental spectrogram frontend for Input_weight.py (through frontend.py).
+ *
+ *   Computes the quantized spectrogram preprocess_for_fpga produces, but
+ *   frame by frame while the audio arrives instead of over the whole second
+ *   afterwards: every FRAME_STEP samples the newest FRAME_LEN-sample frame is
+ *   windowed (periodic Hann, scipy's default), transformed (FFT_LEN-point
+ *   radix-2 FFT), turned into log magnitude, normalized and resized from
+ *   FFT_BINS to FRONTEND_HEIGHT frequency rows. The resize is cv2's
+ *   INTER_CUBIC (A = -0.75, half-pixel centres, edge pixels replicated).
+ *
+ *   Utterance mode (frames > 0) also stretches those frames to 'columns'
+ *   time columns like the cv2 resize does. A column goes out as soon as the
+ *   four frames under its cubic kernel are in, so the last one is ready
+ *   right after the last frame. Streaming mode (frames = 0) emits one
+ *   column per frame (spectrogram_column).
+ *
+ *   Columns are FRONTEND_HEIGHT bytes, low frequency first, quantized as
+ *   clip(x / scale + zero_point, 0, 255) truncated to a byte.
+ *
+ *   Build: gcc -O2 -shared -fPIC -o libfrontend.so frontend.c -lm
+ *          (Windows: gcc -O2 -shared -o frontend.dll frontend.c)
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+#define FRONTEND_API __declspec(dllexport)
+#else
+#define FRONTEND_API
+#endif
+
+#define FRAME_LEN         255
+#define FRAME_STEP        128
+#define FFT_LEN           256
+#define FFT_BINS          (FFT_LEN / 2 + 1)     // 129
+#define FRONTEND_HEIGHT   124
+#define CUBIC_A           -0.75f
+
+typedef struct {
+    int frames;                 // frames of an utterance, 0 when streaming
+    int columns;                // time columns they are resized to
+    double mean, std, scale;
+    int zero_point;
+
+    double window[FRAME_LEN];
+    double cos_table[FFT_LEN / 2], sin_table[FFT_LEN / 2];
+    int bit_reverse[FFT_LEN];
+    int row_tap[FRONTEND_HEIGHT][4];            // frequency resize: source bins
+    float row_coeff[FRONTEND_HEIGHT][4];
+
+    int16_t samples[FRAME_LEN];                 // the current frame, oldest first
+    int have;                                   // samples in it
+    int frame;                                  // frames completed
+    int column;                                 // utterance columns emitted
+    double *rows;                               // utterance: frames x FRONTEND_HEIGHT, normalized
+} Frontend;
+
+// cv2's interpolateCubic.
+static void cubic_coeffs(float x, float c[4]) {
+    c[0] = ((CUBIC_A * (x + 1) - 5 * CUBIC_A) * (x + 1) + 8 * CUBIC_A) * (x + 1) - 4 * CUBIC_A;
+    c[1] = ((CUBIC_A + 2) * x - (CUBIC_A + 3)) * x * x + 1;
+    c[2] = ((CUBIC_A + 2) * (1 - x) - (CUBIC_A + 3)) * (1 - x) * (1 - x) + 1;
+    c[3] = 1.f - c[0] - c[1] - c[2];
+}
+
+// Source taps and weights of destination pixel d when resizing src to dst pixels.
+static void cubic_taps(int d, int src, int dst, int tap[4], float c[4]) {
+    float f = (float)((d + 0.5) * (1.0 / ((double)dst / src)) - 0.5);
+    int s = (int)floorf(f);
+    cubic_coeffs(f - s, c);
+    for (int k = 0; k < 4; k++) {
+        int t = s - 1 + k;
+        tap[k] = t < 0 ? 0 : (t >= src ? src - 1 : t);
+    }
+}
+
+FRONTEND_API void frontend_reset(Frontend *fe) {
+    fe->have = 0;
+    fe->frame = 0;
+    fe->column = 0;
+}
+
+FRONTEND_API void frontend_destroy(Frontend *fe) {
+    if (!fe) return;
+    free(fe->rows);
+    free(fe);
+}
+
+/*
+ * frontend_create:
+ *   frames > 0: utterances of that many frames, resized to 'columns'
+ *   columns; frames = 0: streaming. Returns NULL when out of memory.
+ */
+FRONTEND_API Frontend *frontend_create(int frames, int columns, double mean, double std,
+                                       double scale, int zero_point) {
+    Frontend *fe = (Frontend *)calloc(1, sizeof(Frontend));
+    if (!fe) return NULL;
+    fe->frames = frames > 0 ? frames : 0;
+    fe->columns = fe->frames ? columns : 0;
+    fe->mean = mean;
+    fe->std = std;
+    fe->scale = scale;
+    fe->zero_point = zero_point;
+    if (fe->frames) {
+        fe->rows = (double *)malloc(sizeof(double) * fe->frames * FRONTEND_HEIGHT);
+        if (!fe->rows) {
+            free(fe);
+            return NULL;
+        }
+    }
+
+    for (int n = 0; n < FRAME_LEN; n++) fe->window[n] = 0.5 - 0.5 * cos(2.0 * M_PI * n / FRAME_LEN);
+    for (int k = 0; k < FFT_LEN / 2; k++) {
+        fe->cos_table[k] = cos(2.0 * M_PI * k / FFT_LEN);
+        fe->sin_table[k] = -sin(2.0 * M_PI * k / FFT_LEN);
+    }
+    for (int i = 0; i < FFT_LEN; i++) {
+        int r = 0;
+        for (int b = 1, v = i; b < FFT_LEN; b <<= 1, v >>= 1) r = (r << 1) | (v & 1);
+        fe->bit_reverse[i] = r;
+    }
+    for (int r = 0; r < FRONTEND_HEIGHT; r++) cubic_taps(r, FFT_BINS, FRONTEND_HEIGHT, fe->row_tap[r], fe->row_coeff[r]);
+    frontend_reset(fe);
+    return fe;
+}
+
+static uint8_t quantize(const Frontend *fe, double x) {
+    double q = x / fe->scale + fe->zero_point;
+    if (q < 0) q = 0;
+    if (q > 255) q = 255;
+    return (uint8_t)q;
+}
+
+// Normalized log magnitude of the current frame, resized to FRONTEND_HEIGHT rows.
+static void frame_rows(const Frontend *fe, double *rows) {
+    double re[FFT_LEN], im[FFT_LEN], bins[FFT_BINS];
+    for (int i = 0; i < FFT_LEN; i++) {
+        int n = fe->bit_reverse[i];
+        re[i] = n < FRAME_LEN ? fe->samples[n] / 32768.0 * fe->window[n] : 0.0;
+        im[i] = 0.0;
+    }
+    for (int half = 1; half < FFT_LEN; half <<= 1) {
+        int step = FFT_LEN / (2 * half);
+        for (int start = 0; start < FFT_LEN; start += 2 * half) {
+            for (int k = 0; k < half; k++) {
+                double wr = fe->cos_table[k * step], wi = fe->sin_table[k * step];
+                int a = start + k, b = a + half;
+                double tr = re[b] * wr - im[b] * wi;
+                double ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+    for (int k = 0; k < FFT_BINS; k++) {
+        bins[k] = (log(sqrt(re[k] * re[k] + im[k] * im[k]) + 1e-8) - fe->mean) / fe->std;
+    }
+    for (int r = 0; r < FRONTEND_HEIGHT; r++) {
+        double v = 0.0;
+        for (int k = 0; k < 4; k++) v += fe->row_coeff[r][k] * bins[fe->row_tap[r][k]];
+        rows[r] = v;
+    }
+}
+
+// Utterance columns whose frames are all in, into out; returns how many.
+static int emit_columns(Frontend *fe, uint8_t *out, int max_columns) {
+    int n = 0;
+    while (fe->column < fe->columns && n < max_columns) {
+        int tap[4];
+        float c[4];
+        cubic_taps(fe->column, fe->frames, fe->columns, tap, c);
+        if (tap[3] >= fe->frame) break;
+        for (int r = 0; r < FRONTEND_HEIGHT; r++) {
+            double v = 0.0;
+            for (int k = 0; k < 4; k++) v += c[k] * fe->rows[tap[k] * FRONTEND_HEIGHT + r];
+            out[n * FRONTEND_HEIGHT + r] = quantize(fe, v);
+        }
+        fe->column++;
+        n++;
+    }
+    return n;
+}
+
+/*
+ * frontend_push:
+ *   Feeds samples; writes the columns that became ready to out (up to
+ *   max_columns, FRONTEND_HEIGHT bytes each) and returns how many. Samples
+ *   past the end of an utterance are ignored; frontend_reset starts the next.
+ *   An utterance column left over because out was full comes with the next
+ *   call; when streaming, out needs room for count / FRAME_STEP + 1 columns.
+ */
+FRONTEND_API int frontend_push(Frontend *fe, const int16_t *samples, int count, uint8_t *out, int max_columns) {
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        if (fe->frames && fe->frame >= fe->frames) break;
+        fe->samples[fe->have++] = samples[i];
+        if (fe->have < FRAME_LEN) continue;
+
+        double rows[FRONTEND_HEIGHT];
+        frame_rows(fe, rows);
+        if (fe->frames) {
+            memcpy(&fe->rows[fe->frame * FRONTEND_HEIGHT], rows, sizeof(rows));
+        } else if (n < max_columns) {
+            for (int r = 0; r < FRONTEND_HEIGHT; r++) out[n * FRONTEND_HEIGHT + r] = quantize(fe, rows[r]);
+            n++;
+        }
+        fe->frame++;
+        memmove(fe->samples, fe->samples + FRAME_STEP, (FRAME_LEN - FRAME_STEP) * sizeof(int16_t));
+        fe->have = FRAME_LEN - FRAME_STEP;
+        if (fe->frames) n += emit_columns(fe, out + n * FRONTEND_HEIGHT, max_columns - n);
+    }
+    if (fe->frames) n += emit_columns(fe, out + n * FRONTEND_HEIGHT, max_columns - n);
+    return n;
+}
+
+FRONTEND_API int frontend_height(void) {
+    return FRONTEND_HEIGHT;
+}
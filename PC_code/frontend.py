@@ -0,0 +1,71 @@
+"""ctypes binding of the native spectrogram frontend (frontend.c).
+
+    gcc -O2 -shared -fPIC -o libfrontend.so frontend.c -lm      (Linux)
+    gcc -O2 -shared -o frontend.dll frontend.c                  (Windows)
+
+load() returns None when the library has not been built; Input_weight.py
+then keeps its numpy/cv2 path.
+"""
+import os
+import ctypes
+import numpy as np
+
+_LIBRARY_NAMES = ("frontend.dll", "libfrontend.so", "libfrontend.dylib")
+
+class Frontend:
+    """Quantized spectrogram columns from int16 samples as they are recorded.
+       frames > 0: one utterance of that many STFT frames, stretched to
+       'columns' time columns; frames = 0: one column per frame."""
+    def __init__(self, lib, frames, columns, mean, std, scale, zero_point):
+        self._lib = lib
+        self._handle = lib.frontend_create(frames, columns, mean, std, scale, zero_point)
+        if not self._handle:
+            raise MemoryError("frontend_create failed")
+        self.height = lib.frontend_height()
+
+    def push(self, samples):
+        """Feeds int16 samples; returns the columns that became ready as a
+           (height, n) uint8 array."""
+        samples = np.ascontiguousarray(samples, dtype=np.int16)
+        room = len(samples) // 128 + 4
+        out = np.empty((room, self.height), dtype=np.uint8)
+        n = self._lib.frontend_push(self._handle, samples.ctypes.data_as(ctypes.POINTER(ctypes.c_int16)),
+                                    len(samples), out.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8)), room)
+        return out[:n].T
+
+    def reset(self):
+        self._lib.frontend_reset(self._handle)
+
+    def __del__(self):
+        if getattr(self, "_handle", None):
+            self._lib.frontend_destroy(self._handle)
+            self._handle = None
+
+_lib = None
+
+def load():
+    """The frontend library from this directory, or None if it is not built."""
+    global _lib
+    if _lib is None:
+        here = os.path.dirname(os.path.abspath(__file__))
+        for name in _LIBRARY_NAMES:
+            path = os.path.join(here, name)
+            if os.path.exists(path):
+                lib = ctypes.CDLL(path)
+                lib.frontend_create.restype = ctypes.c_void_p
+                lib.frontend_create.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_double, ctypes.c_double,
+                                                ctypes.c_double, ctypes.c_int]
+                lib.frontend_push.restype = ctypes.c_int
+                lib.frontend_push.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_int16), ctypes.c_int,
+                                              ctypes.POINTER(ctypes.c_uint8), ctypes.c_int]
+                lib.frontend_reset.argtypes = [ctypes.c_void_p]
+                lib.frontend_destroy.argtypes = [ctypes.c_void_p]
+                lib.frontend_height.restype = ctypes.c_int
+                _lib = lib
+                break
+    return _lib
+
+def create(frames, columns, mean, std, scale, zero_point):
+    """A Frontend, or None when the library is not built."""
+    lib = load()
+    return Frontend(lib, frames, columns, mean, std, scale, zero_point) if lib else None